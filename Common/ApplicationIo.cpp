@@ -12,6 +12,10 @@
 #include <IppSupport_Mb.h>              // IPP (fast calculation) support (unused)
 #include <IppIntegerDG_Mb.h>            // IPP (fast calculation) Datagram support (unused)
 #include "ApplicationIo.h"              // MPD main header file
+#include "IngestBenchmark.h"            // Board-free ingest benchmarks
+#include "ReplaySource.h"               // Data.bin playback into the ingest path
+#include "VitaParser.h"                 // Offline parse of a capture file
+#include "FrameReader.h"                // ...and random access to its frames
 #include <SystemSupport_Mb.h>           // II system support utils
 #include <StringSupport_Mb.h>           // II string support utils
 #include <limits>                       // C standcard ?
@@ -36,6 +40,7 @@
 #include <PacketFileDataSet_Mb.h>       // Parse binary disk file
 #include <FileDataSet_Mb.h>             // Parse binary disk file
 #include <vector>                       // stl::vector object
+#include <chrono>                       // Replay polling interval
 #include <cuda.h>                       // General CUDA utils
 #include <cuda_runtime.h>               // Copy to GPU (gpuMemCpy)
 
@@ -66,7 +71,8 @@ ApplicationIo::ApplicationIo(IUserInterface * ui)
     : FiclIo(ui), UI(ui),
       Opened(false), StreamConnected(false), Stopped(true),
       FBlockRate(0.0f), FWordCount(0), SamplesPerWord(1),
-      WordsToLog(0), Time(6), BytesPerBlock(6)
+      WordsToLog(0), Time(6), BytesPerBlock(6),
+      StopRequested(false), CaptureFull(false), Following(false)
 {
     TraceVerbosity(Trace::vNormal);
 
@@ -75,6 +81,7 @@ ApplicationIo::ApplicationIo(IUserInterface * ui)
 	
 	OnLog.SetEvent(this, &ApplicationIo::HandleOnLog);
     Module.OnLog.SetEvent(this, &ApplicationIo::HandleOnLog);
+    Module.OnInputTrigger.SetEvent(this, &ApplicationIo::HandleInputTrigger);
 
     // Use IPP performance memory functions.
 	Init::UsePerformanceMemoryFunctions();
@@ -132,8 +139,9 @@ ApplicationIo::ApplicationIo(IUserInterface * ui)
 
 ApplicationIo::~ApplicationIo()
 {
-	free(arrch1);
-	free(arrch2);
+	Ingest.Stop();
+	Follower.Stop();
+	ReleaseCaptureBuffers();
 	Close();
 }
 
@@ -219,6 +227,10 @@ void  ApplicationIo::Open()
     Module().Reset();
     UI->Log("Module Device opened successfully...");
     Opened = true;
+    //  Kept for exports made with the board closed
+    Settings.InputSpan = static_cast<float>(Module().Input().Info().Span().Delta());
+    Settings.InputBits = Module().Input().Info().Bits();
+    Settings.InputSamplesPerWord = Module().Input().Info().SamplesPerWord();
 
 
     //  Connect Stream
@@ -228,107 +240,8 @@ void  ApplicationIo::Open()
 
 	DisplayLogicVersion();
 
-// Initializes two arrays (declared in ApplicationIo.h) for storing channelized data 
-//	as well as two counters
-
-	int const sz = Settings.SamplesToLog/2;
-	arrch1 = new short [sz];
-	arrch2 = new short [sz];
-
-	cntrch1 = 0;
-	cntrch2 = 0;
-
-//+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++//
-//+++++++++++++++++++++++++++++++++ NOT WORKING +++++++++++++++++++++++++++++++++++//
-//+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++//
-
-// This section of code configured two mxArrays to store data directly instead of using an
-// intermediate C array. Never got it to work properly. In theory this technique could be
-// more efficient.
-/*
-	cntrch1 = 0;
-	cntrch2 = 0;
-   	int rows = Settings.FrameSize;
-	int cols = Settings.SamplesToLog/(rows);
-
-	mwSize const dims[2] = {rows,cols};
-	mwSize const dim = 2;
-
-	mxarrch1 = mxCreateNumericArray(dim,dims,mxINT16_CLASS,mxREAL);
-	mxarrch2 = mxCreateNumericArray(dim,dims,mxINT16_CLASS,mxREAL);
-
-//	mxarrch1 = mxCreateNumericMatrix(rows,cols,mxINT16_CLASS,mxREAL);
-//	mxarrch2 = mxCreateNumericMatrix(rows,cols,mxINT16_CLASS,mxREAL);
-*/
-
-
-// This section of code configured two mxGPUArrays to store data directly instead of using an
-// intermediate C array. Never got it to work properly. In theory this technique could be
-// more efficient.
-/*
-	int rows = Settings.FrameSize;
-	int cols = Settings.SamplesToLog/(2*rows);
-
-	mwSize const dims[2] = {rows,cols};
-	mwSize const dim = 2;
-	asdfgpuch1asdf = mxGPUCreateGPUArray(dim,dims,mxINT16_CLASS,mxREAL,MX_GPU_DO_NOT_INITIALIZE);
-	asdfgpuch2asdf = mxGPUCreateGPUArray(dim,dims,mxINT16_CLASS,mxREAL,MX_GPU_DO_NOT_INITIALIZE);
-	short * agpuch1a = (short *) mxGPUGetData(asdfgpuch1asdf);
-	short * agpuch2a = (short *) mxGPUGetData(asdfgpuch2asdf);
-*/
-//	int rows = Settings.FrameSize;
-//	int cols = Settings.SamplesToLog/(2*rows);
-
-//	mwSize const dims[2] = {rows,cols};
-//	mwSize const dim = 2;
-//	asdfgpuch1asdf = mxGPUCreateGPUArray(dim,dims,mxINT16_CLASS,mxREAL,MX_GPU_DO_NOT_INITIALIZE);
-//	asdfgpuch2asdf = mxGPUCreateGPUArray(dim,dims,mxINT16_CLASS,mxREAL,MX_GPU_DO_NOT_INITIALIZE);
-
-//	int cntrch1 = 0;
-//	int cntrch2 = 0;
-	
-//	int rows = Settings.FrameSize;
-//	int cols = Settings.SamplesToLog/(2*rows);
-
-//	mxarrch1 = mxCreateNumericArray(dim,dims,mxINT16_CLASS,mxREAL);
-//	mxarrch1 = mxCreateNumericMatrix(rows,cols,mxINT16_CLASS,mxREALa);
-//	short * mxptrch1 = (short *) mxGetData(ApplicationIo::mxarrch1);
-
-//	mxarrch2 = mxCreateNumericArray(dim,dims,mxINT16_CLASS,mxREAL);
-//	mxarrch2 = mxCreateNumericMatrix(rows,cols,mxINT16_CLASS,mxREAL);
-//	short * mxptrch2 = (short *) mxGetData(mxarrch2);
-//	Log("arrays created");
-//	mexPrintf("ptrch1: %x\n",mxptrch1);
-//	mexPrintf("ptrch2: %x\n",mxptrch2);
-
-/*
-	int rows = Settings.FrameSize;
-	int cols = Settings.SamplesToLog/(2*rows);
-
-	mwSize const dims[2] = {rows,cols};
-	mwSize const dim = 2;
-//	asdfgpuch1asdf = mxGPUCreateGPUArray(dim,dims,mxINT16_CLASS,mxREAL,MX_GPU_DO_NOT_INITIALIZE);
-//	asdfgpuch2asdf = mxGPUCreateGPUArray(dim,dims,mxINT16_CLASS,mxREAL,MX_GPU_DO_NOT_INITIALIZE);
-
-	int cntrch1 = 0;
-	int cntrch2 = 0;
-	
-//	int rows = Settings.FrameSize;
-//	int cols = Settings.SamplesToLog/(2*rows);
-
-//	mxarrch1 = mxCreateNumericArray(dim,dims,mxINT16_CLASS,mxREAL);
-	mxarrch1 = mxCreateNumericMatrix(rows,cols,mxINT16_CLASS,mxREAL);
-	mxptrch1 = (short *) mxGetData(mxarrch1);
-
-//	mxarrch2 = mxCreateNumericArray(dim,dims,mxINT16_CLASS,mxREAL);
-	mxarrch2 = mxCreateNumericMatrix(rows,cols,mxINT16_CLASS,mxREAL);
-	mxptrch2 = (short *) mxGetData(mxarrch2);
-	Log("arrays created");
-
-	mexPrintf("ptrch1: %x\n",mxptrch1);
-	mexPrintf("ptrch2: %x\n",mxptrch2);
-*/
-//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++//
+// Channelized capture buffers are sized per active channel in StartStreaming(),
+// as persistent mxArrays the packets are copied into directly.
 }
 
 //---------------------------------------------------------------------------
@@ -360,9 +273,6 @@ void  ApplicationIo::StartStreaming()
         Log("Stream not connected! -- Open the boards");
         return;
         }
-	cntrch1 = 0;
-	cntrch2 = 0;
-
 
     //  Set up Parameters for Data Streaming
     //  First have UI get settings into our settings store
@@ -391,7 +301,11 @@ void  ApplicationIo::StartStreaming()
 
     FWordCount = 0;
     SamplesPerWord = Module().Input().Info().SamplesPerWord();
-    WordsToLog = Settings.SamplesToLog / SamplesPerWord;
+    //  The recorder runs until stopped or frozen, not to a sample count
+    if (Settings.CaptureMode != ApplicationSettings::cmFill)
+        WordsToLog = 0;
+    else
+        WordsToLog = Settings.SamplesToLog / SamplesPerWord;
 
     FBlockRate = 0;
 
@@ -439,6 +353,13 @@ void  ApplicationIo::StartStreaming()
         return;
         }
 
+    //  Capture buffers and routing table for the enabled channels
+    Following = Settings.CaptureMode == ApplicationSettings::cmFollow && CanFollowDiskLog();
+    if (Settings.CaptureMode == ApplicationSettings::cmFollow && !Following)
+        Log("CaptureMode follow needs an uncompressed, unstriped DiskLog; recording from the stream");
+    Ingest.Stop();
+    AllocateCaptureBuffers();
+
     //  Always preconfigure
     Stream.Preconfigure();
 
@@ -488,13 +409,37 @@ void  ApplicationIo::StartStreaming()
 			Graph.Quit();
 		}
 
-	if (Settings.LoggerEnable || Settings.PlotEnable)
+	if (Settings.ColumnLog && !OpenColumnLog(false))
+		{
+		UI->AfterStreamAutoStop();
+		return;
+		}
+
+	if (Settings.DiskLog)
+		{
+		if (!OpenDiskLog())
+			{
+			CloseColumnLog();
+			UI->AfterStreamAutoStop();
+			return;
+			}
+		if (Following)
+			StartFollower();
+		}
+	else if (Settings.LoggerEnable || Settings.PlotEnable)
 		{
 			Logger.Start();
 		}
 
 	Trig.AtStreamStart();
 
+    //  Start ingest workers ahead of the first packet
+    StopRequested = false;
+    FStats.Reset();
+    Ingest.WaitHistogram(&FStats.QueueWait);
+    Ingest.Start(std::max(Settings.IngestThreads, 1), std::max(Settings.IngestQueueDepth, 2),
+        [this](IngestBufferPtr & Packet, unsigned int worker) {  ProcessPacket(Packet, worker);  });
+
     //  Start Streaming
     Stopped = false;
     Stream.Start();
@@ -532,106 +477,124 @@ void  ApplicationIo::StopStreaming()
 //---------------------------------------------------------------------------
 //  ApplicationIo::HandleDataAvailable() --  Handle received packet
 //---------------------------------------------------------------------------
+//  Runs on the stream callback thread: dequeue the buffer and hand it to
+//  the ingest workers, nothing more.  A full worker queue drops the buffer
+//  and is counted rather than stalling the driver.
 
 void  ApplicationIo::HandleDataAvailable(VitaPacketStreamDataEvent & Event)
 {
 	if (Stopped)
         return;
 
-	VeloBuffer Packet;
-
-	Event.Sender->Recv(Packet);	
-
-//	int const sz = Settings.SamplesToLog/2;
-//	arrch1 = new short [sz];
-//	arrch2 = new short [sz];
-
-
-//	FWordCount += Packet.SizeInInts();
-//	IntegerDG Packet_DG(Packet);
-//    TallyBlock(Packet_DG.size()*sizeof(int));
-//    if (Settings.LoggerEnable)
-//		if (WordsToLog==0 || (FWordCount < WordsToLog))
-//		{
-//			Logger.LogWithHeader(Packet);
-			//
-			//  Extract the packet from the Incoming Queue...
-			// Attempt to parse in "real time"
-	VitaCursor currentVita(Packet,0);
-	unsigned short vitsize(0);
-	int vitsid(0);
-//			short * agpuch1a = (short *) mxGPUGetData(asdfgpuch1asdf);
-//			short * agpuch2a = (short *) mxGPUGetData(asdfgpuch2asdf);
-//			mexPrintf("address is: %x \n",agpuch1a);
-//			mexPrintf("address is: %x \n",agpuch2a);
-	for (;;)
-	{
+	IngestBufferPtr Packet(new IngestBuffer);
+	Event.Sender->Recv(Packet->Buffer);
+	Receive(Packet);
 
-		if (!currentVita.isValid())
-		{
-			mxArray *dd;
-			dd = mxCreateDoubleScalar(1);
-			mexPutVariable("base","notok",dd);
-			mxDestroyArray(dd);
-			Log("broke since current vita is not valid!:");
-			break;
-		}
-	
-		vitsize = currentVita.PacketSize();
-		vitsid = currentVita.Sid();
-		AccessDatagram<short> DG(currentVita.Data());
+	ServiceAutoStop();
+}
+
+//---------------------------------------------------------------------------
+//  ApplicationIo::Receive() --  Ingest entry point for every packet source
+//---------------------------------------------------------------------------
 
-// Check Vitas for channelization
-		if (vitsid != 256 && vitsid !=257)
+void  ApplicationIo::Receive(IngestBufferPtr & Packet)
+{
+	FStats.Arrived();
+	Ingest.Push(Packet);
+}
+
+//---------------------------------------------------------------------------
+//  ApplicationIo::ProcessPacket() --  Channelize a buffer on a worker thread
+//---------------------------------------------------------------------------
+
+void  ApplicationIo::ProcessPacket(IngestBufferPtr & Packet, unsigned int worker)
+{
+	IntegerDG Packet_DG(Packet->Buffer);
+	const size_t count = Packet->Words.empty() ? Packet_DG.size() : Packet->Words.size();
+	if (!count)
+		return;
+	const unsigned int * words = Packet->Words.empty() ?
+		reinterpret_cast<const unsigned int *>(&Packet_DG[0]) : &Packet->Words[0];
+
+	//  Every worker is handed every buffer; one counts what was delivered,
+	//  from the board or a replay, whether or not it is captured
+	if (worker == 0)
+		FStats.BufferBytes.Record(count*sizeof(int));
+
+	//  The raw stream goes to disk in arrival order, from one worker only.
+	//  This is a copy into the writer's pool; the I/O is on its own thread.
+	//  Buffers that made it get their packets added to the .vidx, at their
+	//  offset in the stream before any compression.
+	if (worker == 0 && Segments.IsOpen())
 		{
-			break;
-		};
-		
-		if (vitsid == 256)
+		VitaIndex & index = Packet->Index;
+		std::call_once(Packet->Scanned, [&]() {  index.Scan(words, count);  });
+		Segments.Write(words, count*sizeof(int), &index);
+		}
+	else if (worker == 0 && Disk.IsOpen())
 		{
-			if (Settings.LoggerEnable)
-				if (WordsToLog==0 || (FWordCount < WordsToLog))
-				{
-//					mexPrintf("ptr: %x\n",mxptrch1);
-//					Log("cntrch1: "+IntToString(cntrch1));
-					FWordCount += DG.SizeInInts();
-					memcpy(&(arrch1[cntrch1]),&DG[0],DG.size()*sizeof(short));
-//	GPU direct		cudaMemcpy(agpuch1a+cntrch1*sizeof(short),&DG[0],DG.size()*sizeof(short),cudaMemcpyHostToDevice);
-//	Vector			asdfch1asdf.insert(asdfch1asdf.end(),DG.begin(),DG.end());
-					cntrch1 += DG.SizeInElements();
-					TallyBlock(DG.size()*sizeof(short));
+		const bool packed = Compressor.IsOpen();
+		const unsigned long long position = packed ? Compressor.Bytes() : Disk.Bytes();
+		const bool written = packed ? Compressor.Write(words, count*sizeof(int)) : Disk.Write(words, count*sizeof(int));
+		if (written && DiskIndex.IsOpen())
+			{
+			VitaIndex & index = Packet->Index;
+			std::call_once(Packet->Scanned, [&]() {  index.Scan(words, count);  });
+			DiskIndex.Append(index, position);
+			}
+		}
 
-				}
-				
-				
-				/*
-				for (size_t j = 0; j<DG.SizeInElements(); ++j)
-				{
-				asdfch1asdf.push_back(DG[j]);
-				}
-				*/
-				
+	const bool capture = Settings.LoggerEnable && !IsDataLoggingCompleted();
+	const bool columns = worker < Columns.size() && Columns[worker]->Count();
+	if (!capture && !columns)
+		return;
+
+	//  Index the VITA headers once per buffer, then route every packet to
+	//  this worker's channels.  Packets with unknown SIDs are skipped and
+	//  counted.
+	const long long start = HiResTimer::Ticks();
+	VitaIndex & index = Packet->Index;
+	std::call_once(Packet->Scanned, [&]() {  index.Scan(words, count);  });
+	size_t bytes = 0;
+	if (capture)
+		{
+		bytes = Demux[worker].Process(index, words);
+		FStats.Channelize.Record(IngestStats::Nanoseconds(HiResTimer::Ticks() - start));
 		}
-		
-		if (vitsid == 257)
+
+	//  Column files of the streams dealt to this worker, headers stripped
+	if (columns)
+		Columns[worker]->Process(index, words);
+	if (!capture)
+		return;
+
+	std::lock_guard<std::mutex> lock(TallyLock);
+	if (!WorkerFull[worker] && Demux[worker].Full())
 		{
-			if (Settings.LoggerEnable)
-				if (WordsToLog==0 || (FWordCount < WordsToLog))
-				{
-//					Log("cntrch2: "+IntToString(cntrch2));
-					FWordCount += DG.SizeInInts();
-//	Vector			asdfch2asdf.insert(asdfch2asdf.end(),DG.begin(),DG.end());
-//	GPU direct		cudaMemcpy(agpuch2a+cntrch2*sizeof(short),&DG[0],DG.size()*sizeof(short),cudaMemcpyHostToDevice);
-					memcpy(&(arrch2[cntrch2]),&DG[0],DG.size()*sizeof(short));
-					TallyBlock(DG.size()*sizeof(short));	
-					cntrch2 += DG.SizeInElements();
-					
-				}
+		WorkerFull[worker] = true;
+		CaptureFull = std::find(WorkerFull.begin(), WorkerFull.end(), 0) == WorkerFull.end();
 		}
-		currentVita.advance();
-	}
+	FWordCount += bytes/sizeof(int);
+	TallyBlock(bytes);
 }
 
+//---------------------------------------------------------------------------
+//  ApplicationIo::ServiceAutoStop() --  Act on a stop raised by a worker
+//---------------------------------------------------------------------------
+//  Workers never stop the stream themselves, since HandleAfterStop joins
+//  them.  The request is picked up on the callback or timer thread.
+
+void  ApplicationIo::ServiceAutoStop()
+{
+	if (!StopRequested.exchange(false))
+		return;
+
+	if (!Stopped)
+		{
+		StopStreaming();
+		Log("Stream Mode Stopped automatically");
+		}
+}
 
 //---------------------------------------------------------------------------
 //  ApplicationIo::HandleSplitComplete() --  
@@ -682,9 +645,8 @@ void  ApplicationIo::TallyBlock(size_t bytes)
     //  Stop streaming when both Channels have passed their limit
     if (Settings.AutoStop && IsDataLoggingCompleted() && !Stopped)
         {
-        // Stop counter and display it
-        StopStreaming();
-        Log("Stream Mode Stopped automatically");
+        // Serviced off the worker thread, see ServiceAutoStop()
+        StopRequested = true;
 //        Log(std::string("Elasped (S): ") + FloatToString(elapsed));
         }
 
@@ -750,10 +712,12 @@ void ApplicationIo::HandleAfterStreamStop(OpenWire::NotifyEvent & /*Event*/)
 
 void ApplicationIo::HandleAfterStop(OpenWire::NotifyEvent & /*Event*/)
 {
+    const bool disk = Disk.IsOpen() || Segments.IsOpen();
+    FinishCapture();
 
     //
     //  Stop Loggers on active Channels
-    if (Settings.LoggerEnable || Settings.PlotEnable)
+    if (!disk && (Settings.LoggerEnable || Settings.PlotEnable))
         {
         Logger.Stop();
         InitBddFile(Graph);
@@ -761,107 +725,64 @@ void ApplicationIo::HandleAfterStop(OpenWire::NotifyEvent & /*Event*/)
 		if (Logger.Logged() && Settings.PlotEnable)
 			Graph.Plot();
         }
+
     Log(std::string("Analog I/O Stopped"));
-	
-	int rows = Settings.FrameSize;
-//	int cols = asdfch1asdf.size()/rows;
-	int cols = Settings.SamplesToLog/(2*rows);
+    UI->AfterStreamAutoStop();
 
-// Reset counters 
-	Log("Cntrch1: " + IntToString(cntrch1));
-	Log("Cntrch2: " + IntToString(cntrch2));
+}
 
-	cntrch1 = 0;
-	cntrch2 = 0;
+//---------------------------------------------------------------------------
+//  ApplicationIo::FinishCapture() --  Drain the workers and publish the data
+//---------------------------------------------------------------------------
+//  Shared by the stream's stop and by Replay().  MATLAB thread only.
 
-	if (gpuCount >= 1)
+void ApplicationIo::FinishCapture()
+{
+    //  Let the workers finish every queued buffer before using the data
+    for (unsigned int w = 0; w < Ingest.Workers(); ++w)
+        {
+        QueueStatus q = Ingest.Status(w);
+        std::stringstream msg;
+        msg << "Ingest worker " << w << ": queued " << q.Pushed << ", high water "
+            << q.HighWater << "/" << q.Capacity << ", full for " << q.Drops;
+        Log(msg.str());
+        }
+    if (Ingest.Drops())
+        Log("Ingest: " + IntToString(static_cast<int>(Ingest.Drops())) + " buffers dropped, a worker queue full");
+    Ingest.Stop();
+    CloseDiskLog();
+    FinishFollower();
+    CloseColumnLog();
+
+	size_t const rows = std::max(Settings.FrameSize, 1);
+
+	if (!Demux.empty() && (Demux[0].Unrouted() || Demux[0].Malformed()))
+		Log("Unrouted packets: " + IntToString(static_cast<int>(Demux[0].Unrouted())) +
+			", malformed buffers: " + IntToString(static_cast<int>(Demux[0].Malformed())));
+	ReportGaps();
+
+// One workspace variable per active channel: ch<n>d, or gch<n> when on the GPU.
+// Channels captured into a caller's buffer are already where they belong.
+// With ExportFormat each also goes to Capture.ch<n>.npy or .mat in Path.
+	for (unsigned int ch = 0; ch < Captures.size(); ++ch)
 	{
-		// If matlab detects a GPU, move data to gpu for processing
-
-		mwSize const dims[2] = {rows,cols};
-		mwSize const dim = 2;
-
-		mxGPUArray *ga1;
-//		const mxGPUArray *ga1;
-		ga1 = mxGPUCreateGPUArray(dim,dims,mxINT16_CLASS,mxREAL,MX_GPU_DO_NOT_INITIALIZE);
-		short * gpuArrayCh1 = (short *) mxGPUGetData(ga1);
-//		cudaMemcpy(gpuArrayCh1,&(asdfch1asdf)[0],asdfch1asdf.size()*sizeof(short),cudaMemcpyHostToDevice);
-		cudaMemcpy(gpuArrayCh1,&arrch1[0],Settings.SamplesToLog*sizeof(short)/2,cudaMemcpyHostToDevice);
-//		ga1 = mxGPUCreateFromMxArray(mxarrch1);
-
-		mxGPUArray *ga2;
-//		const mxGPUArray *ga2;
-		ga2 = mxGPUCreateGPUArray(dim,dims,mxINT16_CLASS,mxREAL,MX_GPU_DO_NOT_INITIALIZE);
-		short * gpuArrayCh2 = (short *) mxGPUGetData(ga2);
-//	    cudaMemcpy(gpuArrayCh2,&(asdfch2asdf)[0],asdfch2asdf.size()*sizeof(short),cudaMemcpyHostToDevice);
-	    cudaMemcpy(gpuArrayCh2,&arrch2[0],Settings.SamplesToLog*sizeof(short)/2,cudaMemcpyHostToDevice);
-//		ga2 = mxGPUCreateFromMxArray(mxarrch2);
-
-//		mexPutVariable("base","gch1",mxarrch1);
-//		mexPutVariable("base","gch2",mxarrch2);
-//		mxGPUDestroyGPUArray(ga1);
-//		mxGPUDestroyGPUArray(ga2);
-
-
-
-		mxArray *fromgpu1;
-		fromgpu1 = mxGPUCreateMxArrayOnGPU(ga1);
-		mexPutVariable("base","gch1",fromgpu1);
-
-		mxArray *fromgpu2;
-		fromgpu2 = mxGPUCreateMxArrayOnGPU(ga2);
-		mexPutVariable("base","gch2",fromgpu2);
-
-		mxDestroyArray(fromgpu1);
-		mxDestroyArray(fromgpu2);
-		mxGPUDestroyGPUArray(ga1);
-		mxGPUDestroyGPUArray(ga2);
-	
-		
-/*
-		mxArray *fromgpu1;
-		fromgpu1 = mxGPUCreateMxArrayOnGPU(asdfgpuch1asdf);
-		mexPutVariable("base","gch1",fromgpu1);
-		mxArray *fromgpu2;
-		fromgpu2 = mxGPUCreateMxArrayOnGPU(asdfgpuch2asdf);
-		mexPutVariable("base","gch2",fromgpu2);
-*/
-		//		mxDestroyArray(fromgpu1);
-//		mxDestroyArray(fromgpu2);
-//		mxGPUDestroyGPUArray(asdfgpuch1asdf);
-//		mxGPUDestroyGPUArray(asdfgpuch2asdf);
-
-
-
+		if (!Captures[ch].Data && !Captures[ch].Packed)
+			continue;
+
+		Log("Cntrch" + IntToString(ch+1) + ": " + IntToString(static_cast<int>(CapturedSamples(ch))));
+		if (Settings.ExportFormat != ApplicationSettings::efNone)
+			ExportCapture(ch, rows);
+		if (!Settings.ExportWorkspace)
+			continue;
+		if (Captures[ch].Packed)
+			PutPackedCapture(ch, rows);
+		else if (Captures[ch].Array || Captures[ch].Block)
+			PutCapture(ch, Captures[ch].Data, rows, Captures[ch].Samples/rows, Captures[ch].Array);
 	}
-	
-	else
-	{
-		// If a gpu is not detected store data in cpu memory
-		mxArray *myarraych1;
-		mxArray *myarraych2;
-		
-		myarraych1 = mxCreateNumericMatrix(rows,cols,mxINT16_CLASS,mxREAL);
-		myarraych2 = mxCreateNumericMatrix(rows,cols,mxINT16_CLASS,mxREAL);
-		
-		Log("Copy to array");
-		short *start_of_arptrch1 = (short *)mxGetData(myarraych1);
-		short *start_of_arptrch2 = (short *)mxGetData(myarraych2);
-
-//		memcpy(start_of_arptrch1, &(asdfch1asdf)[0], asdfch1asdf.size()*sizeof(short));
-//		memcpy(start_of_arptrch2, &(asdfch2asdf)[0], asdfch2asdf.size()*sizeof(short));
-
-		memcpy(start_of_arptrch1, &arrch1[0], Settings.SamplesToLog*sizeof(short)/2);
-		memcpy(start_of_arptrch2, &arrch2[0], Settings.SamplesToLog*sizeof(short)/2);
-
-		mexPutVariable("base","ch1d",myarraych1);
-		mexPutVariable("base","ch2d",myarraych2);
-		mxDestroyArray(myarraych1);
-//		asdfch1asdf.clear();
-		mxDestroyArray(myarraych2);
-//		asdfch2asdf.clear();
 
-	}
+// In recorder mode export everything the rings hold
+	if (!Recorders.empty())
+		SnapshotCapture(0);
 
 // Old technique for the GPU
 /*
@@ -917,120 +838,17 @@ void ApplicationIo::HandleAfterStop(OpenWire::NotifyEvent & /*Event*/)
 
 //	asdfch1asdf.clear();
 //	asdfch2asdf.clear();  	
-
-
-    Log(std::string("Analog I/O Stopped"));
-    UI->AfterStreamAutoStop();
-
 }
 
-//  +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
-//  ApplicationIo::Parse
-//  +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+//---------------------------------------------------------------------------
+//  ApplicationIo::doVpp() -- Parse Settings.File to the workspace
+//---------------------------------------------------------------------------
+//  Kept for the Vpp export; the VitaPacketParser walk it did is replaced
+//  by ParseFile().
+
 void ApplicationIo::doVpp()
-// Outdated function for parsing a datastream using vita packet parser (VPP).
 {
-	/*
-
-	Log("Opening File");
-	RunTimeSW.Start();
-	// Open File to read.
-
-	VeloBuffer in;
-//	in = new VeloBuffer;
-
-
-
-    Player.FileName(Settings.File);
-	Player.Start();
-	Log("Playing started");
-	vector<int16_T> ch1;
-	vector<int16_T> ch2;
-	size_t size = 1;
-	while (size)
-	{
-		size = 	Player.PlayWithHeader(in)*sizeof(int);
-//		Log(IntToString(size));
-		if (!size)
-			break;
-	
-		Log(std::string("size: " + IntToString(size)));
-
-		Log(std::string("Full size of in in ints: ") + IntToString(in.FullSizeInInts()));
-
-	
-// Look at individual vita buffers
-
-		VitaCursor currentVita(in,0);
-		int i (0);
-		unsigned short vitsize(0);
-		int vitsid(0);
-	
-//	while (i<100)
-		for (;;)
-		{
-			if (!currentVita.isValid())
-				break;
-			vitsize = currentVita.PacketSize();
-			vitsid = currentVita.Sid();
-			AccessDatagram<int16_T> DG(currentVita.Data());
-			//		if (vitsid !=(256 || 257))
-			//			return;
-
-			if (vitsid == 256)
-			{
-				for (size_t j = 0; j<DG.SizeInElements(); ++j)
-				{
-					ch1.push_back(DG[j]);
-				}
-			}
-
-			if (vitsid == 257)
-			{
-				for (size_t j = 0; j<DG.SizeInElements(); ++j)
-				{
-					ch2.push_back(DG[j]);
-				}
-			}
-
-//		AccessDatagram<int16_T> DG(currentVita.Data());
-
-			currentVita.advance();
-//		++i;
-//		Log("Done with vitas");
-		}
-	
-	Log("Define array");
-	mxArray *myarraych1; 
-	mxArray *myarraych2; 
-//	ch1.resize(ch1.size()/2);
-//	ch2.resize(ch2.size()/2);
-	Log("initialize array");
-	int rows = Settings.FrameSize;
-	int cols = ch1.size()/rows;
-
-//	myarray = mxCreateNumericMatrix(ch1.size(),2,mxINT16_CLASS,mxREAL);
-	myarraych1 = mxCreateNumericMatrix(rows,cols,mxINT16_CLASS,mxREAL);
-	myarraych2 = mxCreateNumericMatrix(rows,cols,mxINT16_CLASS,mxREAL);
-	Log("Copy to array");
-	int16_T *start_of_arptrch1 = (int16_T *)mxGetData(myarraych1);
-	int16_T *start_of_arptrch2 = (int16_T *)mxGetData(myarraych2);
-	memcpy(start_of_arptrch1, &(ch1)[0], ch1.size()*sizeof(int16_T));
-	memcpy(start_of_arptrch2, &(ch2)[0], ch2.size()*sizeof(int16_T));
-	Log(IntToString(ch1.size()));
-	Log(IntToString(ch2.size()));
-	Log("Mex Put Variable");
-	mexPutVariable("base","ch1",myarraych1);
-	mexPutVariable("base","ch2",myarraych2);
-    mxDestroyArray(myarraych1);
-    mxDestroyArray(myarraych2);
-	}
-
-	//	mexPutVariable("base","ch",CH1);
-//	double Etime = RunTimeSW.Elapsed();
-//	Log(std::string("Elasped setup (S): ") + FloatToString(Etime));
-
-*/
+	ParseFile(pmWorkspace);
 }
 
 // ++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
@@ -1066,217 +884,270 @@ void ApplicationIo::putMat(vector<short>* ch1, vector<short>* ch2)
 */
 }
 
-//  +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
-//  Channelize data
-//  Added by MPD
-//  Added handle OnSplitComplete.SetEvent to AppIo constructor
-//  Added HandleSplitComplete method to AppIo.h/.cpp
-//  +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
-void ApplicationIo::ParseFile(int ohhgod)
-// Outdated function to parse a binary data file written to disk
+//---------------------------------------------------------------------------
+//  ApplicationIo::ParseFile() -- Split a capture file into channel arrays
+//---------------------------------------------------------------------------
+//  Settings.File, or Data.bin if that is empty, is parsed on every core by
+//  VitaParser.  Each stream of an input channel becomes FrameSize x frames
+//  per channel in ExportUnits, PackedLanes channels to a stream, a partial
+//  last frame dropped.  pmWorkspace puts them in the workspace as ch<n>;
+//  pmFiles writes Parse.ch<n> to Path in ExportFormat, raw when none;
+//  pmScan only indexes the file and reports.  Streams are extracted one
+//  at a time, so only one stream's arrays are held at once.  Counts go
+//  straight into the workspace arrays; other units are extracted as int16
+//  first and converted channel by channel.  pmStream writes the files
+//  pmFiles does from a file of any size, see StreamParse().
 
+void ApplicationIo::ParseFile(IIParseMode mode)
 {
-/*
-	RunTimeSW.Start();
-	InGraph.BinFile(Settings.File);
-	InGraph.Restore();
-
-    // Open input file as PacketFileDataSet
-    DataSet * in = 0;
-
-	in = new VitaPacketFileDataSet;
-
-	in->FileName(Settings.File);
-	in->Type(static_cast<DataSet::IIDataType>(DataSet::IIDataType::Int));
-    in->Bits(InGraph.SignificantBits());
-    in->Channels(InGraph.Channels());
-    in->Devices(InGraph.Devices());
-    in->Polarity(static_cast<DataSet::IIPolarity>(InGraph.Polarity()));
-
-    in->Enabled(true);
-    if (!in->Enabled())
-    {
-        delete in;
-        return;
-    }
-
-	int devices = in->Devices()-1;
-    int ChannelsPerDevice = in->Channels()/devices;
-
-
-    // Force parsing of entire packet set, to insure
-    // determination of all embedded packet IDs
-    in->Channel(InGraph.Channels());
-	Sample s = in->Element(in->Samples()-1);
-
-	int rows = Settings.FrameSize;
-	int cols = in->Samples()/rows;
-	int iter = rows*cols;
-	double Elapsed = RunTimeSW.Elapsed();
-	Log(std::string("Elasped setup (S): ") + FloatToString(Elapsed));
-	// Define functor for parallel loop
+	const std::string file = Settings.File.empty() ? Logger.FileName() : Settings.File;
+	if (mode == pmStream)
+	{
+		StreamParse(file);
+		return;
+	}
+	const unsigned int lanes = static_cast<unsigned int>(std::max(Settings.PackedLanes, 1));
+	size_t const rows = std::max(Settings.FrameSize, 1);
+	const bool counts = Settings.ExportUnits == ApplicationSettings::euCounts;
+
+	VitaParser parser;
+	parser.SampleBytes = sizeof(short);
+	parser.Lanes = lanes;
+	const long long start = HiResTimer::Ticks();
+	if (!parser.Open(file))
+	{
+		Log("Parse: " + file + ": " + parser.Error());
+		return;
+	}
+	const double indexed = static_cast<double>(HiResTimer::Ticks() - start) / HiResTimer::TicksPerSecond();
 
-	int *testarray = new int[5];
-	delete[] testarray;
+	std::stringstream msg;
+	msg << "Parse: " << file << ", " << parser.Bytes() << " bytes, " << parser.Packets() << " packets in "
+		<< parser.Streams() << " streams, " << parser.Skipped() << " bytes skipped, " << parser.Chunks()
+		<< " chunks (" << parser.Resynced() << " resynced), indexed in " << indexed << " s";
+	Log(msg.str());
 
-	switch(ohhgod)
+	for (size_t s = 0; s < parser.Streams() && mode != pmScan; ++s)
 	{
-	case 0:
+		const unsigned int sid = parser.Sid(s);
+		const size_t cols = static_cast<size_t>(parser.Samples(s)/rows);
+		if (sid < AnalogInSid(0) || sid - AnalogInSid(0) > 0xFFFF || !cols)
 		{
-			Timer.Enabled(true);
-			RunTimeSW.Start();
-			// Try one matrix per channel
-			mxArray *ch1;
-			ch1 = mxCreateNumericMatrix(rows,cols,mxINT16_CLASS,mxREAL);
-			int16_T *ch1mat = (int16_T *) mxGetData(ch1);
-			in->Channel(0);
-			double elapsed0 = RunTimeSW.Stop();
-			Log(std::string("Elasped setup2 (S): ") + FloatToString(elapsed0));
-
-			RunTimeSW.Start();
-
-			for (int s=0; s<1; ++s)
-			{
-				Sample samp = in->Element(s);
-//				ch1mat[s] = samp.Int();
-			}
-			double elapsed1 = RunTimeSW.Stop();
-			Log(std::string("ch1 for loop (S): ") + FloatToString(elapsed1));
-
-			mexPutVariable("base","ch1",ch1);
-			mxDestroyArray(ch1);
-
-
-			RunTimeSW.Start();
-			mxArray	*ch2;
-			ch2 = mxCreateNumericMatrix(rows,cols,mxINT16_CLASS,mxREAL);
-			int16_T *ch2mat = (int16_T *) mxGetData(ch2);
-			in->Channel(1);
-			for (int s=0; s<iter; ++s)
-			{
-				Sample samp = in->Element(s);
-//				ch2mat[s] = samp.Int();
-			}
-			mexPutVariable("base","ch2",ch2);
-			mxDestroyArray(ch2);
-			double elapsed2 = RunTimeSW.Stop();
-			Log(std::string("ch2 for loop (S): ") + FloatToString(elapsed2));
-			break;
+			std::stringstream skip;
+			skip << "Parse: stream 0x" << std::hex << sid << std::dec << " skipped";
+			Log(skip.str());
+			continue;
 		}
+		const unsigned int first = sid - AnalogInSid(0);
 
-	case 1:
+		std::vector<mxArray *> arrays(lanes, static_cast<mxArray *>(0));
+		std::vector< std::vector<short> > staged(mode == pmFiles || !counts ? lanes : 0);
+		std::vector<char *> dest(lanes);
+		for (unsigned int l = 0; l < lanes; ++l)
 		{
-			int channel;
-			mxArray *ch;
-			ch = mxCreateNumericMatrix(rows,cols*2,mxINT16_CLASS,mxREAL);
-			int16_T *chmat = (int16_T *) mxGetData(ch);
-			
-			for (int s=0; s<iter; ++s)
+			if (!staged.empty())
 			{
-				for (channel=0; channel< ChannelsPerDevice; ++channel)
-				{
-					in->Channel(channel);
-					Sample samp = in->Element(s);
-					chmat[s] = samp.Int();
-				}
+				staged[l].resize(rows*cols);
+				dest[l] = reinterpret_cast<char *>(&staged[l][0]);
+			}
+			else
+			{
+				arrays[l] = mxCreateNumericMatrix(rows,cols,mxINT16_CLASS,mxREAL);
+				dest[l] = static_cast<char *>(mxGetData(arrays[l]));
 			}
-			mexPutVariable("base","ch",ch);
-			mxDestroyArray(ch);
-			break;
 		}
+		parser.Route(sid, &dest[0], static_cast<unsigned long long>(rows)*cols);
+		parser.Extract();
+		parser.Route(sid, 0, 0);
 
-	case 2:
+		for (unsigned int l = 0; l < lanes; ++l)
 		{
-			int channel;
-			mxArray *ch;
-			ch = mxCreateNumericMatrix(rows,cols*2,mxINT16_CLASS,mxREAL);
-			int16_T *chmat = (int16_T *) mxGetData(ch);
-			for (channel=0; channel<ChannelsPerDevice; ++channel)
+			const std::string name = "ch" + IntToString(static_cast<int>(first + l + 1));
+			if (mode != pmFiles)
 			{
-				in->Channel(channel);
-				for (int s=0; s< iter; ++s)
+				if (!counts)
 				{
-					Sample samp = in->Element(s);
-					chmat[s] = samp.Int();
+					arrays[l] = mxCreateNumericMatrix(rows,cols,UnitClass(),mxREAL);
+					ConvertUnits(first + l, &staged[l][0], mxGetData(arrays[l]), rows*cols);
+					std::vector<short>().swap(staged[l]);
 				}
+				mexPutVariable("base",name.c_str(),arrays[l]);
+				mxDestroyArray(arrays[l]);
+				continue;
 			}
-			mexPutVariable("base","CH",ch);
-			mxDestroyArray(ch);
-			break;
-		}
 
-	case 3:
-		{
-		// Try one matrix per channel
-			MatlabMatrix CH1(rows,cols);
-			double * Datach1 = reinterpret_cast<double*>(CH1.DataPtr());
-			in->Channel(0);
-			for (int s=0; s<iter; ++s)
-			{
-				Sample samp = in->Element(s);
-				Datach1[s] = samp.Int();
-			}
-			mxArray* matdat = reinterpret_cast<mxArray*>(Datach1);
-			
-			mexPutVariable("base","ch1",matdat);
-			mxDestroyArray(matdat);
-		
-			MatlabMatrix CH2(rows,cols,mxINT16_CLASS,mxREAL);
-			int16_t *Datach2 = reinterpret_cast<int16_t *>(CH2.DataPtr());
-			in->Channel(1);
-			for (int s=0; s<iter; ++s)
-			{
-				Sample samp = in->Element(s);
-				Datach2[s] = samp.Int();
-			}
-			mxArray* matdat1 = reinterpret_cast<mxArray*>(Datach2);
-			mexPutVariable("base","ch2",matdat1);
-			mxDestroyArray(matdat);
-			break;
+			ArrayWriter out;
+			out.Format = static_cast<ArrayFile::IIFormat>(Settings.ExportFormat);
+			out.Name = name;
+			out.ElementBytes = UnitBytes();
+			out.Floating = !counts;
+			out.Rows = rows;
+			out.Direct = Settings.DiskLogDirect;
+			out.Blocking = true;
+			const std::string path = Settings.Path + "Parse." + name + ArrayFile::Extension(out.Format);
+			if (!out.Open(path) || !WriteUnits(out, first + l, &staged[l][0], staged[l].size()))
+				Log("Parse: " + path + ": " + out.Error());
+			out.Close();
+			std::vector<short>().swap(staged[l]);
 		}
+	}
+
+	const double seconds = static_cast<double>(HiResTimer::Ticks() - start) / HiResTimer::TicksPerSecond();
+	std::stringstream done;
+	done << "Parse: " << seconds << " s, " << parser.Bytes() / std::max(seconds, 1.e-9) / 1.e9 << " GB/s";
+	Log(done.str());
+
+	ProcessCompletionEvent e(0);
+	OnSplitComplete.Execute(e);
+}
+
+//---------------------------------------------------------------------------
+//  ApplicationIo::StreamParse() -- Parse a capture too large for memory
+//---------------------------------------------------------------------------
+//  BlockReader reads 'file' front to back, a thread ahead, and hands over
+//  ParseBlockMB of every channel at a time; each block goes straight to
+//  that channel's Parse.ch<n> in ExportFormat and ExportUnits.  Memory is
+//  two blocks and a read whatever the size of the file, and the disk is
+//  read once, in order.  The input streams are those found at the start
+//  of the file.  Where a stream stopped early its channels are short;
+//  each file's header holds its own frame count.
+
+void ApplicationIo::StreamParse(const std::string & file)
+{
+	const unsigned int lanes = static_cast<unsigned int>(std::max(Settings.PackedLanes, 1));
+	size_t const rows = std::max(Settings.FrameSize, 1);
+	const size_t block = static_cast<size_t>(std::max(Settings.ParseBlockMB, 1)) * 1024 * 1024;
+
+	BlockReader reader;
+	reader.SampleBytes = sizeof(short);
+	reader.Lanes = lanes;
+	reader.BlockSamples = std::max<size_t>(block/sizeof(short)/rows, 1)*rows;
+	const long long start = HiResTimer::Ticks();
+	if (!reader.Open(file))
+	{
+		Log("Parse: " + file + ": " + reader.Error());
+		return;
+	}
 
-	case 4:
+	std::vector< std::shared_ptr<ArrayWriter> > files(reader.Channels());
+	std::vector<unsigned int> input(reader.Channels(), 0);
+	for (size_t k = 0; k < reader.Sids().size(); ++k)
+	{
+		const unsigned int sid = reader.Sids()[k];
+		if (sid < AnalogInSid(0) || sid - AnalogInSid(0) > 0xFFFF)
 		{
-			in->ScanToEnd();
-			break;
+			std::stringstream skip;
+			skip << "Parse: stream 0x" << std::hex << sid << std::dec << " skipped";
+			Log(skip.str());
+			continue;
 		}
-		case 5:
+		for (unsigned int l = 0; l < lanes; ++l)
 		{
-			in->Channel(0);
-			size_t (*temparray) = new size_t [3000];
+			const size_t c = k*lanes + l;
+			input[c] = sid - AnalogInSid(0) + l;
+			std::shared_ptr<ArrayWriter> out(new ArrayWriter);
+			out->Format = static_cast<ArrayFile::IIFormat>(Settings.ExportFormat);
+			out->Name = "ch" + IntToString(static_cast<int>(input[c] + 1));
+			out->ElementBytes = UnitBytes();
+			out->Floating = Settings.ExportUnits != ApplicationSettings::euCounts;
+			out->Rows = rows;
+			out->Direct = Settings.DiskLogDirect;
+			out->Blocking = true;
+			const std::string path = Settings.Path + "Parse." + out->Name + ArrayFile::Extension(out->Format);
+			if (out->Open(path))
+				files[c] = out;
+			else
+				Log("Parse: " + path + ": " + out->Error());
+		}
+	}
 
-			// Try OMP
-//			int tempiter = iter;
-			mexPrintf("made vector\n");
+	while (const CaptureBlock * b = reader.Next())
+		for (size_t c = 0; c < files.size(); ++c)
+			if (files[c])
+				WriteUnits(*files[c], input[c], b->As<short>(c), b->Samples(c));
 
-			Sample k = in->Element(in->Samples()-1);
-			int fart = 0;
-			for(int fart = 0; fart<iter;++fart)
-			{
-				Sample samp = in->Element(fart);
-				temparray[fart] = samp.Int();
-			}
-			
-			delete temparray;
-			break;
-		}
+	for (size_t c = 0; c < files.size(); ++c)
+	{
+		if (!files[c])
+			continue;
+		files[c]->Close();
+		std::stringstream msg;
+		msg << "Parse: " << files[c]->FileName() << ", " << rows << " x " << files[c]->Frames();
+		if (!files[c]->Error().empty())
+			msg << ", " << files[c]->Error();
+		Log(msg.str());
 	}
 
-	in->Enabled(false);
+	const double seconds = static_cast<double>(HiResTimer::Ticks() - start) / HiResTimer::TicksPerSecond();
+	std::stringstream done;
+	done << "Parse: " << file << ", " << reader.Bytes() << " bytes, " << reader.Packets() << " packets in "
+		<< reader.Sids().size() << " streams, " << reader.Unrouted() << " others, " << reader.Skipped()
+		<< " bytes skipped, " << reader.Blocks() << " blocks of " << reader.Footprint() / (1024*1024)
+		<< " MB held, " << seconds << " s, " << reader.Bytes() / std::max(seconds, 1.e-9) / 1.e9 << " GB/s";
+	Log(done.str());
+
 	ProcessCompletionEvent e(0);
 	OnSplitComplete.Execute(e);
-	delete in;
-*/
 }
 
 //---------------------------------------------------------------------------
-// Function to set some of the card parameters
-// Added by MPD
+//  ApplicationIo::ExtractFrames() -- Copy a few frames out of a capture file
 //---------------------------------------------------------------------------
-void ApplicationIo::setParameters(const char *param, double value)
+//  'file', or Data.bin if that is empty, is searched through its .vidx, so
+//  only the index and the packets holding the frames are read.  Bit n of
+//  'mask' selects the stream of input channel n.  'out' receives count x
+//  FrameSize samples per selected channel, lowest channel first, each
+//  FrameSize x count as ParseFile() would lay it out.  Returns the fewest
+//  whole frames found for any channel, or -1 if the file cannot be read,
+//  or its index was written with another FrameSize or with channels
+//  interleaved, which 'out' was not sized for.
+
+long long ApplicationIo::ExtractFrames(const std::string & file, unsigned long long first, size_t count,
+									   unsigned int mask, short * out)
 {
-	if (!_strcmpi(param,"frameSize"))
-	{
+	FrameReader reader;
+	reader.FrameSize = static_cast<unsigned int>(std::max(Settings.FrameSize, 1));
+	reader.SampleBytes = sizeof(short);
+	const std::string name = file.empty() ? Logger.FileName() : file;
+	if (!reader.Open(name))
+		{
+		Log("Extract: " + name + ": " + reader.Error());
+		return -1;
+		}
+	if (reader.Frame() != reader.FrameSize || reader.Bytes() != reader.SampleBytes)
+		{
+		std::stringstream msg;
+		msg << "Extract: " << name << " is indexed as " << reader.Frame() << " sample frames of "
+			<< reader.Bytes() << " bytes, not FrameSize " << reader.FrameSize << " int16";
+		Log(msg.str());
+		return -1;
+		}
+	if (!reader.Indexed())
+		Log("Extract: no packet index beside " + name + ", scanned it whole");
+
+	std::vector<unsigned int> sids;
+	std::vector<void *> dest;
+	char * at = reinterpret_cast<char *>(out);
+	for (unsigned int ch = 0; ch < 32; ++ch)
+		if (mask & (1u << ch))
+			{
+			sids.push_back(AnalogInSid(ch));
+			dest.push_back(at);
+			at += count * reader.FrameSize * sizeof(short);
+			}
+	if (sids.empty() || !count)
+		return 0;
+	return static_cast<long long>(reader.Read(sids, first, count, &dest[0]));
+}
+
+//---------------------------------------------------------------------------
+// Function to set some of the card parameters
+// Added by MPD
+//---------------------------------------------------------------------------
+void ApplicationIo::setParameters(const char *param, double value)
+{
+	if (!_strcmpi(param,"frameSize"))
+	{
 		Settings.FrameSize = value;
 	}	
 
@@ -1293,6 +1164,110 @@ void ApplicationIo::setParameters(const char *param, double value)
 	{
 		Settings.ReferenceClockSource = value;
 	}
+	else if (!_strcmpi(param,"captureMode"))
+	{
+		Settings.CaptureMode = value;
+	}
+	else if (!_strcmpi(param,"recorderFrames"))
+	{
+		Settings.RecorderFrames = value;
+	}
+	else if (!_strcmpi(param,"followIntervalMs"))
+	{
+		Settings.FollowIntervalMs = value;
+	}
+	else if (!_strcmpi(param,"recorderPostTrigger"))
+	{
+		Settings.RecorderPostTrigger = value;
+	}
+	else if (!_strcmpi(param,"capturePacked"))
+	{
+		Settings.CapturePacked = value != 0;
+	}
+	else if (!_strcmpi(param,"exportFormat"))
+	{
+		Settings.ExportFormat = value;
+	}
+	else if (!_strcmpi(param,"exportWorkspace"))
+	{
+		Settings.ExportWorkspace = value != 0;
+	}
+	else if (!_strcmpi(param,"exportUnits"))
+	{
+		Settings.ExportUnits = value;
+	}
+	else if (!_strcmpi(param,"parseBlockMB"))
+	{
+		Settings.ParseBlockMB = value;
+	}
+	else if (!_strcmpi(param,"gapMap"))
+	{
+		Settings.GapMap = value != 0;
+	}
+	else if (!_strcmpi(param,"packedLanes"))
+	{
+		Settings.PackedLanes = value;
+	}
+	else if (!_strcmpi(param,"diskLog"))
+	{
+		Settings.DiskLog = value != 0;
+	}
+	else if (!_strcmpi(param,"diskLogBlockMB"))
+	{
+		Settings.DiskLogBlockMB = value;
+	}
+	else if (!_strcmpi(param,"diskLogDepth"))
+	{
+		Settings.DiskLogDepth = value;
+	}
+	else if (!_strcmpi(param,"diskLogReserveMB"))
+	{
+		Settings.DiskLogReserveMB = value;
+	}
+	else if (!_strcmpi(param,"diskLogDirect"))
+	{
+		Settings.DiskLogDirect = value != 0;
+	}
+	else if (!_strcmpi(param,"diskLogExtentMB"))
+	{
+		Settings.DiskLogExtentMB = value;
+	}
+	else if (!_strcmpi(param,"diskLogIndex"))
+	{
+		Settings.DiskLogIndex = value != 0;
+	}
+	else if (!_strcmpi(param,"diskLogCompress"))
+	{
+		Settings.DiskLogCompress = value != 0;
+	}
+	else if (!_strcmpi(param,"diskLogCompressThreads"))
+	{
+		Settings.DiskLogCompressThreads = value;
+	}
+	else if (!_strcmpi(param,"diskLogSegmentMB"))
+	{
+		Settings.DiskLogSegmentMB = value;
+	}
+	else if (!_strcmpi(param,"diskLogSegmentSeconds"))
+	{
+		Settings.DiskLogSegmentSeconds = value;
+	}
+	else if (!_strcmpi(param,"diskLogRetainSegments"))
+	{
+		Settings.DiskLogRetainSegments = value;
+	}
+	else if (!_strcmpi(param,"diskLogRetainGB"))
+	{
+		Settings.DiskLogRetainGB = value;
+	}
+	else if (!_strcmpi(param,"columnLog"))
+	{
+		Settings.ColumnLog = value != 0;
+	}
+	else if (!_strcmpi(param,"columnLogBlockMB"))
+	{
+		Settings.ColumnLogBlockMB = value;
+	}
 
 }
 
@@ -1322,6 +1297,819 @@ void ApplicationIo::testArray()
 
 
 
+//---------------------------------------------------------------------------
+//  ApplicationIo::Benchmark() -- Run board-free ingest benchmark
+//---------------------------------------------------------------------------
+
+void ApplicationIo::Benchmark(int mode)
+{
+	IngestBenchmark bench;
+	bench.Channels = static_cast<unsigned int>(Settings.ActiveChannels.size());
+	bench.BufferBytes = std::max(Settings.BusmasterSize/4, 1) * 4 * 1024 * 1024;
+	bench.ReplayFile = Settings.Path + "Replay.bin";
+	bench.DiskFile = Settings.Path + "Benchmark.bin";
+	bench.DiskBlockBytes = static_cast<size_t>(std::max(Settings.DiskLogBlockMB, 1)) * 1024 * 1024;
+	bench.DiskDepth = static_cast<unsigned int>(std::max(Settings.DiskLogDepth, 1));
+	bench.ParseFile = Settings.Path + "BenchmarkParse.bin";
+
+	BenchmarkResults results = bench.Run(static_cast<IngestBenchmark::IIMode>(mode));
+
+	std::stringstream ss(IngestBenchmark::Report(results));
+	std::string line;
+	while (std::getline(ss, line))
+		Log(line);
+
+	//  Kept for comparison against later builds
+	const std::string csv = Settings.Path + "Benchmark.csv";
+	if (!IngestBenchmark::Save(results, csv))
+		Log("Benchmark: could not write " + csv);
+}
+
+//---------------------------------------------------------------------------
+//  ApplicationIo::OpenDiskLog() -- Start the asynchronous Data.bin writer
+//---------------------------------------------------------------------------
+//  Replaces the synchronous DataLogger when DiskLog is set.  The file holds
+//  the raw VITA stream, back to back, as received.  The pool has twice the
+//  writes in flight, so one disk hiccup of about Depth blocks is absorbed;
+//  beyond that whole buffers are dropped and counted, not the stream.
+//
+//  With DiskLogStripes naming directories, Data.<n>.bin goes in each and
+//  DiskLogExtentMB extents are dealt to them in turn, one writer per
+//  directory; Data.manifest beside Data.bin records the layout.  Replay
+//  accepts the manifest in place of the file.
+//
+//  With DiskLogCompress the stream is coded losslessly on its own threads
+//  first and the files are named .vcz; Replay reads those too, unstriped.
+//  A segment size or age makes it a segmented log instead, see
+//  OpenSegmentLog().
+
+bool ApplicationIo::OpenDiskLog()
+{
+	if (Settings.DiskLogSegmentMB > 0 || Settings.DiskLogSegmentSeconds > 0)
+		return OpenSegmentLog();
+
+	std::vector<std::string> files;
+	std::stringstream dirs(Settings.DiskLogStripes);
+	std::string dir;
+	while (std::getline(dirs, dir, ';'))
+		{
+		if (dir.empty())
+			continue;
+		if (dir[dir.size()-1] != '\\' && dir[dir.size()-1] != '/')
+			dir += '\\';
+		files.push_back(dir + "Data." + IntToString(static_cast<int>(files.size())) + ".bin");
+		}
+	if (files.size() < 2)
+		files.assign(1, Logger.FileName());
+	if (Settings.DiskLogCompress)
+		for (size_t f = 0; f < files.size(); ++f)
+			files[f] = files[f].substr(0, files[f].find_last_of('.')) + CompressedLogger::Extension();
+
+	Disk.ExtentBytes = static_cast<unsigned long long>(std::max(Settings.DiskLogExtentMB, 1)) * 1024 * 1024;
+	Disk.BlockBytes = static_cast<size_t>(std::max(Settings.DiskLogBlockMB, 1)) * 1024 * 1024;
+	Disk.Depth = static_cast<unsigned int>(std::max(Settings.DiskLogDepth, 1));
+	Disk.Blocks = 2 * Disk.Depth + 2;
+	Disk.Reserve = static_cast<unsigned long long>(std::max(Settings.DiskLogReserveMB, 0)) * 1024 * 1024;
+	Disk.Direct = Settings.DiskLogDirect;
+	Disk.WriteHistogram(&FStats.DiskWrite);
+	if (!Disk.Open(files, Settings.Path + "Data" + StripeManifest::Extension()))
+		{
+		Log("Disk log: " + Disk.Error());
+		return false;
+		}
+
+	for (size_t s = 0; s < Disk.Count(); ++s)
+		{
+		const DiskLogger & stripe = Disk.Stripe(s);
+		std::stringstream msg;
+		msg << "Disk log: " << stripe.FileName() << " via " << DiskLogger::Name(stripe.Backend())
+			<< (stripe.Unbuffered() ? ", unbuffered" : ", buffered") << ", " << Disk.Depth
+			<< " x " << Settings.DiskLogBlockMB << " MB in flight";
+		Log(msg.str());
+		}
+	if (!Disk.ManifestFile().empty())
+		Log("Disk log: " + IntToString(static_cast<int>(Disk.Count())) + " stripes of " +
+			IntToString(Settings.DiskLogExtentMB) + " MB extents, manifest " + Disk.ManifestFile());
+
+	//  Chunks are cut between buffers, a write block's worth each
+	if (Settings.DiskLogCompress)
+		{
+		Compressor.ChunkBytes = Disk.BlockBytes;
+		Compressor.Threads = static_cast<unsigned int>(std::max(Settings.DiskLogCompressThreads, 1));
+		Compressor.Lanes = static_cast<unsigned int>(std::max(Settings.PackedLanes, 1));
+		if (!Compressor.Open([this](const void * data, size_t bytes) {  return Disk.Write(data, bytes);  }))
+			{
+			Log("Disk log: cannot start compression");
+			Disk.Close();
+			return false;
+			}
+		Log("Disk log: compressed on " + IntToString(static_cast<int>(Compressor.Threads)) + " threads");
+		}
+
+	//  FrameReader maps one plain file, so striped and compressed logs,
+	//  whose offsets it could not follow, get no index
+	if (Settings.DiskLogIndex && (Disk.Count() > 1 || Settings.DiskLogCompress))
+		Log("Disk log: no packet index for a striped or compressed log");
+	else if (Settings.DiskLogIndex)
+		{
+		DiskIndex.FrameSize = static_cast<unsigned int>(std::max(Settings.FrameSize, 1));
+		DiskIndex.SampleBytes = static_cast<unsigned int>(sizeof(short) * std::max(Settings.PackedLanes, 1));
+		DiskIndex.SampleRate = Opened ? Module().Clock().FrequencyActual() : Settings.SampleRate*1.e6;
+		DiskIndex.Direct = Settings.DiskLogDirect;
+		const std::string vidx = PacketIndexFile::SidecarName(Logger.FileName());
+		if (DiskIndex.Open(vidx))
+			Log("Disk log: packet index " + vidx);
+		else
+			Log("Disk log: no packet index, " + vidx + ": " + DiskIndex.Error());
+		}
+	return true;
+}
+
+//---------------------------------------------------------------------------
+//  ApplicationIo::OpenSegmentLog() -- Start the rolling Data.<n>.bin writer
+//---------------------------------------------------------------------------
+//  The stream goes to Data.000001.bin, Data.000002.bin, ... each rolled
+//  over at DiskLogSegmentMB or DiskLogSegmentSeconds, and sealed with a
+//  .vseg header and, under DiskLogIndex, its own .vidx.  Each segment is
+//  preallocated to the segment size ahead of need, off the ingest path.
+//  Beyond DiskLogRetainSegments or DiskLogRetainGB the oldest sealed
+//  segments are deleted.  Segments are unstriped and uncompressed.
+
+bool ApplicationIo::OpenSegmentLog()
+{
+	if (!Settings.DiskLogStripes.empty() || Settings.DiskLogCompress)
+		Log("Disk log: segmented, DiskLogStripes and DiskLogCompress ignored");
+
+	Segments.SegmentBytes = static_cast<unsigned long long>(std::max(Settings.DiskLogSegmentMB, 0)) * 1024 * 1024;
+	Segments.SegmentSeconds = std::max(Settings.DiskLogSegmentSeconds, 0);
+	Segments.RetainSegments = static_cast<unsigned int>(std::max(Settings.DiskLogRetainSegments, 0));
+	Segments.RetainBytes = static_cast<unsigned long long>(std::max(Settings.DiskLogRetainGB, 0)) * 1024 * 1024 * 1024;
+	Segments.BlockBytes = static_cast<size_t>(std::max(Settings.DiskLogBlockMB, 1)) * 1024 * 1024;
+	Segments.Depth = static_cast<unsigned int>(std::max(Settings.DiskLogDepth, 1));
+	Segments.Blocks = 2 * Segments.Depth + 2;
+	Segments.Reserve = static_cast<unsigned long long>(std::max(Settings.DiskLogReserveMB, 0)) * 1024 * 1024;
+	Segments.Direct = Settings.DiskLogDirect;
+	Segments.Index = Settings.DiskLogIndex;
+	Segments.FrameSize = static_cast<unsigned int>(std::max(Settings.FrameSize, 1));
+	Segments.SampleBytes = static_cast<unsigned int>(sizeof(short) * std::max(Settings.PackedLanes, 1));
+	Segments.SampleRate = Opened ? Module().Clock().FrequencyActual() : Settings.SampleRate*1.e6;
+	Segments.WriteHistogram(&FStats.DiskWrite);
+	if (!Segments.Open(Logger.FileName()))
+		{
+		Log("Disk log: " + Segments.Error());
+		return false;
+		}
+
+	std::stringstream msg;
+	msg << "Disk log: segments from " << Segments.FileName() << ", " << Settings.DiskLogSegmentMB << " MB / "
+		<< Settings.DiskLogSegmentSeconds << " s each, keeping " << Settings.DiskLogRetainSegments << " / "
+		<< Settings.DiskLogRetainGB << " GB (0 = all)";
+	Log(msg.str());
+	return true;
+}
+
+//---------------------------------------------------------------------------
+//  ApplicationIo::CloseDiskLog() -- Flush and close the Data.bin writer
+//---------------------------------------------------------------------------
+//  Call only once the ingest workers have stopped.
+
+void ApplicationIo::CloseDiskLog()
+{
+	if (Segments.IsOpen())
+		{
+		Segments.Close();
+		std::stringstream msg;
+		msg << "Disk log: " << Segments.Written() << " bytes written, " << Segments.Dropped() << " dropped, "
+			<< Segments.Segments() << " segments sealed, " << Segments.Deleted() << " retired, "
+			<< Segments.Late() << " buffers past a segment's limit";
+		const std::string error = Segments.Error();
+		if (!error.empty())
+			msg << ", " << error;
+		Log(msg.str());
+		}
+	if (!Disk.IsOpen())
+		return;
+
+	if (Compressor.IsOpen())
+		{
+		Compressor.Close();
+		std::stringstream packed;
+		packed << "Disk log: " << Compressor.Bytes() << " bytes compressed "
+			<< Compressor.Ratio() << ":1, " << Compressor.Dropped() << " dropped, " << Compressor.Lost() << " lost";
+		Log(packed.str());
+		}
+	Disk.Close();
+	if (DiskIndex.IsOpen())
+		{
+		DiskIndex.Close();
+		std::stringstream idx;
+		idx << "Disk log: " << DiskIndex.Records() << " packets indexed, " << DiskIndex.Dropped() << " dropped";
+		const std::string error = DiskIndex.Error();
+		if (!error.empty())
+			idx << ", " << error;
+		Log(idx.str());
+		}
+
+	std::stringstream msg;
+	msg << "Disk log: " << Disk.Written() << " bytes written, " << Disk.Dropped() << " dropped";
+	for (size_t s = 0; s < Disk.Count(); ++s)
+		msg << (s ? ", " : ", high water ") << Disk.Stripe(s).HighWater();
+	msg << " of " << Disk.Blocks << " blocks";
+	const std::string error = Disk.Error();
+	if (!error.empty())
+		msg << ", " << error;
+	Log(msg.str());
+}
+
+//---------------------------------------------------------------------------
+//  ApplicationIo::CanFollowDiskLog() -- Whether the disk log reads back as written
+//---------------------------------------------------------------------------
+//  Data.bin, or its segments, hold the stream as received; compressed and
+//  striped logs do not until they are closed.
+
+bool ApplicationIo::CanFollowDiskLog() const
+{
+	if (!Settings.DiskLog || Settings.DiskLogCompress)
+		return false;
+	if (Settings.DiskLogSegmentMB > 0 || Settings.DiskLogSegmentSeconds > 0)
+		return true;
+
+	size_t stripes = 0;
+	std::stringstream dirs(Settings.DiskLogStripes);
+	std::string dir;
+	while (std::getline(dirs, dir, ';'))
+		stripes += dir.empty() ? 0 : 1;
+	return stripes < 2;
+}
+
+//---------------------------------------------------------------------------
+//  ApplicationIo::StartFollower() -- Feed the recorders from the disk log
+//---------------------------------------------------------------------------
+//  Follow mode: the workers only log the stream, and this thread reads it
+//  back a few ms behind into each channel's ring, so SnapshotCapture() and
+//  the freeze controls see the run while it is logged, at no cost to
+//  ingest.  Call once the disk log is open.
+
+void ApplicationIo::StartFollower()
+{
+	Follower.Segmented = Segments.IsOpen();
+	Follower.SampleBytes = sizeof(short);
+	Follower.Interval = static_cast<unsigned int>(std::max(Settings.FollowIntervalMs, 1));
+	const unsigned int first = AnalogInSid(0);
+	Follower.Start(Logger.FileName(), [this, first](unsigned int sid, unsigned long long, const void * samples, size_t count)
+		{
+		const unsigned int ch = sid - first;
+		if (sid < first || ch >= Recorders.size() || !Recorders[ch])
+			return;
+		Recorders[ch]->Write(static_cast<const unsigned int *>(samples), count * sizeof(short) / sizeof(unsigned int));
+		});
+}
+
+//---------------------------------------------------------------------------
+//  ApplicationIo::FinishFollower() -- Read the closed disk log to its end
+//---------------------------------------------------------------------------
+
+void ApplicationIo::FinishFollower()
+{
+	if (!Follower.Running())
+		return;
+	Follower.Finish();
+	std::stringstream msg;
+	msg << "Follower: " << Follower.Bytes() << " bytes, " << Follower.Packets() << " packets, "
+		<< Follower.Skipped() << " bytes skipped";
+	if (Follower.Segments() || Follower.Missed())
+		msg << ", " << Follower.Segments() << " segments, " << Follower.Missed() << " retired unread";
+	Log(msg.str());
+}
+
+//---------------------------------------------------------------------------
+//  ApplicationIo::OpenColumnLog() -- Start the per-stream column files
+//---------------------------------------------------------------------------
+//  Each active stream gets Data.ch<n>.bin, its samples with the VITA
+//  headers stripped, and Data.ch<n>.idx, one ColumnRecord per packet, n
+//  being the stream's first channel.  ExportFormat makes the column file
+//  Data.ch<n>.npy or .mat instead, an array of FrameSize rows.  With
+//  PackedLanes > 1 a column keeps the stream's channels interleaved as
+//  sent.  The streams are dealt to the ingest workers in turn, each
+//  writing its own; the DiskLog depth and direct settings apply.
+//  'blocking' waits for the disk instead of dropping packets, for
+//  offline replay.
+
+bool ApplicationIo::OpenColumnLog(bool blocking)
+{
+	CloseColumnLog();
+
+	const size_t channels = Settings.ActiveChannels.size();
+	const size_t workers = std::max(Settings.IngestThreads, 1);
+	const unsigned int lanes = static_cast<unsigned int>(std::max(Settings.PackedLanes, 1));
+	const double rate = Opened ? Module().Clock().FrequencyActual() : Settings.SampleRate*1.e6;
+
+	for (size_t w = 0; w < workers; ++w)
+		{
+		std::shared_ptr<ColumnLogger> columns = std::make_shared<ColumnLogger>();
+		columns->BlockBytes = static_cast<size_t>(std::max(Settings.ColumnLogBlockMB, 1)) * 1024 * 1024;
+		columns->Depth = static_cast<unsigned int>(std::max(Settings.DiskLogDepth, 1));
+		columns->Blocks = columns->Depth + 2;
+		columns->Direct = Settings.DiskLogDirect;
+		columns->Blocking = blocking;
+		columns->SampleRate = rate;
+		columns->Format = static_cast<ArrayFile::IIFormat>(Settings.ExportFormat);
+		columns->FrameSize = std::max(Settings.FrameSize, 1);
+		Columns.push_back(columns);
+		}
+
+	size_t owner = 0;
+	size_t streams = 0;
+	for (size_t first = 0; first < channels; first += lanes)
+		{
+		bool any = false;
+		for (size_t l = 0; l < lanes && first + l < channels; ++l)
+			any = any || Settings.ActiveChannels[first + l];
+		if (!any)
+			continue;
+
+		const unsigned int ch = static_cast<unsigned int>(first);
+		ColumnLogger & columns = *Columns[owner];
+		if (!columns.Add(AnalogInSid(ch), ch, lanes, sizeof(short),
+				ColumnLogger::DataFile(Settings.Path, ch, columns.Format), ColumnLogger::TableFile(Settings.Path, ch)))
+			{
+			Log("Column log: " + columns.Error());
+			CloseColumnLog();
+			return false;
+			}
+		owner = (owner + 1) % workers;
+		++streams;
+		}
+
+	std::stringstream msg;
+	msg << "Column log: " << streams << " streams to Data.ch<n>.bin and .idx in " << Settings.Path
+		<< ", " << Settings.ColumnLogBlockMB << " MB writes";
+	Log(msg.str());
+	return true;
+}
+
+//---------------------------------------------------------------------------
+//  ApplicationIo::CloseColumnLog() -- Flush and close the column files
+//---------------------------------------------------------------------------
+//  Call only once the ingest workers have stopped.
+
+void ApplicationIo::CloseColumnLog()
+{
+	for (size_t w = 0; w < Columns.size(); ++w)
+		{
+		ColumnLogger & columns = *Columns[w];
+		columns.Close();
+		for (size_t c = 0; c < columns.Count(); ++c)
+			{
+			const ColumnLogger::Column & col = columns.Stream(c);
+			std::stringstream msg;
+			msg << "Column log: " << col.Data->FileName() << ", " << col.Position << " bytes in "
+				<< col.Packets << " packets, " << col.Dropped << " packets dropped";
+			Log(msg.str());
+			}
+		if (!columns.Error().empty())
+			Log("Column log: " + columns.Error());
+		}
+	Columns.clear();
+}
+
+//---------------------------------------------------------------------------
+//  ApplicationIo::Replay() -- Feed a recorded stream file through ingest
+//---------------------------------------------------------------------------
+//  Plays 'file' (Data.bin when empty, or a striped capture's manifest)
+//  into the same entry point as the driver callback, so capture, recorder,
+//  gap and stats behave as in a live run, with no board open.  'speed' 1
+//  paces the packets at SampleRate per active channel, n runs n times
+//  faster and 0 runs flat out; unpaced replay waits for queue room rather
+//  than dropping.  'loops' 0 repeats until the capture completes.
+//  Returns once the replay has finished and its capture is published.
+
+void ApplicationIo::Replay(const std::string & file, double speed, int loops)
+{
+	if (!Stopped)
+		{
+		Log("Replay: stop streaming first");
+		return;
+		}
+
+	UI->GetSettings();
+	unsigned int active = 0;
+	for (size_t ch = 0; ch < Settings.ActiveChannels.size(); ++ch)
+		active += Settings.ActiveChannels[ch] ? 1 : 0;
+	if (!active)
+		{
+		Log("Error: Must enable at least one channel");
+		return;
+		}
+
+	ReplaySource source;
+	source.FileName = file.empty() ? Logger.FileName() : file;
+	source.BufferBytes = std::max(Settings.BusmasterSize/4, 1) * 4 * 1024 * 1024;
+	source.Speed = std::max(speed, 0.0);
+	source.SampleRate = Settings.SampleRate*1.e6;
+	source.Streams = active;
+	source.Loops = static_cast<unsigned int>(std::max(loops, 0));
+
+	FWordCount = 0;
+	SamplesPerWord = std::max(Settings.InputSamplesPerWord, 1);    // As the board packed the file
+	if (Settings.CaptureMode != ApplicationSettings::cmFill)
+		WordsToLog = 0;
+	else
+		WordsToLog = Settings.SamplesToLog / SamplesPerWord;
+
+	//  Nothing is logged to follow; the workers feed the recorders
+	Following = false;
+	Ingest.Stop();
+	AllocateCaptureBuffers();
+	if (Settings.ColumnLog && !OpenColumnLog(source.Speed <= 0.0))
+		return;
+	StopRequested = false;
+	FStats.Reset();
+	Ingest.WaitHistogram(&FStats.QueueWait);
+	Ingest.Start(std::max(Settings.IngestThreads, 1), std::max(Settings.IngestQueueDepth, 2),
+		[this](IngestBufferPtr & Packet, unsigned int worker) {  ProcessPacket(Packet, worker);  });
+	Stopped = false;
+
+	const bool paced = source.Speed > 0.0;
+	const bool started = source.Start([this, paced](std::vector<unsigned int> & words)
+		{
+		if (!paced)
+			while (!Ingest.WaitRoom(10) && !IsDataLoggingCompleted())
+				;
+		IngestBufferPtr Packet(new IngestBuffer);
+		Packet->Words.swap(words);
+		Receive(Packet);
+		});
+	if (!started)
+		Log("Replay: cannot open " + source.FileName);
+	else
+		Log("Replay of " + source.FileName + " started");
+
+	while (source.Running() && !IsDataLoggingCompleted())
+		std::this_thread::sleep_for(std::chrono::milliseconds(10));
+	source.Stop();
+	Stopped = true;
+	StopRequested = false;
+
+	std::stringstream msg;
+	msg << "Replay: " << source.Buffers() << " buffers, " << source.Bytes() << " bytes in "
+		<< source.Seconds() << " s, worst lag " << source.Lag()*1.e3 << " ms, discarded "
+		<< source.Discarded() << " bytes";
+	Log(msg.str());
+
+	FinishCapture();
+}
+
+//---------------------------------------------------------------------------
+//  ApplicationIo::PutCapture() -- Publish a channel to the MATLAB workspace
+//---------------------------------------------------------------------------
+//  'data' is rows x cols samples, one frame per column.  Lands in ch<n>d,
+//  or gch<n> when MATLAB has a GPU, in ExportUnits.  When 'array' already
+//  wraps 'data' and counts are wanted it is handed over as is instead of
+//  being copied into a new one.  mexPutVariable() still copies it into the
+//  workspace, so the capture is resident twice once published; only
+//  AttachCapture() buffers avoid that.
+
+void ApplicationIo::PutCapture(unsigned int ch, const short * data, size_t rows, size_t cols, mxArray * array)
+{
+	std::stringstream name;
+	size_t const bytes = rows*cols*UnitBytes();
+	if (Settings.ExportUnits != ApplicationSettings::euCounts)
+		array = 0;
+
+	if (gpuCount >= 1)
+	{
+		// If matlab detects a GPU, move data to gpu for processing
+
+		mwSize const dims[2] = {rows,cols};
+		mwSize const dim = 2;
+
+		mxGPUArray *ga;
+		ga = mxGPUCreateGPUArray(dim,dims,UnitClass(),mxREAL,MX_GPU_DO_NOT_INITIALIZE);
+		void * gpuArray = mxGPUGetData(ga);
+		if (Settings.ExportUnits == ApplicationSettings::euCounts)
+			cudaMemcpy(gpuArray,data,bytes,cudaMemcpyHostToDevice);
+		else
+		{
+			std::vector<char> host(bytes);
+			ConvertUnits(ch, data, host.empty() ? 0 : &host[0], rows*cols);
+			cudaMemcpy(gpuArray,host.empty() ? 0 : &host[0],bytes,cudaMemcpyHostToDevice);
+		}
+
+		mxArray *fromgpu;
+		fromgpu = mxGPUCreateMxArrayOnGPU(ga);
+		name << "gch" << ch+1;
+		mexPutVariable("base",name.str().c_str(),fromgpu);
+
+		mxDestroyArray(fromgpu);
+		mxGPUDestroyGPUArray(ga);
+	}
+
+	else if (array)
+	{
+		// Samples were captured straight into this array; the workspace
+		// gets its own copy
+		name << "ch" << ch+1 << "d";
+		mexPutVariable("base",name.str().c_str(),array);
+	}
+
+	else
+	{
+		// If a gpu is not detected store data in cpu memory
+		mxArray *myarray;
+		myarray = mxCreateNumericMatrix(rows,cols,UnitClass(),mxREAL);
+		ConvertUnits(ch, data, mxGetData(myarray), rows*cols);
+
+		name << "ch" << ch+1 << "d";
+		mexPutVariable("base",name.str().c_str(),myarray);
+		mxDestroyArray(myarray);
+	}
+}
+
+//---------------------------------------------------------------------------
+//  ApplicationIo::PutPackedCapture() -- Publish a channel held packed
+//---------------------------------------------------------------------------
+//  Unpacked on every core straight into the array that is published, so
+//  the int16 copy exists only for the duration of the export.
+
+void ApplicationIo::PutPackedCapture(unsigned int ch, size_t rows)
+{
+	const PackedCapture & packed = *Captures[ch].Packed;
+	const size_t cols = packed.Capacity()/rows;
+
+	mxArray *array = mxCreateNumericMatrix(rows,cols,mxINT16_CLASS,mxREAL);
+	short *data = (short *)mxGetData(array);
+	packed.Unpack(0, rows*cols, data);
+	if (packed.Clipped())
+		Log("Capture ch" + IntToString(ch+1) + ": " + IntToString(static_cast<int>(packed.Clipped())) +
+			" samples clipped to " + IntToString(static_cast<int>(packed.Bits())) + " bits");
+
+	PutCapture(ch, data, rows, cols, gpuCount >= 1 ? 0 : array);
+	mxDestroyArray(array);
+}
+
+//---------------------------------------------------------------------------
+//  ApplicationIo::ExportCapture() -- Write a channel to an array file
+//---------------------------------------------------------------------------
+//  FrameSize x frames in ExportUnits to Capture.ch<n>.npy, or to .mat as
+//  the variable ch<n>d, without MATLAB.  A packed capture is unpacked a
+//  block of frames at a time, so the int16 copy never exists whole.
+
+void ApplicationIo::ExportCapture(unsigned int ch, size_t rows)
+{
+	const CaptureDest & dest = Captures[ch];
+	const size_t cols = (dest.Packed ? dest.Packed->Capacity() : dest.Samples)/rows;
+
+	ArrayWriter file;
+	file.Format = static_cast<ArrayFile::IIFormat>(Settings.ExportFormat);
+	file.Name = "ch" + IntToString(ch+1) + "d";
+	file.ElementBytes = UnitBytes();
+	file.Floating = Settings.ExportUnits != ApplicationSettings::euCounts;
+	file.Rows = rows;
+	file.Direct = Settings.DiskLogDirect;
+	file.Blocking = true;
+
+	std::stringstream name;
+	name << Settings.Path << "Capture.ch" << ch+1 << ArrayFile::Extension(file.Format);
+	if (!file.Open(name.str()))
+	{
+		Log("Export: " + name.str() + ": " + file.Error());
+		return;
+	}
+
+	if (dest.Packed)
+	{
+		const size_t block = std::max<size_t>(file.BlockBytes/sizeof(short)/rows, 1)*rows;
+		std::vector<short> data(std::min(block, rows*cols));
+		for (size_t first = 0; first < rows*cols; first += block)
+		{
+			const size_t count = std::min(block, rows*cols - first);
+			dest.Packed->Unpack(first, count, &data[0]);
+			WriteUnits(file, ch, &data[0], count);
+		}
+	}
+	else
+		WriteUnits(file, ch, dest.Data, rows*cols);
+	file.Close();
+
+	std::stringstream msg;
+	msg << "Export: " << file.FileName() << ", " << rows << " x " << file.Frames();
+	if (!file.Error().empty())
+		msg << ", " << file.Error();
+	Log(msg.str());
+}
+
+//---------------------------------------------------------------------------
+//  ApplicationIo::ChannelScale() -- Counts to volts for an input channel
+//---------------------------------------------------------------------------
+//  From the IdRom gain and offset ReadRom() loaded and the input span and
+//  ADC width Open() saved, so offline exports need no board.  A channel
+//  the ROM has no entry for is scaled by the span alone, as is every
+//  channel when Calibrated says the board applied the ROM already.
+
+SampleScale ApplicationIo::ChannelScale(unsigned int ch)
+{
+	const bool rom = !Settings.Calibrated;
+	const double gain = rom && ch < Settings.Gain.size() ? Settings.Gain[ch] : 1.;
+	const double offset = rom && ch < Settings.Offset.size() ? Settings.Offset[ch] : 0.;
+	return SampleScale::Calibrated(gain, offset, Settings.InputSpan,
+								   static_cast<unsigned int>(Settings.InputBits));
+}
+
+//---------------------------------------------------------------------------
+//  ApplicationIo::UnitBytes() -- Element size of exported samples
+//---------------------------------------------------------------------------
+
+size_t ApplicationIo::UnitBytes() const
+{
+	switch (Settings.ExportUnits)
+	{
+		case ApplicationSettings::euSingle:  return sizeof(float);
+		case ApplicationSettings::euDouble:  return sizeof(double);
+		default:                             return sizeof(short);
+	}
+}
+
+//---------------------------------------------------------------------------
+//  ApplicationIo::UnitClass() -- MATLAB class of exported samples
+//---------------------------------------------------------------------------
+
+mxClassID ApplicationIo::UnitClass() const
+{
+	switch (Settings.ExportUnits)
+	{
+		case ApplicationSettings::euSingle:  return mxSINGLE_CLASS;
+		case ApplicationSettings::euDouble:  return mxDOUBLE_CLASS;
+		default:                             return mxINT16_CLASS;
+	}
+}
+
+//---------------------------------------------------------------------------
+//  ApplicationIo::ConvertUnits() -- Channel samples into ExportUnits
+//---------------------------------------------------------------------------
+//  'out' holds count x UnitBytes().  Counts are copied; the conversions
+//  run on every core for large buffers.
+
+void ApplicationIo::ConvertUnits(unsigned int ch, const short * data, void * out, size_t count)
+{
+	if (!count)
+		return;
+	if (Settings.ExportUnits == ApplicationSettings::euSingle)
+		ChannelScale(ch).Convert(data, static_cast<float *>(out), count);
+	else if (Settings.ExportUnits == ApplicationSettings::euDouble)
+		ChannelScale(ch).Convert(data, static_cast<double *>(out), count);
+	else
+		memcpy(out, data, count*sizeof(short));
+}
+
+//---------------------------------------------------------------------------
+//  ApplicationIo::WriteUnits() -- Append channel samples in ExportUnits
+//---------------------------------------------------------------------------
+//  Converted a writer block at a time, so only one block of the wider
+//  copy exists at once.  False if any were dropped.
+
+bool ApplicationIo::WriteUnits(ArrayWriter & file, unsigned int ch, const short * data, size_t count)
+{
+	if (Settings.ExportUnits == ApplicationSettings::euCounts)
+		return file.Write(data, count*sizeof(short));
+
+	const size_t block = std::max<size_t>(file.BlockBytes/UnitBytes(), 1);
+	std::vector<char> units(std::min(block, count)*UnitBytes());
+	bool ok = true;
+	for (size_t first = 0; first < count; first += block)
+	{
+		const size_t n = std::min(block, count - first);
+		ConvertUnits(ch, data + first, &units[0], n);
+		ok = file.Write(&units[0], n*UnitBytes()) && ok;
+	}
+	return ok;
+}
+
+//---------------------------------------------------------------------------
+//  ApplicationIo::ReportGaps() -- Log and export packet loss per stream
+//---------------------------------------------------------------------------
+//  Losses are found from the VITA packet counts and timestamps, so this is
+//  the measured answer to whether a PacketSize/BusmasterSize setting keeps
+//  up.  With GapMap on, the workspace gets 'gaps', one row per
+//  discontinuity: [channel, position, packets, samples, ts int, ts frac],
+//  where position is the channel's sample index at which data went
+//  missing.  Negative samples mean the timestamps went backwards.
+
+void ApplicationIo::ReportGaps()
+{
+	std::vector<VitaGap> gaps;
+	for (size_t w = 0; w < Demux.size(); ++w)
+	{
+		for (size_t i = 0; i < Demux[w].Streams(); ++i)
+		{
+			const VitaDemux::Route & r = Demux[w].Stream(i);
+			if (!r.Sequence.Gaps())
+				continue;
+			std::stringstream msg;
+			msg << "Stream 0x" << std::hex << r.Sid << std::dec << ": " << r.Sequence.Gaps()
+				<< " gaps, " << r.Sequence.MissingPackets() << " packets / "
+				<< r.Sequence.MissingSamples() << " samples lost";
+			Log(msg.str());
+		}
+		gaps.insert(gaps.end(), Demux[w].Gaps().begin(), Demux[w].Gaps().end());
+	}
+
+	if (!Settings.GapMap)
+		return;
+
+	mxArray * map = mxCreateDoubleMatrix(gaps.size(), 6, mxREAL);
+	double * col = mxGetPr(map);
+	const size_t n = gaps.size();
+	for (size_t i = 0; i < n; ++i)
+	{
+		col[i]       = static_cast<double>(gaps[i].Sid - AnalogInSid(0) + 1);
+		col[i + n]   = static_cast<double>(gaps[i].Position);
+		col[i + 2*n] = static_cast<double>(gaps[i].Packets);
+		col[i + 3*n] = static_cast<double>(gaps[i].Samples);
+		col[i + 4*n] = static_cast<double>(gaps[i].TsInt);
+		col[i + 5*n] = static_cast<double>(gaps[i].TsFrac);
+	}
+	mexPutVariable("base", "gaps", map);
+	mxDestroyArray(map);
+}
+
+//---------------------------------------------------------------------------
+//  ApplicationIo::FreezeCapture() -- Freeze the flight recorder
+//---------------------------------------------------------------------------
+//  post_frames < 0 freezes at once; otherwise the recorder keeps the rest
+//  of the current frame plus post_frames more, then stops overwriting.
+
+void ApplicationIo::FreezeCapture(int post_frames)
+{
+	for (size_t ch = 0; ch < Recorders.size(); ++ch)
+	{
+		if (!Recorders[ch])
+			continue;
+		if (post_frames < 0)
+			Recorders[ch]->Freeze();
+		else
+			Recorders[ch]->Trigger(post_frames);
+	}
+}
+
+//---------------------------------------------------------------------------
+//  ApplicationIo::ThawCapture() -- Resume flight recording
+//---------------------------------------------------------------------------
+
+void ApplicationIo::ThawCapture()
+{
+	std::lock_guard<std::mutex> lock(TallyLock);
+	for (size_t ch = 0; ch < Recorders.size(); ++ch)
+		if (Recorders[ch])
+			Recorders[ch]->Thaw();
+	std::fill(WorkerFull.begin(), WorkerFull.end(), 0);
+	for (size_t w = 0; w < Demux.size() && w < WorkerFull.size(); ++w)
+		WorkerFull[w] = Demux[w].Destinations() ? 0 : 1;
+	CaptureFull = false;
+}
+
+//---------------------------------------------------------------------------
+//  ApplicationIo::SnapshotCapture() -- Export the newest recorded frames
+//---------------------------------------------------------------------------
+//  Safe while streaming: each ring is copied without stopping its writer.
+//  Publishes each channel through PutCapture (FrameSize x frames) plus
+//  ch<n>start, the stream sample index of its first sample.  frames = 0
+//  takes all held.  Returns the fewest frames exported for any channel.
+
+size_t ApplicationIo::SnapshotCapture(size_t frames)
+{
+	size_t fewest = 0;
+	bool any = false;
+	for (unsigned int ch = 0; ch < Recorders.size(); ++ch)
+	{
+		if (!Recorders[ch])
+			continue;
+
+		const CaptureRing & ring = *Recorders[ch];
+		const size_t want = frames ? std::min(frames, ring.Frames()) : ring.Frames();
+		std::vector<short> data(want*ring.FrameSamples());
+		unsigned long long first = 0;
+		const size_t got = data.empty() ? 0 : ring.Snapshot(&data[0], want, &first);
+
+		std::stringstream msg;
+		msg << "Recorder ch" << ch+1 << ": " << got << " frames from sample " << first
+			<< (ring.Frozen() ? " (frozen)" : "") << ", " << ring.Dropped() << " samples refused";
+		Log(msg.str());
+
+		PutCapture(ch, data.empty() ? 0 : &data[0], ring.FrameSamples(), got);
+
+		std::stringstream name;
+		name << "ch" << ch+1 << "start";
+		mxArray *start = mxCreateDoubleScalar(static_cast<double>(first));
+		mexPutVariable("base",name.str().c_str(),start);
+		mxDestroyArray(start);
+
+		fewest = any ? std::min(fewest, got) : got;
+		any = true;
+	}
+	return fewest;
+}
+
 //---------------------------------------------------------------------------
 //  ApplicationIo::HandleTimer() --  Per-second status timer event
 //---------------------------------------------------------------------------
@@ -1332,6 +2120,7 @@ void ApplicationIo::HandleTimer(OpenWire::NotifyEvent & /*Event*/)
 
     // Display status
     UI->PeriodicStatus();
+    ServiceAutoStop();
 
 //    DioData(~DigIn);
     Trig.AtTimerTick();
@@ -1375,18 +2164,303 @@ void ApplicationIo::HandleOnLog(Innovative::ProcessStatusEvent & Event)
 
 bool  ApplicationIo::IsDataLoggingCompleted()
 {
+    if (CaptureFull)
+        return true;
     if (WordsToLog==0)
         return false;
     else
         return FWordCount >= WordsToLog;
 }
 
+//---------------------------------------------------------------------------
+//  ApplicationIo::AllocateCaptureBuffers() -- Size buffers, build routing table
+//---------------------------------------------------------------------------
+//  Only channels enabled in Settings.ActiveChannels get a destination, and
+//  the SamplesToLog budget is split evenly between them in whole frames.
+//  A channel with a caller buffer attached fills that; otherwise it fills a
+//  persistent FrameSize x frames mxArray that HandleAfterStop publishes as
+//  is, so samples are written once, straight from the packet.  Large page
+//  policies need memory MATLAB cannot provide, so they fill a CaptureMemory
+//  block that is copied out at export.  In recorder mode each gets a ring
+//  of RecorderFrames frames instead; in follow mode the same rings, which
+//  the workers skip and the disk log's follower fills.  Memory is
+//  prefaulted and locked per the Capture* settings, so the first packets
+//  do not take page faults.
+//
+//  Active channels are dealt round-robin to the ingest workers; each
+//  worker's table skips the channels owned by the others.  Storage is kept
+//  across runs when its size has not changed.  Must run on the MATLAB
+//  thread, as mx allocation is not thread safe.
+//
+//  With PackedLanes > 1 each stream carries that many channels interleaved,
+//  under the SID of its first channel, and a PlanarSink splits it into the
+//  channels' buffers.  Recorder mode keeps one channel per stream.
+//
+//  With CapturePacked, and the ADC short of 16 bits, each fill mode channel
+//  is a PackedCapture at the ADC's width instead, unpacked at export.
+//  Caller buffers and interleaved streams stay int16.
+
+void  ApplicationIo::AllocateCaptureBuffers()
+{
+    const size_t channels = Settings.ActiveChannels.size();
+    const size_t workers = std::max(Settings.IngestThreads, 1);
+    const bool recorder = Settings.CaptureMode != ApplicationSettings::cmFill;
+    size_t active = 0;
+    for (size_t ch = 0; ch < channels; ++ch)
+        active += Settings.ActiveChannels[ch] ? 1 : 0;
+    const size_t rows = std::max(Settings.FrameSize, 1);
+    const size_t cols = (active && !recorder) ? static_cast<size_t>(Settings.SamplesToLog / active) / rows : 0;
+    const size_t frames = recorder ? std::max(Settings.RecorderFrames, 1) : 0;
+    const CapturePolicy policy = MemoryPolicy();
+    const bool own = policy.Pages != CapturePolicy::pgNormal;   // mxArrays come in small pages only
+
+    unsigned int lanes = recorder ? 1 : static_cast<unsigned int>(std::max(Settings.PackedLanes, 1));
+    if (lanes > 1 && !Deinterleave::Kernel(sizeof(short), lanes))
+        {
+        Log("PackedLanes must be 1, 2, 4 or 8; capturing one channel per stream");
+        lanes = 1;
+        }
+
+    const unsigned int bits = Settings.CapturePacked && Opened ?
+        static_cast<unsigned int>(Module().Input().Info().Bits()) : 16;
+    const bool pack = bits < 16 && lanes == 1 && !recorder;
+    if (Settings.CapturePacked && lanes > 1)
+        Log("CapturePacked needs PackedLanes 1; capturing int16");
+    else if (pack)
+        Log("Capture memory: packed at " + IntToString(static_cast<int>(bits)) + " bits");
+
+    Captures.resize(channels);
+    Recorders.resize(channels);
+    Planar.assign(lanes > 1 ? channels : 0, std::shared_ptr<PlanarSink>());
+    Demux.assign(workers, VitaDemux());
+    for (size_t w = 0; w < workers; ++w)
+        {
+        Demux[w].TimestampRate(Opened ? Module().Clock().FrequencyActual() : Settings.SampleRate*1.e6);
+        Demux[w].Instrument(&FStats.PacketRoute, &FStats.PacketBytes);
+        }
+    WorkerFull.assign(workers, 0);
+    CaptureFull = false;
+
+    size_t owner = 0;
+    for (size_t ch = 0; ch < channels; ++ch)
+        {
+        const bool want = Settings.ActiveChannels[ch] != 0;
+        const bool attached = ch < Attached.size() && Attached[ch].Data;
+        CaptureDest & dest = Captures[ch];
+
+        if (want && !recorder && attached)
+            {
+            ReleaseCapture(dest);
+            dest = Attached[ch];
+            if (policy.Prefault)
+                CaptureMemory::Prefault(dest.Data, dest.Samples*sizeof(short));
+            }
+        else if (want && pack && cols)
+            {
+            if (!dest.Packed || dest.Samples != rows*cols || dest.Packed->Bits() != bits || dest.Policy != policy.Name())
+                {
+                ReleaseCapture(dest);
+                dest.Packed = std::make_shared<PackedCapture>();
+                if (dest.Packed->Allocate(rows*cols, bits, policy))
+                    {
+                    dest.Samples = rows*cols;
+                    dest.Policy = policy.Name();
+                    }
+                else
+                    dest.Packed.reset();
+                }
+            else
+                dest.Packed->Reset();
+            }
+        else if (want && !recorder && cols)
+            {
+            if (dest.Samples != rows*cols || dest.Policy != policy.Name() || (!dest.Array && !dest.Block))
+                {
+                ReleaseCapture(dest);
+                const size_t bytes = rows*cols*sizeof(short);
+                if (own)
+                    {
+                    dest.Block = std::make_shared<CaptureMemory>();
+                    if (dest.Block->Allocate(bytes, policy))
+                        dest.Data = dest.Block->As<short>();
+                    if (dest.Block->Pages() != policy.Pages)
+                        Log("Capture memory: large pages refused, using " +
+                            IntToString(static_cast<int>(dest.Block->PageBytes()/1024)) + " KB pages");
+                    }
+                else
+                    {
+                    dest.Array = mxCreateNumericMatrix(rows, cols, mxINT16_CLASS, mxREAL);
+                    mexMakeArrayPersistent(dest.Array);
+                    dest.Data = static_cast<short *>(mxGetData(dest.Array));
+                    if (policy.Prefault)
+                        CaptureMemory::Prefault(dest.Data, bytes);
+                    if (policy.Lock)
+                        dest.Locked = CaptureMemory::Lock(dest.Data, bytes);
+                    }
+                dest.Samples = dest.Data ? rows*cols : 0;
+                dest.Policy = policy.Name();
+                }
+            }
+        else
+            ReleaseCapture(dest);
+
+        if (want && recorder)
+            {
+            if (!Recorders[ch] || Recorders[ch]->Frames() != frames || Recorders[ch]->FrameSamples() != rows)
+                {
+                Recorders[ch] = std::make_shared<CaptureRing>();
+                Recorders[ch]->Allocate(frames, rows, policy);
+                }
+            else
+                Recorders[ch]->Reset();
+            }
+        else
+            Recorders[ch].reset();
+
+        if ((!dest.Data && !dest.Packed && !Recorders[ch]) || lanes > 1)
+            continue;
+
+        const unsigned int sid = AnalogInSid(static_cast<unsigned int>(ch));
+        for (size_t w = 0; w < workers; ++w)
+            if (w != owner || (Recorders[ch] && Following))
+                Demux[w].SkipStream(sid);
+            else if (Recorders[ch])
+                Demux[w].AddSink(sid, Recorders[ch].get(), sizeof(short));
+            else if (dest.Packed)
+                Demux[w].AddSink(sid, dest.Packed.get(), sizeof(short));
+            else
+                Demux[w].AddStream(sid, dest.Data, dest.Samples);
+        owner = (owner + 1) % workers;
+        }
+
+    //  Packed streams: route each to a splitter feeding its channels
+    for (size_t first = 0; lanes > 1 && first < channels; first += lanes)
+        {
+        std::shared_ptr<PlanarSink> sink = std::make_shared<PlanarSink>();
+        sink->Format(sizeof(short), lanes);
+        bool any = false;
+        for (unsigned int l = 0; l < lanes && first + l < channels; ++l)
+            {
+            sink->Lane(l, Captures[first + l].Data, Captures[first + l].Samples);
+            any = any || Captures[first + l].Data != 0;
+            }
+        if (!any)
+            continue;
+        Planar[first] = sink;
+
+        const unsigned int sid = AnalogInSid(static_cast<unsigned int>(first));
+        for (size_t w = 0; w < workers; ++w)
+            if (w != owner)
+                Demux[w].SkipStream(sid);
+            else
+                Demux[w].AddSink(sid, sink.get(), sizeof(short) * lanes);
+        owner = (owner + 1) % workers;
+        }
+
+    //  Workers left without a channel count as full from the start
+    for (size_t w = 0; w < workers; ++w)
+        WorkerFull[w] = Demux[w].Destinations() ? 0 : 1;
+}
+
+//---------------------------------------------------------------------------
+//  ApplicationIo::ReleaseCapture() -- Drop one channel's destination
+//---------------------------------------------------------------------------
+
+void  ApplicationIo::ReleaseCapture(CaptureDest & dest)
+{
+    if (dest.Locked)
+        CaptureMemory::Unlock(dest.Data, dest.Samples*sizeof(short));
+    if (dest.Array)
+        mxDestroyArray(dest.Array);
+    dest = CaptureDest();
+}
+
+//---------------------------------------------------------------------------
+//  ApplicationIo::MemoryPolicy() -- Capture memory policy from settings
+//---------------------------------------------------------------------------
+
+CapturePolicy  ApplicationIo::MemoryPolicy() const
+{
+    const int pages = std::min(std::max(Settings.CapturePages, 0), static_cast<int>(CapturePolicy::pgHuge));
+    return CapturePolicy(static_cast<CapturePolicy::IIPages>(pages), Settings.CapturePrefault,
+                         Settings.CaptureLock, Settings.CaptureNumaNode);
+}
+
+//---------------------------------------------------------------------------
+//  ApplicationIo::ReleaseCaptureBuffers() -- Free channelized capture buffers
+//---------------------------------------------------------------------------
+
+void  ApplicationIo::ReleaseCaptureBuffers()
+{
+    Demux.clear();
+    for (size_t ch = 0; ch < Captures.size(); ++ch)
+        ReleaseCapture(Captures[ch]);
+    Captures.clear();
+    Recorders.clear();
+    Planar.clear();
+}
+
+//---------------------------------------------------------------------------
+//  ApplicationIo::AttachCapture() -- Capture a channel into a caller buffer
+//---------------------------------------------------------------------------
+//  Zero-copy path for callers that own the destination, e.g. a MATLAB
+//  libpointer: samples are written there directly and nothing is published
+//  to the workspace for that channel.  The buffer must outlive the run.
+//  Takes effect at the next StartStreaming; data = 0 detaches.
+
+void  ApplicationIo::AttachCapture(unsigned int ch, short * data, size_t samples)
+{
+    if (ch >= Attached.size())
+        Attached.resize(ch + 1);
+    Attached[ch].Data = samples ? data : 0;
+    Attached[ch].Samples = data ? samples : 0;
+    Attached[ch].Array = 0;
+}
+
+//---------------------------------------------------------------------------
+//  ApplicationIo::CapturedSamples() -- Samples stored so far for a channel
+//---------------------------------------------------------------------------
+
+size_t  ApplicationIo::CapturedSamples(unsigned int ch) const
+{
+    if (ch < Captures.size() && Captures[ch].Packed)
+        return Captures[ch].Packed->Samples();
+
+    for (size_t first = 0; first <= ch && first < Planar.size(); ++first)
+        if (Planar[first] && ch < first + Planar[first]->Lanes())
+            return Captures[ch].Data ? Planar[first]->Frames() : 0;
+
+    for (size_t w = 0; w < Demux.size(); ++w)
+        {
+        const int idx = Demux[w].Find(AnalogInSid(ch));
+        if (idx >= 0 && Demux[w].Stream(idx).Dest)
+            return Demux[w].Samples(idx);
+        }
+    return 0;
+}
+
+//---------------------------------------------------------------------------
+//  ApplicationIo::StreamCounters() -- Per-stream totals across workers
+//---------------------------------------------------------------------------
+//  One entry per routed SID; streams skipped by a worker are owned, and
+//  counted, by another.  The counters are those the workers last
+//  published, so this may be called while they run.
+
+void  ApplicationIo::StreamCounters(std::vector<VitaDemux::Totals> & totals) const
+{
+    totals.clear();
+    for (size_t w = 0; w < Demux.size(); ++w)
+        for (size_t i = 0; i < Demux[w].Streams(); ++i)
+            {
+            const VitaDemux::Route & r = Demux[w].Stream(i);
+            if (r.Dest || r.Sink)
+                totals.push_back(Demux[w].Published(i));
+            }
+}
+
 bool ApplicationIo::DLC()
 {
-	if (WordsToLog==0)
-		return false;
-	else
-		return FWordCount >= WordsToLog;
+	return IsDataLoggingCompleted();
 }
 
 //---------------------------------------------------------------------------
@@ -1446,6 +2520,17 @@ void  ApplicationIo::HandleExternalTrigger(OpenWire::NotifyEvent & /*Event*/)
     Module().Input().Trigger().External(true);
 }
 
+//---------------------------------------------------------------------------
+//  ApplicationIo::HandleInputTrigger() --  Input trigger alert freezes recorder
+//---------------------------------------------------------------------------
+
+void  ApplicationIo::HandleInputTrigger(Innovative::AlertSignalEvent & /*Event*/)
+{
+    if (Settings.CaptureMode == ApplicationSettings::cmFill || !Settings.RecorderTriggerFreeze)
+        return;
+    FreezeCapture(std::max(Settings.RecorderPostTrigger, 0));
+}
+
 //------------------------------------------------------------------------------
 //  ApplicationIo::DisplayLogicVersion() --  Log version info
 //------------------------------------------------------------------------------
@@ -1634,7 +2719,8 @@ ApplicationSettings::ApplicationSettings()
 	ActiveChannels(AnalogInChannels()),
 	AlertEnable(AnalogInAlerts(), false),
 	Gain(AnalogInChannels()),
-	Offset(AnalogInChannels())
+	Offset(AnalogInChannels()),
+	Calibrated(false)
 
 
 {
@@ -1683,6 +2769,47 @@ ApplicationSettings::ApplicationSettings()
     Install( ToIni("SamplesToLog",           SamplesToLog,                (ii64)0100000u)  );
     Install( ToIni("AutoStop",               AutoStop,                    true)  );
     Install( ToIni("ForcePacketsize",        ForcePacketSize,             false)  );
+    Install( ToIni("DiskLog",                DiskLog,                     false)  );
+    Install( ToIni("DiskLogBlockMB",         DiskLogBlockMB,              4)  );
+    Install( ToIni("DiskLogDepth",           DiskLogDepth,                4)  );
+    Install( ToIni("DiskLogReserveMB",       DiskLogReserveMB,            0)  );
+    Install( ToIni("DiskLogDirect",          DiskLogDirect,               true)  );
+    Install( ToIni("DiskLogStripes",         DiskLogStripes,              std::string(""))  );
+    Install( ToIni("DiskLogExtentMB",        DiskLogExtentMB,             64)  );
+    Install( ToIni("DiskLogIndex",           DiskLogIndex,                true)  );
+    Install( ToIni("DiskLogCompress",        DiskLogCompress,             false)  );
+    Install( ToIni("DiskLogCompressThreads", DiskLogCompressThreads,      2)  );
+    Install( ToIni("DiskLogSegmentMB",       DiskLogSegmentMB,            0)  );
+    Install( ToIni("DiskLogSegmentSeconds",  DiskLogSegmentSeconds,       0)  );
+    Install( ToIni("DiskLogRetainSegments",  DiskLogRetainSegments,       0)  );
+    Install( ToIni("DiskLogRetainGB",        DiskLogRetainGB,             0)  );
+    Install( ToIni("ColumnLog",              ColumnLog,                   false)  );
+    Install( ToIni("ColumnLogBlockMB",       ColumnLogBlockMB,            1)  );
+    Install( ToIni("ExportFormat",           ExportFormat,                0)  );
+    Install( ToIni("ExportWorkspace",        ExportWorkspace,             true)  );
+    Install( ToIni("ExportUnits",            ExportUnits,                 0)  );
+    Install( ToIni("InputSpan",              InputSpan,                   2.0f)  );
+    Install( ToIni("InputBits",              InputBits,                   16)  );
+    Install( ToIni("InputSamplesPerWord",    InputSamplesPerWord,         2)  );
+    Install( ToIni("ParseBlockMB",           ParseBlockMB,                64)  );
+
+    //  Ingest
+    Install( ToIni("IngestThreads",          IngestThreads,               1)  );
+    Install( ToIni("IngestQueueDepth",       IngestQueueDepth,            64)  );
+
+    //  Capture
+    Install( ToIni("CaptureMode",            CaptureMode,                 0)  );
+    Install( ToIni("RecorderFrames",         RecorderFrames,              64)  );
+    Install( ToIni("FollowIntervalMs",       FollowIntervalMs,            20)  );
+    Install( ToIni("RecorderPostTrigger",    RecorderPostTrigger,         0)  );
+    Install( ToIni("RecorderTriggerFreeze",  RecorderTriggerFreeze,       false)  );
+    Install( ToIni("CapturePages",           CapturePages,                0)  );
+    Install( ToIni("CapturePrefault",        CapturePrefault,             true)  );
+    Install( ToIni("CaptureLock",            CaptureLock,                 false)  );
+    Install( ToIni("CaptureNumaNode",        CaptureNumaNode,             -1)  );
+    Install( ToIni("CapturePacked",          CapturePacked,               false)  );
+    Install( ToIni("GapMap",                 GapMap,                      true)  );
+    Install( ToIni("PackedLanes",            PackedLanes,                 1)  );
 
     Install( ToIni("Help",             Help,  true) );
 
@@ -6,6 +6,20 @@
 #define ApplicationIoH
 
 #include "ModuleIo.h"
+#include "VitaDemux.h"
+#include "IngestPipeline.h"
+#include "CaptureRing.h"
+#include "PackedCapture.h"
+#include "PlanarSink.h"
+#include "IngestStats.h"
+#include "StripedLogger.h"
+#include "ColumnLogger.h"
+#include "PacketIndex.h"
+#include "CompressedLogger.h"
+#include "SegmentedLogger.h"
+#include "VitaFollower.h"
+#include "SampleScale.h"
+#include "BlockReader.h"
 #include <ProcessEvents_Mb.h>
 #include <VitaPacketStream_Mb.h>
 #include <PacketStream_Mb.h>
@@ -29,8 +43,24 @@
 #include <matrix.h>
 #include "mxGPUArray.h"
 #include <mex.h>
+#include <memory>
+#include <mutex>
+#include <atomic>
 class ApplicationIo;
 
+//  A received buffer as handed to the ingest workers.  Whichever worker
+//  gets to it first scans the VITA headers; the others reuse the index.
+//  Buffers from a software source (replay) carry their words in Words
+//  instead of Buffer.
+struct IngestBuffer
+{
+    Innovative::VeloBuffer  Buffer;
+    std::vector<unsigned int>  Words;
+    std::once_flag          Scanned;
+    VitaIndex               Index;
+};
+typedef std::shared_ptr<IngestBuffer>    IngestBufferPtr;
+
 // -----------------------------------
 // Class ProcessinThread - For Parsing
 // Added 6/2/2014 mpd for parsing
@@ -133,6 +163,53 @@ public:
     bool            OverwriteBdd;
     bool            AutoStop;
     bool            ForcePacketSize;
+    bool            DiskLog;            // Raw stream to Data.bin from a writer thread
+    int             DiskLogBlockMB;     // Size of each write
+    int             DiskLogDepth;       // Writes in flight
+    int             DiskLogReserveMB;   // Preallocated at start, 0 = none
+    bool            DiskLogDirect;      // Bypass the page cache
+    std::string     DiskLogStripes;     // Directories to stripe across, ';' separated
+    int             DiskLogExtentMB;    // Stripe unit
+    bool            DiskLogIndex;       // Packet index to Data.vidx beside it
+    bool            DiskLogCompress;    // Losslessly compressed, to Data.vcz instead
+    int             DiskLogCompressThreads; // Threads coding the chunks
+    int             DiskLogSegmentMB;   // Roll over to Data.<n>.bin at this size, 0 = one file
+    int             DiskLogSegmentSeconds; // ...or after this long, 0 = no limit
+    int             DiskLogRetainSegments; // Sealed segments kept, 0 = all
+    int             DiskLogRetainGB;    // ...up to this total, 0 = no limit
+    bool            ColumnLog;          // Each stream's samples to Data.ch<n>.bin, packets to .idx
+    int             ColumnLogBlockMB;   // Size of each column file write
+    enum IIExportFormat { efNone, efNpy, efMat };
+    int             ExportFormat;       // Captures and column files as .npy or v7.3 .mat
+    bool            ExportWorkspace;    // Captures to the MATLAB workspace as well
+    enum IIExportUnits { euCounts, euSingle, euDouble };
+    int             ExportUnits;        // Captures and parses as int16 counts, or as calibrated
+                                        // ...volts in single or double precision
+    float           InputSpan;          // Volts full scale for those, the board's when last opened
+    int             InputBits;          // ...and its ADC's significant bits
+    int             InputSamplesPerWord; // ...and samples per 32-bit word, for replay
+    int             ParseBlockMB;       // Per channel block of a streamed parse
+
+    //  Ingest
+    int             IngestThreads;      // Worker threads channelizing packets
+    int             IngestQueueDepth;   // Buffers queued per worker
+
+    //  Capture
+    enum IICaptureMode { cmFill, cmRecorder, cmFollow };
+    int             CaptureMode;            // Fill SamplesToLog once, or record continuously,
+                                            // ...from the disk log as it is written with cmFollow
+    int             RecorderFrames;         // Frames of FrameSize held per channel
+    int             FollowIntervalMs;       // Disk log poll period with cmFollow
+    int             RecorderPostTrigger;    // Frames let in after a trigger before freezing
+    bool            RecorderTriggerFreeze;  // Input trigger alerts freeze the recorder
+    int             CapturePages;           // CapturePolicy::IIPages; large pages bypass
+                                            // ...the mxArray and cost one copy at export
+    bool            CapturePrefault;        // Fault capture memory in before streaming
+    bool            CaptureLock;            // Pin capture memory
+    int             CaptureNumaNode;        // -1 for any
+    bool            CapturePacked;          // Hold fill captures at the ADC's bit width
+    bool            GapMap;                 // Export stream discontinuities as 'gaps'
+    int             PackedLanes;            // Channels interleaved per input stream (1, 2, 4, 8)
 
     //  Log Page Data
     struct LogD
@@ -249,12 +326,36 @@ public:
         {   return (isr_status>>10)&0x3F;   }       
 
     void ClockInfo();
-	void ParseFile(int ohhgod);
+	enum IIParseMode { pmWorkspace, pmFiles, pmScan, pmStream };
+	void ParseFile(IIParseMode mode);
+	long long ExtractFrames(const std::string & file, unsigned long long first, size_t count,
+							unsigned int mask, short * out);
 	void doVpp();
 	void testArray();
 	bool DLC();
 	void putMat(vector<short> *ch1, vector<short> *ch2);
 	void setParameters(const char *param, double value);
+	void Benchmark(int mode);
+	void Replay(const std::string & file, double speed, int loops);
+	QueueStatus IngestStatus(unsigned int worker) const
+		{  return Ingest.Status(worker);  }
+	unsigned long long IngestDrops() const
+		{  return Ingest.Drops();  }
+	unsigned int IngestWorkers() const
+		{  return Ingest.Workers();  }
+	void FreezeCapture(int post_frames);
+	void ThawCapture();
+	size_t SnapshotCapture(size_t frames);
+	void AttachCapture(unsigned int ch, short * data, size_t samples);
+	IngestStats & Stats()
+		{  return FStats;  }
+	const StripedLogger & DiskLog() const
+		{  return Disk;  }
+	const SegmentedLogger & SegmentLog() const
+		{  return Segments;  }
+	const std::vector< std::shared_ptr<ColumnLogger> > & ColumnLog() const
+		{  return Columns;  }
+	void StreamCounters(std::vector<VitaDemux::Totals> & totals) const;
 
 
     
@@ -266,6 +367,22 @@ public: // Pseudo-protected
 //	void Extract();
 
 private:
+    //  Where one channel's samples land, straight from the packet payload
+    struct CaptureDest
+    {
+        CaptureDest() : Data(0), Samples(0), Array(0), Locked(false)  {}
+
+        short *         Data;
+        size_t          Samples;    // Capacity
+        mxArray *       Array;      // Owning persistent mxArray, or
+        std::shared_ptr<CaptureMemory>
+                        Block;      // ...block under CapturePages; neither if caller supplied
+        std::shared_ptr<PackedCapture>
+                        Packed;     // In place of all three under CapturePacked
+        std::string     Policy;     // Policy it was set up under
+        bool            Locked;
+    };
+
     //  Random test comment
     //  Member Data
     ModuleIo                            Module;
@@ -275,26 +392,37 @@ private:
     Innovative::SoftwareTimer           Timer;
     Innovative::StopWatch               RunTimeSW;
     Innovative::DataLogger              Logger;
+    StripedLogger                       Disk;           // Async writer(s) behind DiskLog
+    PacketIndexWriter                   DiskIndex;      // ...and its .vidx
+    CompressedLogger                    Compressor;     // ...and its coder, behind DiskLogCompress
+    SegmentedLogger                     Segments;       // In place of all three, behind DiskLogSegment*
+    VitaFollower                        Follower;       // Reads either back for the recorders, in follow mode
+    bool                                Following;      // ...and is, for this run
+    std::vector< std::shared_ptr<ColumnLogger> >
+                                        Columns;        // Per worker, behind ColumnLog
     Innovative::BinviewPlotter          RtPlot;
     Innovative::BinView                 Graph;
     Innovative::BinView                 InGraph;
     Innovative::BinView                 OutGraph;
 	Innovative::VitaPacketParser        Vpp;
 	Innovative::DataPlayer              Player;
-	short                               * arrch1;
-	short                               * arrch2;
-	mxArray                             * mxarrch1;
-	mxArray                             * mxarrch2;
-//	void *                              mxptrch1;
-//	short *                              mxptrch2;
+	IngestPipeline<IngestBufferPtr>     Ingest;         // Callback -> worker hand-off
+	std::vector<VitaDemux>              Demux;          // Routing table per worker
+	std::vector<char>                   WorkerFull;     // ...its destinations are full
+	std::mutex                          TallyLock;
+	std::atomic<bool>                   StopRequested;  // Auto stop raised by a worker
+	IngestStats                         FStats;         // Always-on ingest instrumentation
+	std::atomic<bool>                   CaptureFull;
+	std::vector<CaptureDest>            Captures;       // Fill mode destination per input channel
+	std::vector<CaptureDest>            Attached;       // ...caller-owned ones, see AttachCapture()
+	std::vector< std::shared_ptr<CaptureRing> >  Recorders; // Flight recorder per input channel, in recorder mode
+	std::vector< std::shared_ptr<PlanarSink> >   Planar;    // Splitter per packed stream, by first channel
 //	std::vector<short>                  asdfch1asdf;
 //	std::vector<short>                  asdfch2asdf;
 //	mxGPUArray                          *asdfgpuch1asdf;
 //  mxGPUArray                          *asdfgpuch2asdf;
 //	short                               *agpuch1a;
 //	short                               *agpuch2a;
-	int                                 cntrch1;
-	int                                 cntrch2;
 	int                                 gpuCount;
 
 	// Data
@@ -308,8 +436,8 @@ private:
     bool                                StreamConnected;
     bool                                Stopped;
     //  App Status variables
-    double                              FBlockRate;
-    ii64                                FWordCount;
+    std::atomic<double>                 FBlockRate;
+    std::atomic<ii64>                   FWordCount;
     int                                 SamplesPerWord;
     ii64                                WordsToLog;
 
@@ -321,6 +449,9 @@ private:
     //
     //  Member Functions
     void  HandleDataAvailable(Innovative::VitaPacketStreamDataEvent & Event);
+    void  Receive(IngestBufferPtr & Packet);
+    void  ProcessPacket(IngestBufferPtr & Packet, unsigned int worker);
+    void  ServiceAutoStop();
     void  Handle_VPP_ImageAvailable(Innovative::VitaPacketParserImageAvailable & Event);
 
     void  HandleBeforeStreamStart(OpenWire::NotifyEvent & Event);
@@ -336,6 +467,7 @@ private:
 
     void  HandleDisableTrigger(OpenWire::NotifyEvent & Event);
     void  HandleExternalTrigger(OpenWire::NotifyEvent & Event);
+    void  HandleInputTrigger(Innovative::AlertSignalEvent & Event);
     void  HandleSoftwareTrigger(OpenWire::NotifyEvent & Event);
 
 	OpenWire::ThunkedEventHandler<Innovative::ProcessCompletionEvent> OnSplitComplete;
@@ -357,6 +489,30 @@ private:
     void  DoDelay();
 
     bool  IsDataLoggingCompleted();
+    void  AllocateCaptureBuffers();
+    void  ReleaseCaptureBuffers();
+    size_t  CapturedSamples(unsigned int ch) const;
+    void  ReleaseCapture(CaptureDest & dest);
+    CapturePolicy  MemoryPolicy() const;
+    void  PutCapture(unsigned int ch, const short * data, size_t rows, size_t cols, mxArray * array = 0);
+    SampleScale  ChannelScale(unsigned int ch);
+    size_t  UnitBytes() const;
+    mxClassID  UnitClass() const;
+    void  ConvertUnits(unsigned int ch, const short * data, void * out, size_t count);
+    bool  WriteUnits(ArrayWriter & file, unsigned int ch, const short * data, size_t count);
+    void  PutPackedCapture(unsigned int ch, size_t rows);
+    void  ExportCapture(unsigned int ch, size_t rows);
+    void  StreamParse(const std::string & file);
+    void  ReportGaps();
+    void  FinishCapture();
+    bool  OpenDiskLog();
+    bool  OpenSegmentLog();
+    void  CloseDiskLog();
+    bool  CanFollowDiskLog() const;
+    void  StartFollower();
+    void  FinishFollower();
+    bool  OpenColumnLog(bool blocking);
+    void  CloseColumnLog();
     void  InitBddFile(Innovative::BinView & graph);
 
     void  DisplayLogicVersion();
@@ -0,0 +1,438 @@
+// ArrayFile.cpp
+//
+// NumPy .npy and MATLAB v7.3 files written as a stream
+
+#include "ArrayFile.h"
+#include <algorithm>
+#include <sstream>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+
+namespace
+{
+    const unsigned long long Undefined = ~0ull;
+    const size_t UserBlock = 512;               // MATLAB's header, before the HDF5 data
+
+    //-----------------------------------------------------------------------
+    //  Builder -- Little endian byte buffer
+    //-----------------------------------------------------------------------
+
+    struct Builder
+    {
+        std::vector<unsigned char> & Out;
+
+        explicit Builder(std::vector<unsigned char> & out)
+            : Out(out)
+            {}
+        void  U8(unsigned int v)
+            {  Out.push_back(static_cast<unsigned char>(v));  }
+        void  U16(unsigned int v)
+            {  U8(v & 0xFF);  U8(v >> 8 & 0xFF);  }
+        void  U32(unsigned int v)
+            {  U16(v & 0xFFFF);  U16(v >> 16);  }
+        void  U64(unsigned long long v)
+            {  U32(static_cast<unsigned int>(v));  U32(static_cast<unsigned int>(v >> 32));  }
+        void  Text(const std::string & s)
+            {  Out.insert(Out.end(), s.begin(), s.end());  }
+        size_t  Size() const
+            {  return Out.size();  }
+        //  Patch a 32-bit field written earlier
+        void  Set32(size_t at, unsigned int v)
+            {
+            for (int k = 0; k < 4; ++k)
+                Out[at + k] = static_cast<unsigned char>(v >> 8*k);
+            }
+    };
+
+    //  Bob Jenkins' lookup3 hashlittle(), the HDF5 metadata checksum
+    inline unsigned int  Rot(unsigned int x, int k)
+        {  return (x << k) | (x >> (32 - k));  }
+
+    unsigned int  Checksum(const unsigned char * k, size_t length)
+    {
+        unsigned int a, b, c;
+        a = b = c = 0xdeadbeef + static_cast<unsigned int>(length);
+        for (; length > 12; length -= 12, k += 12)
+            {
+            a += k[0] + (k[1] << 8) + (k[2] << 16) + (static_cast<unsigned int>(k[3]) << 24);
+            b += k[4] + (k[5] << 8) + (k[6] << 16) + (static_cast<unsigned int>(k[7]) << 24);
+            c += k[8] + (k[9] << 8) + (k[10] << 16) + (static_cast<unsigned int>(k[11]) << 24);
+            a -= c;  a ^= Rot(c, 4);   c += b;
+            b -= a;  b ^= Rot(a, 6);   a += c;
+            c -= b;  c ^= Rot(b, 8);   b += a;
+            a -= c;  a ^= Rot(c, 16);  c += b;
+            b -= a;  b ^= Rot(a, 19);  a += c;
+            c -= b;  c ^= Rot(b, 4);   b += a;
+            }
+        if (!length)
+            return c;
+        //  The tail, zero padded, adds in as a whole last block would
+        unsigned char t[12] = { 0 };
+        std::memcpy(t, k, length);
+        a += t[0] + (t[1] << 8) + (t[2] << 16) + (static_cast<unsigned int>(t[3]) << 24);
+        b += t[4] + (t[5] << 8) + (t[6] << 16) + (static_cast<unsigned int>(t[7]) << 24);
+        c += t[8] + (t[9] << 8) + (t[10] << 16) + (static_cast<unsigned int>(t[11]) << 24);
+        c ^= b;  c -= Rot(b, 14);
+        a ^= c;  a -= Rot(c, 11);
+        b ^= a;  b -= Rot(a, 25);
+        c ^= b;  c -= Rot(b, 16);
+        a ^= c;  a -= Rot(c, 4);
+        b ^= a;  b -= Rot(a, 14);
+        c ^= b;  c -= Rot(b, 24);
+        return c;
+    }
+
+    //-----------------------------------------------------------------------
+    //  Npy() -- NumPy 1.0 header, padded with spaces to HeaderBytes
+    //-----------------------------------------------------------------------
+
+    void  Npy(size_t element_bytes, bool floating, const std::vector<unsigned long long> & dims,
+              std::vector<unsigned char> & out)
+    {
+        std::stringstream dict;
+        dict << "{'descr': '<" << (floating ? 'f' : 'i') << element_bytes << "', 'fortran_order': True, 'shape': (";
+        for (size_t d = 0; d < dims.size(); ++d)
+            dict << dims[d] << (dims.size() == 1 || d + 1 < dims.size() ? ", " : "");
+        dict << "), }";
+        std::string text = dict.str();
+        text.resize(ArrayFile::HeaderBytes - 10 - 1, ' ');
+        text += '\n';
+
+        Builder b(out);
+        b.U8(0x93);
+        b.Text("NUMPY");
+        b.U8(1);
+        b.U8(0);
+        b.U16(static_cast<unsigned int>(text.size()));
+        b.Text(text);
+    }
+
+    //-----------------------------------------------------------------------
+    //  Version 2 object header -- Messages go between Begin() and End()
+    //-----------------------------------------------------------------------
+    //  Chunk size is a 4 byte field; no times, no creation order.
+
+    size_t  BeginObject(Builder & b)
+    {
+        b.Text("OHDR");
+        b.U8(2);
+        b.U8(0x02);
+        const size_t size_at = b.Size();
+        b.U32(0);
+        return size_at;
+    }
+
+    void  EndObject(Builder & b, size_t start, size_t size_at)
+    {
+        b.Set32(size_at, static_cast<unsigned int>(b.Size() - size_at - 4));
+        b.U32(Checksum(&b.Out[start], b.Size() - start));
+    }
+
+    void  Message(Builder & b, unsigned int type, size_t bytes, unsigned int flags = 0)
+    {
+        b.U8(type);
+        b.U16(static_cast<unsigned int>(bytes));
+        b.U8(flags);
+    }
+
+    //-----------------------------------------------------------------------
+    //  Mat() -- MATLAB user block, HDF5 superblock, root group, dataset
+    //-----------------------------------------------------------------------
+    //  Addresses are relative to the superblock, which follows the user
+    //  block; the end of file address, as HDF5 itself writes it, is not.
+
+    void  Mat(const std::string & name, size_t element_bytes, bool floating,
+              const std::vector<unsigned long long> & dims, unsigned long long data_bytes,
+              std::vector<unsigned char> & out)
+    {
+        Builder b(out);
+
+        //  MATLAB's text header and version, as for any v7.3 file
+        char when[64] = "";
+        const std::time_t now = std::time(0);
+        std::strftime(when, sizeof(when), "%a %b %d %H:%M:%S %Y", std::localtime(&now));
+#ifdef _WIN64
+        const char * platform = "PCWIN64";
+#else
+        const char * platform = "GLNXA64";
+#endif
+        std::string text = std::string("MATLAB 7.3 MAT-file, Platform: ") + platform + ", Created on: " +
+            when + " HDF5 schema 1.00 .";
+        text.resize(116, ' ');
+        b.Text(text);
+        for (int k = 0; k < 8; ++k)
+            b.U8(0);
+        b.U16(0x0200);
+        b.Text("IM");
+        out.resize(UserBlock, 0);
+
+        const unsigned long long data = ArrayFile::HeaderBytes - UserBlock;
+        const size_t sb = b.Size();
+        const unsigned long long root = 48;
+
+        //  Superblock, version 2
+        b.U8(0x89);
+        b.Text("HDF\r\n\x1a\n");
+        b.U8(2);
+        b.U8(8);
+        b.U8(8);
+        b.U8(0);
+        b.U64(UserBlock);
+        b.U64(Undefined);
+        b.U64(ArrayFile::HeaderBytes + data_bytes);
+        b.U64(root);
+        b.U32(Checksum(&out[sb], b.Size() - sb));
+
+        //  Root group: link info, group info and one hard link
+        const size_t root_at = b.Size();
+        size_t size_at = BeginObject(b);
+        Message(b, 0x02, 18);
+        b.U8(0);
+        b.U8(0);
+        b.U64(Undefined);
+        b.U64(Undefined);
+        Message(b, 0x0A, 2, 0x01);
+        b.U8(0);
+        b.U8(0);
+        Message(b, 0x06, 2 + 1 + name.size() + 8);
+        b.U8(1);
+        b.U8(0);
+        b.U8(static_cast<unsigned int>(name.size()));
+        b.Text(name);
+        const size_t set_at = b.Size() + 8 + 4;     // Just past this header's checksum
+        b.U64(set_at - sb);
+        EndObject(b, root_at, size_at);
+
+        //  The dataset
+        size_at = BeginObject(b);
+
+        //  Dataspace, version 2, HDF5 order: slowest first
+        Message(b, 0x01, 4 + 8 * dims.size());
+        b.U8(2);
+        b.U8(static_cast<unsigned int>(dims.size()));
+        b.U8(0);
+        b.U8(1);
+        unsigned long long elements = 1;
+        for (size_t d = dims.size(); d--; )
+            {
+            b.U64(dims[d]);
+            elements *= dims[d];
+            }
+
+        if (floating)
+            {
+            //  Little endian IEEE floating point, implied leading mantissa bit
+            const bool wide = element_bytes == 8;
+            Message(b, 0x03, 20, 0x01);
+            b.U8(0x11);
+            b.U8(0x20);
+            b.U8(wide ? 63 : 31);
+            b.U8(0);
+            b.U32(static_cast<unsigned int>(element_bytes));
+            b.U16(0);
+            b.U16(static_cast<unsigned int>(8 * element_bytes));
+            b.U8(wide ? 52 : 23);
+            b.U8(wide ? 11 : 8);
+            b.U8(0);
+            b.U8(wide ? 52 : 23);
+            b.U32(wide ? 1023 : 127);
+            }
+        else
+            {
+            //  Signed little endian fixed point
+            Message(b, 0x03, 12, 0x01);
+            b.U8(0x10);
+            b.U8(0x08);
+            b.U8(0);
+            b.U8(0);
+            b.U32(static_cast<unsigned int>(element_bytes));
+            b.U16(0);
+            b.U16(static_cast<unsigned int>(8 * element_bytes));
+            }
+
+        //  Fill value, version 3: late allocation, no value set
+        Message(b, 0x05, 2, 0x01);
+        b.U8(3);
+        b.U8(0x0A);
+
+        //  Contiguous layout, version 3
+        Message(b, 0x08, 18);
+        b.U8(3);
+        b.U8(1);
+        b.U64(data);
+        b.U64(elements * element_bytes);
+
+        //  MATLAB_class, a null padded scalar string
+        std::stringstream cls;
+        if (floating)
+            cls << (element_bytes == 8 ? "double" : "single");
+        else
+            cls << "int" << 8 * element_bytes;
+        const std::string attr = "MATLAB_class";
+        Message(b, 0x0C, 1 + 1 + 2 + 2 + 2 + 1 + attr.size() + 1 + 8 + 4 + cls.str().size());
+        b.U8(3);
+        b.U8(0);
+        b.U16(static_cast<unsigned int>(attr.size() + 1));
+        b.U16(8);
+        b.U16(4);
+        b.U8(0);
+        b.Text(attr);
+        b.U8(0);
+        b.U8(0x13);
+        b.U8(0x01);
+        b.U8(0);
+        b.U8(0);
+        b.U32(static_cast<unsigned int>(cls.str().size()));
+        b.U8(2);
+        b.U8(0);
+        b.U8(0);
+        b.U8(0);
+        b.Text(cls.str());
+        EndObject(b, set_at, size_at);
+
+        out.resize(ArrayFile::HeaderBytes, 0);
+    }
+}
+
+//===========================================================================
+//  CLASS ArrayFile  -- Fixed size headers for streamed numeric arrays
+//===========================================================================
+//---------------------------------------------------------------------------
+//  ArrayFile::Extension() --  File extension for a format
+//---------------------------------------------------------------------------
+
+const char *  ArrayFile::Extension(IIFormat format)
+{
+    switch (format)
+        {
+        case afNpy:
+            return ".npy";
+        case afMat:
+            return ".mat";
+        case afRaw:
+        default:
+            return ".bin";
+        }
+}
+
+//---------------------------------------------------------------------------
+//  ArrayFile::Header() --  Build the header for an array
+//---------------------------------------------------------------------------
+
+void  ArrayFile::Header(IIFormat format, const std::string & name, size_t element_bytes,
+                        const std::vector<unsigned long long> & dims, unsigned long long data_bytes,
+                        std::vector<unsigned char> & out, bool floating)
+{
+    out.clear();
+    if (format == afNpy)
+        Npy(element_bytes, floating, dims, out);
+    else if (format == afMat)
+        Mat(name.empty() ? std::string("data") : name.substr(0, 255), element_bytes, floating, dims, data_bytes,
+            out);
+}
+
+//---------------------------------------------------------------------------
+//  ArrayFile::Seal() --  Rewrite a header in place
+//---------------------------------------------------------------------------
+
+bool  ArrayFile::Seal(const std::string & file, IIFormat format, const std::string & name, size_t element_bytes,
+                      const std::vector<unsigned long long> & dims, unsigned long long data_bytes,
+                      bool floating)
+{
+    std::vector<unsigned char> head;
+    Header(format, name, element_bytes, dims, data_bytes, head, floating);
+    if (head.empty())
+        return true;
+
+    std::FILE * f = std::fopen(file.c_str(), "r+b");
+    if (!f)
+        return false;
+    const bool ok = std::fwrite(&head[0], 1, head.size(), f) == head.size();
+    return std::fclose(f) == 0 && ok;
+}
+
+//===========================================================================
+//  CLASS ArrayWriter  -- Stream one array to a file as it arrives
+//===========================================================================
+//---------------------------------------------------------------------------
+//  constructor for class ArrayWriter
+//---------------------------------------------------------------------------
+
+ArrayWriter::ArrayWriter()
+    : Format(ArrayFile::afNpy), ElementBytes(sizeof(short)), Floating(false), Lanes(1), Rows(1),
+      BlockBytes(4 * 1024 * 1024), Direct(true), Blocking(true), FFrames(0)
+{
+}
+
+//---------------------------------------------------------------------------
+//  destructor for class ArrayWriter
+//---------------------------------------------------------------------------
+
+ArrayWriter::~ArrayWriter()
+{
+    Close();
+}
+
+//---------------------------------------------------------------------------
+//  ArrayWriter::Open() --  Create the file with a provisional header
+//---------------------------------------------------------------------------
+
+bool  ArrayWriter::Open(const std::string & file)
+{
+    Close();
+    FFrames = 0;
+    FError.clear();
+
+    Log.BlockBytes = BlockBytes;
+    Log.Direct = Direct;
+    Log.Blocking = Blocking;
+    if (!Log.Open(file))
+        return false;
+
+    std::vector<unsigned char> head;
+    ArrayFile::Header(Format, Name, ElementBytes, Dims(0), 0, head, Floating);
+    if (!head.empty())
+        Log.Write(&head[0], head.size());
+    return true;
+}
+
+//---------------------------------------------------------------------------
+//  ArrayWriter::Close() --  Flush, then seal the header with the frames
+//---------------------------------------------------------------------------
+
+void  ArrayWriter::Close()
+{
+    if (!Log.IsOpen())
+        return;
+    Log.Close();
+
+    const unsigned long long offset = ArrayFile::DataOffset(Format);
+    const unsigned long long bytes = Log.Written() > offset ? Log.Written() - offset : 0;
+    FFrames = bytes / (ElementBytes * std::max<size_t>(Rows, 1) * std::max(Lanes, 1u));
+    if (!ArrayFile::Seal(Log.FileName(), Format, Name, ElementBytes, Dims(FFrames), bytes, Floating))
+        FError = Log.FileName() + ": cannot seal the header";
+}
+
+//---------------------------------------------------------------------------
+//  ArrayWriter::Error() --  Why writing or sealing failed, if it did
+//---------------------------------------------------------------------------
+
+std::string  ArrayWriter::Error() const
+{
+    return FError.empty() ? Log.Error() : FError;
+}
+
+//---------------------------------------------------------------------------
+//  ArrayWriter::Dims() --  Shape for a number of frames
+//---------------------------------------------------------------------------
+
+std::vector<unsigned long long>  ArrayWriter::Dims(unsigned long long frames) const
+{
+    std::vector<unsigned long long> dims;
+    if (Lanes > 1)
+        dims.push_back(Lanes);
+    dims.push_back(std::max<size_t>(Rows, 1));
+    dims.push_back(frames);
+    return dims;
+}
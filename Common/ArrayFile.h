@@ -0,0 +1,106 @@
+// ArrayFile.h
+//
+// NumPy .npy and MATLAB v7.3 files written as a stream
+
+#ifndef ArrayFileH
+#define ArrayFileH
+
+#include "DiskLogger.h"
+#include <string>
+#include <vector>
+
+//===========================================================================
+//  CLASS ArrayFile  -- Fixed size headers for streamed numeric arrays
+//===========================================================================
+//  Both formats are laid out as a header of HeaderBytes, then the array's
+//  elements exactly as they arrive, so a file can be written front to back
+//  while the capture runs and memory mapped by the reader afterwards.
+//  Dimensions are in MATLAB order, first fastest: a channel is FrameSize
+//  x frames, a stream of interleaved lanes lanes x FrameSize x frames.
+//
+//  A .npy is a version 1.0 NumPy array in Fortran order.  A .mat is an
+//  HDF5 file behind MATLAB's 512 byte user block, holding one contiguous
+//  dataset with its MATLAB_class, which load() reads as a variable of the
+//  dataset's name; h5py gives its data offset for numpy.memmap.  Only the
+//  HDF5 structures needed for that are written, by hand, so no HDF5 or
+//  MATLAB library is involved.
+//
+//  The header goes in first with the frames count unknown (0), and Seal()
+//  rewrites it in place, the same size, once the count is.
+
+class ArrayFile
+{
+public:
+    enum IIFormat { afRaw, afNpy, afMat };
+    enum { HeaderBytes = 4096 };
+
+    static const char *  Extension(IIFormat format);
+    //  Where the elements start
+    static size_t  DataOffset(IIFormat format)
+        {  return format == afRaw ? 0 : HeaderBytes;  }
+
+    //  Header of a signed integer array of 'element_bytes' (1, 2, 4 or 8),
+    //  or IEEE float (4 or 8) if 'floating', and 'dims', followed by
+    //  'data_bytes' in the file.  Empty for afRaw.
+    static void  Header(IIFormat format, const std::string & name, size_t element_bytes,
+                        const std::vector<unsigned long long> & dims, unsigned long long data_bytes,
+                        std::vector<unsigned char> & out, bool floating = false);
+    //  Rewrite a finished file's header for its final 'dims'
+    static bool  Seal(const std::string & file, IIFormat format, const std::string & name, size_t element_bytes,
+                      const std::vector<unsigned long long> & dims, unsigned long long data_bytes,
+                      bool floating = false);
+};
+
+//===========================================================================
+//  CLASS ArrayWriter  -- Stream one array to a file as it arrives
+//===========================================================================
+//  Writes go through a DiskLogger, so the caller only copies.  Close()
+//  counts the whole frames that reached the file and seals the header
+//  with them; a partial last frame stays in the file but not the shape.
+
+class ArrayWriter
+{
+public:
+    ArrayWriter();
+    ~ArrayWriter();
+
+    //  Config, read by Open()
+    ArrayFile::IIFormat  Format;
+    std::string         Name;           // Variable name in a .mat
+    size_t              ElementBytes;
+    bool                Floating;       // Elements are float or double
+    unsigned int        Lanes;          // Interleaved per sample, 1 = plain matrix
+    size_t              Rows;           // Samples per frame
+    size_t              BlockBytes;
+    bool                Direct;
+    bool                Blocking;
+
+    bool  Open(const std::string & file);
+    //  Append elements.  False if any were dropped.
+    bool  Write(const void * data, size_t bytes)
+        {  return Log.Write(data, bytes);  }
+    void  Close();
+    bool  IsOpen() const
+        {  return Log.IsOpen();  }
+
+    //  Status
+    const std::string &  FileName() const
+        {  return Log.FileName();  }
+    std::string  Error() const;
+    unsigned long long  Frames() const
+        {  return FFrames;  }
+    unsigned long long  Dropped() const
+        {  return Log.Dropped();  }
+
+private:
+    DiskLogger          Log;
+    unsigned long long  FFrames;
+    std::string         FError;
+
+    std::vector<unsigned long long>  Dims(unsigned long long frames) const;
+
+    ArrayWriter(const ArrayWriter &);
+    ArrayWriter & operator=(const ArrayWriter &);
+};
+
+#endif
@@ -0,0 +1,247 @@
+// BitPack.cpp
+//
+// Packing of int16 samples at the ADC's bit width
+
+#include "BitPack.h"
+#include <cstring>
+
+#if defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2) || defined(__SSE2__)
+#define BITPACK_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace
+{
+    typedef unsigned long long  u64;
+
+    inline u64  Load64(const unsigned char * p)
+        {
+        u64 v;
+        std::memcpy(&v, p, sizeof(v));
+        return v;
+        }
+    inline void  Store64(unsigned char * p, u64 v)
+        {  std::memcpy(p, &v, sizeof(v));  }
+
+    //  Clamp to the signed range of 'bits'
+    inline int  Saturate(int v, unsigned int bits, size_t & clipped)
+        {
+        const int hi = (1 << (bits - 1)) - 1;
+        const int lo = -hi - 1;
+        if (v >= lo && v <= hi)
+            return v;
+        ++clipped;
+        return v < lo ? lo : hi;
+        }
+
+    inline short  Extend(unsigned int field, unsigned int bits)
+        {
+        const unsigned int shift = 32 - bits;
+        return static_cast<short>(static_cast<int>(field << shift) >> shift);
+        }
+
+    //  One sample anywhere in the stream; clears its field first
+    void  PackOne(unsigned char * out, size_t idx, unsigned int bits, int v)
+        {
+        const u64 bit = static_cast<u64>(idx) * bits;
+        unsigned char * p = out + bit / 8;
+        const unsigned int shift = static_cast<unsigned int>(bit % 8);
+        const unsigned int mask = ((1u << bits) - 1) << shift;
+        unsigned int word;
+        std::memcpy(&word, p, sizeof(word));
+        word = (word & ~mask) | ((static_cast<unsigned int>(v) << shift) & mask);
+        std::memcpy(p, &word, sizeof(word));
+        }
+
+    short  UnpackOne(const unsigned char * in, size_t idx, unsigned int bits)
+        {
+        const u64 bit = static_cast<u64>(idx) * bits;
+        unsigned int word;
+        std::memcpy(&word, in + bit / 8, sizeof(word));
+        return Extend((word >> (bit % 8)) & ((1u << bits) - 1), bits);
+        }
+
+    //  Eight samples as two halves of 4*bits each, joined into 'bits'
+    //  bytes at 'p'.  Writes 16 bytes; those past the group are scratch.
+    inline void  StoreGroup(unsigned char * p, u64 lo, u64 hi, unsigned int bits)
+        {
+        const unsigned int half = 4 * bits;
+        Store64(p, lo | hi << half);
+        Store64(p + 8, hi >> (64 - half));
+        }
+
+    inline void  LoadGroup(const unsigned char * p, unsigned int bits, u64 & lo, u64 & hi)
+        {
+        const unsigned int half = 4 * bits;
+        const u64 mask = (static_cast<u64>(1) << half) - 1;
+        lo = Load64(p) & mask;
+        hi = (Load64(p + half / 8) >> (half % 8)) & mask;
+        }
+
+    size_t  PackGroupScalar(const short * in, unsigned int bits, unsigned char * p)
+        {
+        const u64 mask = (1u << bits) - 1;
+        size_t clipped = 0;
+        u64 half[2] = { 0, 0 };
+        for (unsigned int k = 0; k < 8; ++k)
+            half[k / 4] |= (static_cast<u64>(Saturate(in[k], bits, clipped)) & mask) << (k % 4 * bits);
+        StoreGroup(p, half[0], half[1], bits);
+        return clipped;
+        }
+
+    void  UnpackGroupScalar(const unsigned char * p, unsigned int bits, short * out)
+        {
+        const unsigned int mask = (1u << bits) - 1;
+        u64 half[2];
+        LoadGroup(p, bits, half[0], half[1]);
+        for (unsigned int k = 0; k < 8; ++k)
+            out[k] = Extend(static_cast<unsigned int>(half[k / 4] >> (k % 4 * bits)) & mask, bits);
+        }
+
+#ifdef BITPACK_SSE2
+    //-----------------------------------------------------------------------
+    //  Sse2Kernel -- Group kernels for widths up to 14 bits
+    //-----------------------------------------------------------------------
+    //  Fields are merged pairwise: 16-bit samples into 32-bit pairs with a
+    //  multiply-add by (1, 2^bits), pairs into 64-bit quads with shifts.
+    //  Only the final join of the two quads is scalar.
+
+    struct Sse2Kernel
+    {
+        explicit Sse2Kernel(unsigned int bits)
+            : Bits(bits),
+              Mask16(_mm_set1_epi16(static_cast<short>((1u << bits) - 1))),
+              Mask32(_mm_set1_epi32((1 << bits) - 1)),
+              Mask64(_mm_set_epi32(0, (1 << 2*bits) - 1, 0, (1 << 2*bits) - 1)),
+              Low32(_mm_set_epi32(0, -1, 0, -1)),
+              Join(_mm_set1_epi32(1 << (16 + bits) | 1)),
+              Spare(_mm_cvtsi32_si128(16 - bits)),
+              Shift1(_mm_cvtsi32_si128(bits)),
+              Shift2(_mm_cvtsi32_si128(2*bits)),
+              Gap2(_mm_cvtsi32_si128(32 - 2*bits)),
+              Sixteen(_mm_cvtsi32_si128(16)),
+              ThirtyTwo(_mm_cvtsi32_si128(32))
+            {}
+
+        //  False, untouched, if a sample needs saturating
+        bool  Pack(const short * in, unsigned char * p) const
+            {
+            const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(in));
+            const __m128i fit = _mm_sra_epi16(_mm_sll_epi16(v, Spare), Spare);
+            if (_mm_movemask_epi8(_mm_cmpeq_epi16(fit, v)) != 0xFFFF)
+                return false;
+            const __m128i pairs = _mm_madd_epi16(_mm_and_si128(v, Mask16), Join);
+            const __m128i quads = _mm_or_si128(_mm_and_si128(pairs, Low32),
+                                               _mm_srl_epi64(_mm_andnot_si128(Low32, pairs), Gap2));
+            u64 half[2];
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(half), quads);
+            StoreGroup(p, half[0], half[1], Bits);
+            return true;
+            }
+
+        void  Unpack(const unsigned char * p, short * out) const
+            {
+            u64 half[2];
+            LoadGroup(p, Bits, half[0], half[1]);
+            const __m128i quads = _mm_loadu_si128(reinterpret_cast<const __m128i *>(half));
+            const __m128i pairs = _mm_or_si128(_mm_and_si128(quads, Mask64),
+                                               _mm_sll_epi64(_mm_srl_epi64(quads, Shift2), ThirtyTwo));
+            const __m128i fields = _mm_or_si128(_mm_and_si128(pairs, Mask32),
+                                                _mm_sll_epi32(_mm_srl_epi32(pairs, Shift1), Sixteen));
+            const __m128i v = _mm_sra_epi16(_mm_sll_epi16(fields, Spare), Spare);
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(out), v);
+            }
+
+        unsigned int    Bits;
+        __m128i         Mask16, Mask32, Mask64, Low32, Join;
+        __m128i         Spare, Shift1, Shift2, Gap2, Sixteen, ThirtyTwo;
+    };
+#endif
+}
+
+//===========================================================================
+//  CLASS BitPack  -- Kernels between int16 samples and packed bit fields
+//===========================================================================
+//---------------------------------------------------------------------------
+//  BitPack::Pack() --  Pack samples at a sample index
+//---------------------------------------------------------------------------
+
+size_t  BitPack::Pack(const short * in, size_t count, unsigned int bits, unsigned char * out, size_t first)
+{
+    if (bits >= 16 || !bits)
+        {
+        std::memcpy(out + first * sizeof(short), in, count * sizeof(short));
+        return 0;
+        }
+
+    size_t clipped = 0;
+    size_t k = 0;
+    for (; k < count && (first + k) % 8; ++k)
+        PackOne(out, first + k, bits, Saturate(in[k], bits, clipped));
+
+    const size_t groups = (count - k) / 8;
+    unsigned char * p = out + (first + k) / 8 * bits;
+#ifdef BITPACK_SSE2
+    if (bits <= 14)
+        {
+        const Sse2Kernel kernel(bits);
+        for (size_t g = 0; g < groups; ++g, k += 8, p += bits)
+            if (!kernel.Pack(in + k, p))
+                clipped += PackGroupScalar(in + k, bits, p);
+        }
+    else
+#endif
+    for (size_t g = 0; g < groups; ++g, k += 8, p += bits)
+        clipped += PackGroupScalar(in + k, bits, p);
+
+    for (; k < count; ++k)
+        PackOne(out, first + k, bits, Saturate(in[k], bits, clipped));
+    return clipped;
+}
+
+//---------------------------------------------------------------------------
+//  BitPack::Unpack() --  Samples back to int16, sign extended
+//---------------------------------------------------------------------------
+
+void  BitPack::Unpack(const unsigned char * in, size_t first, size_t count, unsigned int bits, short * out)
+{
+    if (bits >= 16 || !bits)
+        {
+        std::memcpy(out, in + first * sizeof(short), count * sizeof(short));
+        return;
+        }
+
+    size_t k = 0;
+    for (; k < count && (first + k) % 8; ++k)
+        out[k] = UnpackOne(in, first + k, bits);
+
+    const size_t groups = (count - k) / 8;
+    const unsigned char * p = in + (first + k) / 8 * bits;
+#ifdef BITPACK_SSE2
+    if (bits <= 14)
+        {
+        const Sse2Kernel kernel(bits);
+        for (size_t g = 0; g < groups; ++g, k += 8, p += bits)
+            kernel.Unpack(p, out + k);
+        }
+    else
+#endif
+    for (size_t g = 0; g < groups; ++g, k += 8, p += bits)
+        UnpackGroupScalar(p, bits, out + k);
+
+    for (; k < count; ++k)
+        out[k] = UnpackOne(in, first + k, bits);
+}
+
+//---------------------------------------------------------------------------
+//  BitPack::Vectorized() --  Whether the group kernels use SSE2
+//---------------------------------------------------------------------------
+
+bool  BitPack::Vectorized()
+{
+#ifdef BITPACK_SSE2
+    return true;
+#else
+    return false;
+#endif
+}
@@ -0,0 +1,45 @@
+// BitPack.h
+//
+// Packing of int16 samples at the ADC's bit width
+
+#ifndef BitPackH
+#define BitPackH
+
+#include <cstddef>
+
+//===========================================================================
+//  CLASS BitPack  -- Kernels between int16 samples and packed bit fields
+//===========================================================================
+//  Sample i of a packed buffer takes bits [i*bits, (i+1)*bits) of a little
+//  endian bit stream, as the low 'bits' of its two's complement value, so
+//  a 14-bit capture needs 7/8 of the memory.  Samples are handled in
+//  groups of eight, which always start and end on a byte; the groups go
+//  through SSE2 where it is compiled in.  A sample outside the signed
+//  range of 'bits' is saturated and counted.
+//
+//  Packed buffers must extend Padding bytes past Bytes(): the group
+//  kernels load and store a whole 16 bytes at a time.  A store clobbers
+//  the bytes past its group, so one thread packs a buffer, and in
+//  ascending sample order.  Unpack() only reads, and is safe from any
+//  number of threads.
+
+class BitPack
+{
+public:
+    enum { Padding = 16 };
+
+    //  Packed size of 'samples', excluding the padding
+    static size_t  Bytes(size_t samples, unsigned int bits)
+        {  return (samples * bits + 7) / 8;  }
+
+    //  Pack 'count' samples into 'out' from sample index 'first' on.
+    //  Returns the samples that had to be saturated.
+    static size_t  Pack(const short * in, size_t count, unsigned int bits, unsigned char * out, size_t first);
+    //  Unpack 'count' samples from sample index 'first' on, sign extended
+    static void  Unpack(const unsigned char * in, size_t first, size_t count, unsigned int bits, short * out);
+
+    //  Whether the group kernels run vectorized in this build
+    static bool  Vectorized();
+};
+
+#endif
@@ -0,0 +1,440 @@
+// BlockReader.cpp
+//
+// Out-of-core iteration over a capture file in fixed blocks per channel
+
+#include "BlockReader.h"
+#include <algorithm>
+#include <cstring>
+
+namespace
+{
+    const size_t Alignment = 4096;              // Of each channel's run
+}
+
+//===========================================================================
+//  CLASS CaptureBlock  -- One block of every channel's samples
+//===========================================================================
+//---------------------------------------------------------------------------
+//  constructor for class CaptureBlock
+//---------------------------------------------------------------------------
+
+CaptureBlock::CaptureBlock()
+    : Stride(0), FIndex(0)
+{
+}
+
+//===========================================================================
+//  CLASS BlockReader  -- Stream a capture of any size in a fixed budget
+//===========================================================================
+//---------------------------------------------------------------------------
+//  constructor for class BlockReader
+//---------------------------------------------------------------------------
+
+BlockReader::BlockReader()
+    : BlockSamples(4 * 1024 * 1024), SampleBytes(sizeof(short)), Lanes(1), ReadBytes(16 * 1024 * 1024),
+      Depth(2), Sync(4), FBlock(0), FSampleBytes(sizeof(short)), FLanes(1), FRead(0), FSync(4),
+      FOverflow(0), Position(0), Carried(0), Primed(0), Split(0), Filling(0), Held(0), Quit(false), Done(true),
+      FBytes(0), FPackets(0), FUnrouted(0), FSkipped(0), FBlocks(0)
+{
+}
+
+//---------------------------------------------------------------------------
+//  destructor for class BlockReader
+//---------------------------------------------------------------------------
+
+BlockReader::~BlockReader()
+{
+    Close();
+}
+
+//---------------------------------------------------------------------------
+//  BlockReader::Open() --  Allocate the blocks and start reading
+//---------------------------------------------------------------------------
+//  The first read is made here, so the streams to take can be found from
+//  it and an unreadable file is reported to the caller.
+
+bool  BlockReader::Open(const std::string & file, const std::vector<unsigned int> & sids)
+{
+    Close();
+    FError.clear();
+    FSids.clear();
+    FBytes = 0;
+    FPackets = 0;
+    FUnrouted = 0;
+    FSkipped = 0;
+    FBlocks = 0;
+
+    FBlock = std::max<size_t>(BlockSamples, 1);
+    FSampleBytes = SampleBytes;
+    FLanes = std::max(Lanes, 1u);
+    FRead = std::max(ReadBytes, Vita::MinReadBytes) / sizeof(unsigned int) * sizeof(unsigned int);
+    FSync = std::max(Sync, 1u);
+    Split = Deinterleave::Kernel(FSampleBytes, FLanes);
+    if (!Split)
+        {
+        FError = "no kernel for this sample width and lane count";
+        return false;
+        }
+
+    if (CompressedReader::IsCompressed(file) ? !Packed.Open(file) : !Reader.Open(file))
+        {
+        FError = file + ": cannot open";
+        return false;
+        }
+    if (!Raw.Allocate(FRead + CarryWords() * sizeof(unsigned int)))
+        {
+        FError = "cannot allocate the read buffer";
+        Close();
+        return false;
+        }
+    Position = 0;
+    Carried = 0;
+    Primed = Fetch(FRead);
+
+    FSids = sids;
+    if (FSids.empty())
+        {
+        const unsigned int * base = Raw.As<unsigned int>();
+        const size_t words = Primed / sizeof(unsigned int);
+        VitaPacketInfo info;
+        for (size_t at = Resync(0, words); at < words && Vita::HasStreamId(base[at]) &&
+             Vita::Decode(base, words, at, info); at += info.Words)
+            if (std::find(FSids.begin(), FSids.end(), info.Sid) == FSids.end())
+                FSids.push_back(info.Sid);
+        }
+    if (FSids.empty())
+        {
+        FError = file + ": no streams found";
+        Close();
+        return false;
+        }
+
+    //  Held frames stay under a block until a packet lands past it
+    FOverflow = (FBlock + Vita::MaxPacketWords * sizeof(unsigned int) / (FSampleBytes * FLanes)) * FSampleBytes;
+    Streams.resize(FSids.size());
+    for (size_t k = 0; k < FSids.size(); ++k)
+        {
+        Stream & s = Streams[k];
+        s.Channel = k * FLanes;
+        s.Fill = 0;
+        s.First = 0;
+        s.Held = 0;
+        s.Overflow.resize(FLanes);
+        for (unsigned int l = 0; l < FLanes; ++l)
+            s.Overflow[l].reserve(FOverflow);
+        Route[FSids[k]] = k;
+        }
+
+    //  Each channel's run rounded up to whole pages
+    const size_t channels = Channels();
+    const size_t stride = (FBlock * FSampleBytes + Alignment - 1) / Alignment * Alignment;
+    for (unsigned int b = 0; b < std::max(Depth, 2u); ++b)
+        {
+        std::shared_ptr<CaptureBlock> block(new CaptureBlock);
+        if (!block->Memory.Allocate(stride * channels, Policy))
+            {
+            FError = "cannot allocate the blocks";
+            Close();
+            return false;
+            }
+        block->Stride = stride;
+        block->FSamples.resize(channels, 0);
+        block->FFirst.resize(channels, 0);
+        Pool.push_back(block);
+        if (b)
+            Free.push_back(b);
+        }
+    Filling = 0;
+    Held = Pool.size();
+    Quit = false;
+    Done = false;
+    Thread = std::thread(&BlockReader::Execute, this);
+    return true;
+}
+
+//---------------------------------------------------------------------------
+//  BlockReader::Close() --  Stop reading and release the blocks
+//---------------------------------------------------------------------------
+
+void  BlockReader::Close()
+{
+    {
+    std::lock_guard<std::mutex> lock(Lock);
+    Quit = true;
+    }
+    Wake.notify_all();
+    if (Thread.joinable())
+        Thread.join();
+
+    Reader.Close();
+    Packed.Close();
+    Raw.Release();
+    Route.clear();
+    Streams.clear();
+    Pool.clear();
+    Ready.clear();
+    Free.clear();
+    Held = 0;
+    Done = true;
+}
+
+//---------------------------------------------------------------------------
+//  BlockReader::Next() --  Hand back the last block, take the next
+//---------------------------------------------------------------------------
+
+const CaptureBlock *  BlockReader::Next()
+{
+    std::unique_lock<std::mutex> lock(Lock);
+    if (Held < Pool.size())
+        {
+        Free.push_back(Held);
+        Held = Pool.size();
+        Wake.notify_all();
+        }
+    Wake.wait(lock, [this]() {  return !Ready.empty() || Done;  });
+    if (Ready.empty())
+        return 0;
+    Held = Ready.front();
+    Ready.pop_front();
+    return Pool[Held].get();
+}
+
+//---------------------------------------------------------------------------
+//  BlockReader::Footprint() --  Bytes of blocks, read buffer and overflow
+//---------------------------------------------------------------------------
+//  The overflow as Open() reserved it, which Deliver() never grows past,
+//  so this is safe to call while the thread reads.
+
+size_t  BlockReader::Footprint() const
+{
+    return (Pool.empty() ? 0 : Pool.size() * Pool[0]->Memory.Bytes()) + Raw.Bytes() +
+           Streams.size() * FLanes * FOverflow;
+}
+
+//---------------------------------------------------------------------------
+//  BlockReader::Fetch() --  Read past the words carried over
+//---------------------------------------------------------------------------
+//  Short only at the end of the file.  Chunks of a compressed file lost
+//  at capture are stepped over and counted as skipped.
+
+size_t  BlockReader::Fetch(size_t bytes)
+{
+    char * at = Raw.As<char>() + Carried * sizeof(unsigned int);
+    unsigned long long lost = 0;
+    const size_t got = Packed.IsOpen() ? Packed.Read(Position, at, bytes, &lost) : Reader.Read(at, bytes);
+    Position += got + lost;
+    FBytes += got;
+    FSkipped += lost;
+    return got;
+}
+
+//---------------------------------------------------------------------------
+//  BlockReader::Parse() --  Deliver the whole packets of the read buffer
+//---------------------------------------------------------------------------
+//  A packet is taken once the header after it has the same layout, or
+//  whole packets follow it.  What cannot be settled yet -- a packet cut
+//  off by the end of the buffer, or words that might start a chain -- is
+//  moved to the front to be completed by the next read, up to
+//  CarryWords().  After the last read everything is settled.  False if
+//  stopped.
+
+bool  BlockReader::Parse(size_t words, bool last)
+{
+    unsigned int * base = Raw.As<unsigned int>();
+    size_t at = 0;
+    while (at < words)
+        {
+        const bool wait = !last && words - at <= CarryWords();
+        const unsigned int hdr = base[at];
+        VitaPacketInfo info;
+        if (Vita::HasStreamId(hdr) && Vita::Decode(base, words, at, info))
+            {
+            const size_t next = at + info.Words;
+            const bool chained = next < words && (base[next] & Vita::HeaderShape) == (hdr & Vita::HeaderShape);
+            if (!chained && wait && (next >= words || Resync(next, words) >= words))
+                break;
+            if (!Deliver(info, base))
+                return false;
+            at = next;
+            continue;
+            }
+
+        //  A header whose packet runs past the buffer
+        if (wait && Vita::HasStreamId(hdr) && Vita::PacketWords(hdr) > words - at &&
+            Vita::PacketWords(hdr) >= Vita::HeaderWords(hdr) + (Vita::HasTrailer(hdr) ? 1 : 0))
+            break;
+
+        //  Not a packet: skip to whole packets
+        const size_t sync = Resync(at + 1, words);
+        if (sync >= words && wait)
+            break;
+        FSkipped += (std::min(sync, words) - at) * sizeof(unsigned int);
+        at = std::min(sync, words);
+        }
+
+    Carried = words - at;
+    if (Carried)
+        std::memmove(base, base + at, Carried * sizeof(unsigned int));
+    return true;
+}
+
+//---------------------------------------------------------------------------
+//  BlockReader::Resync() --  First word at or after 'offset' that starts
+//                            a chain of Sync packets, 'words' if none
+//---------------------------------------------------------------------------
+
+size_t  BlockReader::Resync(size_t offset, size_t words) const
+{
+    return Vita::Resync(Raw.As<unsigned int>(), words, offset, FSync, false);
+}
+
+//---------------------------------------------------------------------------
+//  BlockReader::Deliver() --  One packet's frames to its channels
+//---------------------------------------------------------------------------
+//  Into the block being filled while it has room, past it into the
+//  stream's overflow, which starts the next block.  False if stopped.
+
+bool  BlockReader::Deliver(const VitaPacketInfo & info, const unsigned int * base)
+{
+    const std::map<unsigned int, size_t>::const_iterator route = Route.find(info.Sid);
+    if (route == Route.end())
+        {
+        ++FUnrouted;
+        return true;
+        }
+    ++FPackets;
+
+    Stream & s = Streams[route->second];
+    const size_t frame = FSampleBytes * FLanes;
+    const size_t frames = info.PayloadWords * sizeof(unsigned int) / frame;
+    const char * src = reinterpret_cast<const char *>(base + info.Offset + info.PayloadOffset);
+    char * dest[8];
+
+    const size_t now = s.Held ? 0 : std::min(frames, FBlock - s.Fill);
+    if (now)
+        {
+        CaptureBlock & block = *Pool[Filling];
+        for (unsigned int l = 0; l < FLanes; ++l)
+            dest[l] = block.Lane(s.Channel + l) + s.Fill * FSampleBytes;
+        Split(dest, src, now);
+        s.Fill += now;
+        }
+    if (frames > now)
+        {
+        for (unsigned int l = 0; l < FLanes; ++l)
+            {
+            s.Overflow[l].resize((s.Held + frames - now) * FSampleBytes);
+            dest[l] = &s.Overflow[l][s.Held * FSampleBytes];
+            }
+        Split(dest, src + now * frame, frames - now);
+        s.Held += frames - now;
+        }
+
+    while (Due())
+        if (!Finish())
+            return false;
+    return true;
+}
+
+//---------------------------------------------------------------------------
+//  BlockReader::Due() --  Block full, or a stream a block ahead
+//---------------------------------------------------------------------------
+
+bool  BlockReader::Due() const
+{
+    bool full = true;
+    for (size_t k = 0; k < Streams.size(); ++k)
+        {
+        if (Streams[k].Held >= FBlock)
+            return true;
+        full = full && Streams[k].Fill == FBlock;
+        }
+    return full && !Streams.empty();
+}
+
+//---------------------------------------------------------------------------
+//  BlockReader::Finish() --  Queue the block filled, start the next
+//---------------------------------------------------------------------------
+//  Waits for the caller to hand a block back if none is free, which is
+//  what bounds the read-ahead.  The next block opens with what each
+//  stream held over.  False if stopped.
+
+bool  BlockReader::Finish()
+{
+    CaptureBlock & done = *Pool[Filling];
+    done.FIndex = FBlocks.load();
+    for (size_t k = 0; k < Streams.size(); ++k)
+        {
+        Stream & s = Streams[k];
+        for (unsigned int l = 0; l < FLanes; ++l)
+            {
+            done.FSamples[s.Channel + l] = s.Fill;
+            done.FFirst[s.Channel + l] = s.First;
+            }
+        s.First += s.Fill;
+        }
+
+    {
+    std::unique_lock<std::mutex> lock(Lock);
+    Ready.push_back(Filling);
+    ++FBlocks;
+    Wake.notify_all();
+    Wake.wait(lock, [this]() {  return Quit || !Free.empty();  });
+    if (Quit)
+        return false;
+    Filling = Free.front();
+    Free.pop_front();
+    }
+
+    CaptureBlock & next = *Pool[Filling];
+    for (size_t k = 0; k < Streams.size(); ++k)
+        {
+        Stream & s = Streams[k];
+        const size_t take = std::min(s.Held, FBlock);
+        for (unsigned int l = 0; l < FLanes && take; ++l)
+            {
+            std::vector<char> & over = s.Overflow[l];
+            std::memcpy(next.Lane(s.Channel + l), &over[0], take * FSampleBytes);
+            over.erase(over.begin(), over.begin() + take * FSampleBytes);
+            }
+        s.Held -= take;
+        s.Fill = take;
+        }
+    return true;
+}
+
+//---------------------------------------------------------------------------
+//  BlockReader::Execute() --  Read, parse and fill until the end or stopped
+//---------------------------------------------------------------------------
+
+void  BlockReader::Execute()
+{
+    size_t got = Primed;
+    for (;;)
+        {
+        const bool last = got < FRead;
+        if (last)
+            FSkipped += got % sizeof(unsigned int);
+        if (!Parse(Carried + got / sizeof(unsigned int), last))
+            break;
+        if (last)
+            {
+            //  Out with the partial block and whatever is held past it
+            bool held = true;
+            while (held)
+                {
+                held = false;
+                for (size_t k = 0; k < Streams.size(); ++k)
+                    held = held || Streams[k].Fill || Streams[k].Held;
+                if (held && !Finish())
+                    break;
+                }
+            break;
+            }
+        got = Fetch(FRead);
+        }
+
+    std::lock_guard<std::mutex> lock(Lock);
+    Done = true;
+    Wake.notify_all();
+}
@@ -0,0 +1,197 @@
+// BlockReader.h
+//
+// Out-of-core iteration over a capture file in fixed blocks per channel
+
+#ifndef BlockReaderH
+#define BlockReaderH
+
+#include "StripedLogger.h"
+#include "CompressedLogger.h"
+#include "CaptureMemory.h"
+#include "VitaHeader.h"
+#include "Deinterleave.h"
+#include <string>
+#include <vector>
+#include <deque>
+#include <map>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <memory>
+#include <cstddef>
+
+//===========================================================================
+//  CLASS CaptureBlock  -- One block of every channel's samples
+//===========================================================================
+//  Each channel's run starts on a page boundary.  A channel normally has
+//  the block's full BlockSamples; fewer in the last block, and fewer when
+//  its stream fell a block behind the others (see BlockReader).  First()
+//  is the stream sample index of the run's first sample, so channels of
+//  one block need not line up.
+
+class CaptureBlock
+{
+public:
+    CaptureBlock();
+
+    unsigned long long  Index() const           // Blocks delivered before this one
+        {  return FIndex;  }
+    size_t  Channels() const
+        {  return FSamples.size();  }
+    size_t  Samples(size_t ch) const
+        {  return FSamples[ch];  }
+    unsigned long long  First(size_t ch) const
+        {  return FFirst[ch];  }
+    const void *  Data(size_t ch) const
+        {  return Memory.As<char>() + ch * Stride;  }
+    template <typename T>
+    const T *  As(size_t ch) const
+        {  return static_cast<const T *>(Data(ch));  }
+
+private:
+    friend class BlockReader;
+
+    CaptureMemory                       Memory;
+    size_t                              Stride;     // Bytes per channel, whole pages
+    unsigned long long                  FIndex;
+    std::vector<size_t>                 FSamples;
+    std::vector<unsigned long long>     FFirst;
+
+    char *  Lane(size_t ch)
+        {  return Memory.As<char>() + ch * Stride;  }
+
+    CaptureBlock(const CaptureBlock &);
+    CaptureBlock & operator=(const CaptureBlock &);
+};
+
+//===========================================================================
+//  CLASS BlockReader  -- Stream a capture of any size in a fixed budget
+//===========================================================================
+//  A thread reads the file front to back, ReadBytes at a time, walks the
+//  packets of each read and de-interleaves the payload
+//  of each wanted stream straight into the block being filled, Lanes
+//  channels per stream.  The caller takes finished blocks with Next()
+//  while the thread fills the next, so reading and the caller's work
+//  overlap; with Depth blocks in all the thread runs at most Depth - 1
+//  blocks ahead, and waits there.  Memory is Depth blocks, one read and
+//  the overflow below, whatever the size of the file, so reductions and
+//  transforms can run over files far larger than RAM at the rate the disk
+//  delivers.
+//
+//  A block is finished when every channel is full.  A stream that gets a
+//  block ahead of another -- one stream stopped, or absent -- finishes
+//  the block with the laggard's channels short, so what a channel holds
+//  past the block never grows past a block and a packet.  Open() reserves
+//  that much per channel up front and Footprint() counts it.  Plain, striped and compressed files
+//  are read, as ReplaySource reads them.  Words that do not parse as
+//  packets are skipped up to the next Sync packets that chain, as
+//  VitaParser does, and counted.
+
+class BlockReader
+{
+public:
+    BlockReader();
+    ~BlockReader();
+
+    //  Config, read by Open()
+    size_t          BlockSamples;   // Per channel per block
+    size_t          SampleBytes;    // Per channel sample, 2 or 4
+    unsigned int    Lanes;          // Channels interleaved per stream (1, 2, 4, 8)
+    size_t          ReadBytes;      // Per file read
+    unsigned int    Depth;          // Blocks in all, at least 2
+    unsigned int    Sync;           // Headers that must chain to resync
+    CapturePolicy   Policy;         // Backing of the blocks
+
+    //  Start reading streams 'sids', channel k * Lanes + l being lane l of
+    //  sids[k].  With none given, the streams in the file's first read are
+    //  taken, in order of appearance.
+    bool  Open(const std::string & file, const std::vector<unsigned int> & sids = std::vector<unsigned int>());
+    void  Close();
+    bool  IsOpen() const
+        {  return Thread.joinable();  }
+
+    //  The next block, waiting for it if need be; 0 after the last.  The
+    //  block stays valid until the next call or Close().
+    const CaptureBlock *  Next();
+
+    const std::string &  Error() const
+        {  return FError;  }
+    const std::vector<unsigned int> &  Sids() const
+        {  return FSids;  }
+    size_t  Channels() const
+        {  return FSids.size() * FLanes;  }
+    //  Memory held, blocks, read buffer and overflow
+    size_t  Footprint() const;
+
+    //  Status
+    unsigned long long  Bytes() const           // File bytes read
+        {  return FBytes.load();  }
+    unsigned long long  Packets() const         // ...of the wanted streams
+        {  return FPackets.load();  }
+    unsigned long long  Unrouted() const        // ...and of others
+        {  return FUnrouted.load();  }
+    unsigned long long  Skipped() const         // Bytes not part of any packet
+        {  return FSkipped.load();  }
+    unsigned long long  Blocks() const          // Finished
+        {  return FBlocks.load();  }
+
+private:
+    struct Stream
+    {
+        size_t                          Channel;    // First of its lanes
+        size_t                          Fill;       // Frames in the block being filled
+        unsigned long long              First;      // Stream sample of its first
+        size_t                          Held;       // Frames past the block, in Overflow
+        std::vector< std::vector<char> >  Overflow; // ...per lane
+    };
+
+    size_t                              FBlock;     // Config as Open() found it
+    size_t                              FSampleBytes;
+    unsigned int                        FLanes;
+    size_t                              FRead;
+    unsigned int                        FSync;
+    size_t                              FOverflow;  // Bytes reserved per lane past the block
+    StripeReader                        Reader;
+    CompressedReader                    Packed;     // In place of Reader
+    unsigned long long                  Position;
+    CaptureMemory                       Raw;        // One read plus a packet carried over
+    size_t                              Carried;    // Words of it at the front
+    size_t                              Primed;     // Bytes after them read by Open()
+    Deinterleave::Ftn                   Split;
+    std::map<unsigned int, size_t>      Route;      // SID to Streams
+    std::vector<Stream>                 Streams;
+    std::vector< std::shared_ptr<CaptureBlock> >  Pool;
+    size_t                              Filling;    // Pool entry the thread fills
+    std::deque<size_t>                  Ready;      // ...finished, oldest first
+    std::deque<size_t>                  Free;
+    size_t                              Held;       // Given out by Next(), or Pool.size()
+    std::thread                         Thread;
+    std::mutex                          Lock;
+    std::condition_variable             Wake;
+    bool                                Quit;
+    bool                                Done;
+    std::string                         FError;
+    std::vector<unsigned int>           FSids;
+
+    std::atomic<unsigned long long>     FBytes;
+    std::atomic<unsigned long long>     FPackets;
+    std::atomic<unsigned long long>     FUnrouted;
+    std::atomic<unsigned long long>     FSkipped;
+    std::atomic<unsigned long long>     FBlocks;
+
+    size_t  Fetch(size_t bytes);
+    bool  Parse(size_t words, bool last);
+    size_t  Resync(size_t offset, size_t words) const;
+    size_t  CarryWords() const
+        {  return (FSync + 1) * Vita::MaxPacketWords;  }
+    bool  Deliver(const VitaPacketInfo & info, const unsigned int * base);
+    bool  Due() const;
+    bool  Finish();
+    void  Execute();
+
+    BlockReader(const BlockReader &);
+    BlockReader & operator=(const BlockReader &);
+};
+
+#endif
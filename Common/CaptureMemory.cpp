@@ -0,0 +1,274 @@
+// CaptureMemory.cpp
+//
+// Page-policy aware allocation for capture and staging buffers
+
+#include "CaptureMemory.h"
+#include <sstream>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#ifndef MAP_HUGE_SHIFT
+#define MAP_HUGE_SHIFT  26
+#endif
+#endif
+
+namespace
+{
+    const size_t SmallPage = 4096;
+
+    size_t  RoundUp(size_t bytes, size_t page)
+        {  return (bytes + page - 1) / page * page;  }
+
+#ifdef _WIN32
+    //  Large pages need SeLockMemoryPrivilege enabled in the process token
+    bool  LockMemoryPrivilege()
+    {
+        static int state = -1;
+        if (state >= 0)
+            return state != 0;
+
+        state = 0;
+        HANDLE token;
+        if (!OpenProcessToken(GetCurrentProcess(), TOKEN_ADJUST_PRIVILEGES | TOKEN_QUERY, &token))
+            return false;
+        TOKEN_PRIVILEGES tp;
+        tp.PrivilegeCount = 1;
+        tp.Privileges[0].Attributes = SE_PRIVILEGE_ENABLED;
+        if (LookupPrivilegeValue(0, SE_LOCK_MEMORY_NAME, &tp.Privileges[0].Luid)
+            && AdjustTokenPrivileges(token, FALSE, &tp, 0, 0, 0)
+            && GetLastError() == ERROR_SUCCESS)
+            state = 1;
+        CloseHandle(token);
+        return state != 0;
+    }
+#endif
+}
+
+//===========================================================================
+//  STRUCT CapturePolicy  -- How capture memory is backed
+//===========================================================================
+//---------------------------------------------------------------------------
+//  CapturePolicy::Name() --  Short description for logs and reports
+//---------------------------------------------------------------------------
+
+std::string  CapturePolicy::Name() const
+{
+    const char * pages[] = { "4K", "2M", "1G" };
+    std::stringstream ss;
+    ss << pages[Pages];
+    if (Prefault)
+        ss << "+fault";
+    if (Lock)
+        ss << "+lock";
+    if (Node >= 0)
+        ss << "+node" << Node;
+    return ss.str();
+}
+
+//===========================================================================
+//  CLASS CaptureMemory  -- One page-aligned block owned by a policy
+//===========================================================================
+//---------------------------------------------------------------------------
+//  constructor for class CaptureMemory
+//---------------------------------------------------------------------------
+
+CaptureMemory::CaptureMemory()
+    : FData(0), FBytes(0), FMapped(0), FPageBytes(0),
+      FPages(CapturePolicy::pgNormal), FLocked(false)
+{
+}
+
+//---------------------------------------------------------------------------
+//  destructor for class CaptureMemory
+//---------------------------------------------------------------------------
+
+CaptureMemory::~CaptureMemory()
+{
+    Release();
+}
+
+//---------------------------------------------------------------------------
+//  CaptureMemory::PageSize() --  Bytes per page of a given kind
+//---------------------------------------------------------------------------
+
+size_t  CaptureMemory::PageSize(CapturePolicy::IIPages pages)
+{
+    switch (pages)
+        {
+        case CapturePolicy::pgHuge:
+            return static_cast<size_t>(1) << 30;
+        case CapturePolicy::pgLarge:
+#ifdef _WIN32
+            {
+            const size_t large = GetLargePageMinimum();
+            return large ? large : static_cast<size_t>(2) << 20;
+            }
+#else
+            return static_cast<size_t>(2) << 20;
+#endif
+        default:
+            return SmallPage;
+        }
+}
+
+//---------------------------------------------------------------------------
+//  CaptureMemory::Allocate() --  Obtain a block under 'policy'
+//---------------------------------------------------------------------------
+//  Returns false only when no memory could be had at all.
+
+bool  CaptureMemory::Allocate(size_t bytes, const CapturePolicy & policy)
+{
+    Release();
+    if (!bytes)
+        return true;
+
+    //  Step down the page sizes until the OS agrees
+    for (int pages = policy.Pages; pages >= CapturePolicy::pgNormal && !FData; --pages)
+        FData = Map(bytes, static_cast<CapturePolicy::IIPages>(pages), policy.Node);
+    if (!FData)
+        return false;
+    FBytes = bytes;
+
+    //  Fault in before locking, so the lock does not have to
+    if (policy.Prefault)
+        Prefault(FData, FMapped, FPageBytes);
+    if (policy.Lock && !FLocked)
+        FLocked = Lock(FData, FMapped);
+
+    return true;
+}
+
+//---------------------------------------------------------------------------
+//  CaptureMemory::Map() --  Reserve and commit one block of 'pages'
+//---------------------------------------------------------------------------
+
+void *  CaptureMemory::Map(size_t bytes, CapturePolicy::IIPages pages, int node)
+{
+    const size_t page = PageSize(pages);
+    const size_t mapped = RoundUp(bytes, page);
+    void * data = 0;
+
+#ifdef _WIN32
+    //  1 GB pages need VirtualAlloc2, absent from this SDK
+    if (pages == CapturePolicy::pgHuge)
+        return 0;
+
+    DWORD type = MEM_RESERVE | MEM_COMMIT;
+    if (pages == CapturePolicy::pgLarge)
+        {
+        if (!GetLargePageMinimum() || !LockMemoryPrivilege())
+            return 0;
+        type |= MEM_LARGE_PAGES;
+        }
+    if (node >= 0)
+        data = VirtualAllocExNuma(GetCurrentProcess(), 0, mapped, type, PAGE_READWRITE, node);
+    else
+        data = VirtualAlloc(0, mapped, type, PAGE_READWRITE);
+    if (!data)
+        return 0;
+    //  Large pages are never paged out
+    FLocked = pages != CapturePolicy::pgNormal;
+#else
+    int flags = MAP_PRIVATE | MAP_ANONYMOUS;
+    if (pages == CapturePolicy::pgLarge)
+        flags |= MAP_HUGETLB | (21 << MAP_HUGE_SHIFT);
+    else if (pages == CapturePolicy::pgHuge)
+        flags |= MAP_HUGETLB | (30 << MAP_HUGE_SHIFT);
+    data = mmap(0, mapped, PROT_READ | PROT_WRITE, flags, -1, 0);
+    if (data == MAP_FAILED)
+        return 0;
+
+    //  Bind before first touch; MPOL_BIND = 2.  Best effort.
+    if (node >= 0 && node < 64)
+        {
+        unsigned long mask = 1UL << node;
+        syscall(SYS_mbind, data, mapped, 2, &mask, 64, 0);
+        }
+#endif
+
+    FMapped = mapped;
+    FPageBytes = page;
+    FPages = pages;
+    return data;
+}
+
+//---------------------------------------------------------------------------
+//  CaptureMemory::Release() --  Return the block to the OS
+//---------------------------------------------------------------------------
+
+void  CaptureMemory::Release()
+{
+    if (!FData)
+        return;
+
+#ifdef _WIN32
+    if (FLocked && FPages == CapturePolicy::pgNormal)
+        Unlock(FData, FMapped);
+    VirtualFree(FData, 0, MEM_RELEASE);
+#else
+    if (FLocked)
+        Unlock(FData, FMapped);
+    munmap(FData, FMapped);
+#endif
+
+    FData = 0;
+    FBytes = FMapped = FPageBytes = 0;
+    FPages = CapturePolicy::pgNormal;
+    FLocked = false;
+}
+
+//---------------------------------------------------------------------------
+//  CaptureMemory::Prefault() --  Touch every page so faults happen now
+//---------------------------------------------------------------------------
+//  Rewrites the byte it reads, so it is safe on memory already in use.
+
+void  CaptureMemory::Prefault(void * data, size_t bytes, size_t page_bytes)
+{
+    volatile char * p = static_cast<volatile char *>(data);
+    const size_t step = page_bytes < SmallPage ? SmallPage : page_bytes;
+    for (size_t i = 0; i < bytes; i += step)
+        p[i] = p[i];
+    if (bytes)
+        p[bytes - 1] = p[bytes - 1];
+}
+
+//---------------------------------------------------------------------------
+//  CaptureMemory::Lock() --  Pin a range in physical memory
+//---------------------------------------------------------------------------
+
+bool  CaptureMemory::Lock(void * data, size_t bytes)
+{
+    if (!data || !bytes)
+        return false;
+#ifdef _WIN32
+    //  VirtualLock is limited by the working set minimum; grow it first
+    SIZE_T lo, hi;
+    if (GetProcessWorkingSetSize(GetCurrentProcess(), &lo, &hi))
+        SetProcessWorkingSetSize(GetCurrentProcess(), lo + bytes, hi + bytes);
+    return VirtualLock(data, bytes) != 0;
+#else
+    return mlock(data, bytes) == 0;
+#endif
+}
+
+//---------------------------------------------------------------------------
+//  CaptureMemory::Unlock() --  Release a range pinned by Lock()
+//---------------------------------------------------------------------------
+
+void  CaptureMemory::Unlock(void * data, size_t bytes)
+{
+    if (!data || !bytes)
+        return;
+#ifdef _WIN32
+    VirtualUnlock(data, bytes);
+    SIZE_T lo, hi;
+    if (GetProcessWorkingSetSize(GetCurrentProcess(), &lo, &hi) && lo > bytes && hi > bytes)
+        SetProcessWorkingSetSize(GetCurrentProcess(), lo - bytes, hi - bytes);
+#else
+    munlock(data, bytes);
+#endif
+}
@@ -0,0 +1,84 @@
+// CaptureMemory.h
+//
+// Page-policy aware allocation for capture and staging buffers
+
+#ifndef CaptureMemoryH
+#define CaptureMemoryH
+
+#include <cstddef>
+#include <string>
+
+//===========================================================================
+//  STRUCT CapturePolicy  -- How capture memory is backed
+//===========================================================================
+
+struct CapturePolicy
+{
+    enum IIPages { pgNormal, pgLarge, pgHuge };     // 4 KB, 2 MB, 1 GB
+
+    CapturePolicy(IIPages pages = pgNormal, bool prefault = true, bool lock = false, int node = -1)
+        : Pages(pages), Prefault(prefault), Lock(lock), Node(node)
+        {}
+
+    IIPages         Pages;
+    bool            Prefault;       // Touch every page at allocation time
+    bool            Lock;           // Pin in physical memory
+    int             Node;           // NUMA node, -1 for any
+
+    std::string  Name() const;
+};
+
+//===========================================================================
+//  CLASS CaptureMemory  -- One page-aligned block owned by a policy
+//===========================================================================
+//  Capture buffers otherwise take their first-touch page faults inside
+//  the ingest copy, at line rate.  A block allocated here is backed by
+//  the requested page size, bound to a NUMA node, faulted in and
+//  optionally locked before streaming starts.  Large and huge page
+//  requests fall back to the next smaller size when the OS refuses them
+//  (no privilege, no reserved pages); Pages() reports what was obtained.
+
+class CaptureMemory
+{
+public:
+    CaptureMemory();
+    ~CaptureMemory();
+
+    bool  Allocate(size_t bytes, const CapturePolicy & policy = CapturePolicy());
+    void  Release();
+
+    void *  Data() const
+        {  return FData;  }
+    template <typename T>
+    T *  As() const
+        {  return static_cast<T *>(FData);  }
+    size_t  Bytes() const
+        {  return FBytes;  }
+    size_t  PageBytes() const
+        {  return FPageBytes;  }
+    CapturePolicy::IIPages  Pages() const
+        {  return FPages;  }
+    bool  Locked() const
+        {  return FLocked;  }
+
+    //  Helpers usable on memory from elsewhere, e.g. an mxArray
+    static size_t  PageSize(CapturePolicy::IIPages pages);
+    static void    Prefault(void * data, size_t bytes, size_t page_bytes = 4096);
+    static bool    Lock(void * data, size_t bytes);
+    static void    Unlock(void * data, size_t bytes);
+
+private:
+    void *                  FData;
+    size_t                  FBytes;         // Requested size
+    size_t                  FMapped;        // ...rounded up to whole pages
+    size_t                  FPageBytes;
+    CapturePolicy::IIPages  FPages;
+    bool                    FLocked;
+
+    void *  Map(size_t bytes, CapturePolicy::IIPages pages, int node);
+
+    CaptureMemory(const CaptureMemory &);
+    CaptureMemory & operator=(const CaptureMemory &);
+};
+
+#endif
@@ -0,0 +1,198 @@
+// CaptureRing.cpp
+//
+// Per-channel flight recorder ring buffer
+
+#include "CaptureRing.h"
+#include <algorithm>
+#include <cstring>
+
+namespace
+{
+    const unsigned long long Never = ~0ULL;
+}
+
+//===========================================================================
+//  CLASS CaptureRing  -- Continuously overwritten capture of one channel
+//===========================================================================
+//---------------------------------------------------------------------------
+//  constructor for class CaptureRing
+//---------------------------------------------------------------------------
+
+CaptureRing::CaptureRing()
+    : Data(0), FFrames(0), FFrameSamples(0),
+      FWritten(0), FWriting(0), FreezeAt(Never), FDropped(0), FFrozen(false)
+{
+}
+
+//---------------------------------------------------------------------------
+//  CaptureRing::Allocate() --  Size the ring, in frames of 'frame_samples'
+//---------------------------------------------------------------------------
+
+void  CaptureRing::Allocate(size_t frames, size_t frame_samples, const CapturePolicy & policy)
+{
+    if (!frame_samples)
+        frames = 0;
+    Memory.Allocate(frames * frame_samples * sizeof(short), policy);
+    Data = Memory.As<short>();
+    FFrames = Data ? frames : 0;
+    FFrameSamples = frame_samples;
+    Reset();
+}
+
+//---------------------------------------------------------------------------
+//  CaptureRing::Reset() --  Empty and unfreeze; writer must be idle
+//---------------------------------------------------------------------------
+
+void  CaptureRing::Reset()
+{
+    FWritten = 0;
+    FWriting = 0;
+    FreezeAt = Never;
+    FDropped = 0;
+    FFrozen = false;
+}
+
+//---------------------------------------------------------------------------
+//  CaptureRing::Write() --  Append payload, overwriting the oldest samples
+//---------------------------------------------------------------------------
+
+size_t  CaptureRing::Write(const unsigned int * payload, size_t words)
+{
+    const size_t n = words * sizeof(unsigned int) / sizeof(short);
+    const size_t cap = Capacity();
+    if (!cap || Frozen())
+        {
+        FDropped.fetch_add(n, std::memory_order_relaxed);
+        return 0;
+        }
+
+    const short * src = reinterpret_cast<const short *>(payload);
+    unsigned long long w = FWritten.load(std::memory_order_relaxed);
+
+    //  Stop short at a pending trigger freeze point
+    size_t take = n;
+    bool freeze = false;
+    const unsigned long long stop = FreezeAt.load(std::memory_order_acquire);
+    if (stop != Never && w + take >= stop)
+        {
+        take = stop > w ? static_cast<size_t>(stop - w) : 0;
+        freeze = true;
+        }
+
+    //  Announce each span before overwriting it, so readers can tell
+    //  which part of a concurrent copy is stale
+    size_t done = 0;
+    while (done < take)
+        {
+        const size_t chunk = std::min(take - done, cap);
+        FWriting.store(w + chunk, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+
+        const size_t pos = static_cast<size_t>(w % cap);
+        const size_t first = std::min(chunk, cap - pos);
+        std::memcpy(&Data[pos], src + done, first * sizeof(short));
+        if (chunk > first)
+            std::memcpy(&Data[0], src + done + first, (chunk - first) * sizeof(short));
+
+        w += chunk;
+        done += chunk;
+        FWritten.store(w, std::memory_order_release);
+        }
+
+    if (n > take)
+        FDropped.fetch_add(n - take, std::memory_order_relaxed);
+    if (freeze)
+        FFrozen.store(true, std::memory_order_release);
+
+    return take * sizeof(short);
+}
+
+//---------------------------------------------------------------------------
+//  CaptureRing::Freeze() --  Stop recording now
+//---------------------------------------------------------------------------
+
+void  CaptureRing::Freeze()
+{
+    FFrozen.store(true, std::memory_order_release);
+}
+
+//---------------------------------------------------------------------------
+//  CaptureRing::Trigger() --  Freeze after the current frame plus 'post_frames'
+//---------------------------------------------------------------------------
+
+void  CaptureRing::Trigger(size_t post_frames)
+{
+    const unsigned long long fs = FFrameSamples ? FFrameSamples : 1;
+    const unsigned long long w = FWritten.load(std::memory_order_acquire);
+    FreezeAt.store(((w + fs - 1) / fs + post_frames) * fs, std::memory_order_release);
+}
+
+//---------------------------------------------------------------------------
+//  CaptureRing::Thaw() --  Resume recording
+//---------------------------------------------------------------------------
+
+void  CaptureRing::Thaw()
+{
+    FreezeAt.store(Never, std::memory_order_release);
+    FFrozen.store(false, std::memory_order_release);
+}
+
+//---------------------------------------------------------------------------
+//  CaptureRing::FramesHeld() --  Complete frames currently in the ring
+//---------------------------------------------------------------------------
+
+size_t  CaptureRing::FramesHeld() const
+{
+    if (!FFrameSamples)
+        return 0;
+    const unsigned long long end = Written();
+    return static_cast<size_t>(std::min<unsigned long long>(end / FFrameSamples, FFrames));
+}
+
+//---------------------------------------------------------------------------
+//  CaptureRing::Snapshot() --  Lock-free copy of the newest frames
+//---------------------------------------------------------------------------
+
+size_t  CaptureRing::Snapshot(short * dest, size_t frames, unsigned long long * first) const
+{
+    const size_t cap = Capacity();
+    const unsigned long long fs = FFrameSamples;
+    if (!cap)
+        return 0;
+
+    unsigned long long end = Written();
+    end -= end % fs;
+    const size_t held = static_cast<size_t>(std::min<unsigned long long>(end, cap) / fs);
+    size_t count = frames ? std::min(frames, held) : held;
+    unsigned long long start = end - count * fs;
+
+    //  Copy oldest first, unwrapping the ring
+    const size_t samples = static_cast<size_t>(count * fs);
+    const size_t pos = static_cast<size_t>(start % cap);
+    const size_t head = std::min(samples, cap - pos);
+    if (samples)
+        {
+        std::memcpy(dest, &Data[pos], head * sizeof(short));
+        if (samples > head)
+            std::memcpy(dest + head, &Data[0], (samples - head) * sizeof(short));
+        }
+
+    //  Samples below (writing - cap) may have been overwritten during the
+    //  copy; drop the frames they touch
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    const unsigned long long writing = FWriting.load(std::memory_order_relaxed);
+    if (writing > start + cap)
+        {
+        unsigned long long valid = writing - cap;
+        valid = (valid + fs - 1) / fs * fs;
+        const size_t lost = valid >= end ? count : static_cast<size_t>((valid - start) / fs);
+        if (lost < count)
+            std::memmove(dest, dest + lost * fs, static_cast<size_t>((count - lost) * fs) * sizeof(short));
+        count -= lost;
+        start += lost * fs;
+        }
+
+    if (first)
+        *first = start;
+    return count;
+}
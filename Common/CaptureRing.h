@@ -0,0 +1,78 @@
+// CaptureRing.h
+//
+// Per-channel flight recorder ring buffer
+
+#ifndef CaptureRingH
+#define CaptureRingH
+
+#include "StreamSink.h"
+#include "CaptureMemory.h"
+#include <atomic>
+
+//===========================================================================
+//  CLASS CaptureRing  -- Continuously overwritten capture of one channel
+//===========================================================================
+//  The owning ingest worker streams samples in indefinitely, overwriting
+//  the oldest frame.  Any thread may take a snapshot of the newest frames
+//  without locking: the writer announces the span it is about to overwrite
+//  before copying, and a reader discards whatever part of its copy may
+//  have been clobbered meanwhile.
+//
+//  Freeze() stops the writer at once.  Trigger(n) lets n more frames in,
+//  then freezes, so the ring holds the time either side of the event.
+
+class CaptureRing : public IStreamSink
+{
+public:
+    CaptureRing();
+
+    void  Allocate(size_t frames, size_t frame_samples,
+                   const CapturePolicy & policy = CapturePolicy());
+    void  Reset();
+
+    //  IStreamSink -- writer side, single thread
+    size_t  Write(const unsigned int * payload, size_t words);
+    bool    Full() const
+        {  return Frozen();  }
+
+    //  Control -- any thread
+    void  Freeze();
+    void  Trigger(size_t post_frames);
+    void  Thaw();
+    bool  Frozen() const
+        {  return FFrozen.load(std::memory_order_acquire);  }
+
+    //  Readers -- any thread.  Copies up to 'frames' of the newest complete
+    //  frames (0 = all held) into 'dest', oldest first.  Returns frames
+    //  copied; 'first' receives the stream sample index of dest[0].
+    size_t  Snapshot(short * dest, size_t frames, unsigned long long * first = 0) const;
+
+    //  Status
+    size_t  Frames() const
+        {  return FFrames;  }
+    size_t  FrameSamples() const
+        {  return FFrameSamples;  }
+    size_t  Capacity() const
+        {  return FFrames * FFrameSamples;  }
+    size_t  FramesHeld() const;
+    unsigned long long  Written() const
+        {  return FWritten.load(std::memory_order_acquire);  }
+    unsigned long long  Dropped() const
+        {  return FDropped.load(std::memory_order_relaxed);  }
+
+private:
+    CaptureMemory                       Memory;
+    short *                             Data;
+    size_t                              FFrames;
+    size_t                              FFrameSamples;
+    std::atomic<unsigned long long>     FWritten;   // Samples published
+    std::atomic<unsigned long long>     FWriting;   // ...end of span being written
+    std::atomic<unsigned long long>     FreezeAt;   // Freeze once written reaches this
+    std::atomic<unsigned long long>     FDropped;   // Samples refused while frozen
+    std::atomic<bool>                   FFrozen;
+
+    CaptureRing(const CaptureRing &);
+    CaptureRing & operator=(const CaptureRing &);
+};
+
+#endif
@@ -0,0 +1,224 @@
+// ColumnLogger.cpp
+//
+// Per-stream sample files with a packet side table, written at ingest
+
+#include "ColumnLogger.h"
+#include <sstream>
+#include <algorithm>
+#include <cstring>
+
+//===========================================================================
+//  CLASS ColumnLogger  -- Column file and side table per stream
+//===========================================================================
+//---------------------------------------------------------------------------
+//  constructor for class ColumnLogger
+//---------------------------------------------------------------------------
+
+ColumnLogger::ColumnLogger()
+    : BlockBytes(4 * 1024 * 1024), Depth(2), Blocks(0), Direct(true), Blocking(false),
+      SampleRate(0), Format(ArrayFile::afRaw), FrameSize(1), Last(0)
+{
+}
+
+//---------------------------------------------------------------------------
+//  destructor for class ColumnLogger
+//---------------------------------------------------------------------------
+
+ColumnLogger::~ColumnLogger()
+{
+    Close();
+}
+
+//---------------------------------------------------------------------------
+//  ColumnLogger::Add() --  Open the files of one stream
+//---------------------------------------------------------------------------
+
+bool  ColumnLogger::Add(unsigned int sid, unsigned int channel, unsigned int lanes, unsigned int sample_bytes,
+                        const std::string & data_file, const std::string & table_file)
+{
+    if (!Columns.empty() && !Columns[0].Data->IsOpen())
+        {
+        Columns.clear();
+        FError.clear();
+        Last = 0;
+        }
+
+    Column col;
+    col.Sid = sid;
+    col.Channel = channel;
+    col.Lanes = std::max(lanes, 1u);
+    col.SampleBytes = sample_bytes;
+    col.Position = ArrayFile::DataOffset(Format);
+    col.Packets = 0;
+    col.Dropped = 0;
+    col.Data = std::make_shared<DiskLogger>();
+    col.Table = std::make_shared<DiskLogger>();
+
+    col.Data->BlockBytes = BlockBytes;
+    col.Data->Depth = Depth;
+    col.Data->Blocks = Blocks;
+    col.Data->Direct = Direct;
+    col.Data->Blocking = Blocking;
+    //  32 bytes a packet is a small fraction of the samples
+    col.Table->BlockBytes = std::max<size_t>(BlockBytes / 16, 64 * 1024);
+    col.Table->Depth = Depth;
+    col.Table->Blocks = Blocks;
+    col.Table->Direct = Direct;
+    col.Table->Blocking = Blocking;
+
+    if (!col.Data->Open(data_file))
+        {
+        FError = data_file + ": " + col.Data->Error();
+        return false;
+        }
+    if (!col.Table->Open(table_file))
+        {
+        FError = table_file + ": " + col.Table->Error();
+        col.Data->Close();
+        return false;
+        }
+
+    ColumnTableHeader head;
+    std::memset(&head, 0, sizeof(head));
+    std::memcpy(head.Magic, "IICOLTBL", sizeof(head.Magic));
+    head.Version = 1;
+    head.HeaderBytes = sizeof(ColumnTableHeader);
+    head.RecordBytes = sizeof(ColumnRecord);
+    head.Sid = sid;
+    head.Channel = channel;
+    head.Lanes = std::max(lanes, 1u);
+    head.SampleBytes = sample_bytes;
+    head.SampleRate = SampleRate;
+    col.Table->Write(&head, sizeof(head));
+
+    std::vector<unsigned char> array;
+    ArrayFile::Header(Format, Name(channel), sample_bytes, Dims(col, 0), 0, array);
+    if (!array.empty())
+        col.Data->Write(&array[0], array.size());
+
+    Columns.push_back(col);
+    return true;
+}
+
+//---------------------------------------------------------------------------
+//  ColumnLogger::Process() --  Append a buffer's payloads and records
+//---------------------------------------------------------------------------
+//  Packets of streams not held here are passed over.  A buffer usually
+//  repeats one stream, or cycles through a few, so the lookup tries the
+//  previous packet's column first.
+
+void  ColumnLogger::Process(const VitaIndex & index, const unsigned int * words)
+{
+    const size_t columns = Columns.size();
+    for (size_t p = 0; p < index.Size() && columns; ++p)
+        {
+        const VitaPacketInfo & info = index[p];
+        if (!info.PayloadWords)
+            continue;
+
+        size_t c = Last < columns && Columns[Last].Sid == info.Sid ? Last : columns;
+        for (size_t k = 0; c == columns && k < columns; ++k)
+            if (Columns[k].Sid == info.Sid)
+                c = k;
+        if (c == columns)
+            continue;
+        Last = c;
+
+        Column & col = Columns[c];
+        const size_t bytes = info.PayloadWords * sizeof(unsigned int);
+        if (!Blocking && !(col.Data->Room(bytes) && col.Table->Room(sizeof(ColumnRecord))))
+            {
+            ++col.Dropped;
+            continue;
+            }
+
+        ColumnRecord rec;
+        rec.Offset = col.Position;
+        rec.TsFrac = static_cast<unsigned long long>(info.TsFracHi) << 32 | info.TsFracLo;
+        rec.TsInt = info.TsInt;
+        rec.Bytes = static_cast<unsigned int>(bytes);
+        rec.Count = static_cast<unsigned short>(info.Count);
+        rec.Types = static_cast<unsigned short>(info.Tsi << 2 | info.Tsf);
+        rec.Reserved = 0;
+
+        col.Data->Write(words + info.Offset + info.PayloadOffset, bytes);
+        col.Table->Write(&rec, sizeof(rec));
+        col.Position += bytes;
+        ++col.Packets;
+        }
+}
+
+//---------------------------------------------------------------------------
+//  ColumnLogger::Close() --  Flush and close every file
+//---------------------------------------------------------------------------
+//  The columns stay listed, with their counts, until the next Add().
+
+void  ColumnLogger::Close()
+{
+    for (size_t c = 0; c < Columns.size(); ++c)
+        {
+        Column & col = Columns[c];
+        if (!col.Data->IsOpen())
+            continue;
+        col.Data->Close();
+        col.Table->Close();
+
+        const unsigned long long offset = ArrayFile::DataOffset(Format);
+        const unsigned long long bytes = col.Data->Written() > offset ? col.Data->Written() - offset : 0;
+        const unsigned long long frames = bytes / (col.SampleBytes * col.Lanes * std::max<size_t>(FrameSize, 1));
+        if (!ArrayFile::Seal(col.Data->FileName(), Format, Name(col.Channel), col.SampleBytes,
+                Dims(col, frames), bytes) && FError.empty())
+            FError = col.Data->FileName() + ": cannot seal the header";
+        if (FError.empty() && !col.Data->Error().empty())
+            FError = col.Data->FileName() + ": " + col.Data->Error();
+        if (FError.empty() && !col.Table->Error().empty())
+            FError = col.Table->FileName() + ": " + col.Table->Error();
+        }
+}
+
+//---------------------------------------------------------------------------
+//  ColumnLogger::DataFile() --  Conventional column file name
+//---------------------------------------------------------------------------
+
+std::string  ColumnLogger::DataFile(const std::string & path, unsigned int channel, ArrayFile::IIFormat format)
+{
+    std::stringstream name;
+    name << path << "Data.ch" << channel + 1 << ArrayFile::Extension(format);
+    return name.str();
+}
+
+//---------------------------------------------------------------------------
+//  ColumnLogger::TableFile() --  Conventional side table name
+//---------------------------------------------------------------------------
+
+std::string  ColumnLogger::TableFile(const std::string & path, unsigned int channel)
+{
+    std::stringstream name;
+    name << path << "Data.ch" << channel + 1 << ".idx";
+    return name.str();
+}
+
+//---------------------------------------------------------------------------
+//  ColumnLogger::Name() --  Variable name of a column in a .mat
+//---------------------------------------------------------------------------
+
+std::string  ColumnLogger::Name(unsigned int channel)
+{
+    std::stringstream name;
+    name << "ch" << channel + 1;
+    return name.str();
+}
+
+//---------------------------------------------------------------------------
+//  ColumnLogger::Dims() --  Array shape of a column, MATLAB order
+//---------------------------------------------------------------------------
+
+std::vector<unsigned long long>  ColumnLogger::Dims(const Column & col, unsigned long long frames) const
+{
+    std::vector<unsigned long long> dims;
+    if (col.Lanes > 1)
+        dims.push_back(col.Lanes);
+    dims.push_back(std::max<size_t>(FrameSize, 1));
+    dims.push_back(frames);
+    return dims;
+}
@@ -0,0 +1,134 @@
+// ColumnLogger.h
+//
+// Per-stream sample files with a packet side table, written at ingest
+
+#ifndef ColumnLoggerH
+#define ColumnLoggerH
+
+#include "ArrayFile.h"
+#include "DiskLogger.h"
+#include "VitaIndex.h"
+#include <string>
+#include <vector>
+#include <memory>
+
+//===========================================================================
+//  STRUCT ColumnTableHeader  -- First 64 bytes of a side table file
+//===========================================================================
+//  The records follow back to back; their count is the file size less
+//  HeaderBytes, over RecordBytes.  Little endian, as written.
+
+struct ColumnTableHeader
+{
+    char                Magic[8];       // "IICOLTBL"
+    unsigned int        Version;        // 1
+    unsigned int        HeaderBytes;    // sizeof(ColumnTableHeader)
+    unsigned int        RecordBytes;    // sizeof(ColumnRecord)
+    unsigned int        Sid;
+    unsigned int        Channel;        // First channel in the stream, from 0
+    unsigned int        Lanes;          // Channels interleaved in each sample
+    unsigned int        SampleBytes;    // Per channel
+    unsigned int        Reserved0;
+    double              SampleRate;     // Hz per channel, 0 if unknown
+    unsigned char       Reserved[16];
+};
+
+//===========================================================================
+//  STRUCT ColumnRecord  -- One packet's entry in the side table
+//===========================================================================
+
+struct ColumnRecord
+{
+    unsigned long long  Offset;         // Payload start in the column file, bytes
+    unsigned long long  TsFrac;         // Fractional timestamp, as sent
+    unsigned int        TsInt;          // Integer timestamp, as sent
+    unsigned int        Bytes;          // Payload length
+    unsigned short      Count;          // 4-bit packet count
+    unsigned short      Types;          // TSI << 2 | TSF
+    unsigned int        Reserved;
+};
+
+//===========================================================================
+//  CLASS ColumnLogger  -- Column file and side table per stream
+//===========================================================================
+//  Process() strips each packet of a buffer down to its payload and
+//  appends it to its stream's column file, so the file is nothing but the
+//  stream's samples in order, starting on a page boundary and readable at
+//  any offset without parsing.  Each packet also adds a fixed size
+//  ColumnRecord -- where its samples start and when they were taken -- to
+//  the stream's side table.
+//
+//  Both files go through their own DiskLogger, so the producer only
+//  copies.  A packet's payload and record land together or are dropped
+//  together, and the column never gets a hole its table does not show.
+//  One thread calls Process(); give each ingest worker its own logger
+//  holding a share of the streams.
+//
+//  With Format afNpy or afMat a column file is also an array, FrameSize x
+//  frames (lanes x FrameSize x frames if interleaved), whose header
+//  Close() seals; record offsets then count from the start of the file,
+//  header included.
+
+class ColumnLogger
+{
+public:
+    struct Column
+    {
+        unsigned int                    Sid;
+        unsigned int                    Channel;
+        unsigned int                    Lanes;
+        unsigned int                    SampleBytes;
+        unsigned long long              Position;       // Column file offset of the next payload
+        unsigned long long              Packets;        // ...in this many packets
+        unsigned long long              Dropped;        // Packets refused
+        std::shared_ptr<DiskLogger>     Data;
+        std::shared_ptr<DiskLogger>     Table;
+    };
+
+    ColumnLogger();
+    ~ColumnLogger();
+
+    //  Config, read by Add()
+    size_t              BlockBytes;     // Column file writes; tables use 1/16
+    unsigned int        Depth;
+    unsigned int        Blocks;
+    bool                Direct;
+    bool                Blocking;
+    double              SampleRate;     // Recorded in each table header
+    ArrayFile::IIFormat Format;         // Column files as raw samples, .npy or .mat
+    size_t              FrameSize;      // Rows of a column array
+
+    //  Open the column file and table for stream 'sid'
+    bool  Add(unsigned int sid, unsigned int channel, unsigned int lanes, unsigned int sample_bytes,
+              const std::string & data_file, const std::string & table_file);
+    //  Producer: append this buffer's packets for the streams held
+    void  Process(const VitaIndex & index, const unsigned int * words);
+    void  Close();
+
+    //  Status
+    size_t  Count() const
+        {  return Columns.size();  }
+    const Column &  Stream(size_t c) const
+        {  return Columns[c];  }
+    std::string  Error() const
+        {  return FError;  }
+
+    //  Conventional names beside a capture's Data.bin: Data.ch<n>.bin (or
+    //  .npy, .mat) and Data.ch<n>.idx, n counting from 1
+    static std::string  DataFile(const std::string & path, unsigned int channel,
+                                 ArrayFile::IIFormat format = ArrayFile::afRaw);
+    static std::string  TableFile(const std::string & path, unsigned int channel);
+
+private:
+    std::vector<Column>     Columns;
+    size_t                  Last;           // Column of the previous packet
+    std::string             FError;
+
+    static std::string  Name(unsigned int channel);
+    std::vector<unsigned long long>  Dims(const Column & col, unsigned long long frames) const;
+
+    ColumnLogger(const ColumnLogger &);
+    ColumnLogger & operator=(const ColumnLogger &);
+};
+
+#endif
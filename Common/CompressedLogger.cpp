@@ -0,0 +1,500 @@
+// CompressedLogger.cpp
+//
+// Parallel lossless compression stage for the stream file, and its reader
+
+#include "CompressedLogger.h"
+#include <fstream>
+#include <algorithm>
+#include <cstring>
+
+namespace
+{
+    const char Magic[] = "IIVCOMP1";
+    const unsigned int ChunkMagic = 0x435A4949;         // "IIZC"
+    const unsigned int TrailerMagic = 0x585A4949;       // "IIZX"
+
+    bool  EntryBefore(unsigned long long offset, const CompressedEntry & entry)
+        {  return offset < entry.RawOffset;  }
+}
+
+//===========================================================================
+//  CLASS CompressedLogger  -- Compress a stream on a thread pool
+//===========================================================================
+//---------------------------------------------------------------------------
+//  constructor for class CompressedLogger
+//---------------------------------------------------------------------------
+
+CompressedLogger::CompressedLogger()
+    : ChunkBytes(1024 * 1024), Threads(2), Chunks(0), Lanes(1), Blocking(false),
+      Current(0), Closing(false), NextSequence(0), NextOut(0),
+      FBytes(0), FDropped(0), FPacked(0), FLost(0)
+{
+}
+
+//---------------------------------------------------------------------------
+//  destructor for class CompressedLogger
+//---------------------------------------------------------------------------
+
+CompressedLogger::~CompressedLogger()
+{
+    Close();
+}
+
+//---------------------------------------------------------------------------
+//  CompressedLogger::Open() --  Write the file header, start the workers
+//---------------------------------------------------------------------------
+
+bool  CompressedLogger::Open(Sink sink)
+{
+    Close();
+    if (!sink)
+        return false;
+
+    if (!Threads)
+        Threads = 1;
+    if (!Lanes)
+        Lanes = 1;
+    ChunkBytes = std::max<size_t>(ChunkBytes, 4096);
+    const unsigned int count = std::max(Chunks ? Chunks : 2*Threads + 2, Threads + 2);
+
+    Pool.clear();
+    Free.clear();
+    Pending.clear();
+    Done.clear();
+    Table.clear();
+    for (unsigned int k = 0; k < count; ++k)
+        {
+        std::shared_ptr<Chunk> chunk(new Chunk);
+        chunk->Raw.resize(ChunkBytes / sizeof(unsigned int) + 1);
+        chunk->Fill = 0;
+        chunk->RawOffset = 0;
+        chunk->Sequence = 0;
+        chunk->Packed.reserve(ChunkBytes + ChunkBytes / 8 + sizeof(CompressedChunk));
+        Pool.push_back(chunk);
+        Free.push_back(chunk.get());
+        }
+
+    Out = sink;
+    Current = 0;
+    Closing = false;
+    NextSequence = 0;
+    NextOut = 0;
+    FBytes = 0;
+    FDropped = 0;
+    FPacked = 0;
+    FLost = 0;
+
+    CompressedHeader head;
+    std::memset(&head, 0, sizeof(head));
+    std::memcpy(head.Magic, Magic, sizeof(head.Magic));
+    head.Version = 1;
+    head.HeaderBytes = sizeof(CompressedHeader);
+    head.Lanes = Lanes;
+    head.BlockSamples = SampleCodec::BlockSamples;
+    head.ChunkBytes = ChunkBytes;
+    if (!Emit(&head, sizeof(head)))
+        {
+        Out = Sink();
+        return false;
+        }
+
+    for (unsigned int t = 0; t < Threads; ++t)
+        Workers.push_back(std::thread(&CompressedLogger::Execute, this));
+    return true;
+}
+
+//---------------------------------------------------------------------------
+//  CompressedLogger::Write() --  Queue data for coding
+//---------------------------------------------------------------------------
+//  A write is never split across chunks, so a chunk boundary always falls
+//  between the packet groups the stream is written in.
+
+bool  CompressedLogger::Write(const void * data, size_t bytes)
+{
+    if (!IsOpen() || !bytes)
+        return !bytes;
+
+    if (Current && Current->Fill + bytes > ChunkBytes)
+        Submit();
+    if (!Current)
+        {
+        if (!(Current = Take()))
+            {
+            FDropped += bytes;
+            return false;
+            }
+        Current->Fill = 0;
+        Current->RawOffset = FBytes;
+        }
+
+    //  Only a single write larger than a chunk grows the buffer
+    const size_t words = (Current->Fill + bytes + sizeof(unsigned int) - 1) / sizeof(unsigned int);
+    if (words > Current->Raw.size())
+        Current->Raw.resize(words);
+    std::memcpy(reinterpret_cast<char *>(&Current->Raw[0]) + Current->Fill, data, bytes);
+    Current->Fill += bytes;
+    FBytes += bytes;
+
+    if (Current->Fill >= ChunkBytes)
+        Submit();
+    return true;
+}
+
+//---------------------------------------------------------------------------
+//  CompressedLogger::Close() --  Drain the workers and write the chunk table
+//---------------------------------------------------------------------------
+
+void  CompressedLogger::Close()
+{
+    if (!IsOpen())
+        return;
+
+    if (Current && Current->Fill)
+        Submit();
+    else if (Current)
+        {
+        std::lock_guard<std::mutex> lock(Lock);
+        Free.push_back(Current);
+        Current = 0;
+        }
+    {
+    std::lock_guard<std::mutex> lock(Lock);
+    Closing = true;
+    }
+    Queued.notify_all();
+    for (size_t t = 0; t < Workers.size(); ++t)
+        Workers[t].join();
+    Workers.clear();
+
+    //  Every chunk has been emitted by the worker that finished it last
+    CompressedTrailer trailer;
+    std::memset(&trailer, 0, sizeof(trailer));
+    trailer.Magic = TrailerMagic;
+    trailer.Version = 1;
+    trailer.Entries = Table.size();
+    trailer.TableOffset = FPacked.load();
+    trailer.RawBytes = FBytes;
+    if (Table.empty() || Emit(&Table[0], Table.size() * sizeof(CompressedEntry)))
+        Emit(&trailer, sizeof(trailer));
+
+    Out = Sink();
+    Pool.clear();
+    Free.clear();
+}
+
+//---------------------------------------------------------------------------
+//  CompressedLogger::Ratio() --  Raw bytes per byte written
+//---------------------------------------------------------------------------
+
+double  CompressedLogger::Ratio() const
+{
+    const unsigned long long packed = FPacked.load();
+    return packed ? static_cast<double>(FBytes) / packed : 0;
+}
+
+//---------------------------------------------------------------------------
+//  CompressedLogger::Take() --  A free chunk, or 0 if none and not Blocking
+//---------------------------------------------------------------------------
+
+CompressedLogger::Chunk *  CompressedLogger::Take()
+{
+    std::unique_lock<std::mutex> lock(Lock);
+    while (Free.empty())
+        {
+        if (!Blocking)
+            return 0;
+        Freed.wait(lock);
+        }
+    Chunk * chunk = Free.front();
+    Free.pop_front();
+    return chunk;
+}
+
+//---------------------------------------------------------------------------
+//  CompressedLogger::Submit() --  Hand the current chunk to the workers
+//---------------------------------------------------------------------------
+
+void  CompressedLogger::Submit()
+{
+    {
+    std::lock_guard<std::mutex> lock(Lock);
+    Current->Sequence = NextSequence++;
+    Pending.push_back(Current);
+    Current = 0;
+    }
+    Queued.notify_one();
+}
+
+//---------------------------------------------------------------------------
+//  CompressedLogger::Execute() --  Worker: code chunks, emit them in order
+//---------------------------------------------------------------------------
+//  A worker that finishes a chunk passes on every chunk that is ready in
+//  sequence, its own or another's.  Chunks go into Done before the
+//  worker takes Output, so none is left behind when the workers stop.
+
+void  CompressedLogger::Execute()
+{
+    for (;;)
+        {
+        Chunk * chunk;
+        {
+        std::unique_lock<std::mutex> lock(Lock);
+        while (Pending.empty() && !Closing)
+            Queued.wait(lock);
+        if (Pending.empty())
+            return;
+        chunk = Pending.front();
+        Pending.pop_front();
+        }
+
+        chunk->Packed.resize(sizeof(CompressedChunk));
+        SampleCodec::EncodeChunk(&chunk->Raw[0], chunk->Fill, Lanes, chunk->Packed, chunk->Index);
+        CompressedChunk head;
+        std::memset(&head, 0, sizeof(head));
+        head.Magic = ChunkMagic;
+        head.RawBytes = static_cast<unsigned int>(chunk->Fill);
+        head.PackedBytes = static_cast<unsigned int>(chunk->Packed.size() - sizeof(head));
+        head.RawOffset = chunk->RawOffset;
+        head.Sequence = chunk->Sequence;
+        std::memcpy(&chunk->Packed[0], &head, sizeof(head));
+
+        {
+        std::lock_guard<std::mutex> lock(Lock);
+        Done[chunk->Sequence] = chunk;
+        }
+
+        std::lock_guard<std::mutex> output(Output);
+        for (;;)
+            {
+            Chunk * ready;
+            {
+            std::lock_guard<std::mutex> lock(Lock);
+            std::map<unsigned long long, Chunk *>::iterator it = Done.find(NextOut);
+            if (it == Done.end())
+                break;
+            ready = it->second;
+            Done.erase(it);
+            ++NextOut;
+            }
+
+            CompressedEntry entry;
+            entry.RawOffset = ready->RawOffset;
+            entry.FileOffset = FPacked.load();
+            if (Emit(&ready->Packed[0], ready->Packed.size()))
+                Table.push_back(entry);
+            else
+                FLost += ready->Fill;
+
+            {
+            std::lock_guard<std::mutex> lock(Lock);
+            Free.push_back(ready);
+            }
+            Freed.notify_one();
+            }
+        }
+}
+
+//---------------------------------------------------------------------------
+//  CompressedLogger::Emit() --  Pass bytes to the sink and count them
+//---------------------------------------------------------------------------
+
+bool  CompressedLogger::Emit(const void * data, size_t bytes)
+{
+    if (!Out(data, bytes))
+        return false;
+    FPacked += bytes;
+    return true;
+}
+
+//===========================================================================
+//  CLASS CompressedReader  -- Random access to a compressed stream file
+//===========================================================================
+//---------------------------------------------------------------------------
+//  constructor for class CompressedReader
+//---------------------------------------------------------------------------
+
+CompressedReader::CompressedReader()
+{
+}
+
+//---------------------------------------------------------------------------
+//  CompressedReader::Open() --  Map a file and find its chunks
+//---------------------------------------------------------------------------
+
+bool  CompressedReader::Open(const std::string & file)
+{
+    Close();
+    if (!Map.Open(file))
+        return false;
+
+    const unsigned long long bytes = Map.Bytes();
+    if (bytes < sizeof(CompressedHeader))
+        {
+        Close();
+        return false;
+        }
+    const CompressedHeader & head = Header();
+    if (std::memcmp(head.Magic, Magic, sizeof(head.Magic)) != 0 || head.Version != 1
+        || head.HeaderBytes < sizeof(CompressedHeader) || head.HeaderBytes > bytes)
+        {
+        Close();
+        return false;
+        }
+
+    //  The table, if the file was closed and every entry names a whole
+    //  chunk before it, in stream order
+    if (bytes >= head.HeaderBytes + sizeof(CompressedTrailer))
+        {
+        const CompressedTrailer & trailer =
+            *reinterpret_cast<const CompressedTrailer *>(Map.Data() + bytes - sizeof(CompressedTrailer));
+        if (trailer.Magic == TrailerMagic && trailer.Version == 1
+            && trailer.Entries <= bytes / sizeof(CompressedEntry)
+            && trailer.TableOffset + trailer.Entries * sizeof(CompressedEntry) + sizeof(CompressedTrailer) == bytes)
+            {
+            const CompressedEntry * table = reinterpret_cast<const CompressedEntry *>(Map.Data() + trailer.TableOffset);
+            Table.assign(table, table + trailer.Entries);
+            for (size_t k = 0; k < Table.size(); ++k)
+                if (!Whole(Table[k], trailer.TableOffset) || (k && Table[k].RawOffset <= Table[k - 1].RawOffset))
+                    {
+                    Table.clear();
+                    break;
+                    }
+            if (!Table.empty() || !trailer.Entries)
+                return true;
+            }
+        }
+
+    //  Otherwise walk the chunk headers, up to one cut short
+    unsigned long long pos = head.HeaderBytes;
+    while (pos + sizeof(CompressedChunk) <= bytes)
+        {
+        const CompressedChunk & chunk = *reinterpret_cast<const CompressedChunk *>(Map.Data() + pos);
+        if (chunk.Magic != ChunkMagic || pos + sizeof(CompressedChunk) + chunk.PackedBytes > bytes
+            || (!Table.empty() && chunk.RawOffset <= Table.back().RawOffset))
+            break;
+        CompressedEntry entry;
+        entry.RawOffset = chunk.RawOffset;
+        entry.FileOffset = pos;
+        Table.push_back(entry);
+        pos += sizeof(CompressedChunk) + chunk.PackedBytes;
+        }
+    return true;
+}
+
+//---------------------------------------------------------------------------
+//  CompressedReader::Whole() --  Whether an entry names a chunk before 'end'
+//---------------------------------------------------------------------------
+
+bool  CompressedReader::Whole(const CompressedEntry & entry, unsigned long long end) const
+{
+    if (entry.FileOffset < Header().HeaderBytes || entry.FileOffset > end
+        || end - entry.FileOffset < sizeof(CompressedChunk))
+        return false;
+    const CompressedChunk & chunk = *reinterpret_cast<const CompressedChunk *>(Map.Data() + entry.FileOffset);
+    return chunk.Magic == ChunkMagic && chunk.RawOffset == entry.RawOffset
+        && chunk.PackedBytes <= end - entry.FileOffset - sizeof(CompressedChunk);
+}
+
+//---------------------------------------------------------------------------
+//  CompressedReader::Close() --  Unmap
+//---------------------------------------------------------------------------
+
+void  CompressedReader::Close()
+{
+    Map.Close();
+    Table.clear();
+}
+
+//---------------------------------------------------------------------------
+//  CompressedReader::Chunk() --  Header of chunk 'k'
+//---------------------------------------------------------------------------
+
+const CompressedChunk &  CompressedReader::Chunk(size_t k) const
+{
+    return *reinterpret_cast<const CompressedChunk *>(Map.Data() + Table[k].FileOffset);
+}
+
+//---------------------------------------------------------------------------
+//  CompressedReader::Bytes() --  End of the raw stream covered
+//---------------------------------------------------------------------------
+
+unsigned long long  CompressedReader::Bytes() const
+{
+    if (Table.empty())
+        return 0;
+    const CompressedChunk & last = Chunk(Table.size() - 1);
+    return last.RawOffset + last.RawBytes;
+}
+
+//---------------------------------------------------------------------------
+//  CompressedReader::Decode() --  Rebuild the raw bytes of one chunk
+//---------------------------------------------------------------------------
+
+bool  CompressedReader::Decode(size_t k, std::vector<unsigned int> & out) const
+{
+    if (k >= Table.size())
+        return false;
+    const CompressedChunk & chunk = Chunk(k);
+    out.resize((chunk.RawBytes + sizeof(unsigned int) - 1) / sizeof(unsigned int));
+    if (out.empty())
+        return true;
+    const unsigned char * body = reinterpret_cast<const unsigned char *>(&chunk + 1);
+    return SampleCodec::DecodeChunk(body, chunk.PackedBytes, chunk.RawBytes, Header().Lanes,
+                                    reinterpret_cast<unsigned char *>(&out[0]));
+}
+
+//---------------------------------------------------------------------------
+//  CompressedReader::Read() --  Raw bytes from any stream offset
+//---------------------------------------------------------------------------
+
+//  Chunks are cut between packet groups, so packets either side of a
+//  lost one stay whole when the bytes around it are put back to back.
+
+size_t  CompressedReader::Read(unsigned long long offset, void * out, size_t bytes,
+                               unsigned long long * skipped) const
+{
+    std::vector<CompressedEntry>::const_iterator it =
+        std::upper_bound(Table.begin(), Table.end(), offset, EntryBefore);
+    size_t k = it == Table.begin() ? 0 : (it - Table.begin()) - 1;
+
+    std::vector<unsigned int> raw;
+    char * dst = static_cast<char *>(out);
+    size_t copied = 0;
+    unsigned long long lost = 0;
+    for (; copied < bytes && k < Table.size(); ++k)
+        {
+        const CompressedChunk & chunk = Chunk(k);
+        if (offset >= chunk.RawOffset + chunk.RawBytes)
+            continue;
+        if (offset < chunk.RawOffset)
+            {
+            lost += chunk.RawOffset - offset;
+            offset = chunk.RawOffset;
+            }
+        if (!Decode(k, raw))
+            {
+            lost += chunk.RawBytes - (offset - chunk.RawOffset);
+            offset = chunk.RawOffset + chunk.RawBytes;
+            continue;
+            }
+        const size_t at = static_cast<size_t>(offset - chunk.RawOffset);
+        const size_t n = std::min<size_t>(bytes - copied, chunk.RawBytes - at);
+        std::memcpy(dst + copied, reinterpret_cast<const char *>(&raw[0]) + at, n);
+        copied += n;
+        offset += n;
+        }
+    if (skipped)
+        *skipped = lost;
+    return copied;
+}
+
+//---------------------------------------------------------------------------
+//  CompressedReader::IsCompressed() --  Whether a file starts with the header
+//---------------------------------------------------------------------------
+
+bool  CompressedReader::IsCompressed(const std::string & file)
+{
+    std::ifstream in(file.c_str(), std::ios::binary);
+    char magic[sizeof(CompressedHeader().Magic)];
+    return in.read(magic, sizeof(magic)) && std::memcmp(magic, Magic, sizeof(magic)) == 0;
+}
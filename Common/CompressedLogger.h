@@ -0,0 +1,200 @@
+// CompressedLogger.h
+//
+// Parallel lossless compression stage for the stream file, and its reader
+
+#ifndef CompressedLoggerH
+#define CompressedLoggerH
+
+#include "SampleCodec.h"
+#include "MappedFile.h"
+#include <string>
+#include <vector>
+#include <deque>
+#include <map>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
+
+//===========================================================================
+//  STRUCTS  -- Compressed stream file layout (little endian)
+//===========================================================================
+//  File header, then chunks, each a CompressedChunk followed by its
+//  SampleCodec body, then the chunk table and a CompressedTrailer.  A file
+//  that was never closed has no table; its chunks are found by walking
+//  their headers.  Raw offsets count only the bytes accepted, so a chunk
+//  the sink refused leaves a gap in them.
+
+struct CompressedHeader
+{
+    char                Magic[8];       // "IIVCOMP1"
+    unsigned int        Version;        // 1
+    unsigned int        HeaderBytes;
+    unsigned int        Lanes;          // Interleave the payloads were coded with
+    unsigned int        BlockSamples;
+    unsigned long long  ChunkBytes;     // Nominal raw bytes per chunk
+};
+
+struct CompressedChunk
+{
+    unsigned int        Magic;          // 'IIZC'
+    unsigned int        RawBytes;
+    unsigned int        PackedBytes;    // Body, excluding this header
+    unsigned int        Reserved;
+    unsigned long long  RawOffset;      // In the uncompressed stream
+    unsigned long long  Sequence;
+};
+
+struct CompressedEntry
+{
+    unsigned long long  RawOffset;
+    unsigned long long  FileOffset;     // Of the CompressedChunk
+};
+
+struct CompressedTrailer
+{
+    unsigned int        Magic;          // 'IIZX'
+    unsigned int        Version;
+    unsigned long long  Entries;
+    unsigned long long  TableOffset;
+    unsigned long long  RawBytes;       // Stream bytes accepted
+};
+
+//===========================================================================
+//  CLASS CompressedLogger  -- Compress a stream on a thread pool
+//===========================================================================
+//  Sits in front of the stream writer.  Write() copies into a chunk of
+//  about ChunkBytes, cut only between writes so chunks hold whole packet
+//  groups; full chunks are coded by Threads workers in parallel and handed
+//  to the Sink in order, each chunk self-contained so the file can be
+//  entered at any of them.  Like DiskLogger, Write() never waits on the
+//  workers unless Blocking is set: with every chunk busy the data is
+//  dropped and counted.  Only one thread may call Write(); the Sink is
+//  called from the workers, one at a time.
+
+class CompressedLogger
+{
+public:
+    typedef std::function<bool (const void * data, size_t bytes)>  Sink;
+
+    CompressedLogger();
+    ~CompressedLogger();
+
+    //  Config, read by Open()
+    size_t              ChunkBytes;
+    unsigned int        Threads;
+    unsigned int        Chunks;         // Pool size, at least Threads + 2
+    unsigned int        Lanes;          // Channels interleaved per stream
+    bool                Blocking;
+
+    bool  Open(Sink sink);
+    bool  Write(const void * data, size_t bytes);
+    //  Code what is left, wait for the workers, append the chunk table
+    void  Close();
+    bool  IsOpen() const
+        {  return !Workers.empty();  }
+
+    //  Status
+    unsigned long long  Bytes() const           // Raw bytes accepted
+        {  return FBytes;  }
+    unsigned long long  Packed() const          // Bytes given to the sink
+        {  return FPacked.load();  }
+    unsigned long long  Dropped() const         // Raw bytes refused
+        {  return FDropped;  }
+    unsigned long long  Lost() const            // Raw bytes the sink refused
+        {  return FLost.load();  }
+    double  Ratio() const;
+
+    static const char *  Extension()
+        {  return ".vcz";  }
+
+private:
+    struct Chunk
+    {
+        std::vector<unsigned int>   Raw;
+        size_t                      Fill;       // Raw bytes
+        unsigned long long          RawOffset;
+        unsigned long long          Sequence;
+        std::vector<unsigned char>  Packed;
+        VitaIndex                   Index;
+    };
+
+    std::vector< std::shared_ptr<Chunk> >   Pool;
+    std::deque<Chunk *>                 Free;
+    std::deque<Chunk *>                 Pending;
+    std::map<unsigned long long, Chunk *>  Done;    // Coded, awaiting their turn
+    Chunk *                             Current;
+    std::vector<std::thread>            Workers;
+    std::mutex                          Lock;
+    std::mutex                          Output;     // Held while feeding the sink
+    std::condition_variable             Queued;
+    std::condition_variable             Freed;
+    bool                                Closing;
+    Sink                                Out;
+    unsigned long long                  NextSequence;
+    unsigned long long                  NextOut;
+    std::vector<CompressedEntry>        Table;
+
+    unsigned long long                  FBytes;
+    unsigned long long                  FDropped;
+    std::atomic<unsigned long long>     FPacked;
+    std::atomic<unsigned long long>     FLost;
+
+    Chunk *  Take();
+    void     Submit();
+    void     Execute();
+    bool     Emit(const void * data, size_t bytes);
+
+    CompressedLogger(const CompressedLogger &);
+    CompressedLogger & operator=(const CompressedLogger &);
+};
+
+//===========================================================================
+//  CLASS CompressedReader  -- Random access to a compressed stream file
+//===========================================================================
+//  Open() maps the file and takes the chunk table from the trailer, once
+//  every entry is checked against its chunk, or rebuilds it from the
+//  chunk headers.  Read() decodes only the chunks a range touches.  Const
+//  members may be used from any number of threads.
+
+class CompressedReader
+{
+public:
+    CompressedReader();
+
+    bool  Open(const std::string & file);
+    void  Close();
+    bool  IsOpen() const
+        {  return Map.IsOpen();  }
+
+    const CompressedHeader &  Header() const
+        {  return *Map.As<CompressedHeader>();  }
+    size_t  Chunks() const
+        {  return Table.size();  }
+    const CompressedChunk &  Chunk(size_t k) const;
+    //  End of the raw stream covered
+    unsigned long long  Bytes() const;
+
+    //  Decode chunk 'k' into 'out', resized to its raw length
+    bool  Decode(size_t k, std::vector<unsigned int> & out) const;
+    //  Raw bytes from 'offset', short only at the end.  Chunks lost at
+    //  capture, or that fail to decode, are stepped over and their raw
+    //  bytes counted in 'skipped', so the stream advances by the return
+    //  value plus 'skipped'.
+    size_t  Read(unsigned long long offset, void * out, size_t bytes, unsigned long long * skipped = 0) const;
+
+    static bool  IsCompressed(const std::string & file);
+
+private:
+    MappedFile                      Map;
+    std::vector<CompressedEntry>    Table;
+
+    bool  Whole(const CompressedEntry & entry, unsigned long long end) const;
+
+    CompressedReader(const CompressedReader &);
+    CompressedReader & operator=(const CompressedReader &);
+};
+
+#endif
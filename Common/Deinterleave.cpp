@@ -0,0 +1,293 @@
+// Deinterleave.cpp
+//
+// Vectorized split of interleaved samples into planar buffers
+
+#include "DeinterleaveKernel.h"
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define DEINTERLEAVE_X86
+#if defined(_MSC_VER)
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+#endif
+
+#if defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2) || defined(__SSE2__)
+#define DEINTERLEAVE_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace
+{
+#ifdef DEINTERLEAVE_SSE2
+    //  Even samples are the low halves of each 32-bit pair, odd ones the
+    //  high halves; both sign extend, so the saturating pack is exact.
+    struct Sse2Int16
+    {
+        typedef __m128i Vec;
+        static Vec   Load(const short * p)
+            {  return _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));  }
+        static void  Store(short * p, Vec v)
+            {  _mm_storeu_si128(reinterpret_cast<__m128i *>(p), v);  }
+        static void  Split(Vec a, Vec b, Vec & even, Vec & odd)
+            {
+            even = _mm_packs_epi32(_mm_srai_epi32(_mm_slli_epi32(a, 16), 16),
+                                   _mm_srai_epi32(_mm_slli_epi32(b, 16), 16));
+            odd = _mm_packs_epi32(_mm_srai_epi32(a, 16), _mm_srai_epi32(b, 16));
+            }
+    };
+
+    struct Sse2Int32
+    {
+        typedef __m128i Vec;
+        static Vec   Load(const int * p)
+            {  return _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));  }
+        static void  Store(int * p, Vec v)
+            {  _mm_storeu_si128(reinterpret_cast<__m128i *>(p), v);  }
+        static void  Split(Vec a, Vec b, Vec & even, Vec & odd)
+            {
+            const __m128 fa = _mm_castsi128_ps(a);
+            const __m128 fb = _mm_castsi128_ps(b);
+            even = _mm_castps_si128(_mm_shuffle_ps(fa, fb, _MM_SHUFFLE(2, 0, 2, 0)));
+            odd = _mm_castps_si128(_mm_shuffle_ps(fa, fb, _MM_SHUFFLE(3, 1, 3, 1)));
+            }
+    };
+
+    //  4x4 transpose of 32-bit elements: rows in v, columns out
+    inline void  Transpose4x32(__m128i v0, __m128i v1, __m128i v2, __m128i v3, __m128i * out)
+    {
+        const __m128i t0 = _mm_unpacklo_epi32(v0, v1);
+        const __m128i t1 = _mm_unpackhi_epi32(v0, v1);
+        const __m128i t2 = _mm_unpacklo_epi32(v2, v3);
+        const __m128i t3 = _mm_unpackhi_epi32(v2, v3);
+        out[0] = _mm_unpacklo_epi64(t0, t2);
+        out[1] = _mm_unpackhi_epi64(t0, t2);
+        out[2] = _mm_unpacklo_epi64(t1, t3);
+        out[3] = _mm_unpackhi_epi64(t1, t3);
+    }
+#endif
+}
+
+//---------------------------------------------------------------------------
+//  DeinterleaveSplit specializations -- SSE2 transposes
+//---------------------------------------------------------------------------
+//  Where a block is a whole number of frames per vector, unpacking costs
+//  far fewer instructions than repeated even/odd splits.
+
+#ifdef DEINTERLEAVE_SSE2
+template <>
+struct DeinterleaveSplit<Sse2Int16, 4>
+{
+    //  Two frames per vector
+    static void  Run(const __m128i * v, __m128i * lane)
+        {
+        const __m128i a0 = _mm_unpacklo_epi16(v[0], v[1]);     // f0 f2 interleaved
+        const __m128i a1 = _mm_unpackhi_epi16(v[0], v[1]);     // f1 f3
+        const __m128i b0 = _mm_unpacklo_epi16(v[2], v[3]);
+        const __m128i b1 = _mm_unpackhi_epi16(v[2], v[3]);
+        const __m128i x0 = _mm_unpacklo_epi16(a0, a1);          // lanes 0,1 of f0-f3
+        const __m128i x1 = _mm_unpackhi_epi16(a0, a1);          // lanes 2,3
+        const __m128i y0 = _mm_unpacklo_epi16(b0, b1);          // ...of f4-f7
+        const __m128i y1 = _mm_unpackhi_epi16(b0, b1);
+        lane[0] = _mm_unpacklo_epi64(x0, y0);
+        lane[1] = _mm_unpackhi_epi64(x0, y0);
+        lane[2] = _mm_unpacklo_epi64(x1, y1);
+        lane[3] = _mm_unpackhi_epi64(x1, y1);
+        }
+};
+
+template <>
+struct DeinterleaveSplit<Sse2Int16, 8>
+{
+    //  One frame per vector: 8x8 transpose
+    static void  Run(const __m128i * v, __m128i * lane)
+        {
+        __m128i t[8], u[8];
+        for (int i = 0; i < 4; ++i)
+            {
+            t[2*i] = _mm_unpacklo_epi16(v[2*i], v[2*i + 1]);
+            t[2*i + 1] = _mm_unpackhi_epi16(v[2*i], v[2*i + 1]);
+            }
+        for (int i = 0; i < 2; ++i)
+            {
+            u[4*i] = _mm_unpacklo_epi32(t[4*i], t[4*i + 2]);
+            u[4*i + 1] = _mm_unpackhi_epi32(t[4*i], t[4*i + 2]);
+            u[4*i + 2] = _mm_unpacklo_epi32(t[4*i + 1], t[4*i + 3]);
+            u[4*i + 3] = _mm_unpackhi_epi32(t[4*i + 1], t[4*i + 3]);
+            }
+        for (int i = 0; i < 4; ++i)
+            {
+            lane[2*i] = _mm_unpacklo_epi64(u[i], u[i + 4]);
+            lane[2*i + 1] = _mm_unpackhi_epi64(u[i], u[i + 4]);
+            }
+        }
+};
+
+template <>
+struct DeinterleaveSplit<Sse2Int32, 4>
+{
+    static void  Run(const __m128i * v, __m128i * lane)
+        {  Transpose4x32(v[0], v[1], v[2], v[3], lane);  }
+};
+
+template <>
+struct DeinterleaveSplit<Sse2Int32, 8>
+{
+    //  Two vectors per frame
+    static void  Run(const __m128i * v, __m128i * lane)
+        {
+        Transpose4x32(v[0], v[2], v[4], v[6], lane);
+        Transpose4x32(v[1], v[3], v[5], v[7], lane + 4);
+        }
+};
+#endif
+
+namespace
+{
+    //-----------------------------------------------------------------------
+    //  Cpu() --  Instruction set support reported by the processor and OS
+    //-----------------------------------------------------------------------
+
+#ifdef DEINTERLEAVE_X86
+    void  Cpuid(unsigned int regs[4], unsigned int leaf, unsigned int sub)
+    {
+#if defined(_MSC_VER)
+        int r[4];
+        __cpuidex(r, static_cast<int>(leaf), static_cast<int>(sub));
+        for (int i = 0; i < 4; ++i)
+            regs[i] = static_cast<unsigned int>(r[i]);
+#else
+        regs[0] = regs[1] = regs[2] = regs[3] = 0;
+        if (leaf <= __get_cpuid_max(0, 0))
+            __cpuid_count(leaf, sub, regs[0], regs[1], regs[2], regs[3]);
+#endif
+    }
+
+    //  Register state the OS saves on context switch (XCR0)
+    unsigned long long  SavedState()
+    {
+#if defined(_MSC_VER)
+        return _xgetbv(0);
+#else
+        unsigned int lo, hi;
+        __asm__ __volatile__ ("xgetbv" : "=a"(lo), "=d"(hi) : "c"(0));
+        return (static_cast<unsigned long long>(hi) << 32) | lo;
+#endif
+    }
+#endif
+
+    Deinterleave::IIIsa  Cpu()
+    {
+        Deinterleave::IIIsa isa = Deinterleave::isScalar;
+#ifdef DEINTERLEAVE_X86
+        unsigned int r1[4], r7[4];
+        Cpuid(r1, 1, 0);
+        Cpuid(r7, 7, 0);
+        if (r1[3] & (1u << 26))
+            isa = Deinterleave::isSse2;
+        const bool osxsave = (r1[2] & (1u << 27)) != 0;
+        const unsigned long long xcr0 = osxsave ? SavedState() : 0;
+        if ((r1[2] & (1u << 28)) && (r7[1] & (1u << 5)) && (xcr0 & 0x6) == 0x6)
+            isa = Deinterleave::isAvx2;
+        if (isa == Deinterleave::isAvx2 && (r7[1] & (1u << 16)) && (r7[1] & (1u << 30))
+            && (xcr0 & 0xE6) == 0xE6)
+            isa = Deinterleave::isAvx512;
+#endif
+        return isa;
+    }
+
+    //-----------------------------------------------------------------------
+    //  Kernels -- Table of every kernel compiled in, built at load time
+    //-----------------------------------------------------------------------
+
+    struct KernelTable
+    {
+        Deinterleave::Ftn       Ftn[Deinterleave::isCount][2][3];
+        Deinterleave::IIIsa     Best;
+
+        KernelTable()
+            {
+            for (int i = 0; i < Deinterleave::isCount; ++i)
+                for (int w = 0; w < 2; ++w)
+                    for (int l = 0; l < 3; ++l)
+                        Ftn[i][w][l] = 0;
+
+            Ftn[Deinterleave::isScalar][0][0] = &DeinterleaveScalar<short, 2>;
+            Ftn[Deinterleave::isScalar][0][1] = &DeinterleaveScalar<short, 4>;
+            Ftn[Deinterleave::isScalar][0][2] = &DeinterleaveScalar<short, 8>;
+            Ftn[Deinterleave::isScalar][1][0] = &DeinterleaveScalar<int, 2>;
+            Ftn[Deinterleave::isScalar][1][1] = &DeinterleaveScalar<int, 4>;
+            Ftn[Deinterleave::isScalar][1][2] = &DeinterleaveScalar<int, 8>;
+            bool compiled[Deinterleave::isCount] = { true, false, false, false };
+#ifdef DEINTERLEAVE_SSE2
+            DeinterleaveTable<Sse2Int16, Sse2Int32>(Ftn[Deinterleave::isSse2]);
+            compiled[Deinterleave::isSse2] = true;
+#endif
+            compiled[Deinterleave::isAvx2] = DeinterleaveAvx2Table(Ftn[Deinterleave::isAvx2]);
+            compiled[Deinterleave::isAvx512] = DeinterleaveAvx512Table(Ftn[Deinterleave::isAvx512]);
+
+            //  Highest level the CPU runs with everything below it built
+            const Deinterleave::IIIsa cpu = Cpu();
+            Best = Deinterleave::isScalar;
+            for (int i = 1; i <= cpu && compiled[i]; ++i)
+                Best = static_cast<Deinterleave::IIIsa>(i);
+            }
+    };
+
+    const KernelTable   Kernels;
+}
+
+//===========================================================================
+//  CLASS Deinterleave  -- Kernel selection for interleaved payloads
+//===========================================================================
+//---------------------------------------------------------------------------
+//  Deinterleave::Supported() --  Best usable instruction set
+//---------------------------------------------------------------------------
+
+Deinterleave::IIIsa  Deinterleave::Supported()
+{
+    return Kernels.Best;
+}
+
+//---------------------------------------------------------------------------
+//  Deinterleave::Name() --  Instruction set name for reports
+//---------------------------------------------------------------------------
+
+const char *  Deinterleave::Name(IIIsa isa)
+{
+    static const char * names[isCount] = { "scalar", "sse2", "avx2", "avx512" };
+    return isa >= 0 && isa < isCount ? names[isa] : "?";
+}
+
+//---------------------------------------------------------------------------
+//  Deinterleave::Kernel() --  Kernel for a width, lane count and level
+//---------------------------------------------------------------------------
+
+Deinterleave::Ftn  Deinterleave::Kernel(size_t sample_bytes, unsigned int lanes, IIIsa isa)
+{
+    if (!Available(isa))
+        return 0;
+    if (lanes == 1)
+        return sample_bytes == 2 ? &DeinterleaveScalar<short, 1>
+             : sample_bytes == 4 ? &DeinterleaveScalar<int, 1> : 0;
+
+    int w;
+    switch (sample_bytes)
+        {
+        case 2:  w = 0;  break;
+        case 4:  w = 1;  break;
+        default: return 0;
+        }
+
+    int l;
+    switch (lanes)
+        {
+        case 2:  l = 0;  break;
+        case 4:  l = 1;  break;
+        case 8:  l = 2;  break;
+        default: return 0;
+        }
+
+    return Kernels.Ftn[isa][w][l];
+}
@@ -0,0 +1,39 @@
+// Deinterleave.h
+//
+// Vectorized split of interleaved samples into planar buffers
+
+#ifndef DeinterleaveH
+#define DeinterleaveH
+
+#include <cstddef>
+
+//===========================================================================
+//  CLASS Deinterleave  -- Kernel selection for interleaved payloads
+//===========================================================================
+//  Packed multi-channel and I/Q payloads carry frames of 'lanes' samples,
+//  ch0,ch1,...  A kernel copies 'frames' such frames from 'src' to one
+//  planar buffer per lane, dest[0..lanes-1].  Kernels exist for 16 and 32
+//  bit samples with 2, 4 or 8 lanes, per instruction set; Kernel() picks
+//  the fastest this CPU runs.  No alignment is required.
+
+class Deinterleave
+{
+public:
+    enum IIIsa { isScalar, isSse2, isAvx2, isAvx512, isCount };
+
+    typedef void (*Ftn)(char * const * dest, const char * src, size_t frames);
+
+    //  Best instruction set compiled in and supported by this CPU
+    static IIIsa  Supported();
+    static bool   Available(IIIsa isa)
+        {  return isa <= Supported();  }
+    static const char *  Name(IIIsa isa);
+
+    //  Kernel for a sample width (2 or 4 bytes) and lane count (1, 2, 4
+    //  or 8), or 0 if there is none.  One lane is a plain copy.
+    static Ftn  Kernel(size_t sample_bytes, unsigned int lanes)
+        {  return Kernel(sample_bytes, lanes, Supported());  }
+    static Ftn  Kernel(size_t sample_bytes, unsigned int lanes, IIIsa isa);
+};
+
+#endif
@@ -0,0 +1,174 @@
+// DeinterleaveAvx2.cpp
+//
+// AVX2 de-interleave kernels
+//
+// Built with AVX2 code generation enabled (-mavx2 under gcc, /arch:AVX in
+// the project so MSVC emits no SSE/AVX transitions).  Only reached when
+// the CPU reports AVX2.
+
+#include "DeinterleaveKernel.h"
+
+#if defined(__AVX2__) || (defined(_MSC_VER) && _MSC_VER >= 1700 && (defined(_M_X64) || defined(_M_IX86)))
+#define DEINTERLEAVE_AVX2
+#include <immintrin.h>
+#endif
+
+#ifdef DEINTERLEAVE_AVX2
+namespace
+{
+    //  The 128-bit lane pack/shuffle leaves the quarters in 0,2,1,3 order;
+    //  one 64-bit permute puts them back.
+    struct Avx2Int16
+    {
+        typedef __m256i Vec;
+        static Vec   Load(const short * p)
+            {  return _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p));  }
+        static void  Store(short * p, Vec v)
+            {  _mm256_storeu_si256(reinterpret_cast<__m256i *>(p), v);  }
+        static void  Split(Vec a, Vec b, Vec & even, Vec & odd)
+            {
+            const __m256i e = _mm256_packs_epi32(_mm256_srai_epi32(_mm256_slli_epi32(a, 16), 16),
+                                                 _mm256_srai_epi32(_mm256_slli_epi32(b, 16), 16));
+            const __m256i o = _mm256_packs_epi32(_mm256_srai_epi32(a, 16), _mm256_srai_epi32(b, 16));
+            even = _mm256_permute4x64_epi64(e, 0xD8);
+            odd = _mm256_permute4x64_epi64(o, 0xD8);
+            }
+    };
+
+    struct Avx2Int32
+    {
+        typedef __m256i Vec;
+        static Vec   Load(const int * p)
+            {  return _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p));  }
+        static void  Store(int * p, Vec v)
+            {  _mm256_storeu_si256(reinterpret_cast<__m256i *>(p), v);  }
+        static void  Split(Vec a, Vec b, Vec & even, Vec & odd)
+            {
+            const __m256 fa = _mm256_castsi256_ps(a);
+            const __m256 fb = _mm256_castsi256_ps(b);
+            even = _mm256_permute4x64_epi64(_mm256_castps_si256(_mm256_shuffle_ps(fa, fb, 0x88)), 0xD8);
+            odd = _mm256_permute4x64_epi64(_mm256_castps_si256(_mm256_shuffle_ps(fa, fb, 0xDD)), 0xD8);
+            }
+    };
+
+    //  4x4 transpose of 32-bit elements within each 128-bit half
+    inline void  Transpose4x32(__m256i v0, __m256i v1, __m256i v2, __m256i v3, __m256i * out)
+    {
+        const __m256i t0 = _mm256_unpacklo_epi32(v0, v1);
+        const __m256i t1 = _mm256_unpackhi_epi32(v0, v1);
+        const __m256i t2 = _mm256_unpacklo_epi32(v2, v3);
+        const __m256i t3 = _mm256_unpackhi_epi32(v2, v3);
+        out[0] = _mm256_unpacklo_epi64(t0, t2);
+        out[1] = _mm256_unpackhi_epi64(t0, t2);
+        out[2] = _mm256_unpacklo_epi64(t1, t3);
+        out[3] = _mm256_unpackhi_epi64(t1, t3);
+    }
+
+    //  Dword order putting the two halves' frames back in sequence
+    inline __m256i  MergeHalves(__m256i v)
+    {
+        return _mm256_permutevar8x32_epi32(v, _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7));
+    }
+}
+
+//---------------------------------------------------------------------------
+//  DeinterleaveSplit specializations -- AVX2 transposes
+//---------------------------------------------------------------------------
+//  Unpacks work within 128-bit halves, so each half is transposed on its
+//  own and one lane-crossing permute per output merges them.  Far fewer
+//  cross-lane operations than repeated even/odd splits.
+
+template <>
+struct DeinterleaveSplit<Avx2Int16, 4>
+{
+    //  Each half holds two frames; gather each lane's pair into one dword
+    static void  Run(const __m256i * v, __m256i * lane)
+        {
+        const __m256i group = _mm256_setr_epi8(0, 1, 8, 9, 2, 3, 10, 11, 4, 5, 12, 13, 6, 7, 14, 15,
+                                               0, 1, 8, 9, 2, 3, 10, 11, 4, 5, 12, 13, 6, 7, 14, 15);
+        __m256i t[4];
+        Transpose4x32(_mm256_shuffle_epi8(v[0], group), _mm256_shuffle_epi8(v[1], group),
+                      _mm256_shuffle_epi8(v[2], group), _mm256_shuffle_epi8(v[3], group), t);
+        for (int l = 0; l < 4; ++l)
+            lane[l] = MergeHalves(t[l]);
+        }
+};
+
+template <>
+struct DeinterleaveSplit<Avx2Int16, 8>
+{
+    //  Pair frame j with frame j+8 in one vector, then an 8x8 transpose
+    //  per half leaves lane k's frames 0-7 low and 8-15 high
+    static void  Run(const __m256i * v, __m256i * lane)
+        {
+        __m256i w[8], t[8], u[8];
+        for (int j = 0; j < 4; ++j)
+            {
+            w[2*j] = _mm256_permute2x128_si256(v[j], v[j + 4], 0x20);
+            w[2*j + 1] = _mm256_permute2x128_si256(v[j], v[j + 4], 0x31);
+            }
+        for (int i = 0; i < 4; ++i)
+            {
+            t[2*i] = _mm256_unpacklo_epi16(w[2*i], w[2*i + 1]);
+            t[2*i + 1] = _mm256_unpackhi_epi16(w[2*i], w[2*i + 1]);
+            }
+        for (int i = 0; i < 2; ++i)
+            {
+            u[4*i] = _mm256_unpacklo_epi32(t[4*i], t[4*i + 2]);
+            u[4*i + 1] = _mm256_unpackhi_epi32(t[4*i], t[4*i + 2]);
+            u[4*i + 2] = _mm256_unpacklo_epi32(t[4*i + 1], t[4*i + 3]);
+            u[4*i + 3] = _mm256_unpackhi_epi32(t[4*i + 1], t[4*i + 3]);
+            }
+        for (int i = 0; i < 4; ++i)
+            {
+            lane[2*i] = _mm256_unpacklo_epi64(u[i], u[i + 4]);
+            lane[2*i + 1] = _mm256_unpackhi_epi64(u[i], u[i + 4]);
+            }
+        }
+};
+
+template <>
+struct DeinterleaveSplit<Avx2Int32, 4>
+{
+    //  One frame per half
+    static void  Run(const __m256i * v, __m256i * lane)
+        {
+        __m256i t[4];
+        Transpose4x32(v[0], v[1], v[2], v[3], t);
+        for (int l = 0; l < 4; ++l)
+            lane[l] = MergeHalves(t[l]);
+        }
+};
+
+template <>
+struct DeinterleaveSplit<Avx2Int32, 8>
+{
+    //  One frame per vector: 4x4 transposes of the halves, then recombine
+    static void  Run(const __m256i * v, __m256i * lane)
+        {
+        __m256i r[4], s[4];
+        Transpose4x32(v[0], v[1], v[2], v[3], r);
+        Transpose4x32(v[4], v[5], v[6], v[7], s);
+        for (int k = 0; k < 4; ++k)
+            {
+            lane[k] = _mm256_permute2x128_si256(r[k], s[k], 0x20);
+            lane[k + 4] = _mm256_permute2x128_si256(r[k], s[k], 0x31);
+            }
+        }
+};
+#endif
+
+//---------------------------------------------------------------------------
+//  DeinterleaveAvx2Table() --  AVX2 kernels, if this compiler has them
+//---------------------------------------------------------------------------
+
+bool  DeinterleaveAvx2Table(Deinterleave::Ftn table[2][3])
+{
+#ifdef DEINTERLEAVE_AVX2
+    DeinterleaveTable<Avx2Int16, Avx2Int32>(table);
+    return true;
+#else
+    (void)table;
+    return false;
+#endif
+}
@@ -0,0 +1,70 @@
+// DeinterleaveAvx512.cpp
+//
+// AVX-512 de-interleave kernels
+//
+// Built with AVX-512F/BW code generation enabled (-mavx512f -mavx512bw
+// under gcc).  MSVC has the intrinsics from VS2017 on; older compilers
+// leave this level out.  Only reached when the CPU and OS report both.
+
+#include "DeinterleaveKernel.h"
+
+#if (defined(__AVX512F__) && defined(__AVX512BW__)) || (defined(_MSC_VER) && _MSC_VER >= 1911 && defined(_M_X64))
+#define DEINTERLEAVE_AVX512
+#include <immintrin.h>
+#endif
+
+#ifdef DEINTERLEAVE_AVX512
+namespace
+{
+    //  Two-source permutes pick the even and odd samples of a:b directly
+    const short EvenWords[32] = {  0,  2,  4,  6,  8, 10, 12, 14, 16, 18, 20, 22, 24, 26, 28, 30,
+                                  32, 34, 36, 38, 40, 42, 44, 46, 48, 50, 52, 54, 56, 58, 60, 62 };
+    const short OddWords[32]  = {  1,  3,  5,  7,  9, 11, 13, 15, 17, 19, 21, 23, 25, 27, 29, 31,
+                                  33, 35, 37, 39, 41, 43, 45, 47, 49, 51, 53, 55, 57, 59, 61, 63 };
+    const int   EvenDwords[16] = {  0,  2,  4,  6,  8, 10, 12, 14, 16, 18, 20, 22, 24, 26, 28, 30 };
+    const int   OddDwords[16]  = {  1,  3,  5,  7,  9, 11, 13, 15, 17, 19, 21, 23, 25, 27, 29, 31 };
+
+    struct Avx512Int16
+    {
+        typedef __m512i Vec;
+        static Vec   Load(const short * p)
+            {  return _mm512_loadu_si512(p);  }
+        static void  Store(short * p, Vec v)
+            {  _mm512_storeu_si512(p, v);  }
+        static void  Split(Vec a, Vec b, Vec & even, Vec & odd)
+            {
+            even = _mm512_permutex2var_epi16(a, _mm512_loadu_si512(EvenWords), b);
+            odd = _mm512_permutex2var_epi16(a, _mm512_loadu_si512(OddWords), b);
+            }
+    };
+
+    struct Avx512Int32
+    {
+        typedef __m512i Vec;
+        static Vec   Load(const int * p)
+            {  return _mm512_loadu_si512(p);  }
+        static void  Store(int * p, Vec v)
+            {  _mm512_storeu_si512(p, v);  }
+        static void  Split(Vec a, Vec b, Vec & even, Vec & odd)
+            {
+            even = _mm512_permutex2var_epi32(a, _mm512_loadu_si512(EvenDwords), b);
+            odd = _mm512_permutex2var_epi32(a, _mm512_loadu_si512(OddDwords), b);
+            }
+    };
+}
+#endif
+
+//---------------------------------------------------------------------------
+//  DeinterleaveAvx512Table() --  AVX-512 kernels, if this compiler has them
+//---------------------------------------------------------------------------
+
+bool  DeinterleaveAvx512Table(Deinterleave::Ftn table[2][3])
+{
+#ifdef DEINTERLEAVE_AVX512
+    DeinterleaveTable<Avx512Int16, Avx512Int32>(table);
+    return true;
+#else
+    (void)table;
+    return false;
+#endif
+}
@@ -0,0 +1,179 @@
+// DeinterleaveKernel.h
+//
+// Shared body of the per instruction set de-interleave kernels
+//
+// Included only by the Deinterleave*.cpp files.  Each of those is built
+// for one instruction set and supplies a traits class K per sample type:
+//
+//     typedef ... Vec;
+//     static Vec   Load(const T * p);
+//     static void  Store(T * p, Vec v);
+//     static void  Split(Vec a, Vec b, Vec & even, Vec & odd);
+//
+// Split() treats a:b as one run of samples and returns the even and odd
+// numbered ones, which de-interleaves two lanes.  The traits live in each
+// file's anonymous namespace, and the two kernels below that take none
+// are static, so no instantiation is shared between files built for
+// different instruction sets.
+
+#ifndef DeinterleaveKernelH
+#define DeinterleaveKernelH
+
+#include "Deinterleave.h"
+#include <cstring>
+
+//---------------------------------------------------------------------------
+//  DeinterleaveTail() --  Scalar de-interleave, also used for leftovers
+//---------------------------------------------------------------------------
+
+template <typename T, unsigned int L>
+static inline void  DeinterleaveTail(T * const * out, const T * in, size_t first, size_t frames)
+{
+    for (unsigned int l = 0; l < L; ++l)
+        {
+        T * o = out[l];
+        const T * i = in + first * L + l;
+        for (size_t f = first; f < frames; ++f, i += L)
+            o[f] = *i;
+        }
+}
+
+//---------------------------------------------------------------------------
+//  DeinterleaveScalar() --  Portable kernel
+//---------------------------------------------------------------------------
+
+template <typename T, unsigned int L>
+static void  DeinterleaveScalar(char * const * dest, const char * src, size_t frames)
+{
+    if (L == 1)
+        {
+        std::memcpy(dest[0], src, frames * sizeof(T));
+        return;
+        }
+    T * out[L];
+    for (unsigned int l = 0; l < L; ++l)
+        out[l] = reinterpret_cast<T *>(dest[l]);
+    DeinterleaveTail<T, L>(out, reinterpret_cast<const T *>(src), 0, frames);
+}
+
+//---------------------------------------------------------------------------
+//  DeinterleaveSplit<K, L> --  Split one block of L vectors into lanes
+//---------------------------------------------------------------------------
+//  The block holds exactly one vector of samples per lane.  Splitting the
+//  pairs yields the even lanes and the odd lanes, each an interleaved
+//  block of L/2 lanes, which are split again.  Written as a recursion on
+//  the template argument so every stage is unrolled and stays in registers.
+
+template <class K, unsigned int L>
+struct DeinterleaveSplit
+{
+    typedef typename K::Vec Vec;
+
+    static void  Run(const Vec * v, Vec * lane)
+        {
+        Vec even[L / 2], odd[L / 2];
+        for (unsigned int k = 0; k < L / 2; ++k)
+            K::Split(v[2*k], v[2*k + 1], even[k], odd[k]);
+
+        Vec le[L / 2], lo[L / 2];
+        DeinterleaveSplit<K, L / 2>::Run(even, le);
+        DeinterleaveSplit<K, L / 2>::Run(odd, lo);
+        for (unsigned int k = 0; k < L / 2; ++k)
+            {
+            lane[2*k] = le[k];
+            lane[2*k + 1] = lo[k];
+            }
+        }
+};
+
+template <class K>
+struct DeinterleaveSplit<K, 1>
+{
+    typedef typename K::Vec Vec;
+
+    static void  Run(const Vec * v, Vec * lane)
+        {  lane[0] = v[0];  }
+};
+
+//---------------------------------------------------------------------------
+//  DeinterleaveLanes<K, T, N> --  Unrolled block loads and stores
+//---------------------------------------------------------------------------
+//  Left as loops, compilers keep the block in memory rather than registers.
+
+template <class K, typename T, unsigned int N>
+struct DeinterleaveLanes
+{
+    typedef typename K::Vec Vec;
+
+    static void  Load(Vec * v, const T * in, size_t per)
+        {
+        DeinterleaveLanes<K, T, N - 1>::Load(v, in, per);
+        v[N - 1] = K::Load(in + (N - 1) * per);
+        }
+    static void  Store(T * const * out, size_t f, const Vec * lane)
+        {
+        DeinterleaveLanes<K, T, N - 1>::Store(out, f, lane);
+        K::Store(out[N - 1] + f, lane[N - 1]);
+        }
+};
+
+template <class K, typename T>
+struct DeinterleaveLanes<K, T, 0>
+{
+    typedef typename K::Vec Vec;
+
+    static void  Load(Vec *, const T *, size_t)
+        {}
+    static void  Store(T * const *, size_t, const Vec *)
+        {}
+};
+
+//---------------------------------------------------------------------------
+//  DeinterleaveVector() --  Kernel built on a traits class
+//---------------------------------------------------------------------------
+
+template <class K, typename T, unsigned int L>
+void  DeinterleaveVector(char * const * dest, const char * src, size_t frames)
+{
+    typedef typename K::Vec Vec;
+    const size_t per = sizeof(Vec) / sizeof(T);     // Frames per block
+
+    T * out[L];
+    for (unsigned int l = 0; l < L; ++l)
+        out[l] = reinterpret_cast<T *>(dest[l]);
+
+    const T * in = reinterpret_cast<const T *>(src);
+    size_t f = 0;
+    for (; f + per <= frames; f += per, in += per * L)
+        {
+        Vec v[L], lane[L];
+        DeinterleaveLanes<K, T, L>::Load(v, in, per);
+        DeinterleaveSplit<K, L>::Run(v, lane);
+        DeinterleaveLanes<K, T, L>::Store(out, f, lane);
+        }
+
+    DeinterleaveTail<T, L>(out, reinterpret_cast<const T *>(src), f, frames);
+}
+
+//---------------------------------------------------------------------------
+//  DeinterleaveTable() --  Fill an instruction set's kernel table
+//---------------------------------------------------------------------------
+//  Rows are sample widths (int16, int32), columns lane counts (2, 4, 8).
+//  The AVX2 and AVX-512 files are built with those instruction sets
+//  enabled and report false when the compiler cannot provide them.
+
+bool  DeinterleaveAvx2Table(Deinterleave::Ftn table[2][3]);
+bool  DeinterleaveAvx512Table(Deinterleave::Ftn table[2][3]);
+
+template <class K16, class K32>
+inline void  DeinterleaveTable(Deinterleave::Ftn table[2][3])
+{
+    table[0][0] = &DeinterleaveVector<K16, short, 2>;
+    table[0][1] = &DeinterleaveVector<K16, short, 4>;
+    table[0][2] = &DeinterleaveVector<K16, short, 8>;
+    table[1][0] = &DeinterleaveVector<K32, int, 2>;
+    table[1][1] = &DeinterleaveVector<K32, int, 4>;
+    table[1][2] = &DeinterleaveVector<K32, int, 8>;
+}
+
+#endif
@@ -0,0 +1,806 @@
+// DiskLogger.cpp
+//
+// Asynchronous direct I/O stream file writer
+
+#include "DiskLogger.h"
+#include "CaptureMemory.h"
+#include "HiResTimer.h"
+#include <sstream>
+#include <cstring>
+#include <algorithm>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <sys/uio.h>
+#ifdef __linux__
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <linux/io_uring.h>
+#endif
+#endif
+
+namespace
+{
+    //  Direct I/O transfers must be whole sectors; 4 KB covers every
+    //  device in use, 512e included
+    const size_t Sector = 4096;
+
+    size_t  RoundUp(size_t bytes, size_t unit)
+        {  return (bytes + unit - 1) / unit * unit;  }
+
+#ifndef _WIN32
+    std::string  SystemError(const char * what, int code)
+    {
+        std::stringstream ss;
+        ss << what << ": " << std::strerror(code);
+        return ss.str();
+    }
+#endif
+}
+
+//===========================================================================
+//  STRUCT DiskLogger::Block  -- One aligned buffer of the pool
+//===========================================================================
+
+struct DiskLogger::Block
+{
+    Block()
+        : Fill(0), Length(0), Offset(0), Issued(0), Result(0)
+        {
+#ifdef _WIN32
+        Event = CreateEvent(0, TRUE, FALSE, 0);
+#endif
+        }
+    ~Block()
+        {
+#ifdef _WIN32
+        if (Event)
+            CloseHandle(Event);
+#endif
+        }
+
+    CaptureMemory       Memory;
+    size_t              Fill;           // Bytes of data
+    size_t              Length;         // Bytes to write, Fill padded to a sector
+    unsigned long long  Offset;
+    long long           Issued;         // Ticks at submission
+    long long           Result;         // Bytes written, negative on error
+#ifdef _WIN32
+    HANDLE              Event;
+    OVERLAPPED          Overlapped;
+#else
+    struct iovec        Vec;
+#endif
+};
+
+//===========================================================================
+//  CLASS DiskLogger::Io  -- File and write mechanism, per platform
+//===========================================================================
+
+class DiskLogger::Io
+{
+public:
+    virtual ~Io()
+        {}
+
+    //  Start writing block->Length bytes at block->Offset
+    virtual bool  Submit(Block * block) = 0;
+    //  A finished write.  Without 'wait', 0 when none has finished yet.
+    virtual Block *  Reap(bool wait) = 0;
+    //  Set the final length and close
+    virtual bool  Finish(unsigned long long length) = 0;
+
+    std::string     Error;
+};
+
+namespace
+{
+#ifdef _WIN32
+    //=======================================================================
+    //  CLASS OverlappedIo  -- Windows overlapped writes
+    //=======================================================================
+    //  Completions are collected oldest first.  Writes at later offsets may
+    //  finish earlier, but only wait for the head of the list.
+
+    class OverlappedIo : public DiskLogger::Io
+    {
+    public:
+        OverlappedIo()
+            : File(INVALID_HANDLE_VALUE)
+            {}
+        ~OverlappedIo()
+            {
+            if (File != INVALID_HANDLE_VALUE)
+                CloseHandle(File);
+            }
+
+        bool  Open(const std::string & name, bool direct, unsigned long long reserve)
+            {
+            const DWORD flags = FILE_ATTRIBUTE_NORMAL | FILE_FLAG_OVERLAPPED |
+                (direct ? FILE_FLAG_NO_BUFFERING : 0);
+            File = CreateFileA(name.c_str(), GENERIC_WRITE, FILE_SHARE_READ, 0,
+                CREATE_ALWAYS, flags, 0);
+            if (File == INVALID_HANDLE_VALUE)
+                {
+                Error = "Cannot create " + name;
+                return false;
+                }
+            if (reserve)
+                {
+                FILE_ALLOCATION_INFO info;
+                info.AllocationSize.QuadPart = static_cast<LONGLONG>(reserve);
+                SetFileInformationByHandle(File, FileAllocationInfo, &info, sizeof(info));
+                }
+            return true;
+            }
+
+        bool  Submit(DiskLogger::Block * block)
+            {
+            std::memset(&block->Overlapped, 0, sizeof(block->Overlapped));
+            block->Overlapped.Offset = static_cast<DWORD>(block->Offset);
+            block->Overlapped.OffsetHigh = static_cast<DWORD>(block->Offset >> 32);
+            block->Overlapped.hEvent = block->Event;
+            if (!WriteFile(File, block->Memory.Data(), static_cast<DWORD>(block->Length), 0, &block->Overlapped)
+                && GetLastError() != ERROR_IO_PENDING)
+                {
+                std::stringstream ss;
+                ss << "WriteFile: error " << GetLastError();
+                Error = ss.str();
+                block->Result = -1;
+                Done.push_back(block);
+                return true;
+                }
+            Pending.push_back(block);
+            return true;
+            }
+
+        DiskLogger::Block *  Reap(bool wait)
+            {
+            if (!Done.empty())
+                return Pop(Done);
+            if (Pending.empty())
+                return 0;
+            DiskLogger::Block * block = Pending.front();
+            DWORD bytes = 0;
+            if (GetOverlappedResult(File, &block->Overlapped, &bytes, wait ? TRUE : FALSE))
+                block->Result = bytes;
+            else if (GetLastError() == ERROR_IO_INCOMPLETE)
+                return 0;
+            else
+                {
+                std::stringstream ss;
+                ss << "WriteFile: error " << GetLastError();
+                Error = ss.str();
+                block->Result = -1;
+                }
+            return Pop(Pending);
+            }
+
+        bool  Finish(unsigned long long length)
+            {
+            FILE_END_OF_FILE_INFO eof;
+            eof.EndOfFile.QuadPart = static_cast<LONGLONG>(length);
+            const bool ok = SetFileInformationByHandle(File, FileEndOfFileInfo, &eof, sizeof(eof)) != FALSE;
+            CloseHandle(File);
+            File = INVALID_HANDLE_VALUE;
+            return ok;
+            }
+
+    private:
+        HANDLE                              File;
+        std::deque<DiskLogger::Block *>     Pending;
+        std::deque<DiskLogger::Block *>     Done;
+
+        static DiskLogger::Block *  Pop(std::deque<DiskLogger::Block *> & list)
+            {
+            DiskLogger::Block * block = list.front();
+            list.pop_front();
+            return block;
+            }
+    };
+
+#else
+    //=======================================================================
+    //  CLASS PosixIo  -- Blocking pwrite() on the writer thread
+    //=======================================================================
+    //  Also owns the descriptor for UringIo.
+
+    class PosixIo : public DiskLogger::Io
+    {
+    public:
+        PosixIo()
+            : File(-1), Unbuffered(false)
+            {}
+        ~PosixIo()
+            {
+            if (File >= 0)
+                close(File);
+            }
+
+        bool  Open(const std::string & name, bool direct, unsigned long long reserve)
+            {
+            const int flags = O_WRONLY | O_CREAT | O_TRUNC;
+#ifdef O_DIRECT
+            //  Not every filesystem (tmpfs, some network mounts) takes O_DIRECT
+            if (direct)
+                {
+                File = open(name.c_str(), flags | O_DIRECT, 0644);
+                Unbuffered = File >= 0;
+                }
+#endif
+            if (File < 0)
+                File = open(name.c_str(), flags, 0644);
+            if (File < 0)
+                {
+                Error = SystemError(name.c_str(), errno);
+                return false;
+                }
+            if (reserve)
+                {
+#ifdef __linux__
+                fallocate(File, 0, 0, static_cast<off_t>(reserve));
+#else
+                posix_fallocate(File, 0, static_cast<off_t>(reserve));
+#endif
+                }
+            return true;
+            }
+
+        bool  Submit(DiskLogger::Block * block)
+            {
+            const char * data = block->Memory.As<char>();
+            size_t done = 0;
+            while (done < block->Length)
+                {
+                const ssize_t n = pwrite(File, data + done, block->Length - done,
+                    static_cast<off_t>(block->Offset + done));
+                if (n < 0 && errno == EINTR)
+                    continue;
+                if (n <= 0)
+                    {
+                    Error = SystemError("pwrite", n < 0 ? errno : ENOSPC);
+                    break;
+                    }
+                done += static_cast<size_t>(n);
+                }
+            block->Result = done == block->Length ? static_cast<long long>(done) : -1;
+            Done.push_back(block);
+            return true;
+            }
+
+        DiskLogger::Block *  Reap(bool)
+            {
+            if (Done.empty())
+                return 0;
+            DiskLogger::Block * block = Done.front();
+            Done.pop_front();
+            return block;
+            }
+
+        bool  Finish(unsigned long long length)
+            {
+            const bool ok = ftruncate(File, static_cast<off_t>(length)) == 0;
+            close(File);
+            File = -1;
+            return ok;
+            }
+
+        int     File;
+        bool    Unbuffered;
+
+    private:
+        std::deque<DiskLogger::Block *>     Done;
+    };
+
+#ifdef __linux__
+    //=======================================================================
+    //  CLASS UringIo  -- io_uring writes, many in flight
+    //=======================================================================
+    //  Talks to the kernel directly rather than through liburing, so there
+    //  is nothing extra to install.  The rings are shared with the kernel:
+    //  the tails we publish and the heads we consume are ordered with
+    //  acquire/release accesses.
+
+    class UringIo : public PosixIo
+    {
+    public:
+        UringIo()
+            : Ring(-1), SqMap(0), SqBytes(0), CqMap(0), CqBytes(0), Sqes(0), SqeBytes(0)
+            {}
+        ~UringIo()
+            {
+            if (Sqes)
+                munmap(Sqes, SqeBytes);
+            if (CqMap && CqMap != SqMap)
+                munmap(CqMap, CqBytes);
+            if (SqMap)
+                munmap(SqMap, SqBytes);
+            if (Ring >= 0)
+                close(Ring);
+            }
+
+        //  False when the kernel has no io_uring or it is not permitted
+        bool  Setup(unsigned int depth)
+            {
+            io_uring_params p;
+            std::memset(&p, 0, sizeof(p));
+            Ring = static_cast<int>(syscall(__NR_io_uring_setup, depth, &p));
+            if (Ring < 0)
+                return false;
+
+            SqBytes = p.sq_off.array + p.sq_entries * sizeof(unsigned int);
+            CqBytes = p.cq_off.cqes + p.cq_entries * sizeof(io_uring_cqe);
+            const bool single = (p.features & IORING_FEAT_SINGLE_MMAP) != 0;
+            if (single)
+                SqBytes = CqBytes = std::max(SqBytes, CqBytes);
+            SqMap = Map(SqBytes, IORING_OFF_SQ_RING);
+            CqMap = single ? SqMap : Map(CqBytes, IORING_OFF_CQ_RING);
+            SqeBytes = p.sq_entries * sizeof(io_uring_sqe);
+            Sqes = static_cast<io_uring_sqe *>(Map(SqeBytes, IORING_OFF_SQES));
+            if (!SqMap || !CqMap || !Sqes)
+                return false;
+
+            char * sq = static_cast<char *>(SqMap);
+            SqTail = reinterpret_cast<unsigned int *>(sq + p.sq_off.tail);
+            SqMask = *reinterpret_cast<unsigned int *>(sq + p.sq_off.ring_mask);
+            SqArray = reinterpret_cast<unsigned int *>(sq + p.sq_off.array);
+            char * cq = static_cast<char *>(CqMap);
+            CqHead = reinterpret_cast<unsigned int *>(cq + p.cq_off.head);
+            CqTail = reinterpret_cast<unsigned int *>(cq + p.cq_off.tail);
+            CqMask = *reinterpret_cast<unsigned int *>(cq + p.cq_off.ring_mask);
+            Cqes = reinterpret_cast<io_uring_cqe *>(cq + p.cq_off.cqes);
+            return true;
+            }
+
+        bool  Submit(DiskLogger::Block * block)
+            {
+            block->Vec.iov_base = block->Memory.Data();
+            block->Vec.iov_len = block->Length;
+
+            const unsigned int tail = *SqTail;
+            const unsigned int idx = tail & SqMask;
+            io_uring_sqe & sqe = Sqes[idx];
+            std::memset(&sqe, 0, sizeof(sqe));
+            sqe.opcode = IORING_OP_WRITEV;
+            sqe.fd = File;
+            sqe.addr = reinterpret_cast<unsigned long long>(&block->Vec);
+            sqe.len = 1;
+            sqe.off = block->Offset;
+            sqe.user_data = reinterpret_cast<unsigned long long>(block);
+            SqArray[idx] = idx;
+            __atomic_store_n(SqTail, tail + 1, __ATOMIC_RELEASE);
+
+            while (syscall(__NR_io_uring_enter, Ring, 1, 0, 0, 0, 0) < 0)
+                if (errno != EINTR)
+                    {
+                    Error = SystemError("io_uring_enter", errno);
+                    return false;
+                    }
+            return true;
+            }
+
+        DiskLogger::Block *  Reap(bool wait)
+            {
+            for (;;)
+                {
+                const unsigned int head = *CqHead;
+                if (head != __atomic_load_n(CqTail, __ATOMIC_ACQUIRE))
+                    {
+                    const io_uring_cqe & cqe = Cqes[head & CqMask];
+                    DiskLogger::Block * block = reinterpret_cast<DiskLogger::Block *>(cqe.user_data);
+                    block->Result = cqe.res;
+                    if (cqe.res < 0 && Error.empty())
+                        Error = SystemError("write", -cqe.res);
+                    __atomic_store_n(CqHead, head + 1, __ATOMIC_RELEASE);
+                    return block;
+                    }
+                if (!wait)
+                    return 0;
+                if (syscall(__NR_io_uring_enter, Ring, 0, 1, IORING_ENTER_GETEVENTS, 0, 0) < 0
+                    && errno != EINTR)
+                    {
+                    Error = SystemError("io_uring_enter", errno);
+                    return 0;
+                    }
+                }
+            }
+
+    private:
+        int                 Ring;
+        void *              SqMap;
+        size_t              SqBytes;
+        void *              CqMap;
+        size_t              CqBytes;
+        io_uring_sqe *      Sqes;
+        size_t              SqeBytes;
+        unsigned int *      SqTail;
+        unsigned int        SqMask;
+        unsigned int *      SqArray;
+        unsigned int *      CqHead;
+        unsigned int *      CqTail;
+        unsigned int        CqMask;
+        io_uring_cqe *      Cqes;
+
+        void *  Map(size_t bytes, long long offset)
+            {
+            void * p = mmap(0, bytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, Ring, offset);
+            return p == MAP_FAILED ? 0 : p;
+            }
+    };
+#endif
+#endif
+}
+
+//===========================================================================
+//  CLASS DiskLogger  -- Stream to disk from a dedicated writer thread
+//===========================================================================
+//---------------------------------------------------------------------------
+//  constructor for class DiskLogger
+//---------------------------------------------------------------------------
+
+DiskLogger::DiskLogger()
+    : BlockBytes(4 * 1024 * 1024), Depth(4), Blocks(0), Reserve(0), Direct(true),
+      Uring(true), Blocking(false), Current(0), Closing(false), Latency(0),
+      FBackend(bkNone), FUnbuffered(false), FBytes(0), FWritten(0), FDropped(0),
+      FHighWater(0), Valid(0)
+{
+}
+
+//---------------------------------------------------------------------------
+//  destructor for class DiskLogger
+//---------------------------------------------------------------------------
+
+DiskLogger::~DiskLogger()
+{
+    Close();
+}
+
+//---------------------------------------------------------------------------
+//  DiskLogger::Name() --  Backend name for logs and reports
+//---------------------------------------------------------------------------
+
+const char *  DiskLogger::Name(IIBackend backend)
+{
+    const char * names[] = { "none", "pwrite", "io_uring", "overlapped" };
+    return names[backend];
+}
+
+//---------------------------------------------------------------------------
+//  DiskLogger::Error() --  First I/O error, empty if none
+//---------------------------------------------------------------------------
+
+std::string  DiskLogger::Error() const
+{
+    std::lock_guard<std::mutex> lock(Lock);
+    return FError;
+}
+
+//---------------------------------------------------------------------------
+//  DiskLogger::Open() --  Create the file and start the writer
+//---------------------------------------------------------------------------
+
+bool  DiskLogger::Open(const std::string & file)
+{
+    Close();
+    FFileName = file;
+    FError.clear();
+    FBackend = bkNone;
+    FUnbuffered = false;
+    FBytes = 0;
+    FWritten = 0;
+    FDropped = 0;
+    FHighWater = 0;
+
+    const size_t block_bytes = RoundUp(std::max<size_t>(BlockBytes, Sector), Sector);
+    const unsigned int depth = std::max(Depth, 1u);
+    const unsigned int blocks = std::max(Blocks, depth + 2);
+
+#ifdef _WIN32
+    OverlappedIo * io = new OverlappedIo;
+    Device.reset(io);
+    if (!io->Open(file, Direct, Reserve))
+        {
+        FError = io->Error;
+        Device.reset();
+        return false;
+        }
+    FBackend = bkOverlapped;
+    FUnbuffered = Direct;
+#else
+    PosixIo * io = 0;
+#ifdef __linux__
+    if (Uring)
+        {
+        UringIo * ring = new UringIo;
+        if (ring->Setup(depth))
+            {
+            io = ring;
+            FBackend = bkUring;
+            }
+        else
+            delete ring;
+        }
+#endif
+    if (!io)
+        {
+        io = new PosixIo;
+        FBackend = bkSync;
+        }
+    Device.reset(io);
+    if (!io->Open(file, Direct, Reserve))
+        {
+        FError = io->Error;
+        Device.reset();
+        FBackend = bkNone;
+        return false;
+        }
+    FUnbuffered = io->Unbuffered;
+#endif
+
+    if (Pool.size() != blocks || Pool.empty() || Pool[0]->Memory.Bytes() != block_bytes)
+        {
+        Pool.clear();
+        for (unsigned int b = 0; b < blocks; ++b)
+            {
+            std::shared_ptr<Block> block = std::make_shared<Block>();
+            if (!block->Memory.Allocate(block_bytes))
+                {
+                FError = "Out of memory for disk blocks";
+                Pool.clear();
+                Device.reset();
+                FBackend = bkNone;
+                return false;
+                }
+            Pool.push_back(block);
+            }
+        }
+    Free.clear();
+    Full.clear();
+    for (size_t b = 0; b < Pool.size(); ++b)
+        {
+        Pool[b]->Fill = 0;
+        Free.push_back(Pool[b].get());
+        }
+    Current = 0;
+    Closing = false;
+    Thread = std::thread(&DiskLogger::Execute, this);
+    return true;
+}
+
+//---------------------------------------------------------------------------
+//  DiskLogger::Write() --  Queue data for the file
+//---------------------------------------------------------------------------
+//  A write either lands whole or is dropped whole, so the file never
+//  holds a torn packet.
+
+bool  DiskLogger::Write(const void * data, size_t bytes)
+{
+    if (!IsOpen() || !bytes)
+        return !bytes;
+
+    if (!Blocking && !Room(bytes))
+        {
+        FDropped.fetch_add(bytes);
+        return false;
+        }
+
+    const size_t block_bytes = Pool[0]->Memory.Bytes();
+    const char * src = static_cast<const char *>(data);
+    while (bytes)
+        {
+        if (!Current && !(Current = Take()))
+            {
+            FDropped.fetch_add(bytes);
+            return false;
+            }
+        const size_t n = std::min(bytes, block_bytes - Current->Fill);
+        std::memcpy(Current->Memory.As<char>() + Current->Fill, src, n);
+        Current->Fill += n;
+        src += n;
+        bytes -= n;
+        FBytes.fetch_add(n);
+        if (Current->Fill == block_bytes)
+            {
+            Submit(Current);
+            Current = 0;
+            }
+        }
+    return true;
+}
+
+//---------------------------------------------------------------------------
+//  DiskLogger::Room() --  Whether a write fits the free blocks now
+//---------------------------------------------------------------------------
+
+bool  DiskLogger::Room(size_t bytes) const
+{
+    if (!IsOpen())
+        return false;
+    const size_t block_bytes = Pool[0]->Memory.Bytes();
+    const size_t room = Current ? block_bytes - Current->Fill : 0;
+    if (bytes <= room)
+        return true;
+    const size_t needed = (bytes - room + block_bytes - 1) / block_bytes;
+    std::lock_guard<std::mutex> lock(Lock);
+    return Free.size() >= needed;
+}
+
+//---------------------------------------------------------------------------
+//  DiskLogger::Close() --  Flush, wait for every write, trim and close
+//---------------------------------------------------------------------------
+
+void  DiskLogger::Close()
+{
+    if (!IsOpen())
+        return;
+
+    if (Current && Current->Fill)
+        Submit(Current);
+    else if (Current)
+        {
+        std::lock_guard<std::mutex> lock(Lock);
+        Free.push_back(Current);
+        }
+    Current = 0;
+
+    {
+    std::lock_guard<std::mutex> lock(Lock);
+    Closing = true;
+    }
+    Queued.notify_one();
+    Freed.notify_all();
+    Thread.join();
+    Device.reset();
+}
+
+//---------------------------------------------------------------------------
+//  DiskLogger::Take() --  Producer: a free block, or 0
+//---------------------------------------------------------------------------
+
+DiskLogger::Block *  DiskLogger::Take()
+{
+    std::unique_lock<std::mutex> lock(Lock);
+    while (Blocking && Free.empty() && !Closing)
+        Freed.wait(lock);
+    if (Free.empty())
+        return 0;
+    Block * block = Free.front();
+    Free.pop_front();
+    block->Fill = 0;
+    return block;
+}
+
+//---------------------------------------------------------------------------
+//  DiskLogger::Submit() --  Producer: hand a filled block to the writer
+//---------------------------------------------------------------------------
+
+void  DiskLogger::Submit(Block * block)
+{
+    {
+    std::lock_guard<std::mutex> lock(Lock);
+    Full.push_back(block);
+    const unsigned int busy = static_cast<unsigned int>(Pool.size() - Free.size());
+    FHighWater = std::max(FHighWater, busy);
+    }
+    Queued.notify_one();
+}
+
+//---------------------------------------------------------------------------
+//  DiskLogger::Fail() --  Keep the first error; later blocks are dropped
+//---------------------------------------------------------------------------
+
+void  DiskLogger::Fail(const std::string & error)
+{
+    std::lock_guard<std::mutex> lock(Lock);
+    if (FError.empty())
+        FError = error.empty() ? "Write failed" : error;
+}
+
+//---------------------------------------------------------------------------
+//  DiskLogger::Execute() --  Writer thread
+//---------------------------------------------------------------------------
+//  Blocks go out in the order they were filled, at consecutive offsets.
+//  Only the last one can be partial, so padding it to a sector never
+//  leaves a hole; Finish() trims the padding off again.
+
+void  DiskLogger::Execute()
+{
+    unsigned long long offset = 0;
+    unsigned long long length = 0;
+    unsigned int inflight = 0;
+    bool failed = false;
+    Valid = ~0ull;
+
+    for (;;)
+        {
+        //  Return finished blocks to the pool as early as possible
+        Block * done = 0;
+        while (inflight && (done = Device->Reap(false)) != 0)
+            {
+            --inflight;
+            Retire(done);
+            }
+
+        Block * next = 0;
+        {
+        std::unique_lock<std::mutex> lock(Lock);
+        while (Full.empty() && !Closing && !inflight)
+            Queued.wait(lock);
+        if (Full.empty() && !inflight)
+            break;
+        if (!Full.empty() && inflight < std::max(Depth, 1u))
+            {
+            next = Full.front();
+            Full.pop_front();
+            }
+        failed = !FError.empty();
+        }
+
+        if (next)
+            {
+            next->Length = RoundUp(next->Fill, Sector);
+            std::memset(next->Memory.As<char>() + next->Fill, 0, next->Length - next->Fill);
+            next->Offset = offset;
+            next->Issued = HiResTimer::Ticks();
+            offset += next->Length;
+            length += next->Fill;
+            if (!failed && Device->Submit(next))
+                ++inflight;
+            else
+                {
+                if (!failed)
+                    Fail(Device->Error);
+                next->Result = -1;
+                Retire(next);
+                }
+            continue;
+            }
+
+        done = Device->Reap(true);
+        if (!done)
+            {
+            //  The ring itself failed; what was in flight is lost
+            Fail(Device->Error);
+            Valid = std::min(Valid, offset);
+            inflight = 0;
+            continue;
+            }
+        --inflight;
+        Retire(done);
+        }
+
+    //  After an error keep only what precedes the first failed write
+    if (!Device->Finish(std::min(length, Valid)))
+        Fail("Cannot set the length of " + FFileName);
+}
+
+//---------------------------------------------------------------------------
+//  DiskLogger::Retire() --  Writer: account for a block, back to the pool
+//---------------------------------------------------------------------------
+
+void  DiskLogger::Retire(Block * block)
+{
+    if (Latency)
+        Latency->Record(static_cast<unsigned long long>(
+            HiResTimer::ToSeconds(HiResTimer::Ticks() - block->Issued) * 1.0e9));
+
+    if (block->Result == static_cast<long long>(block->Length))
+        FWritten.fetch_add(block->Fill);
+    else
+        {
+        FDropped.fetch_add(block->Fill);
+        Valid = std::min(Valid, block->Offset);
+        Fail(Device->Error);
+        }
+
+    {
+    std::lock_guard<std::mutex> lock(Lock);
+    block->Fill = 0;
+    Free.push_back(block);
+    }
+    Freed.notify_one();
+}
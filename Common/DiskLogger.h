@@ -0,0 +1,124 @@
+// DiskLogger.h
+//
+// Asynchronous direct I/O stream file writer
+
+#ifndef DiskLoggerH
+#define DiskLoggerH
+
+#include "LatencyHistogram.h"
+#include <string>
+#include <vector>
+#include <deque>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <cstddef>
+
+//===========================================================================
+//  CLASS DiskLogger  -- Stream to disk from a dedicated writer thread
+//===========================================================================
+//  The producer copies data into page aligned blocks from a fixed pool;
+//  each full block goes to the writer thread, which keeps up to Depth of
+//  them in flight at consecutive file offsets and returns them to the pool
+//  as they complete.  Write() never touches the disk.  When the pool runs
+//  dry it drops and counts the data, unless Blocking is set, rather than
+//  stalling the stream.
+//
+//  Files are opened to bypass the page cache where the volume allows it
+//  (O_DIRECT, FILE_FLAG_NO_BUFFERING), so writeback never stalls the
+//  machine.  Linux issues writes through io_uring, or pwrite() where the
+//  kernel lacks it; Windows uses overlapped I/O.  Space may be reserved up
+//  front; Close() pads the last block to the sector size, then trims the
+//  file to the bytes actually written.  Only one thread may call Write().
+
+class DiskLogger
+{
+public:
+    enum IIBackend { bkNone, bkSync, bkUring, bkOverlapped };
+
+    DiskLogger();
+    ~DiskLogger();
+
+    //  Config, read by Open()
+    size_t              BlockBytes;     // Size of each write, rounded to 4 KB
+    unsigned int        Depth;          // Writes in flight
+    unsigned int        Blocks;         // Pool size, at least Depth + 2
+    unsigned long long  Reserve;        // Bytes preallocated, 0 = none
+    bool                Direct;         // Bypass the page cache
+    bool                Uring;          // Use io_uring where available
+    bool                Blocking;       // Write() waits for a free block
+
+    bool  Open(const std::string & file);
+    //  Producer.  False if any of the data was dropped.
+    bool  Write(const void * data, size_t bytes);
+    //  Producer: whether Write() would take 'bytes' now without dropping
+    bool  Room(size_t bytes) const;
+    //  Flush, wait for every write, trim and close
+    void  Close();
+    bool  IsOpen() const
+        {  return Thread.joinable();  }
+
+    //  Record each write's submit to completion time, in ns (0 = off)
+    void  WriteHistogram(LatencyHistogram * latency)
+        {  Latency = latency;  }
+
+    //  Status
+    IIBackend  Backend() const
+        {  return FBackend;  }
+    static const char *  Name(IIBackend backend);
+    bool  Unbuffered() const
+        {  return FUnbuffered;  }
+    const std::string &  FileName() const
+        {  return FFileName;  }
+    unsigned long long  Bytes() const           // Accepted by Write()
+        {  return FBytes.load();  }
+    unsigned long long  Written() const         // Completed on disk
+        {  return FWritten.load();  }
+    //  Refused for want of a free block, or lost to a write error
+    unsigned long long  Dropped() const
+        {  return FDropped.load();  }
+    unsigned int  HighWater() const             // Most blocks queued or in flight
+        {  return FHighWater;  }
+    //  First I/O error, empty if none
+    std::string  Error() const;
+
+    //  Defined in DiskLogger.cpp
+    struct Block;
+    class Io;
+
+private:
+    std::vector< std::shared_ptr<Block> >   Pool;
+    std::deque<Block *>                 Free;
+    std::deque<Block *>                 Full;
+    Block *                             Current;        // Being filled
+    std::unique_ptr<Io>                 Device;
+    std::thread                         Thread;
+    mutable std::mutex                  Lock;
+    std::condition_variable             Queued;         // Writer: work to do
+    std::condition_variable             Freed;          // Blocking producer
+    bool                                Closing;
+    LatencyHistogram *                  Latency;
+
+    IIBackend                           FBackend;
+    bool                                FUnbuffered;
+    std::string                         FFileName;
+    std::atomic<unsigned long long>     FBytes;
+    std::atomic<unsigned long long>     FWritten;
+    std::atomic<unsigned long long>     FDropped;
+    unsigned int                        FHighWater;
+    std::string                         FError;
+    unsigned long long                  Valid;          // Writer: file is good up to here
+
+    Block *  Take();
+    void     Submit(Block * block);
+    void     Execute();
+    void     Retire(Block * block);
+    void     Fail(const std::string & error);
+
+    DiskLogger(const DiskLogger &);
+    DiskLogger & operator=(const DiskLogger &);
+};
+
+#endif
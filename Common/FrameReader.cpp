@@ -0,0 +1,141 @@
+// FrameReader.cpp
+//
+// Random access to frames of a recorded VITA stream file through its index
+
+#include "FrameReader.h"
+#include "VitaHeader.h"
+#include <algorithm>
+#include <thread>
+#include <cstring>
+
+//===========================================================================
+//  CLASS FrameReader  -- Fetch any frames of any streams of a capture
+//===========================================================================
+//---------------------------------------------------------------------------
+//  constructor for class FrameReader
+//---------------------------------------------------------------------------
+
+FrameReader::FrameReader()
+    : FrameSize(4096), SampleBytes(sizeof(short)), FFrameSize(4096), FSampleBytes(sizeof(short))
+{
+}
+
+//---------------------------------------------------------------------------
+//  FrameReader::Open() --  Map a capture and its sidecar
+//---------------------------------------------------------------------------
+//  The sidecar is taken if its first record describes the packet that
+//  starts the file.  Records past the end of a file cut short since, or
+//  of another file, fail their check when read, as any other mismatch
+//  does.
+
+bool  FrameReader::Open(const std::string & file)
+{
+    Close();
+    FFrameSize = std::max(FrameSize, 1u);
+    FSampleBytes = std::max<size_t>(SampleBytes, 1);
+
+    VitaPacketInfo info;
+    if (Table.Open(PacketIndexFile::SidecarName(file)) && Table.Records() && !Table[0].Offset &&
+        Map.Open(file) &&
+        Vita::Decode(Map.As<unsigned int>(), static_cast<size_t>(Map.Bytes() / sizeof(unsigned int)), 0, info) &&
+        info.Sid == Table[0].Sid && info.Words == Table[0].Words)
+        {
+        if (Table.Header().FrameSize)
+            FFrameSize = Table.Header().FrameSize;
+        if (Table.Header().SampleBytes)
+            FSampleBytes = Table.Header().SampleBytes;
+        return true;
+        }
+    Map.Close();
+    Table.Close();
+
+    //  No index to trust: scan the file once
+    Whole.SampleBytes = FSampleBytes;
+    if (!Whole.Open(file))
+        {
+        FError = Whole.Error();
+        return false;
+        }
+    return true;
+}
+
+//---------------------------------------------------------------------------
+//  FrameReader::Close() --  Unmap
+//---------------------------------------------------------------------------
+
+void  FrameReader::Close()
+{
+    Table.Close();
+    Map.Close();
+    Whole.Close();
+    FError.clear();
+}
+
+//---------------------------------------------------------------------------
+//  FrameReader::Read() --  Frames of one stream
+//---------------------------------------------------------------------------
+
+size_t  FrameReader::Read(unsigned int sid, unsigned long long first, size_t frames, void * out) const
+{
+    const unsigned long long sample = first * FFrameSize;
+    const size_t want = frames * FFrameSize;
+    unsigned char * dest = static_cast<unsigned char *>(out);
+
+    if (!Table.IsOpen())
+        {
+        const int stream = Whole.IsOpen() ? Whole.Find(sid) : -1;
+        return stream < 0 ? 0 : Whole.Gather(stream, sample, want, out) / FFrameSize;
+        }
+
+    const unsigned int * words = Map.As<unsigned int>();
+    const size_t count = static_cast<size_t>(Map.Bytes() / sizeof(unsigned int));
+    unsigned long long at = sample;
+    size_t done = 0;
+    for (size_t r = Table.FindSample(sid, sample); done < want && r < Table.Records(); r = Table.Next(sid, r + 1))
+        {
+        //  The record must describe the packet it points at, and follow on
+        const PacketIndexRecord & rec = Table[r];
+        VitaPacketInfo info;
+        if (rec.Sample > at || rec.Offset % sizeof(unsigned int) ||
+            rec.Offset + rec.Words * sizeof(unsigned int) > Map.Bytes() ||
+            !Vita::Decode(words, count, static_cast<size_t>(rec.Offset / sizeof(unsigned int)), info) ||
+            info.Sid != sid || info.Words != rec.Words)
+            break;
+
+        const size_t samples = info.PayloadWords * sizeof(unsigned int) / FSampleBytes;
+        const size_t skip = static_cast<size_t>(at - rec.Sample);
+        if (skip >= samples)
+            continue;
+        const size_t n = std::min(want - done, samples - skip);
+        const unsigned char * src = reinterpret_cast<const unsigned char *>(words + info.Offset + info.PayloadOffset);
+        std::memcpy(dest + done * FSampleBytes, src + skip * FSampleBytes, n * FSampleBytes);
+        done += n;
+        at += n;
+        }
+    return done / FFrameSize;
+}
+
+//---------------------------------------------------------------------------
+//  FrameReader::Read() --  Frames of several streams at once
+//---------------------------------------------------------------------------
+//  Each stream's packets are faulted in by its own thread, so the page
+//  reads of all of them are in flight together.
+
+size_t  FrameReader::Read(const std::vector<unsigned int> & sids, unsigned long long first, size_t frames,
+                          void * const * out) const
+{
+    if (sids.empty())
+        return 0;
+
+    std::vector<size_t> copied(sids.size(), 0);
+    std::vector<std::thread> pool;
+    for (size_t k = 1; k < sids.size(); ++k)
+        pool.push_back(std::thread([this, &sids, &copied, first, frames, out, k]()
+            {
+            copied[k] = Read(sids[k], first, frames, out[k]);
+            }));
+    copied[0] = Read(sids[0], first, frames, out[0]);
+    for (size_t t = 0; t < pool.size(); ++t)
+        pool[t].join();
+    return *std::min_element(copied.begin(), copied.end());
+}
@@ -0,0 +1,74 @@
+// FrameReader.h
+//
+// Random access to frames of a recorded VITA stream file through its index
+
+#ifndef FrameReaderH
+#define FrameReaderH
+
+#include "PacketIndex.h"
+#include "VitaFile.h"
+#include "MappedFile.h"
+#include <string>
+#include <vector>
+#include <cstddef>
+
+//===========================================================================
+//  CLASS FrameReader  -- Fetch any frames of any streams of a capture
+//===========================================================================
+//  The file is mapped and its .vidx sidecar, listed by stream once on
+//  Open(), bisected for the packet holding the first sample wanted, so a
+//  read touches the index records it probes and the pages of the packets
+//  it copies, however far into the file they are.  Each packet's header is
+//  checked against its record before it is used, and a read ends early
+//  where the index stops matching the file or skips samples.
+//
+//  Without a usable sidecar the file is indexed whole by VitaFile on
+//  Open() instead, and reads gather from that.  Frames are FrameSize
+//  samples unless the sidecar says otherwise.  Reads may be made from
+//  any number of threads.
+
+class FrameReader
+{
+public:
+    FrameReader();
+
+    //  Config, read by Open(); the sidecar's own values win
+    unsigned int    FrameSize;      // Stream samples per frame
+    size_t          SampleBytes;    // Bytes per stream sample, all lanes
+
+    bool  Open(const std::string & file);
+    void  Close();
+    bool  IsOpen() const
+        {  return Map.IsOpen() || Whole.IsOpen();  }
+
+    const std::string &  Error() const
+        {  return FError;  }
+    //  True if reads seek through the sidecar, false if the file was scanned
+    bool  Indexed() const
+        {  return Table.IsOpen();  }
+    unsigned int  Frame() const                 // Samples per frame in use
+        {  return FFrameSize;  }
+    size_t  Bytes() const                       // ...and bytes per sample
+        {  return FSampleBytes;  }
+
+    //  Copy 'frames' frames of stream 'sid' from frame 'first' to 'out'.
+    //  Returns the whole frames copied.
+    size_t  Read(unsigned int sid, unsigned long long first, size_t frames, void * out) const;
+    //  The same for each of 'sids', out[k] receiving sids[k], a thread per
+    //  stream.  Returns the fewest frames copied for any.
+    size_t  Read(const std::vector<unsigned int> & sids, unsigned long long first, size_t frames,
+                 void * const * out) const;
+
+private:
+    MappedFile          Map;
+    PacketIndexFile     Table;
+    VitaFile            Whole;          // In place of both
+    std::string         FError;
+    unsigned int        FFrameSize;
+    size_t              FSampleBytes;
+
+    FrameReader(const FrameReader &);
+    FrameReader & operator=(const FrameReader &);
+};
+
+#endif
@@ -0,0 +1,51 @@
+// HiResTimer.cpp
+//
+// Lightweight high resolution tick source for instrumentation and benchmarks
+
+#include "HiResTimer.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <time.h>
+#endif
+
+//===========================================================================
+//  CLASS HiResTimer  -- Monotonic tick counter
+//===========================================================================
+//---------------------------------------------------------------------------
+//  HiResTimer::Ticks() --  Current tick count
+//---------------------------------------------------------------------------
+
+long long  HiResTimer::Ticks()
+{
+#ifdef _WIN32
+    LARGE_INTEGER now;
+    QueryPerformanceCounter(&now);
+    return now.QuadPart;
+#else
+    timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return static_cast<long long>(now.tv_sec) * 1000000000LL + now.tv_nsec;
+#endif
+}
+
+//---------------------------------------------------------------------------
+//  HiResTimer::TicksPerSecond() --  Tick frequency
+//---------------------------------------------------------------------------
+
+double  HiResTimer::TicksPerSecond()
+{
+#ifdef _WIN32
+    static double Freq = 0.0;
+    if (Freq == 0.0)
+        {
+        LARGE_INTEGER f;
+        QueryPerformanceFrequency(&f);
+        Freq = static_cast<double>(f.QuadPart);
+        }
+    return Freq;
+#else
+    return 1.0e9;
+#endif
+}
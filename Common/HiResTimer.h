@@ -0,0 +1,34 @@
+// HiResTimer.h
+//
+// Lightweight high resolution tick source for instrumentation and benchmarks
+
+#ifndef HiResTimerH
+#define HiResTimerH
+
+//===========================================================================
+//  CLASS HiResTimer  -- Monotonic tick counter
+//===========================================================================
+//  Unlike Innovative::StopWatch this has no library dependency, so the
+//  portable ingest modules can time themselves off the board.
+
+class HiResTimer
+{
+public:
+    HiResTimer()
+        {  Start();  }
+
+    void    Start()
+        {  Origin = Ticks();  }
+    double  Elapsed() const
+        {  return (Ticks() - Origin) / TicksPerSecond();  }
+
+    static long long  Ticks();
+    static double     TicksPerSecond();
+    static double     ToSeconds(long long ticks)
+        {  return ticks / TicksPerSecond();  }
+
+private:
+    long long   Origin;
+};
+
+#endif
@@ -0,0 +1,1276 @@
+// IngestBenchmark.cpp
+//
+// Board-free benchmarks of the ingest path using synthetic VITA buffers
+
+#include "IngestBenchmark.h"
+#include "VitaSynth.h"
+#include "VitaDemux.h"
+#include "VitaIndex.h"
+#include "HiResTimer.h"
+#include "IngestPipeline.h"
+#include "CaptureMemory.h"
+#include "Deinterleave.h"
+#include "ReplaySource.h"
+#include "DiskLogger.h"
+#include "CompressedLogger.h"
+#include "PackedCapture.h"
+#include "PacketIndex.h"
+#include "VitaFile.h"
+#include "VitaParser.h"
+#include "FrameReader.h"
+#include "SampleScale.h"
+#include <sstream>
+#include <iomanip>
+#include <cstring>
+#include <cstdio>
+#include <chrono>
+#include <thread>
+#include <atomic>
+#ifdef _WIN32
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <unistd.h>
+#endif
+
+namespace
+{
+    //  Keeps results of timed loops observable
+    volatile size_t Sink = 0;
+
+    //  Packets per stream in each half of the Parse() seek file
+    const size_t SeekPackets = 2048;
+
+    //  Bytes of the process resident now
+    double  ResidentBytes()
+    {
+#ifdef _WIN32
+        PROCESS_MEMORY_COUNTERS counters;
+        if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+            return 0.0;
+        return static_cast<double>(counters.WorkingSetSize);
+#else
+        std::FILE * file = std::fopen("/proc/self/statm", "r");
+        if (!file)
+            return 0.0;
+        unsigned long size = 0, resident = 0;
+        const int fields = std::fscanf(file, "%lu %lu", &size, &resident);
+        std::fclose(file);
+        return fields == 2 ? static_cast<double>(resident) * sysconf(_SC_PAGESIZE) : 0.0;
+#endif
+    }
+
+    //  Most bytes resident from construction to Stop(), polled each
+    //  millisecond.  The process peak would carry over from earlier runs,
+    //  and from the host application.
+    class RssProbe
+    {
+    public:
+        RssProbe()
+            : Quit(false), Peak(ResidentBytes()), Thread(&RssProbe::Execute, this)
+            {}
+
+        double  Stop()
+            {
+            Quit = true;
+            Thread.join();
+            return std::max(Peak, ResidentBytes());
+            }
+
+    private:
+        std::atomic<bool>   Quit;
+        double              Peak;
+        std::thread         Thread;
+
+        void  Execute()
+            {
+            while (!Quit)
+                {
+                Peak = std::max(Peak, ResidentBytes());
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                }
+            }
+
+        RssProbe(const RssProbe &);
+        RssProbe & operator=(const RssProbe &);
+    };
+}
+
+//===========================================================================
+//  CLASS IngestBenchmark  -- Synthetic ingest benchmarks
+//===========================================================================
+//---------------------------------------------------------------------------
+//  constructor for class IngestBenchmark
+//---------------------------------------------------------------------------
+
+IngestBenchmark::IngestBenchmark()
+    : Channels(2), BufferBytes(4 * 1024 * 1024), TotalBytes(1024 * 1024 * 1024),
+      CaptureBytes(256 * 1024 * 1024), ReplayFile("IngestReplay.bin"),
+      DiskFile("IngestDisk.bin"), DiskBlockBytes(4 * 1024 * 1024), DiskDepth(4),
+      CompressThreads(std::max(std::thread::hardware_concurrency(), 1u)), PackBits(14),
+      ParseFile("IngestParse.bin"), ParseBytes(256 * 1024 * 1024),
+      ParseThreads(std::max(std::thread::hardware_concurrency(), 1u))
+{
+    for (size_t bytes = 0x1000; bytes <= 0x10000; bytes *= 2)
+        PacketSizes.push_back(bytes);
+}
+
+//---------------------------------------------------------------------------
+//  IngestBenchmark::Run() --  Run benchmark by mode
+//---------------------------------------------------------------------------
+
+BenchmarkResults  IngestBenchmark::Run(IIMode mode)
+{
+    switch (mode)
+        {
+        case bmQueue:
+            return Queue();
+        case bmMemory:
+            return Memory();
+        case bmIndex:
+            return Index();
+        case bmDeinterleave:
+            return Deinterleave();
+        case bmReplay:
+            return Replay();
+        case bmDisk:
+            return Disk();
+        case bmCompress:
+            return Compress();
+        case bmPack:
+            return Pack();
+        case bmParse:
+            return Parse();
+        case bmUnits:
+            return Units();
+        case bmDemux:
+        default:
+            return Demux();
+        }
+}
+
+//---------------------------------------------------------------------------
+//  IngestBenchmark::Demux() --  Demultiplexer throughput vs packet size
+//---------------------------------------------------------------------------
+//  A memcpy of the same buffers is timed first as the memory bandwidth
+//  ceiling the demultiplexer is measured against.
+
+BenchmarkResults  IngestBenchmark::Demux()
+{
+    BenchmarkResults results;
+    const size_t Buffers = 8;
+    const size_t DestSamples = 16 * 1024 * 1024;
+
+    std::vector< std::vector<short> > dest(Channels, std::vector<short>(DestSamples));
+
+    for (size_t p = 0; p < PacketSizes.size(); ++p)
+        {
+        VitaSynth synth(Channels, PacketSizes[p]);
+        std::vector< std::vector<unsigned int> > in(Buffers);
+        for (size_t b = 0; b < Buffers; ++b)
+            synth.Fill(in[b], BufferBytes);
+
+        const size_t in_bytes = in[0].size() * sizeof(unsigned int);
+        const size_t passes = TotalBytes / in_bytes + 1;
+        const double packets_per_buffer = static_cast<double>(synth.Packets()) / Buffers;
+
+        //  Reference: raw copy of the whole buffer
+        {
+        BenchmarkResult r("memcpy", PacketSizes[p]);
+        std::vector<unsigned int> sink(in[0].size());
+        HiResTimer t;
+        for (size_t i = 0; i < passes; ++i)
+            std::memcpy(&sink[0], &in[i % Buffers][0], in_bytes);
+        r.Seconds = t.Elapsed();
+        r.Bytes = static_cast<double>(passes) * in_bytes;
+        r.Packets = passes * packets_per_buffer;
+        results.push_back(r);
+        }
+
+        //  Demultiplex to per-channel destinations
+        {
+        BenchmarkResult r("demux", PacketSizes[p]);
+        VitaDemux demux;
+        for (unsigned int ch = 0; ch < Channels; ++ch)
+            demux.AddStream(synth.FirstSid() + ch, &dest[ch][0], DestSamples);
+
+        double bytes = 0.0;
+        HiResTimer t;
+        for (size_t i = 0; i < passes; ++i)
+            {
+            const std::vector<unsigned int> & buf = in[i % Buffers];
+            bytes += demux.Process(&buf[0], buf.size());
+            if (demux.Full())
+                demux.Rewind();
+            }
+        r.Seconds = t.Elapsed();
+        r.Bytes = bytes;
+        r.Packets = passes * packets_per_buffer;
+        results.push_back(r);
+        }
+        }
+
+    return results;
+}
+
+//---------------------------------------------------------------------------
+//  IngestBenchmark::Queue() --  Software source through the ingest pipeline
+//---------------------------------------------------------------------------
+//  A software packet source pushes prebuilt buffers through IngestPipeline
+//  to 1..Channels workers, each demultiplexing its share of the streams,
+//  as HandleDataAvailable does with live VeloBuffers.  The source waits for
+//  room rather than dropping, so the result is the lossless ceiling.
+
+typedef std::shared_ptr< std::vector<unsigned int> >   WordBufferPtr;
+
+BenchmarkResults  IngestBenchmark::Queue()
+{
+    BenchmarkResults results;
+    const size_t Buffers = 8;
+    const size_t DestSamples = 16 * 1024 * 1024;
+
+    std::vector< std::vector<short> > dest(Channels, std::vector<short>(DestSamples));
+
+    for (size_t p = 0; p < PacketSizes.size(); ++p)
+        {
+        VitaSynth synth(Channels, PacketSizes[p]);
+        std::vector<WordBufferPtr> in(Buffers);
+        for (size_t b = 0; b < Buffers; ++b)
+            {
+            in[b] = std::make_shared< std::vector<unsigned int> >();
+            synth.Fill(*in[b], BufferBytes);
+            }
+        const size_t in_bytes = in[0]->size() * sizeof(unsigned int);
+        const size_t passes = TotalBytes / in_bytes + 1;
+        const double packets_per_buffer = static_cast<double>(synth.Packets()) / Buffers;
+
+        //  One worker, then one worker per channel
+        std::vector<unsigned int> counts(1, 1u);
+        if (Channels > 1)
+            counts.push_back(Channels);
+
+        for (size_t c = 0; c < counts.size(); ++c)
+            {
+            const unsigned int workers = counts[c];
+            //  Streams split across workers, as in the live path
+            std::vector<VitaDemux> demux(workers);
+            for (unsigned int ch = 0; ch < Channels; ++ch)
+                for (unsigned int w = 0; w < workers; ++w)
+                    if (ch % workers == w)
+                        demux[w].AddStream(synth.FirstSid() + ch, &dest[ch][0], DestSamples);
+                    else
+                        demux[w].SkipStream(synth.FirstSid() + ch);
+
+            std::vector<double> bytes(workers, 0.0);
+            IngestPipeline<WordBufferPtr> pipe;
+            pipe.Start(workers, 64, [&](WordBufferPtr & buf, unsigned int w)
+                {
+                bytes[w] += demux[w].Process(&(*buf)[0], buf->size());
+                if (demux[w].Full())
+                    demux[w].Rewind();
+                });
+
+            std::stringstream name;
+            name << "queue x" << workers;
+            BenchmarkResult r(name.str(), PacketSizes[p]);
+            HiResTimer t;
+            for (size_t i = 0; i < passes; ++i)
+                {
+                while (!pipe.Room())
+                    std::this_thread::yield();
+                pipe.Push(in[i % Buffers]);
+                }
+            pipe.Drain();
+            r.Seconds = t.Elapsed();
+
+            for (unsigned int w = 0; w < workers; ++w)
+                {
+                r.Bytes += bytes[w];
+                r.HighWater = std::max(r.HighWater, static_cast<double>(pipe.Status(w).HighWater));
+                }
+            r.Drops = static_cast<double>(pipe.Drops());
+            pipe.Stop();
+            r.Packets = passes * packets_per_buffer;
+            results.push_back(r);
+            }
+        }
+
+    return results;
+}
+
+//---------------------------------------------------------------------------
+//  IngestBenchmark::Memory() --  Capture memory policies compared
+//---------------------------------------------------------------------------
+//  For each allocation policy a fresh capture block is filled once with
+//  packet payload, as the first run after StartStreaming would, then
+//  copied over repeatedly.  "fill" carries the setup cost and the time to
+//  land the first packet; "copy" is the sustained bandwidth once every
+//  page is resident.  A policy the OS refuses is reported under the page
+//  size actually obtained.
+
+BenchmarkResults  IngestBenchmark::Memory()
+{
+    BenchmarkResults results;
+
+    std::vector<CapturePolicy> policies;
+    policies.push_back(CapturePolicy(CapturePolicy::pgNormal, false));
+    policies.push_back(CapturePolicy(CapturePolicy::pgNormal, true));
+    policies.push_back(CapturePolicy(CapturePolicy::pgNormal, true, true));
+    policies.push_back(CapturePolicy(CapturePolicy::pgLarge, true));
+    policies.push_back(CapturePolicy(CapturePolicy::pgHuge, true));
+
+    const size_t packet = PacketSizes.empty() ? 0x10000 : PacketSizes.back();
+    VitaSynth synth(1, packet);
+    std::vector<unsigned int> src;
+    synth.Fill(src, BufferBytes);
+    const size_t src_bytes = src.size() * sizeof(unsigned int);
+
+    for (size_t i = 0; i < policies.size(); ++i)
+        {
+        HiResTimer t;
+        CaptureMemory block;
+        if (!block.Allocate(CaptureBytes, policies[i]))
+            continue;
+        const double setup = t.Elapsed();
+
+        CapturePolicy got = policies[i];
+        got.Pages = block.Pages();
+        got.Lock = policies[i].Lock && block.Locked();
+        char * dest = block.As<char>();
+        const size_t bytes = block.Bytes();
+
+        //  First pass: one packet, then the rest of the block
+        BenchmarkResult fill("fill " + got.Name(), packet);
+        fill.Setup = setup;
+        t.Start();
+        std::memcpy(dest, &src[0], std::min(packet, bytes));
+        fill.FirstPacket = t.Elapsed();
+        for (size_t off = packet; off < bytes; off += src_bytes)
+            std::memcpy(dest + off, &src[0], std::min(src_bytes, bytes - off));
+        fill.Seconds = t.Elapsed();
+        fill.Bytes = static_cast<double>(bytes);
+        fill.Packets = fill.Bytes / packet;
+        results.push_back(fill);
+
+        //  Sustained: every page already resident
+        BenchmarkResult copy("copy " + got.Name(), packet);
+        const size_t passes = std::max<size_t>(TotalBytes / bytes, 1);
+        t.Start();
+        for (size_t p = 0; p < passes; ++p)
+            for (size_t off = 0; off < bytes; off += src_bytes)
+                std::memcpy(dest + off, &src[0], std::min(src_bytes, bytes - off));
+        copy.Seconds = t.Elapsed();
+        copy.Bytes = static_cast<double>(passes) * bytes;
+        copy.Packets = copy.Bytes / packet;
+        results.push_back(copy);
+        }
+
+    return results;
+}
+
+//---------------------------------------------------------------------------
+//  IngestBenchmark::Index() --  Header pre-scan vs the decode-as-you-go walk
+//---------------------------------------------------------------------------
+//  "decode" walks the headers one Vita::Decode() at a time, as the cursor
+//  loop did; "scan" builds a VitaIndex of the same buffer.  Then the
+//  single pass demultiplexer is timed against scan plus indexed demux.
+//  Bytes are whole buffer bytes, so all four rows compare directly.
+
+BenchmarkResults  IngestBenchmark::Index()
+{
+    BenchmarkResults results;
+    const size_t Buffers = 8;
+    const size_t DestSamples = 16 * 1024 * 1024;
+
+    std::vector< std::vector<short> > dest(Channels, std::vector<short>(DestSamples));
+
+    for (size_t p = 0; p < PacketSizes.size(); ++p)
+        {
+        VitaSynth synth(Channels, PacketSizes[p]);
+        std::vector< std::vector<unsigned int> > in(Buffers);
+        for (size_t b = 0; b < Buffers; ++b)
+            synth.Fill(in[b], BufferBytes);
+
+        const size_t in_bytes = in[0].size() * sizeof(unsigned int);
+        const size_t passes = TotalBytes / in_bytes + 1;
+        const double packets = passes * static_cast<double>(synth.Packets()) / Buffers;
+        const double bytes = static_cast<double>(passes) * in_bytes;
+
+        //  Header walks only
+        {
+        BenchmarkResult r("decode", PacketSizes[p]);
+        size_t found = 0;
+        HiResTimer t;
+        for (size_t i = 0; i < passes; ++i)
+            {
+            const std::vector<unsigned int> & buf = in[i % Buffers];
+            VitaPacketInfo info;
+            for (size_t off = 0; Vita::Decode(&buf[0], buf.size(), off, info); off += info.Words)
+                found += info.Sid & 1;
+            }
+        r.Seconds = t.Elapsed();
+        Sink = found;
+        r.Bytes = bytes;
+        r.Packets = packets;
+        results.push_back(r);
+        }
+
+        VitaIndex index;
+        {
+        BenchmarkResult r("scan", PacketSizes[p]);
+        HiResTimer t;
+        for (size_t i = 0; i < passes; ++i)
+            {
+            const std::vector<unsigned int> & buf = in[i % Buffers];
+            index.Scan(&buf[0], buf.size());
+            }
+        r.Seconds = t.Elapsed();
+        r.Bytes = bytes;
+        r.Packets = packets;
+        results.push_back(r);
+        }
+
+        //  Full ingest: one pass vs two
+        for (int two_pass = 0; two_pass < 2; ++two_pass)
+            {
+            BenchmarkResult r(two_pass ? "scan+demux" : "demux", PacketSizes[p]);
+            VitaDemux demux;
+            for (unsigned int ch = 0; ch < Channels; ++ch)
+                demux.AddStream(synth.FirstSid() + ch, &dest[ch][0], DestSamples);
+
+            HiResTimer t;
+            for (size_t i = 0; i < passes; ++i)
+                {
+                const std::vector<unsigned int> & buf = in[i % Buffers];
+                if (two_pass)
+                    {
+                    index.Scan(&buf[0], buf.size());
+                    demux.Process(index, &buf[0]);
+                    }
+                else
+                    demux.Process(&buf[0], buf.size());
+                if (demux.Full())
+                    demux.Rewind();
+                }
+            r.Seconds = t.Elapsed();
+            r.Bytes = bytes;
+            r.Packets = packets;
+            results.push_back(r);
+            }
+        }
+
+    return results;
+}
+
+//---------------------------------------------------------------------------
+//  IngestBenchmark::Deinterleave() --  Interleaved to planar kernels
+//---------------------------------------------------------------------------
+//  Every kernel available on this machine -- scalar up to the best vector
+//  level -- splits BufferBytes of interleaved int16 and int32 samples into
+//  2, 4 and 8 planar lanes, against a memcpy of the same size.  Rows are
+//  named "<isa> i<bits>x<lanes>"; packets are buffers.
+
+BenchmarkResults  IngestBenchmark::Deinterleave()
+{
+    BenchmarkResults results;
+    const size_t bytes = BufferBytes & ~static_cast<size_t>(63);
+    const size_t passes = std::max<size_t>(TotalBytes / bytes, 1);
+
+    //  Page aligned, as capture buffers are
+    CaptureMemory src_block, dst_block;
+    if (!src_block.Allocate(bytes) || !dst_block.Allocate(bytes))
+        return results;
+    char * src = src_block.As<char>();
+    char * dst = dst_block.As<char>();
+    for (size_t i = 0; i < bytes; ++i)
+        src[i] = static_cast<char>(i * 7);
+
+    {
+    BenchmarkResult r("memcpy", bytes);
+    HiResTimer t;
+    for (size_t p = 0; p < passes; ++p)
+        std::memcpy(dst, src, bytes);
+    r.Seconds = t.Elapsed();
+    r.Bytes = static_cast<double>(passes) * bytes;
+    r.Packets = static_cast<double>(passes);
+    results.push_back(r);
+    }
+
+    for (int isa = ::Deinterleave::isScalar; isa <= ::Deinterleave::Supported(); ++isa)
+        for (size_t width = 2; width <= 4; width *= 2)
+            for (unsigned int lanes = 2; lanes <= 8; lanes *= 2)
+                {
+                ::Deinterleave::Ftn kernel = ::Deinterleave::Kernel(width, lanes, static_cast< ::Deinterleave::IIIsa >(isa));
+                if (!kernel)
+                    continue;
+                //  Lanes staggered by a cache line so they do not alias
+                const size_t frames = (bytes - lanes * 64) / (width * lanes);
+                std::vector<char *> dest(lanes);
+                for (unsigned int l = 0; l < lanes; ++l)
+                    dest[l] = &dst[l * (frames * width + 64)];
+
+                std::stringstream name;
+                name << ::Deinterleave::Name(static_cast< ::Deinterleave::IIIsa >(isa))
+                     << " i" << width * 8 << "x" << lanes;
+                BenchmarkResult r(name.str(), bytes);
+                HiResTimer t;
+                for (size_t p = 0; p < passes; ++p)
+                    kernel(&dest[0], src, frames);
+                r.Seconds = t.Elapsed();
+                Sink = static_cast<size_t>(dst[bytes - 1]);
+                r.Bytes = static_cast<double>(passes) * frames * width * lanes;
+                r.Packets = static_cast<double>(passes);
+                results.push_back(r);
+                }
+
+    return results;
+}
+
+//---------------------------------------------------------------------------
+//  IngestBenchmark::Replay() --  Stream file replayed through the pipeline
+//---------------------------------------------------------------------------
+//  Per packet size a synthetic stream file of up to 256 MB is written to
+//  ReplayFile, then ReplaySource plays it unpaced, looping to TotalBytes,
+//  into one worker per channel as ApplicationIo::Replay() does.  The file
+//  normally sits in the page cache, so this is the software path's ceiling
+//  rather than a disk figure.  The file is removed afterwards.
+
+BenchmarkResults  IngestBenchmark::Replay()
+{
+    BenchmarkResults results;
+    const size_t DestSamples = 16 * 1024 * 1024;
+    const size_t file_bytes = std::min<size_t>(TotalBytes, 256 * 1024 * 1024);
+
+    std::vector< std::vector<short> > dest(Channels, std::vector<short>(DestSamples));
+
+    for (size_t p = 0; p < PacketSizes.size(); ++p)
+        {
+        VitaSynth synth(Channels, PacketSizes[p]);
+        std::FILE * file = std::fopen(ReplayFile.c_str(), "wb");
+        if (!file)
+            return results;
+        std::vector<unsigned int> buf;
+        size_t written = 0;
+        while (written < file_bytes)
+            {
+            synth.Fill(buf, BufferBytes);
+            written += std::fwrite(&buf[0], sizeof(unsigned int), buf.size(), file) * sizeof(unsigned int);
+            }
+        std::fclose(file);
+        const double packets_per_byte = static_cast<double>(synth.Packets()) / written;
+
+        const unsigned int workers = Channels;
+        std::vector<VitaDemux> demux(workers);
+        for (unsigned int ch = 0; ch < Channels; ++ch)
+            for (unsigned int w = 0; w < workers; ++w)
+                if (ch == w)
+                    demux[w].AddStream(synth.FirstSid() + ch, &dest[ch][0], DestSamples);
+                else
+                    demux[w].SkipStream(synth.FirstSid() + ch);
+
+        std::vector<double> bytes(workers, 0.0);
+        IngestPipeline<WordBufferPtr> pipe;
+        pipe.Start(workers, 64, [&](WordBufferPtr & buf, unsigned int w)
+            {
+            bytes[w] += demux[w].Process(&(*buf)[0], buf->size());
+            if (demux[w].Full())
+                demux[w].Rewind();
+            });
+
+        ReplaySource source;
+        source.FileName = ReplayFile;
+        source.BufferBytes = BufferBytes;
+        source.Speed = 0.0;
+        source.Loops = static_cast<unsigned int>(std::max<size_t>(TotalBytes / written, 1));
+
+        BenchmarkResult r("replay max", PacketSizes[p]);
+        HiResTimer t;
+        source.Start([&](std::vector<unsigned int> & words)
+            {
+            while (!pipe.Room())
+                std::this_thread::yield();
+            WordBufferPtr packet = std::make_shared< std::vector<unsigned int> >();
+            packet->swap(words);
+            pipe.Push(packet);
+            });
+        while (source.Running())
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        source.Stop();
+        pipe.Drain();
+        r.Seconds = t.Elapsed();
+
+        for (unsigned int w = 0; w < workers; ++w)
+            {
+            r.Bytes += bytes[w];
+            r.HighWater = std::max(r.HighWater, static_cast<double>(pipe.Status(w).HighWater));
+            }
+        r.Drops = static_cast<double>(pipe.Drops());
+        pipe.Stop();
+        r.Packets = static_cast<double>(source.Bytes()) * packets_per_byte;
+        results.push_back(r);
+        std::remove(ReplayFile.c_str());
+        }
+
+    return results;
+}
+
+//---------------------------------------------------------------------------
+//  IngestBenchmark::Disk() --  Sustained disk log rate per write mechanism
+//---------------------------------------------------------------------------
+//  TotalBytes of synthetic stream buffers go through a blocking DiskLogger
+//  to DiskFile, timed from the first Write() until Close() has trimmed the
+//  file, so the figure is what reached the volume.  Each mechanism this
+//  platform offers is run unbuffered, then once through the page cache for
+//  comparison.  Rows are "disk <mechanism> <direct|cached>"; packets are
+//  writer blocks, and the high water mark is in blocks.
+
+BenchmarkResults  IngestBenchmark::Disk()
+{
+    BenchmarkResults results;
+    const size_t Buffers = 8;
+
+    VitaSynth synth(Channels, PacketSizes.back());
+    std::vector< std::vector<unsigned int> > in(Buffers);
+    for (size_t b = 0; b < Buffers; ++b)
+        synth.Fill(in[b], BufferBytes);
+    const size_t in_bytes = in[0].size() * sizeof(unsigned int);
+    const size_t passes = std::max<size_t>(TotalBytes / in_bytes, 1);
+
+    struct Setup
+    {
+        bool    Uring;
+        bool    Direct;
+    };
+    const Setup setups[] = { { true, true }, { false, true }, { false, false } };
+
+    for (size_t s = 0; s < sizeof(setups) / sizeof(setups[0]); ++s)
+        {
+        DiskLogger disk;
+        disk.BlockBytes = DiskBlockBytes;
+        disk.Depth = DiskDepth;
+        disk.Reserve = static_cast<unsigned long long>(passes) * in_bytes;
+        disk.Uring = setups[s].Uring;
+        disk.Direct = setups[s].Direct;
+        disk.Blocking = true;
+
+        HiResTimer t;
+        if (!disk.Open(DiskFile))
+            return results;
+        //  Only one row per mechanism actually obtained
+        if (setups[s].Uring && disk.Backend() != DiskLogger::bkUring)
+            {
+            disk.Close();
+            continue;
+            }
+        for (size_t i = 0; i < passes; ++i)
+            disk.Write(&in[i % Buffers][0], in_bytes);
+        disk.Close();
+
+        std::stringstream name;
+        name << "disk " << DiskLogger::Name(disk.Backend()) << (disk.Unbuffered() ? " direct" : " cached");
+        BenchmarkResult r(name.str(), DiskBlockBytes);
+        r.Seconds = t.Elapsed();
+        r.Bytes = static_cast<double>(disk.Written());
+        r.Packets = r.Bytes / DiskBlockBytes;
+        r.Drops = static_cast<double>(disk.Dropped());
+        r.HighWater = disk.HighWater();
+        results.push_back(r);
+        std::remove(DiskFile.c_str());
+        }
+
+    return results;
+}
+
+//---------------------------------------------------------------------------
+//  IngestBenchmark::Compress() --  Lossless stream coding rate and ratio
+//---------------------------------------------------------------------------
+//  TotalBytes of sawtooth (the board's test generator) and of full-scale
+//  noise, the best and worst cases, go through a blocking
+//  CompressedLogger whose sink only counts, first on one thread and then
+//  on CompressThreads; Bytes is raw stream coded.  A "decode" row per
+//  pattern times SampleCodec::DecodeChunk() on one thread over the same
+//  data, coded once up front.  Packets are chunks, or buffers decoded.
+
+BenchmarkResults  IngestBenchmark::Compress()
+{
+    BenchmarkResults results;
+    const size_t Buffers = 8;
+
+    struct Setup
+    {
+        const char *        Name;
+        VitaSynth::IIPattern Pattern;
+    };
+    const Setup setups[] = { { "saw", VitaSynth::pSawtooth }, { "noise", VitaSynth::pNoise } };
+
+    for (size_t s = 0; s < sizeof(setups) / sizeof(setups[0]); ++s)
+        {
+        VitaSynth synth(Channels, PacketSizes.back());
+        synth.Pattern(setups[s].Pattern);
+        std::vector< std::vector<unsigned int> > in(Buffers);
+        for (size_t b = 0; b < Buffers; ++b)
+            synth.Fill(in[b], BufferBytes);
+        const size_t in_bytes = in[0].size() * sizeof(unsigned int);
+        const size_t passes = std::max<size_t>(TotalBytes / in_bytes, 1);
+
+        std::vector<unsigned int> threads(1, 1);
+        if (CompressThreads > 1)
+            threads.push_back(CompressThreads);
+        for (size_t t = 0; t < threads.size(); ++t)
+            {
+            CompressedLogger coder;
+            coder.ChunkBytes = DiskBlockBytes;
+            coder.Threads = threads[t];
+            coder.Blocking = true;
+
+            HiResTimer timer;
+            coder.Open([](const void *, size_t) {  return true;  });
+            for (size_t i = 0; i < passes; ++i)
+                coder.Write(&in[i % Buffers][0], in_bytes);
+            coder.Close();
+
+            std::stringstream name;
+            name << "compress " << setups[s].Name << " x" << threads[t];
+            BenchmarkResult r(name.str(), PacketSizes.back());
+            r.Seconds = timer.Elapsed();
+            r.Bytes = static_cast<double>(coder.Bytes());
+            r.Packets = r.Bytes / coder.ChunkBytes;
+            r.Drops = static_cast<double>(coder.Dropped());
+            r.Ratio = coder.Ratio();
+            results.push_back(r);
+            }
+
+        VitaIndex scratch;
+        std::vector< std::vector<unsigned char> > coded(Buffers);
+        for (size_t b = 0; b < Buffers; ++b)
+            SampleCodec::EncodeChunk(&in[b][0], in_bytes, 1, coded[b], scratch);
+        std::vector<unsigned char> out(in_bytes);
+
+        BenchmarkResult r(std::string("decode ") + setups[s].Name, PacketSizes.back());
+        HiResTimer timer;
+        size_t bad = 0;
+        for (size_t i = 0; i < passes; ++i)
+            {
+            const std::vector<unsigned char> & c = coded[i % Buffers];
+            bad += !SampleCodec::DecodeChunk(&c[0], c.size(), in_bytes, 1, &out[0]);
+            }
+        r.Seconds = timer.Elapsed();
+        r.Bytes = static_cast<double>(passes) * in_bytes;
+        r.Packets = passes;
+        r.Drops = static_cast<double>(bad);
+        Sink += out[0];
+        results.push_back(r);
+        }
+
+    return results;
+}
+
+//---------------------------------------------------------------------------
+//  IngestBenchmark::Pack() --  Packed capture ingest and readout rates
+//---------------------------------------------------------------------------
+//  Per packet size, TotalBytes of 14-bit noise payload is packed at
+//  PackBits into a PackedCapture of CaptureBytes' worth of int16, packet
+//  by packet as a worker would, refilling it from the top as needed.  The
+//  capture is then unpacked whole, on one thread and on CompressThreads.
+//  Bytes are int16 sample bytes either way; drops are clipped samples.
+
+BenchmarkResults  IngestBenchmark::Pack()
+{
+    BenchmarkResults results;
+    const size_t Buffers = 8;
+    const size_t samples = CaptureBytes / sizeof(short);
+
+    PackedCapture capture;
+    if (!capture.Allocate(samples, PackBits))
+        return results;
+
+    for (size_t p = 0; p < PacketSizes.size(); ++p)
+        {
+        VitaSynth synth(1, PacketSizes[p]);
+        synth.Pattern(VitaSynth::pNoise);
+        std::vector< std::vector<unsigned int> > in(Buffers);
+        std::vector<VitaIndex> index(Buffers);
+        for (size_t b = 0; b < Buffers; ++b)
+            {
+            synth.Fill(in[b], BufferBytes);
+            index[b].Scan(&in[b][0], in[b].size());
+            }
+        const size_t passes = std::max<size_t>(TotalBytes / (in[0].size() * sizeof(unsigned int)), 1);
+
+        std::stringstream name;
+        name << "pack " << PackBits;
+        BenchmarkResult r(name.str(), PacketSizes[p]);
+        capture.Reset();
+        size_t clipped = 0;
+        HiResTimer t;
+        for (size_t i = 0; i < passes; ++i)
+            {
+            const std::vector<unsigned int> & buf = in[i % Buffers];
+            const VitaIndex & idx = index[i % Buffers];
+            for (size_t k = 0; k < idx.Size(); ++k)
+                {
+                if (capture.Full())
+                    {
+                    clipped += capture.Clipped();
+                    capture.Reset();
+                    }
+                r.Bytes += capture.Write(&buf[idx[k].Offset + idx[k].PayloadOffset], idx[k].PayloadWords);
+                }
+            r.Packets += static_cast<double>(idx.Size());
+            }
+        r.Seconds = t.Elapsed();
+        r.Drops = static_cast<double>(clipped + capture.Clipped());
+        results.push_back(r);
+        }
+
+    std::vector<short> out(capture.Samples());
+    std::vector<unsigned int> threads(1, 1);
+    if (CompressThreads > 1)
+        threads.push_back(CompressThreads);
+    for (size_t t = 0; t < threads.size() && !out.empty(); ++t)
+        {
+        std::stringstream name;
+        name << "unpack " << PackBits << " x" << threads[t];
+        BenchmarkResult r(name.str(), 0);
+        HiResTimer timer;
+        capture.Unpack(0, out.size(), &out[0], threads[t]);
+        r.Seconds = timer.Elapsed();
+        r.Bytes = static_cast<double>(out.size() * sizeof(short));
+        Sink += out[out.size() / 2];
+        results.push_back(r);
+        }
+
+    return results;
+}
+
+//---------------------------------------------------------------------------
+//  IngestBenchmark::Parse() --  Recorded file to per-stream arrays, every reader
+//---------------------------------------------------------------------------
+//  Per packet size a capture file of ParseBytes is written from seeded
+//  noise, so a given size, packet size and channel count always gives the
+//  same file, with a .vidx sidecar as the disk log writes.  Each way we
+//  have of reading a capture then delivers every stream's samples from it
+//  to the same planar arrays:
+//
+//      read            fread() of the whole file, the ceiling
+//      file vidx       VitaFile indexed from the sidecar, Gather() per stream
+//      file scan       VitaFile indexing its own headers, Gather() per stream
+//      file order      ...then every packet in file order, each to its stream
+//      parse xN        VitaParser on N threads, Open() then Extract()
+//      seek vidx       PacketIndexFile lookups of every packet of a small
+//                      file whose streams end unevenly; Drops are misses
+//      frames vidx     FrameReader extracts at the ends of that file, each
+//                      checked against a scan; Drops are mismatches
+//
+//  The first two are channel major, file order is sample major.  Bytes
+//  are file bytes throughout, so GB/s compare directly; samples/s counts
+//  what was delivered.  The file is in the page cache for all but the
+//  first run.  PeakRss includes the destination arrays, touched
+//  beforehand, so differences are the readers' own mappings and tables.
+
+BenchmarkResults  IngestBenchmark::Parse()
+{
+    BenchmarkResults results;
+    const std::string sidecar = PacketIndexFile::SidecarName(ParseFile);
+
+    for (size_t p = 0; p < PacketSizes.size(); ++p)
+        {
+        VitaSynth synth(Channels, PacketSizes[p]);
+        synth.Pattern(VitaSynth::pNoise);
+        PacketIndexWriter table;
+        table.Direct = false;
+        std::FILE * file = std::fopen(ParseFile.c_str(), "wb");
+        if (!file)
+            return results;
+        if (!table.Open(sidecar))
+            {
+            std::fclose(file);
+            return results;
+            }
+        std::vector<unsigned int> buf;
+        VitaIndex index;
+        unsigned long long written = 0;
+        while (written < ParseBytes)
+            {
+            synth.Fill(buf, BufferBytes);
+            index.Scan(&buf[0], buf.size());
+            table.Append(index, written);
+            written += std::fwrite(&buf[0], sizeof(unsigned int), buf.size(), file) * sizeof(unsigned int);
+            }
+        std::fclose(file);
+        table.Close();
+        const double bytes = static_cast<double>(written);
+        const double packets = static_cast<double>(synth.Packets());
+
+        const size_t capacity = static_cast<size_t>(written / sizeof(short) / std::max(Channels, 1u));
+        std::vector< std::vector<short> > dest(Channels, std::vector<short>(capacity));
+
+        {
+        BenchmarkResult r("read", PacketSizes[p]);
+        std::vector<unsigned char> block(BufferBytes);
+        RssProbe probe;
+        HiResTimer t;
+        file = std::fopen(ParseFile.c_str(), "rb");
+        if (file)
+            {
+            size_t n = 0;
+            while ((n = std::fread(&block[0], 1, block.size(), file)) != 0)
+                Sink += block[n / 2];
+            std::fclose(file);
+            }
+        r.Seconds = t.Elapsed();
+        r.PeakRss = probe.Stop();
+        r.Bytes = bytes;
+        r.Packets = packets;
+        results.push_back(r);
+        }
+
+        //  Channel major, with and then without the sidecar
+        for (int scan = 0; scan < 2; ++scan)
+            {
+            if (scan)
+                std::remove(sidecar.c_str());
+            BenchmarkResult r(scan ? "file scan" : "file vidx", PacketSizes[p]);
+            RssProbe probe;
+            HiResTimer t;
+            VitaFile vita;
+            vita.SampleBytes = sizeof(short);
+            if (vita.Open(ParseFile))
+                for (size_t s = 0; s < vita.Streams() && s < dest.size(); ++s)
+                    r.Samples += static_cast<double>(vita.Gather(s, 0,
+                        static_cast<size_t>(std::min<unsigned long long>(vita.Samples(s), capacity)), &dest[s][0]));
+            r.Seconds = t.Elapsed();
+            r.PeakRss = probe.Stop();
+            r.Bytes = bytes;
+            r.Packets = static_cast<double>(vita.Packets());
+            results.push_back(r);
+            }
+
+        //  Sample major: packets in the order they were recorded
+        {
+        BenchmarkResult r("file order", PacketSizes[p]);
+        RssProbe probe;
+        HiResTimer t;
+        VitaFile vita;
+        vita.SampleBytes = sizeof(short);
+        if (vita.Open(ParseFile))
+            {
+            const unsigned int * words = vita.Words();
+            std::vector<size_t> at(dest.size(), 0);
+            for (size_t k = 0; k < vita.Packets(); ++k)
+                {
+                const VitaPacketInfo & info = vita.Packet(k);
+                const int s = vita.Find(info.Sid);
+                if (s < 0 || static_cast<size_t>(s) >= dest.size())
+                    continue;
+                const size_t n = std::min(info.PayloadWords * sizeof(unsigned int) / sizeof(short), capacity - at[s]);
+                std::memcpy(&dest[s][at[s]], words + info.Offset + info.PayloadOffset, n * sizeof(short));
+                at[s] += n;
+                r.Samples += static_cast<double>(n);
+                }
+            }
+        r.Seconds = t.Elapsed();
+        r.PeakRss = probe.Stop();
+        r.Bytes = bytes;
+        r.Packets = static_cast<double>(vita.Packets());
+        results.push_back(r);
+        }
+
+        std::vector<unsigned int> threads(1, 1);
+        if (ParseThreads > 1)
+            threads.push_back(ParseThreads);
+        for (size_t n = 0; n < threads.size(); ++n)
+            {
+            std::stringstream name;
+            name << "parse x" << threads[n];
+            BenchmarkResult r(name.str(), PacketSizes[p]);
+            RssProbe probe;
+            HiResTimer t;
+            VitaParser parser;
+            parser.Threads = threads[n];
+            parser.SampleBytes = sizeof(short);
+            if (parser.Open(ParseFile))
+                {
+                for (size_t s = 0; s < parser.Streams() && s < dest.size(); ++s)
+                    {
+                    char * lane = reinterpret_cast<char *>(&dest[s][0]);
+                    parser.Route(parser.Sid(s), &lane, capacity);
+                    }
+                r.Samples = static_cast<double>(parser.Extract());
+                }
+            r.Seconds = t.Elapsed();
+            r.PeakRss = probe.Stop();
+            r.Bytes = bytes;
+            r.Packets = static_cast<double>(parser.Packets());
+            results.push_back(r);
+            }
+
+        //  Index lookups where the streams end unevenly: the last stream
+        //  runs on alone after the others stop.  Every packet is looked up
+        //  by its first and last sample, its frame and its timestamp, and
+        //  a miss counts as a drop.
+        {
+        BenchmarkResult r("seek vidx", PacketSizes[p]);
+        VitaSynth seek(Channels, PacketSizes[p]);
+        seek.Pattern(VitaSynth::pNoise);
+        const unsigned int last = seek.FirstSid() + seek.Channels() - 1;
+        PacketIndexWriter table;
+        table.Direct = false;
+        table.FrameSize = 1000;
+        file = std::fopen(ParseFile.c_str(), "wb");
+        if (file && table.Open(sidecar))
+            {
+            written = 0;
+            for (int tail = 0; tail < 2; ++tail)
+                {
+                buf.clear();
+                seek.Generate(buf, SeekPackets * seek.Channels());
+                if (tail)
+                    {
+                    std::vector<unsigned int> alone;
+                    index.Scan(&buf[0], buf.size());
+                    for (size_t k = 0; k < index.Size(); ++k)
+                        if (index[k].Sid == last)
+                            alone.insert(alone.end(), buf.begin() + index[k].Offset,
+                                         buf.begin() + index[k].Offset + index[k].Words);
+                    buf.swap(alone);
+                    }
+                index.Scan(&buf[0], buf.size());
+                table.Append(index, written);
+                written += std::fwrite(&buf[0], sizeof(unsigned int), buf.size(), file) * sizeof(unsigned int);
+                }
+            }
+        if (file)
+            std::fclose(file);
+        table.Close();
+
+        PacketIndexFile vidx;
+        if (vidx.Open(sidecar))
+            {
+            HiResTimer t;
+            const size_t records = vidx.Records();
+            for (unsigned int ch = 0; ch < seek.Channels(); ++ch)
+                {
+                const unsigned int sid = seek.FirstSid() + ch;
+                unsigned long long end = 0;
+                unsigned int frame = ~0u;
+                for (size_t k = vidx.Next(sid, 0); k < records; k = vidx.Next(sid, k + 1))
+                    {
+                    const PacketIndexRecord & rec = vidx[k];
+                    end = rec.Sample + rec.PayloadWords * sizeof(unsigned int) / sizeof(short);
+                    r.Drops += vidx.FindSample(sid, rec.Sample) != k;
+                    r.Drops += vidx.FindSample(sid, end - 1) != k;
+                    r.Drops += vidx.FindTime(sid, rec.TsInt, rec.TsFrac) != k;
+                    if (rec.Frame != frame)
+                        r.Drops += vidx.FindFrame(sid, rec.Frame) != k;
+                    frame = rec.Frame;
+                    r.Packets += 4;
+                    }
+                r.Drops += vidx.FindSample(sid, end) != records;
+                r.Packets += 1;
+                }
+            r.Seconds = t.Elapsed();
+            r.Bytes = static_cast<double>(written);
+            }
+        else
+            r.Drops = 1;
+        results.push_back(r);
+
+        //  The last frames of each stream and of all of them together,
+        //  extracted through the sidecar and checked against a scan
+        {
+        BenchmarkResult x("frames vidx", PacketSizes[p]);
+        const size_t frames = 4;
+        FrameReader reader;
+        VitaFile scan;
+        scan.SampleBytes = sizeof(short);
+        if (reader.Open(ParseFile) && reader.Indexed() && scan.Open(ParseFile))
+            {
+            const size_t frame = reader.Frame();
+            std::vector< std::vector<short> > got(scan.Streams(), std::vector<short>(frames * frame));
+            std::vector<short> want(frames * frame);
+            std::vector<unsigned int> sids;
+            std::vector<void *> out;
+            unsigned long long shortest = ~0ull;
+            HiResTimer t;
+            for (size_t s = 0; s < scan.Streams(); ++s)
+                {
+                const unsigned long long total = scan.Samples(s) / frame;
+                for (unsigned long long first = total > frames ? total - frames : 0; first <= total; ++first)
+                    {
+                    const size_t expect = static_cast<size_t>(std::min<unsigned long long>(frames, total - first));
+                    const size_t copied = reader.Read(scan.Sid(s), first, frames, &got[s][0]);
+                    scan.Gather(s, first * frame, expect * frame, &want[0]);
+                    x.Drops += copied != expect ||
+                               std::memcmp(&got[s][0], &want[0], expect * frame * sizeof(short)) != 0;
+                    x.Packets += 1;
+                    x.Bytes += static_cast<double>(copied * frame * sizeof(short));
+                    }
+                sids.push_back(scan.Sid(s));
+                out.push_back(&got[s][0]);
+                shortest = std::min(shortest, total);
+                }
+            const unsigned long long first = shortest > frames ? shortest - frames / 2 : 0;
+            x.Drops += reader.Read(sids, first, frames, &out[0]) != shortest - first;
+            x.Packets += 1;
+            x.Seconds = t.Elapsed();
+            }
+        else
+            x.Drops = 1;
+        results.push_back(x);
+        }
+
+        std::remove(sidecar.c_str());
+        }
+
+        std::remove(ParseFile.c_str());
+        }
+
+    return results;
+}
+
+//---------------------------------------------------------------------------
+//  IngestBenchmark::Report() --  Format results, one run per line
+//---------------------------------------------------------------------------
+
+std::string  IngestBenchmark::Report(const BenchmarkResults & results)
+{
+    std::stringstream ss;
+    for (size_t i = 0; i < results.size(); ++i)
+        {
+        const BenchmarkResult & r = results[i];
+        ss << std::left << std::setw(20) << r.Name
+           << " pkt " << std::setw(6) << r.PacketBytes
+           << std::fixed << std::setprecision(3)
+           << " " << std::setw(8) << r.GBps() << " GB/s"
+           << std::setprecision(0)
+           << " " << std::setw(10) << r.PacketRate() << " pkt/s";
+        if (r.HighWater || r.Drops)
+            ss << " hwm " << r.HighWater << " drops " << r.Drops;
+        if (r.Ratio)
+            ss << std::setprecision(2) << " ratio " << r.Ratio << "x";
+        if (r.FirstPacket)
+            ss << std::setprecision(1) << " setup " << r.Setup * 1.0e3 << " ms"
+               << " first " << r.FirstPacket * 1.0e6 << " us";
+        if (r.Samples)
+            ss << std::setprecision(1) << " " << r.SampleRate() / 1.0e6 << " MS/s";
+        if (r.PeakRss)
+            ss << std::setprecision(0) << " rss " << r.PeakRss / (1024 * 1024) << " MB";
+        ss << "\n";
+        }
+    return ss.str();
+}
+
+//---------------------------------------------------------------------------
+//  IngestBenchmark::Save() --  Write results as CSV for later comparison
+//---------------------------------------------------------------------------
+//  Rates are written beside the totals they come from, so a script can
+//  compare runs without knowing how they are derived.
+
+bool  IngestBenchmark::Save(const BenchmarkResults & results, const std::string & file)
+{
+    std::stringstream ss;
+    ss << "name,packet_bytes,seconds,bytes,gbps,packets,packets_per_s,samples,samples_per_s,"
+          "peak_rss,drops,high_water,setup,first_packet,ratio\n";
+    ss << std::setprecision(10);
+    for (size_t i = 0; i < results.size(); ++i)
+        {
+        const BenchmarkResult & r = results[i];
+        ss << r.Name << "," << r.PacketBytes << "," << r.Seconds << "," << r.Bytes << "," << r.GBps()
+           << "," << r.Packets << "," << r.PacketRate() << "," << r.Samples << "," << r.SampleRate()
+           << "," << r.PeakRss << "," << r.Drops << "," << r.HighWater << "," << r.Setup
+           << "," << r.FirstPacket << "," << r.Ratio << "\n";
+        }
+
+    std::FILE * out = std::fopen(file.c_str(), "w");
+    if (!out)
+        return false;
+    const std::string text = ss.str();
+    const bool ok = std::fwrite(text.data(), 1, text.size(), out) == text.size();
+    return std::fclose(out) == 0 && ok;
+}
+
+//---------------------------------------------------------------------------
+//  IngestBenchmark::Units() --  Counts to calibrated volts
+//---------------------------------------------------------------------------
+//  Up to 32M int16 noise samples, a typical capture's worth, converted to
+//  single and double by each instruction set's kernel on one thread, then
+//  by SampleScale::Convert() on one thread and on CompressThreads.  Bytes
+//  are int16 sample bytes read.  The first million of each must match the
+//  scalar kernel's bit for bit; those that do not are counted as drops.
+
+BenchmarkResults  IngestBenchmark::Units()
+{
+    BenchmarkResults results;
+    const size_t samples = std::min<size_t>(CaptureBytes / sizeof(short), 32 * 1024 * 1024);
+    if (!samples)
+        return results;
+
+    std::vector<short> in(samples);
+    unsigned int seed = 1;
+    for (size_t i = 0; i < samples; ++i)
+        {
+        seed = seed * 1664525u + 1013904223u;
+        in[i] = static_cast<short>(seed >> 16);
+        }
+    std::vector<float> single(samples);
+    std::vector<double> wide(samples);
+    //  A gain and offset that round, so a fused multiply-add would show
+    const SampleScale scale = SampleScale::Calibrated(1.0123, -3.7, 2.0);
+    const size_t check = std::min<size_t>(samples, 1024 * 1024);
+    std::vector<float> single_ref(check);
+    std::vector<double> wide_ref(check);
+    SampleScale::SingleKernel(::Deinterleave::isScalar)(&in[0], &single_ref[0], check,
+                                                        static_cast<float>(scale.Scale()),
+                                                        static_cast<float>(scale.Bias()));
+    SampleScale::DoubleKernel(::Deinterleave::isScalar)(&in[0], &wide_ref[0], check, scale.Scale(), scale.Bias());
+
+    for (int isa = ::Deinterleave::isScalar; isa <= SampleScale::Supported(); ++isa)
+        for (int w = 0; w < 2; ++w)
+            {
+            const ::Deinterleave::IIIsa level = static_cast< ::Deinterleave::IIIsa >(isa);
+            std::stringstream name;
+            name << "units " << (w ? "f64 " : "f32 ") << ::Deinterleave::Name(level);
+            BenchmarkResult r(name.str(), 0);
+            HiResTimer t;
+            if (w)
+                SampleScale::DoubleKernel(level)(&in[0], &wide[0], samples, scale.Scale(), scale.Bias());
+            else
+                SampleScale::SingleKernel(level)(&in[0], &single[0], samples, static_cast<float>(scale.Scale()),
+                                                 static_cast<float>(scale.Bias()));
+            r.Seconds = t.Elapsed();
+            r.Bytes = static_cast<double>(samples * sizeof(short));
+            r.Samples = static_cast<double>(samples);
+            for (size_t i = 0; i < check; ++i)
+                r.Drops += w ? std::memcmp(&wide[i], &wide_ref[i], sizeof(double)) != 0
+                             : std::memcmp(&single[i], &single_ref[i], sizeof(float)) != 0;
+            Sink += (w ? wide[samples / 2] : single[samples / 2]) > 0.0;
+            results.push_back(r);
+            }
+
+    std::vector<unsigned int> threads(1, 1);
+    if (CompressThreads > 1)
+        threads.push_back(CompressThreads);
+    for (size_t t = 0; t < threads.size(); ++t)
+        for (int w = 0; w < 2; ++w)
+            {
+            std::stringstream name;
+            name << "units " << (w ? "f64" : "f32") << " x" << threads[t];
+            BenchmarkResult r(name.str(), 0);
+            HiResTimer timer;
+            if (w)
+                scale.Convert(&in[0], &wide[0], samples, threads[t]);
+            else
+                scale.Convert(&in[0], &single[0], samples, threads[t]);
+            r.Seconds = timer.Elapsed();
+            r.Bytes = static_cast<double>(samples * sizeof(short));
+            r.Samples = static_cast<double>(samples);
+            for (size_t i = 0; i < check; ++i)
+                r.Drops += w ? std::memcmp(&wide[i], &wide_ref[i], sizeof(double)) != 0
+                             : std::memcmp(&single[i], &single_ref[i], sizeof(float)) != 0;
+            Sink += (w ? wide[samples / 2] : single[samples / 2]) > 0.0;
+            results.push_back(r);
+            }
+
+    return results;
+}
@@ -0,0 +1,93 @@
+// IngestBenchmark.h
+//
+// Board-free benchmarks of the ingest path using synthetic VITA buffers
+
+#ifndef IngestBenchmarkH
+#define IngestBenchmarkH
+
+#include <string>
+#include <vector>
+#include <cstddef>
+
+//===========================================================================
+//  STRUCT BenchmarkResult  -- One timed run
+//===========================================================================
+
+struct BenchmarkResult
+{
+    BenchmarkResult(const std::string & name = "", size_t packet_bytes = 0)
+        : Name(name), PacketBytes(packet_bytes), Seconds(0.0), Bytes(0.0), Packets(0.0),
+          Drops(0.0), HighWater(0.0), Setup(0.0), FirstPacket(0.0), Ratio(0.0),
+          Samples(0.0), PeakRss(0.0)
+        {}
+
+    std::string     Name;
+    size_t          PacketBytes;
+    double          Seconds;
+    double          Bytes;          // Payload bytes moved
+    double          Packets;
+    double          Drops;          // Buffers lost to full queues
+    double          HighWater;      // Deepest queue seen
+    double          Setup;          // Seconds to allocate and prepare memory
+    double          FirstPacket;    // Seconds to land the first packet
+    double          Ratio;          // Compression achieved, raw to coded
+    double          Samples;        // Stream samples delivered, all lanes
+    double          PeakRss;        // Most bytes resident during the run
+
+    double  GBps() const
+        {  return Seconds > 0.0 ? Bytes / Seconds / 1.0e9 : 0.0;  }
+    double  PacketRate() const
+        {  return Seconds > 0.0 ? Packets / Seconds : 0.0;  }
+    double  SampleRate() const
+        {  return Seconds > 0.0 ? Samples / Seconds : 0.0;  }
+};
+
+typedef std::vector<BenchmarkResult>    BenchmarkResults;
+
+//===========================================================================
+//  CLASS IngestBenchmark  -- Synthetic ingest benchmarks
+//===========================================================================
+
+class IngestBenchmark
+{
+public:
+    enum IIMode { bmDemux, bmQueue, bmMemory, bmIndex, bmDeinterleave, bmReplay, bmDisk, bmCompress, bmPack, bmParse,
+                  bmUnits };
+
+    IngestBenchmark();
+
+    //  Config
+    unsigned int    Channels;
+    size_t          BufferBytes;        // Size of each synthetic VeloBuffer
+    size_t          TotalBytes;         // Bytes pushed through per run
+    size_t          CaptureBytes;       // Capture block size for Memory()
+    std::vector<size_t> PacketSizes;    // Packet payload sizes to sweep
+    std::string     ReplayFile;         // Scratch stream file for Replay()
+    std::string     DiskFile;           // Scratch file for Disk()
+    size_t          DiskBlockBytes;     // DiskLogger write size
+    unsigned int    DiskDepth;          // ...and writes in flight
+    unsigned int    CompressThreads;    // Widest CompressedLogger pool tried
+    unsigned int    PackBits;           // ADC width for Pack()
+    std::string     ParseFile;          // Scratch capture file for Parse()
+    size_t          ParseBytes;         // ...and its size
+    unsigned int    ParseThreads;       // Widest VitaParser tried
+
+    BenchmarkResults  Run(IIMode mode);
+    BenchmarkResults  Demux();
+    BenchmarkResults  Queue();
+    BenchmarkResults  Memory();
+    BenchmarkResults  Index();
+    BenchmarkResults  Deinterleave();
+    BenchmarkResults  Replay();
+    BenchmarkResults  Disk();
+    BenchmarkResults  Compress();
+    BenchmarkResults  Pack();
+    BenchmarkResults  Parse();
+    BenchmarkResults  Units();
+
+    static std::string  Report(const BenchmarkResults & results);
+    //  Comma separated, a header line then one run per line
+    static bool  Save(const BenchmarkResults & results, const std::string & file);
+};
+
+#endif
@@ -0,0 +1,212 @@
+// IngestPipeline.h
+//
+// Packet hand-off from the stream callback to ingest worker threads
+
+#ifndef IngestPipelineH
+#define IngestPipelineH
+
+#include "PacketQueue.h"
+#include "LatencyHistogram.h"
+#include "HiResTimer.h"
+#include <vector>
+#include <thread>
+#include <memory>
+#include <atomic>
+#include <mutex>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <algorithm>
+
+//===========================================================================
+//  CLASS IngestPipeline  -- Fan packets out to worker threads
+//===========================================================================
+//  The producer (driver callback or a software packet source) calls Push()
+//  and returns immediately.  Every worker owns an SPSC queue and sees every
+//  packet, so work is split by stream rather than by packet and per-stream
+//  ordering is preserved.  A packet goes to every queue or to none, so the
+//  streams of a dropped buffer are lost together.  T should be a cheap
+//  handle (e.g. shared_ptr).  Packets are stamped on Push() so the time
+//  spent queued can be recorded.
+
+template <typename T>
+class IngestPipeline
+{
+public:
+    typedef std::function<void (T & packet, unsigned int worker)>  Handler;
+
+    IngestPipeline()
+        : Quit(false), FRunning(false), Waits(0), FDrops(0), Blocked(false)
+        {}
+    ~IngestPipeline()
+        {  Stop();  }
+
+    //  Start 'workers' threads, each with a queue 'depth' packets deep
+    void  Start(unsigned int workers, size_t depth, Handler handler)
+        {
+        Stop();
+        if (!workers)
+            workers = 1;
+        Process = handler;
+        Quit = false;
+        FDrops = 0;
+        Queues.clear();
+        Completed.reset(new std::atomic<unsigned long long>[workers]);
+        for (unsigned int i = 0; i < workers; ++i)
+            {
+            Queues.push_back(std::unique_ptr< PacketQueue<Stamped> >(new PacketQueue<Stamped>(depth)));
+            Completed[i] = 0;
+            }
+        for (unsigned int i = 0; i < workers; ++i)
+            Threads.push_back(std::thread(&IngestPipeline::Execute, this, i));
+        FRunning = true;
+        }
+
+    //  Finish queued packets, then join workers
+    void  Stop()
+        {
+        if (!FRunning)
+            return;
+        Drain();
+        Quit = true;
+        for (size_t i = 0; i < Queues.size(); ++i)
+            Queues[i]->Wake();
+        for (size_t i = 0; i < Threads.size(); ++i)
+            Threads[i].join();
+        Threads.clear();
+        FRunning = false;
+        }
+
+    //  Producer: hand a packet to every worker.  If any queue is full it
+    //  goes to none, counted once in Drops() and by each full queue.
+    bool  Push(const T & packet)
+        {
+        if (!FRunning)
+            return false;
+        bool room = true;
+        for (size_t i = 0; i < Queues.size(); ++i)
+            if (Queues[i]->Depth() >= Queues[i]->Capacity())
+                {
+                Queues[i]->Refuse();
+                room = false;
+                }
+        if (!room)
+            {
+            FDrops.fetch_add(1, std::memory_order_relaxed);
+            return false;
+            }
+
+        //  Only this thread fills the queues, so the room is still there
+        Stamped item;
+        item.Packet = packet;
+        item.Ticks = HiResTimer::Ticks();
+        for (size_t i = 0; i < Queues.size(); ++i)
+            Queues[i]->Push(item);
+        return true;
+        }
+
+    //  Free slots in the fullest queue -- lets a paced source avoid drops
+    size_t  Room() const
+        {
+        size_t room = Queues.empty() ? 0 : Queues[0]->Capacity();
+        for (size_t i = 0; i < Queues.size(); ++i)
+            room = std::min(room, Queues[i]->Capacity() - Queues[i]->Depth());
+        return room;
+        }
+
+    //  Producer: sleep up to 'ms' until Room() is nonzero, for a source that
+    //  must not drop.  Workers take the lock only while it is asleep, with
+    //  the same fence pairing as PacketQueue::Wait().
+    bool  WaitRoom(unsigned int ms)
+        {
+        if (Room())
+            return true;
+        std::unique_lock<std::mutex> lock(SpaceLock);
+        Blocked.store(true, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        const bool room = Space.wait_for(lock, std::chrono::milliseconds(ms), [this]() {  return Room() != 0;  });
+        Blocked.store(false, std::memory_order_relaxed);
+        return room;
+        }
+
+    //  Block until every packet pushed so far has been processed
+    void  Drain()
+        {
+        for (size_t i = 0; i < Queues.size(); ++i)
+            while (Completed[i].load() < Queues[i]->Pushed())
+                std::this_thread::yield();
+        }
+
+    //  Status
+    bool  Running() const
+        {  return FRunning;  }
+    unsigned int  Workers() const
+        {  return static_cast<unsigned int>(Queues.size());  }
+    QueueStatus  Status(unsigned int worker) const
+        {  return Queues[worker]->Status();  }
+    unsigned long long  Drops() const           // Packets no worker got
+        {  return FDrops.load(std::memory_order_relaxed);  }
+    void  ResetStats()
+        {
+        for (size_t i = 0; i < Queues.size(); ++i)
+            Queues[i]->ResetStats();
+        FDrops = 0;
+        }
+    //  Record each packet's queued time, in ns, into 'waits' (0 = off)
+    void  WaitHistogram(LatencyHistogram * waits)
+        {  Waits = waits;  }
+
+private:
+    struct Stamped
+    {
+        Stamped() : Ticks(0)  {}
+        T           Packet;
+        long long   Ticks;
+    };
+
+    std::vector< std::unique_ptr< PacketQueue<Stamped> > >  Queues;
+    std::unique_ptr< std::atomic<unsigned long long>[] > Completed;
+    std::vector<std::thread>    Threads;
+    Handler                     Process;
+    std::atomic<bool>           Quit;
+    bool                        FRunning;
+    LatencyHistogram *          Waits;
+    std::atomic<unsigned long long> FDrops;
+
+    std::mutex                  SpaceLock;
+    std::condition_variable     Space;
+    std::atomic<bool>           Blocked;
+
+    void  Execute(unsigned int idx)
+        {
+        PacketQueue<Stamped> & q = *Queues[idx];
+        Stamped item;
+        for (;;)
+            {
+            if (q.Wait(item, 10))
+                {
+                std::atomic_thread_fence(std::memory_order_seq_cst);
+                if (Blocked.load(std::memory_order_relaxed))
+                    {
+                    std::lock_guard<std::mutex> lock(SpaceLock);
+                    Space.notify_one();
+                    }
+                if (Waits)
+                    {
+                    const long long queued = HiResTimer::Ticks() - item.Ticks;
+                    Waits->Record(static_cast<unsigned long long>(HiResTimer::ToSeconds(queued > 0 ? queued : 0) * 1.0e9));
+                    }
+                Process(item.Packet, idx);
+                item = Stamped();
+                Completed[idx].fetch_add(1);
+                }
+            else if (Quit)
+                break;
+            }
+        }
+
+    IngestPipeline(const IngestPipeline &);
+    IngestPipeline & operator=(const IngestPipeline &);
+};
+
+#endif
@@ -0,0 +1,46 @@
+// IngestStats.cpp
+//
+// Always-on timing and size instrumentation of the ingest path
+
+#include "IngestStats.h"
+
+//===========================================================================
+//  CLASS IngestStats  -- Histograms kept while streaming
+//===========================================================================
+//---------------------------------------------------------------------------
+//  constructor for class IngestStats
+//---------------------------------------------------------------------------
+
+IngestStats::IngestStats()
+    : Origin(HiResTimer::Ticks()), LastArrival(0)
+{
+}
+
+//---------------------------------------------------------------------------
+//  IngestStats::Reset() --  Start a new measurement interval
+//---------------------------------------------------------------------------
+
+void  IngestStats::Reset()
+{
+    InterArrival.Reset();
+    Channelize.Reset();
+    PacketRoute.Reset();
+    QueueWait.Reset();
+    BufferBytes.Reset();
+    PacketBytes.Reset();
+    DiskWrite.Reset();
+    Origin.store(HiResTimer::Ticks());
+    LastArrival.store(0);
+}
+
+//---------------------------------------------------------------------------
+//  IngestStats::Arrived() --  Note a stream callback
+//---------------------------------------------------------------------------
+
+void  IngestStats::Arrived()
+{
+    const long long now = HiResTimer::Ticks();
+    const long long last = LastArrival.exchange(now);
+    if (last)
+        InterArrival.Record(Nanoseconds(now - last));
+}
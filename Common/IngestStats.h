@@ -0,0 +1,45 @@
+// IngestStats.h
+//
+// Always-on timing and size instrumentation of the ingest path
+
+#ifndef IngestStatsH
+#define IngestStatsH
+
+#include "LatencyHistogram.h"
+#include "HiResTimer.h"
+#include <atomic>
+
+//===========================================================================
+//  CLASS IngestStats  -- Histograms kept while streaming
+//===========================================================================
+//  Times are recorded in nanoseconds.  Arrived() belongs to the stream
+//  callback thread; the histograms themselves may be fed from any thread,
+//  and Reset() may be called from any thread while they are.
+
+class IngestStats
+{
+public:
+    IngestStats();
+
+    LatencyHistogram    InterArrival;   // Between stream callbacks
+    LatencyHistogram    Channelize;     // Demultiplexing one buffer on a worker
+    LatencyHistogram    PacketRoute;    // ...one packet of it
+    LatencyHistogram    QueueWait;      // Push to worker pickup
+    LatencyHistogram    BufferBytes;    // Size of each buffer delivered to the workers
+    LatencyHistogram    PacketBytes;    // ...and of each packet stored
+    LatencyHistogram    DiskWrite;      // One disk log block, submit to completion
+
+    void  Reset();
+    void  Arrived();
+    double  Seconds() const
+        {  return HiResTimer::ToSeconds(HiResTimer::Ticks() - Origin.load());  }
+
+    static unsigned long long  Nanoseconds(long long ticks)
+        {  return ticks > 0 ? static_cast<unsigned long long>(HiResTimer::ToSeconds(ticks) * 1.0e9) : 0;  }
+
+private:
+    std::atomic<long long>  Origin;
+    std::atomic<long long>  LastArrival;
+};
+
+#endif
@@ -0,0 +1,73 @@
+// LatencyHistogram.cpp
+//
+// Lock-free log-linear histogram for always-on latency and size tracking
+
+#include "LatencyHistogram.h"
+
+//===========================================================================
+//  CLASS LatencyHistogram  -- HDR-style histogram of unsigned values
+//===========================================================================
+//---------------------------------------------------------------------------
+//  constructor for class LatencyHistogram
+//---------------------------------------------------------------------------
+
+LatencyHistogram::LatencyHistogram()
+{
+    Reset();
+}
+
+//---------------------------------------------------------------------------
+//  LatencyHistogram::Reset() --  Discard all samples
+//---------------------------------------------------------------------------
+
+void  LatencyHistogram::Reset()
+{
+    for (size_t i = 0; i < Buckets; ++i)
+        Counts[i].store(0, std::memory_order_relaxed);
+    FCount.store(0, std::memory_order_relaxed);
+    FSum.store(0, std::memory_order_relaxed);
+    FMin.store(~0ULL, std::memory_order_relaxed);
+    FMax.store(0, std::memory_order_relaxed);
+}
+
+//---------------------------------------------------------------------------
+//  LatencyHistogram::UpperBound() --  Largest value held by a bucket
+//---------------------------------------------------------------------------
+
+unsigned long long  LatencyHistogram::UpperBound(size_t index)
+{
+    if (index < 2 * SubCount)
+        return index;
+    const unsigned int msb = static_cast<unsigned int>(index / SubCount) + SubBits - 1;
+    const unsigned long long sub = index % SubCount + SubCount;
+    return ((sub + 1) << (msb - SubBits)) - 1;
+}
+
+//---------------------------------------------------------------------------
+//  LatencyHistogram::Percentile() --  Value below which 'pct' % of samples fall
+//---------------------------------------------------------------------------
+
+unsigned long long  LatencyHistogram::Percentile(double pct) const
+{
+    const unsigned long long total = Count();
+    if (!total)
+        return 0;
+
+    unsigned long long want = static_cast<unsigned long long>(pct / 100.0 * total + 0.5);
+    if (want < 1)
+        want = 1;
+
+    unsigned long long seen = 0;
+    for (size_t i = 0; i < Buckets; ++i)
+        {
+        seen += Counts[i].load(std::memory_order_relaxed);
+        if (seen >= want)
+            {
+            //  Never report past the largest value actually seen
+            const unsigned long long bound = UpperBound(i);
+            const unsigned long long top = Max();
+            return bound < top ? bound : top;
+            }
+        }
+    return Max();
+}
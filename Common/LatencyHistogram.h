@@ -0,0 +1,94 @@
+// LatencyHistogram.h
+//
+// Lock-free log-linear histogram for always-on latency and size tracking
+
+#ifndef LatencyHistogramH
+#define LatencyHistogramH
+
+#include <atomic>
+#include <cstddef>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+//===========================================================================
+//  CLASS LatencyHistogram  -- HDR-style histogram of unsigned values
+//===========================================================================
+//  Each power of two is split into 32 linear sub-buckets, so any value is
+//  held to within about 3% over the full 64-bit range in a fixed 15 KB
+//  table.  Record() is a few relaxed atomic adds and may be called from
+//  any number of threads; readers see a consistent enough picture for
+//  percentiles without stopping the writers.
+
+class LatencyHistogram
+{
+public:
+    enum { SubBits = 5, SubCount = 1 << SubBits, Buckets = (64 - SubBits + 1) * SubCount };
+
+    LatencyHistogram();
+
+    void  Record(unsigned long long value)
+        {
+        Counts[Index(value)].fetch_add(1, std::memory_order_relaxed);
+        FCount.fetch_add(1, std::memory_order_relaxed);
+        FSum.fetch_add(value, std::memory_order_relaxed);
+        unsigned long long m = FMin.load(std::memory_order_relaxed);
+        while (value < m && !FMin.compare_exchange_weak(m, value, std::memory_order_relaxed))
+            ;
+        m = FMax.load(std::memory_order_relaxed);
+        while (value > m && !FMax.compare_exchange_weak(m, value, std::memory_order_relaxed))
+            ;
+        }
+    void  Reset();
+
+    unsigned long long  Count() const
+        {  return FCount.load(std::memory_order_relaxed);  }
+    unsigned long long  Sum() const
+        {  return FSum.load(std::memory_order_relaxed);  }
+    unsigned long long  Min() const
+        {  return Count() ? FMin.load(std::memory_order_relaxed) : 0;  }
+    unsigned long long  Max() const
+        {  return FMax.load(std::memory_order_relaxed);  }
+    double  Mean() const
+        {  return Count() ? static_cast<double>(Sum()) / Count() : 0.0;  }
+    //  Smallest bucket bound at or above 'pct' percent of the samples
+    unsigned long long  Percentile(double pct) const;
+
+    static size_t  Index(unsigned long long value)
+        {
+        if (value < 2 * SubCount)
+            return static_cast<size_t>(value);
+        const unsigned int msb = Msb(value);
+        const size_t sub = static_cast<size_t>(value >> (msb - SubBits));
+        return (msb - SubBits + 1) * SubCount + (sub - SubCount);
+        }
+    static unsigned long long  UpperBound(size_t index);
+
+private:
+    std::atomic<unsigned long long>     Counts[Buckets];
+    std::atomic<unsigned long long>     FCount;
+    std::atomic<unsigned long long>     FSum;
+    std::atomic<unsigned long long>     FMin;
+    std::atomic<unsigned long long>     FMax;
+
+    static unsigned int  Msb(unsigned long long value)
+        {
+#if defined(_MSC_VER) && defined(_M_X64)
+        unsigned long idx;
+        _BitScanReverse64(&idx, value);
+        return idx;
+#elif defined(__GNUC__)
+        return 63 - __builtin_clzll(value);
+#else
+        unsigned int idx = 0;
+        while (value >>= 1)
+            ++idx;
+        return idx;
+#endif
+        }
+
+    LatencyHistogram(const LatencyHistogram &);
+    LatencyHistogram & operator=(const LatencyHistogram &);
+};
+
+#endif
@@ -0,0 +1,150 @@
+// MappedFile.cpp
+//
+// Whole file mapped read-only
+
+#include "MappedFile.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <cstdint>
+#endif
+
+//===========================================================================
+//  CLASS MappedFile  -- Read-only view of a file in the page cache
+//===========================================================================
+//---------------------------------------------------------------------------
+//  constructor for class MappedFile
+//---------------------------------------------------------------------------
+
+MappedFile::MappedFile()
+    : Base(0), File(0), Mapping(0), FBytes(0)
+{
+}
+
+//---------------------------------------------------------------------------
+//  destructor for class MappedFile
+//---------------------------------------------------------------------------
+
+MappedFile::~MappedFile()
+{
+    Close();
+}
+
+//---------------------------------------------------------------------------
+//  MappedFile::Open() --  Map the whole file read-only
+//---------------------------------------------------------------------------
+
+bool  MappedFile::Open(const std::string & file)
+{
+    Close();
+    FError.clear();
+
+#ifdef _WIN32
+    HANDLE handle = CreateFileA(file.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, 0,
+                                OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, 0);
+    if (handle == INVALID_HANDLE_VALUE)
+        {
+        FError = "cannot open";
+        return false;
+        }
+    File = handle;
+
+    LARGE_INTEGER size;
+    size.QuadPart = 0;
+    if (!GetFileSizeEx(handle, &size) || !size.QuadPart)
+        {
+        FError = size.QuadPart ? "cannot size" : "empty file";
+        Close();
+        return false;
+        }
+    FBytes = static_cast<unsigned long long>(size.QuadPart);
+    if (FBytes != static_cast<size_t>(FBytes))
+        {
+        FError = "too large to map in a 32-bit process";
+        Close();
+        return false;
+        }
+
+    Mapping = CreateFileMappingA(handle, 0, PAGE_READONLY, 0, 0, 0);
+    if (Mapping)
+        Base = static_cast<const unsigned char *>(MapViewOfFile(Mapping, FILE_MAP_READ, 0, 0, 0));
+#else
+    const int fd = open(file.c_str(), O_RDONLY);
+    if (fd < 0)
+        {
+        FError = "cannot open";
+        return false;
+        }
+    File = reinterpret_cast<void *>(static_cast<intptr_t>(fd) + 1);     // 0 means closed
+
+    struct stat st;
+    const bool sized = fstat(fd, &st) == 0;
+    if (!sized || st.st_size <= 0)
+        {
+        FError = sized ? "empty file" : "cannot size";
+        Close();
+        return false;
+        }
+    FBytes = static_cast<unsigned long long>(st.st_size);
+    if (FBytes != static_cast<size_t>(FBytes))
+        {
+        FError = "too large to map in a 32-bit process";
+        Close();
+        return false;
+        }
+
+    void * base = mmap(0, static_cast<size_t>(FBytes), PROT_READ, MAP_SHARED, fd, 0);
+    if (base != MAP_FAILED)
+        Base = static_cast<const unsigned char *>(base);
+#endif
+
+    if (!Base)
+        {
+        FError = "cannot map";
+        Close();
+        return false;
+        }
+    return true;
+}
+
+//---------------------------------------------------------------------------
+//  MappedFile::Close() --  Unmap and close
+//---------------------------------------------------------------------------
+
+void  MappedFile::Close()
+{
+#ifdef _WIN32
+    if (Base)
+        UnmapViewOfFile(Base);
+    if (Mapping)
+        CloseHandle(Mapping);
+    if (File)
+        CloseHandle(File);
+#else
+    if (Base)
+        munmap(const_cast<unsigned char *>(Base), static_cast<size_t>(FBytes));
+    if (File)
+        close(static_cast<int>(reinterpret_cast<intptr_t>(File) - 1));
+#endif
+    Base = 0;
+    Mapping = 0;
+    File = 0;
+    FBytes = 0;
+}
+
+//---------------------------------------------------------------------------
+//  MappedFile::Sequential() --  Read-ahead hint for a front to back pass
+//---------------------------------------------------------------------------
+
+void  MappedFile::Sequential() const
+{
+#ifndef _WIN32
+    if (Base)
+        madvise(const_cast<unsigned char *>(Base), static_cast<size_t>(FBytes), MADV_SEQUENTIAL);
+#endif
+}
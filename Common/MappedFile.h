@@ -0,0 +1,52 @@
+// MappedFile.h
+//
+// Whole file mapped read-only
+
+#ifndef MappedFileH
+#define MappedFileH
+
+#include <string>
+#include <cstddef>
+
+//===========================================================================
+//  CLASS MappedFile  -- Read-only view of a file in the page cache
+//===========================================================================
+//  Maps the whole file at once; pages come in as they are first read.  A
+//  64-bit build is needed to map files over 2 GB.
+
+class MappedFile
+{
+public:
+    MappedFile();
+    ~MappedFile();
+
+    bool  Open(const std::string & file);
+    void  Close();
+    bool  IsOpen() const
+        {  return Base != 0;  }
+    //  Hint the kernel that reads will run front to back
+    void  Sequential() const;
+
+    const unsigned char *  Data() const
+        {  return Base;  }
+    template <typename T>
+    const T *  As() const
+        {  return reinterpret_cast<const T *>(Base);  }
+    unsigned long long  Bytes() const
+        {  return FBytes;  }
+    //  Why Open() failed
+    const std::string &  Error() const
+        {  return FError;  }
+
+private:
+    const unsigned char *   Base;
+    void *                  File;           // Platform handles
+    void *                  Mapping;
+    unsigned long long      FBytes;
+    std::string             FError;
+
+    MappedFile(const MappedFile &);
+    MappedFile & operator=(const MappedFile &);
+};
+
+#endif
@@ -328,6 +328,9 @@ void  ModuleIo::HandleTriggerAlert(Innovative::AlertSignalEvent & event)
         << " Type: " <<  triggerType
         << " after " << std::dec << Elapsed(event.TimeStamp);
     Log(msg.str());
+
+    if (event.Argument & 0x1)
+        OnInputTrigger.Execute(event);
 }
 
 //------------------------------------------------------------------------------
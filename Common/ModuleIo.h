@@ -27,6 +27,8 @@ inline int    AnalogInAlerts()
           {  return 6;  }
 inline float  MaxInRateMHz()
           {  return 1000.0;  }     // In MHz
+inline unsigned int AnalogInSid(unsigned int ch)
+          {  return 0x100 + ch;  } // VITA stream ID of input channel
 
 //
 //   Analog Out Info
@@ -81,6 +83,7 @@ public:
             {   return &Module;  }
 
     OpenWire::ThunkedEventHandler<Innovative::ProcessStatusEvent>  OnLog;
+    OpenWire::ThunkedEventHandler<Innovative::AlertSignalEvent>   OnInputTrigger;
 
     //
     //  App System Methods
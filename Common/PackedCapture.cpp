@@ -0,0 +1,64 @@
+// PackedCapture.cpp
+//
+// Channel capture stored at the ADC's bit width
+
+#include "PackedCapture.h"
+#include "ParallelSplit.h"
+#include <algorithm>
+
+//===========================================================================
+//  CLASS PackedCapture  -- Fill mode destination holding packed samples
+//===========================================================================
+//---------------------------------------------------------------------------
+//  constructor for class PackedCapture
+//---------------------------------------------------------------------------
+
+PackedCapture::PackedCapture()
+    : FBits(16), FCapacity(0), FSamples(0), FClipped(0)
+{
+}
+
+//---------------------------------------------------------------------------
+//  PackedCapture::Allocate() --  Room for 'samples' at 'bits' each
+//---------------------------------------------------------------------------
+
+bool  PackedCapture::Allocate(size_t samples, unsigned int bits, const CapturePolicy & policy)
+{
+    FBits = std::min(std::max(bits, 1u), 16u);
+    FCapacity = 0;
+    Reset();
+    if (!Block.Allocate(BitPack::Bytes(samples, FBits) + BitPack::Padding, policy))
+        return false;
+    FCapacity = samples;
+    return true;
+}
+
+//---------------------------------------------------------------------------
+//  PackedCapture::Write() --  Pack one packet's payload
+//---------------------------------------------------------------------------
+
+size_t  PackedCapture::Write(const unsigned int * payload, size_t words)
+{
+    const size_t samples = std::min(words * sizeof(unsigned int) / sizeof(short), FCapacity - FSamples);
+    FClipped += BitPack::Pack(reinterpret_cast<const short *>(payload), samples, FBits,
+                              Block.As<unsigned char>(), FSamples);
+    FSamples += samples;
+    return samples * sizeof(short);
+}
+
+//---------------------------------------------------------------------------
+//  PackedCapture::Unpack() --  A range of samples back to int16
+//---------------------------------------------------------------------------
+//  threads = 0 uses every core.  ParallelSplit() starts pieces on
+//  multiples of eight samples, so each thread runs whole groups.
+
+void  PackedCapture::Unpack(size_t first, size_t count, short * out, unsigned int threads) const
+{
+    count = first < FSamples ? std::min(count, FSamples - first) : 0;
+    const unsigned char * data = Block.As<unsigned char>();
+    const unsigned int bits = FBits;
+    ParallelSplit(count, threads, [=](size_t at, size_t n)
+        {
+        BitPack::Unpack(data, first + at, n, bits, out + at);
+        });
+}
@@ -0,0 +1,65 @@
+// PackedCapture.h
+//
+// Channel capture stored at the ADC's bit width
+
+#ifndef PackedCaptureH
+#define PackedCaptureH
+
+#include "StreamSink.h"
+#include "CaptureMemory.h"
+#include "BitPack.h"
+
+//===========================================================================
+//  CLASS PackedCapture  -- Fill mode destination holding packed samples
+//===========================================================================
+//  Stands in for a channel's int16 buffer when the ADC delivers fewer
+//  significant bits: the owning ingest worker packs each payload straight
+//  from the packet through BitPack, so a 14-bit channel fits 8/7 as many
+//  samples in the same memory, a 12-bit one 4/3.  Samples are expected
+//  right justified and sign extended, as the board delivers them; any
+//  that do not fit are saturated and counted in Clipped().
+//
+//  Unpack() turns any range back into int16, split across threads for
+//  large ranges, for export and for readers after the run.
+
+class PackedCapture : public IStreamSink
+{
+public:
+    PackedCapture();
+
+    bool  Allocate(size_t samples, unsigned int bits, const CapturePolicy & policy = CapturePolicy());
+    void  Reset()
+        {  FSamples = 0;  FClipped = 0;  }
+
+    //  IStreamSink -- writer side, single thread
+    size_t  Write(const unsigned int * payload, size_t words);
+    bool    Full() const
+        {  return FSamples >= FCapacity;  }
+
+    //  Readers, once the writer has stopped
+    void  Unpack(size_t first, size_t count, short * out, unsigned int threads = 0) const;
+
+    //  Status
+    unsigned int  Bits() const
+        {  return FBits;  }
+    size_t  Capacity() const
+        {  return FCapacity;  }
+    size_t  Samples() const
+        {  return FSamples;  }
+    size_t  Clipped() const
+        {  return FClipped;  }
+    const CaptureMemory &  Memory() const
+        {  return Block;  }
+
+private:
+    CaptureMemory   Block;
+    unsigned int    FBits;
+    size_t          FCapacity;
+    size_t          FSamples;
+    size_t          FClipped;
+
+    PackedCapture(const PackedCapture &);
+    PackedCapture & operator=(const PackedCapture &);
+};
+
+#endif
@@ -0,0 +1,281 @@
+// PacketIndex.cpp
+//
+// Packet index sidecar (.vidx) of a recorded VITA stream file
+
+#include "PacketIndex.h"
+#include <algorithm>
+#include <cstring>
+
+namespace
+{
+    const char Magic[] = "IIPKTIDX";
+
+    //  Bisect one stream's records, 'stream' holding their places in the
+    //  table, for the first that has 'reached' the target
+    template <typename Reached>
+    size_t  Search(const PacketIndexFile & file, const std::vector<size_t> & stream, Reached reached)
+    {
+        size_t lo = 0;
+        size_t hi = stream.size();
+        while (lo < hi)
+            {
+            const size_t mid = lo + (hi - lo) / 2;
+            if (reached(file[stream[mid]]))
+                hi = mid;
+            else
+                lo = mid + 1;
+            }
+        return lo < stream.size() ? stream[lo] : file.Records();
+    }
+
+    struct FrameReached
+    {
+        unsigned int Frame;
+        bool  operator()(const PacketIndexRecord & rec) const
+            {  return rec.Frame >= Frame;  }
+    };
+
+    struct SampleReached
+    {
+        unsigned long long Sample;
+        unsigned int SampleBytes;
+        bool  operator()(const PacketIndexRecord & rec) const
+            {  return rec.Sample + rec.PayloadWords * sizeof(unsigned int) / SampleBytes > Sample;  }
+    };
+
+    struct TimeReached
+    {
+        unsigned int Int;
+        unsigned long long Frac;
+        bool  operator()(const PacketIndexRecord & rec) const
+            {  return rec.TsInt > Int || (rec.TsInt == Int && rec.TsFrac >= Frac);  }
+    };
+}
+
+//===========================================================================
+//  CLASS PacketIndexWriter  -- Build a .vidx while the stream is logged
+//===========================================================================
+//---------------------------------------------------------------------------
+//  constructor for class PacketIndexWriter
+//---------------------------------------------------------------------------
+
+PacketIndexWriter::PacketIndexWriter()
+    : FrameSize(0), SampleBytes(sizeof(short)), SampleRate(0), BlockBytes(256 * 1024), Depth(2),
+      Direct(true), FRecords(0), FDropped(0)
+{
+}
+
+//---------------------------------------------------------------------------
+//  destructor for class PacketIndexWriter
+//---------------------------------------------------------------------------
+
+PacketIndexWriter::~PacketIndexWriter()
+{
+    Close();
+}
+
+//---------------------------------------------------------------------------
+//  PacketIndexWriter::Open() --  Create the sidecar and write its header
+//---------------------------------------------------------------------------
+
+bool  PacketIndexWriter::Open(const std::string & file)
+{
+    Close();
+    Samples.clear();
+    FRecords = 0;
+    FDropped = 0;
+    if (!SampleBytes)
+        SampleBytes = sizeof(short);
+
+    //  Records are small and few; a deep pool rides out long disk stalls
+    Log.BlockBytes = BlockBytes;
+    Log.Depth = Depth;
+    Log.Blocks = 4 * Depth + 2;
+    Log.Direct = Direct;
+    if (!Log.Open(file))
+        return false;
+
+    PacketIndexHeader head;
+    std::memset(&head, 0, sizeof(head));
+    std::memcpy(head.Magic, Magic, sizeof(head.Magic));
+    head.Version = 1;
+    head.HeaderBytes = sizeof(PacketIndexHeader);
+    head.RecordBytes = sizeof(PacketIndexRecord);
+    head.FrameSize = FrameSize;
+    head.SampleBytes = SampleBytes;
+    head.SampleRate = SampleRate;
+    Log.Write(&head, sizeof(head));
+    return true;
+}
+
+//---------------------------------------------------------------------------
+//  PacketIndexWriter::Append() --  Index a buffer written at 'position'
+//---------------------------------------------------------------------------
+
+void  PacketIndexWriter::Append(const VitaIndex & index, unsigned long long position)
+{
+    if (index.Empty())
+        return;
+
+    Batch.resize(index.Size());
+    for (size_t p = 0; p < index.Size(); ++p)
+        {
+        const VitaPacketInfo & info = index[p];
+        PacketIndexRecord & rec = Batch[p];
+        unsigned long long & sample = Samples[info.Sid];
+
+        rec.Offset = position + info.Offset * sizeof(unsigned int);
+        rec.Sample = sample;
+        rec.TsFrac = static_cast<unsigned long long>(info.TsFracHi) << 32 | info.TsFracLo;
+        rec.TsInt = info.TsInt;
+        rec.Sid = info.Sid;
+        rec.Frame = FrameSize ? static_cast<unsigned int>(sample / FrameSize) : 0;
+        rec.Words = static_cast<unsigned short>(info.Words);
+        rec.PayloadWords = static_cast<unsigned short>(info.PayloadWords);
+        rec.PayloadOffset = static_cast<unsigned char>(info.PayloadOffset);
+        rec.Count = static_cast<unsigned char>(info.Count);
+        rec.Types = static_cast<unsigned char>(info.Tsi << 2 | info.Tsf);
+        rec.Reserved0 = 0;
+        rec.Reserved = 0;
+        sample += info.PayloadWords * sizeof(unsigned int) / SampleBytes;
+        }
+
+    if (Log.Write(&Batch[0], Batch.size() * sizeof(PacketIndexRecord)))
+        FRecords += Batch.size();
+    else
+        FDropped += Batch.size();
+}
+
+//---------------------------------------------------------------------------
+//  PacketIndexWriter::Close() --  Flush and close the sidecar
+//---------------------------------------------------------------------------
+
+void  PacketIndexWriter::Close()
+{
+    if (Log.IsOpen())
+        Log.Close();
+}
+
+//===========================================================================
+//  CLASS PacketIndexFile  -- Mapped .vidx with frame and time search
+//===========================================================================
+//---------------------------------------------------------------------------
+//  constructor for class PacketIndexFile
+//---------------------------------------------------------------------------
+
+PacketIndexFile::PacketIndexFile()
+    : Table(0), FRecords(0)
+{
+}
+
+//---------------------------------------------------------------------------
+//  PacketIndexFile::Open() --  Map a sidecar and check its header
+//---------------------------------------------------------------------------
+
+bool  PacketIndexFile::Open(const std::string & file)
+{
+    Close();
+    if (!Map.Open(file))
+        return false;
+
+    if (Map.Bytes() < sizeof(PacketIndexHeader))
+        {
+        Close();
+        return false;
+        }
+    const PacketIndexHeader & head = Header();
+    if (std::memcmp(head.Magic, Magic, sizeof(head.Magic)) != 0
+        || head.Version != 1 || head.RecordBytes != sizeof(PacketIndexRecord)
+        || head.HeaderBytes < sizeof(PacketIndexHeader) || head.HeaderBytes > Map.Bytes())
+        {
+        Close();
+        return false;
+        }
+
+    Table = reinterpret_cast<const PacketIndexRecord *>(Map.Data() + head.HeaderBytes);
+    FRecords = static_cast<size_t>((Map.Bytes() - head.HeaderBytes) / head.RecordBytes);
+    for (size_t r = 0; r < FRecords; ++r)
+        Streams[Table[r].Sid].push_back(r);
+    return true;
+}
+
+//---------------------------------------------------------------------------
+//  PacketIndexFile::Close() --  Unmap
+//---------------------------------------------------------------------------
+
+void  PacketIndexFile::Close()
+{
+    Map.Close();
+    Streams.clear();
+    Table = 0;
+    FRecords = 0;
+}
+
+//---------------------------------------------------------------------------
+//  PacketIndexFile::Next() --  Next record of a stream
+//---------------------------------------------------------------------------
+
+size_t  PacketIndexFile::Next(unsigned int sid, size_t idx) const
+{
+    const std::vector<size_t> & stream = Stream(sid);
+    const std::vector<size_t>::const_iterator at = std::lower_bound(stream.begin(), stream.end(), idx);
+    return at == stream.end() ? FRecords : *at;
+}
+
+//---------------------------------------------------------------------------
+//  PacketIndexFile::Stream() --  Places of a stream's records
+//---------------------------------------------------------------------------
+
+const std::vector<size_t> &  PacketIndexFile::Stream(unsigned int sid) const
+{
+    const std::map< unsigned int, std::vector<size_t> >::const_iterator s = Streams.find(sid);
+    return s == Streams.end() ? None : s->second;
+}
+
+//---------------------------------------------------------------------------
+//  PacketIndexFile::FindFrame() --  Packet where a frame starts
+//---------------------------------------------------------------------------
+
+size_t  PacketIndexFile::FindFrame(unsigned int sid, unsigned int frame) const
+{
+    FrameReached reached;
+    reached.Frame = frame;
+    return Search(*this, Stream(sid), reached);
+}
+
+//---------------------------------------------------------------------------
+//  PacketIndexFile::FindSample() --  Packet holding a stream sample
+//---------------------------------------------------------------------------
+
+size_t  PacketIndexFile::FindSample(unsigned int sid, unsigned long long sample) const
+{
+    SampleReached reached;
+    reached.Sample = sample;
+    reached.SampleBytes = IsOpen() && Header().SampleBytes ? Header().SampleBytes : sizeof(short);
+    return Search(*this, Stream(sid), reached);
+}
+
+//---------------------------------------------------------------------------
+//  PacketIndexFile::FindTime() --  First packet at or after a timestamp
+//---------------------------------------------------------------------------
+
+size_t  PacketIndexFile::FindTime(unsigned int sid, unsigned int ts_int, unsigned long long ts_frac) const
+{
+    TimeReached reached;
+    reached.Int = ts_int;
+    reached.Frac = ts_frac;
+    return Search(*this, Stream(sid), reached);
+}
+
+//---------------------------------------------------------------------------
+//  PacketIndexFile::SidecarName() --  .vidx beside a stream file
+//---------------------------------------------------------------------------
+
+std::string  PacketIndexFile::SidecarName(const std::string & data_file)
+{
+    const size_t dot = data_file.find_last_of('.');
+    const size_t slash = data_file.find_last_of("\\/");
+    if (dot == std::string::npos || (slash != std::string::npos && dot < slash))
+        return data_file + ".vidx";
+    return data_file.substr(0, dot) + ".vidx";
+}
@@ -0,0 +1,159 @@
+// PacketIndex.h
+//
+// Packet index sidecar (.vidx) of a recorded VITA stream file
+
+#ifndef PacketIndexH
+#define PacketIndexH
+
+#include "DiskLogger.h"
+#include "MappedFile.h"
+#include "VitaIndex.h"
+#include <string>
+#include <vector>
+#include <map>
+
+//===========================================================================
+//  STRUCT PacketIndexHeader  -- First 64 bytes of a .vidx file
+//===========================================================================
+//  The records follow back to back, one per packet in file order; their
+//  count is the file size less HeaderBytes, over RecordBytes.  Little
+//  endian, as written.
+
+struct PacketIndexHeader
+{
+    char                Magic[8];       // "IIPKTIDX"
+    unsigned int        Version;        // 1
+    unsigned int        HeaderBytes;    // sizeof(PacketIndexHeader)
+    unsigned int        RecordBytes;    // sizeof(PacketIndexRecord)
+    unsigned int        FrameSize;      // Stream samples per frame
+    unsigned int        SampleBytes;    // Bytes per stream sample, all lanes
+    unsigned int        Reserved0;
+    double              SampleRate;     // Hz, 0 if unknown
+    unsigned char       Reserved[24];
+};
+
+//===========================================================================
+//  STRUCT PacketIndexRecord  -- One packet of the stream file
+//===========================================================================
+
+struct PacketIndexRecord
+{
+    unsigned long long  Offset;         // Packet start in the stream file, bytes
+    unsigned long long  Sample;         // Its first payload sample, in its stream
+    unsigned long long  TsFrac;         // Fractional timestamp, as sent
+    unsigned int        TsInt;          // Integer timestamp, as sent
+    unsigned int        Sid;
+    unsigned int        Frame;          // Sample / FrameSize
+    unsigned short      Words;          // Packet size
+    unsigned short      PayloadWords;
+    unsigned char       PayloadOffset;  // Words before the payload
+    unsigned char       Count;          // 4-bit packet count
+    unsigned char       Types;          // TSI << 2 | TSF
+    unsigned char       Reserved0;
+    unsigned int        Reserved;
+};
+
+//===========================================================================
+//  CLASS PacketIndexWriter  -- Build a .vidx while the stream is logged
+//===========================================================================
+//  Append() takes each buffer's VitaIndex, already scanned for the
+//  channelizer, and the file position the buffer was written at.  Sample
+//  and frame numbers count the samples that reached the file, per SID, so
+//  a buffer the stream file dropped must not be appended.  A buffer's
+//  records are written whole or dropped whole through a DiskLogger;
+//  readers check that the records tile the file before trusting them.
+//  Only one thread may call Append().
+
+class PacketIndexWriter
+{
+public:
+    PacketIndexWriter();
+    ~PacketIndexWriter();
+
+    //  Config, read by Open()
+    unsigned int        FrameSize;
+    unsigned int        SampleBytes;
+    double              SampleRate;
+    size_t              BlockBytes;
+    unsigned int        Depth;
+    bool                Direct;
+
+    bool  Open(const std::string & file);
+    void  Append(const VitaIndex & index, unsigned long long position);
+    void  Close();
+    bool  IsOpen() const
+        {  return Log.IsOpen();  }
+
+    //  Status
+    const std::string &  FileName() const
+        {  return Log.FileName();  }
+    unsigned long long  Records() const
+        {  return FRecords;  }
+    unsigned long long  Dropped() const         // Records lost
+        {  return FDropped;  }
+    std::string  Error() const
+        {  return Log.Error();  }
+
+private:
+    DiskLogger                                  Log;
+    std::map<unsigned int, unsigned long long>  Samples;    // Per SID, so far
+    std::vector<PacketIndexRecord>              Batch;
+    unsigned long long                          FRecords;
+    unsigned long long                          FDropped;
+
+    PacketIndexWriter(const PacketIndexWriter &);
+    PacketIndexWriter & operator=(const PacketIndexWriter &);
+};
+
+//===========================================================================
+//  CLASS PacketIndexFile  -- Mapped .vidx with frame and time search
+//===========================================================================
+//  Records are in file order, so streams are interleaved; each stream's
+//  own records rise in frame and time.  Open() lists where each stream's
+//  records are, in one pass, and the searches bisect a stream's list,
+//  reading only the records they probe, so they cost a log of the
+//  stream's packet count however the streams interleave or end.
+
+class PacketIndexFile
+{
+public:
+    PacketIndexFile();
+
+    bool  Open(const std::string & file);
+    void  Close();
+    bool  IsOpen() const
+        {  return Map.IsOpen();  }
+
+    const PacketIndexHeader &  Header() const
+        {  return *Map.As<PacketIndexHeader>();  }
+    size_t  Records() const
+        {  return FRecords;  }
+    const PacketIndexRecord &  operator[](size_t idx) const
+        {  return Table[idx];  }
+
+    //  First record of 'sid' at or after 'idx'; Records() if none
+    size_t  Next(unsigned int sid, size_t idx) const;
+    //  First record of 'sid' whose frame is at least 'frame'
+    size_t  FindFrame(unsigned int sid, unsigned int frame) const;
+    //  ...whose sample range reaches 'sample'
+    size_t  FindSample(unsigned int sid, unsigned long long sample) const;
+    //  ...whose timestamp is at least 'ts_int', 'ts_frac'
+    size_t  FindTime(unsigned int sid, unsigned int ts_int, unsigned long long ts_frac) const;
+
+    //  Sidecar name of a stream file: its extension replaced by .vidx
+    static std::string  SidecarName(const std::string & data_file);
+
+private:
+    MappedFile                  Map;
+    const PacketIndexRecord *   Table;
+    size_t                      FRecords;
+    std::map< unsigned int, std::vector<size_t> >   Streams;    // Record places per SID
+    std::vector<size_t>         None;                           // ...of a SID never seen
+
+    const std::vector<size_t> &  Stream(unsigned int sid) const;
+
+    PacketIndexFile(const PacketIndexFile &);
+    PacketIndexFile & operator=(const PacketIndexFile &);
+};
+
+#endif
@@ -0,0 +1,160 @@
+// PacketQueue.h
+//
+// Bounded lock-free single-producer/single-consumer packet queue
+
+#ifndef PacketQueueH
+#define PacketQueueH
+
+#include <vector>
+#include <atomic>
+#include <mutex>
+#include <chrono>
+#include <condition_variable>
+
+//===========================================================================
+//  STRUCT QueueStatus  -- Snapshot of queue counters
+//===========================================================================
+
+struct QueueStatus
+{
+    size_t              Depth;
+    size_t              Capacity;
+    size_t              HighWater;
+    unsigned long long  Pushed;
+    unsigned long long  Popped;
+    unsigned long long  Drops;
+};
+
+//===========================================================================
+//  CLASS PacketQueue  -- SPSC ring of packet handles
+//===========================================================================
+//  Push() never waits: a full ring drops the item and counts it, so the
+//  driver callback can not be stalled by a slow consumer.  The consumer may
+//  sleep in Wait(); the producer only takes the wake lock while it is
+//  actually asleep.  A full fence on each side, between publishing its own
+//  flag and reading the other's, means either the consumer sees the item
+//  before it sleeps or the producer sees it asleep and wakes it.
+
+template <typename T>
+class PacketQueue
+{
+public:
+    explicit PacketQueue(size_t capacity = 64)
+        : Head(0), Tail(0), FHighWater(0), FDrops(0), Sleeping(false)
+        {
+        size_t size = 2;
+        while (size < capacity)
+            size <<= 1;
+        Slots.resize(size);
+        Mask = size - 1;
+        }
+
+    //  Producer side
+    bool  Push(const T & item)
+        {
+        const size_t head = Head.load(std::memory_order_relaxed);
+        const size_t tail = Tail.load(std::memory_order_acquire);
+        if (head - tail > Mask)
+            {
+            FDrops.fetch_add(1, std::memory_order_relaxed);
+            return false;
+            }
+        Slots[head & Mask] = item;
+        Head.store(head + 1, std::memory_order_release);
+
+        const size_t depth = head + 1 - tail;
+        if (depth > FHighWater.load(std::memory_order_relaxed))
+            FHighWater.store(depth, std::memory_order_relaxed);
+
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (Sleeping.load(std::memory_order_relaxed))
+            Wake();
+        return true;
+        }
+
+    //  Count an item the producer dropped without offering it
+    void  Refuse()
+        {  FDrops.fetch_add(1, std::memory_order_relaxed);  }
+
+    //  Consumer side
+    bool  Pop(T & item)
+        {
+        const size_t tail = Tail.load(std::memory_order_relaxed);
+        if (tail == Head.load(std::memory_order_acquire))
+            return false;
+        item = Slots[tail & Mask];
+        Slots[tail & Mask] = T();       // release our reference now
+        Tail.store(tail + 1, std::memory_order_release);
+        return true;
+        }
+
+    bool  Wait(T & item, unsigned int ms)
+        {
+        if (Pop(item))
+            return true;
+        std::unique_lock<std::mutex> lock(Lock);
+        Sleeping.store(true, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (!Pop(item))
+            Ready.wait_for(lock, std::chrono::milliseconds(ms));
+        Sleeping.store(false, std::memory_order_relaxed);
+        return Pop(item);
+        }
+
+    void  Wake()
+        {
+        std::lock_guard<std::mutex> lock(Lock);
+        Ready.notify_one();
+        }
+
+    //  Status
+    size_t  Capacity() const
+        {  return Mask + 1;  }
+    size_t  Depth() const
+        {  return Head.load(std::memory_order_acquire) - Tail.load(std::memory_order_acquire);  }
+    size_t  HighWater() const
+        {  return FHighWater.load(std::memory_order_relaxed);  }
+    unsigned long long  Pushed() const
+        {  return Head.load(std::memory_order_acquire);  }
+    unsigned long long  Popped() const
+        {  return Tail.load(std::memory_order_acquire);  }
+    unsigned long long  Drops() const
+        {  return FDrops.load(std::memory_order_relaxed);  }
+    QueueStatus  Status() const
+        {
+        QueueStatus s;
+        s.Popped = Popped();
+        s.Pushed = Pushed();
+        s.Depth = static_cast<size_t>(s.Pushed - s.Popped);
+        s.Capacity = Capacity();
+        s.HighWater = HighWater();
+        s.Drops = Drops();
+        return s;
+        }
+    void  ResetStats()
+        {
+        FHighWater.store(Depth());
+        FDrops.store(0);
+        }
+
+private:
+    //  Producer and consumer indices live on separate cache lines
+    std::vector<T>              Slots;
+    size_t                      Mask;
+    char                        Pad0[64];
+    std::atomic<size_t>         Head;
+    char                        Pad1[64];
+    std::atomic<size_t>         Tail;
+    char                        Pad2[64];
+    std::atomic<size_t>         FHighWater;
+    std::atomic<unsigned long long> FDrops;
+
+    std::mutex                  Lock;
+    std::condition_variable     Ready;
+    std::atomic<bool>           Sleeping;
+
+    PacketQueue(const PacketQueue &);
+    PacketQueue & operator=(const PacketQueue &);
+};
+
+#endif
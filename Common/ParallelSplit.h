@@ -0,0 +1,51 @@
+// ParallelSplit.h
+//
+// One run of samples worked on by several threads at once
+
+#ifndef ParallelSplitH
+#define ParallelSplitH
+
+#include <algorithm>
+#include <thread>
+#include <vector>
+#include <cstddef>
+
+//  Below this many samples a thread is not worth starting
+const size_t ParallelSplitSamples = 1024 * 1024;
+
+//---------------------------------------------------------------------------
+//  ParallelSplit() --  Call work(at, n) over pieces of 'count' samples
+//---------------------------------------------------------------------------
+//  threads = 0 uses every core, but a run gets no more threads than it
+//  has ParallelSplitSamples, so short ones stay on the calling thread.
+//  Pieces start on multiples of eight samples so only the last one has a
+//  tail.  The calling thread takes the first piece and returns when every
+//  piece is done.
+
+template <class Work>
+void  ParallelSplit(size_t count, unsigned int threads, Work work)
+{
+    if (!threads)
+        threads = std::max(std::thread::hardware_concurrency(), 1u);
+    threads = static_cast<unsigned int>(std::min<size_t>(threads, count / ParallelSplitSamples + 1));
+    if (threads <= 1)
+        {
+        work(0, count);
+        return;
+        }
+
+    const size_t piece = (count / threads + 7) / 8 * 8;
+    std::vector<std::thread> pool;
+    for (unsigned int t = 1; t < threads; ++t)
+        {
+        const size_t at = t * piece;
+        if (at >= count)
+            break;
+        pool.push_back(std::thread(work, at, std::min(piece, count - at)));
+        }
+    work(0, std::min(piece, count));
+    for (size_t t = 0; t < pool.size(); ++t)
+        pool[t].join();
+}
+
+#endif
@@ -0,0 +1,98 @@
+// PlanarSink.cpp
+//
+// Stream sink splitting interleaved payload into per-lane buffers
+
+#include "PlanarSink.h"
+#include <algorithm>
+
+namespace
+{
+    //  Frames per kernel call while some lane is being discarded
+    const size_t ScratchFrames = 4096;
+}
+
+//===========================================================================
+//  CLASS PlanarSink  -- De-interleave one stream into planar buffers
+//===========================================================================
+//---------------------------------------------------------------------------
+//  constructor for class PlanarSink
+//---------------------------------------------------------------------------
+
+PlanarSink::PlanarSink()
+    : Capacity(static_cast<size_t>(-1)), FFrames(0), FSampleBytes(2), Kernel(0)
+{
+}
+
+//---------------------------------------------------------------------------
+//  PlanarSink::Format() --  Set sample width and lanes, dropping buffers
+//---------------------------------------------------------------------------
+
+bool  PlanarSink::Format(size_t sample_bytes, unsigned int lanes)
+{
+    Kernel = Deinterleave::Kernel(sample_bytes, lanes);
+    FSampleBytes = sample_bytes;
+    Dest.assign(Kernel ? lanes : 0, static_cast<char *>(0));
+    Samples.assign(Dest.size(), 0);
+    Target.resize(Dest.size());
+    Capacity = static_cast<size_t>(-1);
+    FFrames = 0;
+    return Kernel != 0;
+}
+
+//---------------------------------------------------------------------------
+//  PlanarSink::Lane() --  Attach a lane's destination buffer
+//---------------------------------------------------------------------------
+
+void  PlanarSink::Lane(unsigned int lane, void * dest, size_t samples)
+{
+    if (lane >= Dest.size())
+        return;
+    Dest[lane] = static_cast<char *>(dest);
+    Samples[lane] = dest ? samples : 0;
+
+    Capacity = static_cast<size_t>(-1);
+    bool discard = false;
+    for (size_t l = 0; l < Dest.size(); ++l)
+        if (Dest[l])
+            Capacity = std::min(Capacity, Samples[l]);
+        else
+            discard = true;
+    Scratch.resize(discard ? ScratchFrames * FSampleBytes : 0);
+}
+
+//---------------------------------------------------------------------------
+//  PlanarSink::Reset() --  Restart filling from the top of every buffer
+//---------------------------------------------------------------------------
+
+void  PlanarSink::Reset()
+{
+    FFrames = 0;
+}
+
+//---------------------------------------------------------------------------
+//  PlanarSink::Write() --  De-interleave one packet's payload
+//---------------------------------------------------------------------------
+
+size_t  PlanarSink::Write(const unsigned int * payload, size_t words)
+{
+    if (!Kernel)
+        return 0;
+
+    const size_t frame_bytes = FSampleBytes * Dest.size();
+    const size_t frames = std::min(words * sizeof(unsigned int) / frame_bytes, Capacity - FFrames);
+    const size_t step = Scratch.empty() ? frames : ScratchFrames;
+    const char * src = reinterpret_cast<const char *>(payload);
+
+    for (size_t done = 0; done < frames; )
+        {
+        const size_t n = std::min(step, frames - done);
+        for (size_t l = 0; l < Dest.size(); ++l)
+            Target[l] = Dest[l] ? Dest[l] + FFrames * FSampleBytes : &Scratch[0];
+        Kernel(&Target[0], src, n);
+        src += n * frame_bytes;
+        FFrames += n;
+        done += n;
+        }
+
+    return frames * frame_bytes;
+}
@@ -0,0 +1,59 @@
+// PlanarSink.h
+//
+// Stream sink splitting interleaved payload into per-lane buffers
+
+#ifndef PlanarSinkH
+#define PlanarSinkH
+
+#include "StreamSink.h"
+#include "Deinterleave.h"
+#include <vector>
+
+//===========================================================================
+//  CLASS PlanarSink  -- De-interleave one stream into planar buffers
+//===========================================================================
+//  For SIDs carrying several channels (or I and Q) per packet.  Each lane
+//  fills its own preallocated buffer, straight from the packet, through
+//  the fastest Deinterleave kernel.  A lane without a buffer is discarded.
+//  Only whole frames are stored; the sink is full when any buffer is.
+
+class PlanarSink : public IStreamSink
+{
+public:
+    PlanarSink();
+
+    //  Stream layout.  False if no kernel handles it.
+    bool  Format(size_t sample_bytes, unsigned int lanes);
+    //  Buffer of 'samples' for 'lane'; dest 0 discards the lane
+    void  Lane(unsigned int lane, void * dest, size_t samples);
+    void  Reset();
+
+    //  IStreamSink -- writer side, single thread
+    size_t  Write(const unsigned int * payload, size_t words);
+    bool    Full() const
+        {  return FFrames >= Capacity;  }
+
+    //  Status
+    unsigned int  Lanes() const
+        {  return static_cast<unsigned int>(Dest.size());  }
+    size_t  SampleBytes() const
+        {  return FSampleBytes;  }
+    //  Samples stored in each lane
+    size_t  Frames() const
+        {  return FFrames;  }
+
+private:
+    std::vector<char *>     Dest;
+    std::vector<size_t>     Samples;
+    std::vector<char *>     Target;     // Write positions for one kernel call
+    std::vector<char>       Scratch;    // Landing area for discarded lanes
+    size_t                  Capacity;   // Frames, smallest lane buffer
+    size_t                  FFrames;
+    size_t                  FSampleBytes;
+    Deinterleave::Ftn       Kernel;
+
+    PlanarSink(const PlanarSink &);
+    PlanarSink & operator=(const PlanarSink &);
+};
+
+#endif
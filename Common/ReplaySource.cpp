@@ -0,0 +1,215 @@
+// ReplaySource.cpp
+//
+// Software packet source replaying a recorded VITA stream file
+
+#include "ReplaySource.h"
+#include "VitaHeader.h"
+#include "HiResTimer.h"
+#include <chrono>
+#include <algorithm>
+#include <cstring>
+
+//===========================================================================
+//  CLASS ReplaySource  -- Deliver buffers of a recorded stream, paced
+//===========================================================================
+//---------------------------------------------------------------------------
+//  constructor for class ReplaySource
+//---------------------------------------------------------------------------
+
+ReplaySource::ReplaySource()
+    : BufferBytes(4 * 1024 * 1024), Speed(1.0), SampleRate(0.0), Streams(1),
+      SampleBytes(sizeof(short)), Loops(1), ChunkIndex(0), ChunkAt(0), Quit(false), FRunning(false),
+      FBuffers(0), FBytes(0), FLag(0.0), FDiscarded(0), FSeconds(0.0)
+{
+}
+
+//---------------------------------------------------------------------------
+//  destructor for class ReplaySource
+//---------------------------------------------------------------------------
+
+ReplaySource::~ReplaySource()
+{
+    Stop();
+}
+
+//---------------------------------------------------------------------------
+//  ReplaySource::Start() --  Open the file and start delivering
+//---------------------------------------------------------------------------
+
+bool  ReplaySource::Start(Handler handler)
+{
+    Stop();
+    if (CompressedReader::IsCompressed(FileName) ? !Packed.Open(FileName) : !Reader.Open(FileName))
+        return false;
+    Rewind();
+
+    Deliver = handler;
+    Quit = false;
+    FBuffers = 0;
+    FBytes = 0;
+    FLag = 0.0;
+    FDiscarded = 0;
+    FSeconds = 0.0;
+    FRunning = true;
+    Thread = std::thread(&ReplaySource::Execute, this);
+    return true;
+}
+
+//---------------------------------------------------------------------------
+//  ReplaySource::Stop() --  Stop delivering and join the reader
+//---------------------------------------------------------------------------
+
+void  ReplaySource::Stop()
+{
+    Quit = true;
+    if (Thread.joinable())
+        Thread.join();
+}
+
+//---------------------------------------------------------------------------
+//  ReplaySource::Execute() --  Reader thread
+//---------------------------------------------------------------------------
+//  Words after the last complete packet of a read are carried into the
+//  next buffer, so every delivered buffer holds whole packets only.  A
+//  word that starts no packet, with a maximum size packet's worth after
+//  it or at the end of the file, is dropped in place and the packets
+//  after it moved down, so a damaged stretch costs only its own words.
+
+void  ReplaySource::Execute()
+{
+    const size_t target = std::max<size_t>(BufferBytes / sizeof(unsigned int), 0x10000);
+    const double samples_per_second = SampleRate * std::max(Streams, 1u) * Speed;
+    std::vector<unsigned int> buffer;
+    std::vector<unsigned int> carry;
+    unsigned int pass = 0;
+    bool any = false;                               // Packets in this pass
+    double due = 0.0;
+    HiResTimer clock;
+
+    while (!Quit)
+        {
+        //  Leftover packet start, then fresh words from the file
+        buffer.resize(target + carry.size());
+        std::copy(carry.begin(), carry.end(), buffer.begin());
+        const size_t bytes_read = Read(&buffer[carry.size()], target * sizeof(unsigned int));
+        const size_t got = bytes_read / sizeof(unsigned int);
+        FDiscarded += bytes_read % sizeof(unsigned int);
+        buffer.resize(carry.size() + got);
+        carry.clear();
+
+        if (buffer.empty())
+            {
+            if (++pass == Loops || !any)
+                break;
+            Rewind();
+            any = false;
+            continue;
+            }
+
+        //  Keep the whole packets, counting samples for pacing
+        size_t at = 0;
+        size_t kept = 0;
+        size_t payload = 0;
+        VitaPacketInfo info;
+        while (at < buffer.size())
+            {
+            if (Vita::Decode(&buffer[0], buffer.size(), at, info))
+                {
+                if (kept != at)
+                    std::copy(buffer.begin() + at, buffer.begin() + at + info.Words, buffer.begin() + kept);
+                at += info.Words;
+                kept += info.Words;
+                payload += info.PayloadWords;
+                }
+            else if (!got || buffer.size() - at >= 0xFFFF)
+                {
+                ++at;
+                FDiscarded += sizeof(unsigned int);
+                }
+            else
+                break;
+            }
+        carry.assign(buffer.begin() + at, buffer.end());
+        buffer.resize(kept);
+        if (buffer.empty())
+            continue;
+
+        if (samples_per_second > 0.0)
+            {
+            due += payload * sizeof(unsigned int) / static_cast<double>(SampleBytes) / samples_per_second;
+            double ahead = due - clock.Elapsed();
+            FLag = std::max(FLag, -ahead);
+            while (ahead > 0.0 && !Quit)
+                {
+                if (ahead > 0.002)
+                    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                else
+                    std::this_thread::yield();
+                ahead = due - clock.Elapsed();
+                }
+            }
+
+        const size_t bytes = buffer.size() * sizeof(unsigned int);
+        any = true;
+        Deliver(buffer);
+        FBuffers.fetch_add(1);
+        FBytes.fetch_add(bytes);
+        }
+
+    Reader.Close();
+    Packed.Close();
+    FSeconds = clock.Elapsed();
+    FRunning = false;
+}
+
+//---------------------------------------------------------------------------
+//  ReplaySource::Read() --  Next bytes of the stream, from either reader
+//---------------------------------------------------------------------------
+//  Chunks of a compressed file are cut between packet groups, so one lost
+//  at capture, or one that fails to decode and is discarded, leaves the
+//  packets either side whole.
+
+size_t  ReplaySource::Read(void * out, size_t bytes)
+{
+    if (!Packed.IsOpen())
+        return Reader.Read(out, bytes);
+
+    char * dst = static_cast<char *>(out);
+    size_t copied = 0;
+    while (copied < bytes)
+        {
+        const size_t have = Chunk.empty() ? 0 : Packed.Chunk(ChunkIndex - 1).RawBytes - ChunkAt;
+        if (!have)
+            {
+            if (ChunkIndex >= Packed.Chunks())
+                {
+                Chunk.clear();
+                break;
+                }
+            if (!Packed.Decode(ChunkIndex++, Chunk))
+                {
+                FDiscarded += Packed.Chunk(ChunkIndex - 1).RawBytes;
+                Chunk.clear();
+                }
+            ChunkAt = 0;
+            continue;
+            }
+        const size_t n = std::min(bytes - copied, have);
+        std::memcpy(dst + copied, reinterpret_cast<const char *>(&Chunk[0]) + ChunkAt, n);
+        ChunkAt += n;
+        copied += n;
+        }
+    return copied;
+}
+
+//---------------------------------------------------------------------------
+//  ReplaySource::Rewind() --  Back to the start of the file
+//---------------------------------------------------------------------------
+
+void  ReplaySource::Rewind()
+{
+    Reader.Rewind();
+    Chunk.clear();
+    ChunkIndex = 0;
+    ChunkAt = 0;
+}
@@ -0,0 +1,92 @@
+// ReplaySource.h
+//
+// Software packet source replaying a recorded VITA stream file
+
+#ifndef ReplaySourceH
+#define ReplaySourceH
+
+#include "StripedLogger.h"
+#include "CompressedLogger.h"
+#include <string>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <functional>
+#include <cstddef>
+
+//===========================================================================
+//  CLASS ReplaySource  -- Deliver buffers of a recorded stream, paced
+//===========================================================================
+//  Reads a file of back to back VITA packets (Data.bin), the manifest of
+//  a striped one, or a compressed one (Data.vcz), decoded a chunk at a
+//  time, on its own thread and hands it to the handler in
+//  buffers of about BufferBytes, cut on packet boundaries, as the driver's
+//  stream callback would.  The handler may swap the vector out to keep it.
+//
+//  Pacing follows the payload: with Speed 1 buffers are released at the
+//  rate SampleRate samples per second per stream would produce them, with
+//  Speed n n times faster, and with Speed 0 as fast as the handler takes
+//  them.  Loops > 1 replays the file again, 0 until stopped, for soaks.
+
+class ReplaySource
+{
+public:
+    typedef std::function<void (std::vector<unsigned int> & words)>  Handler;
+
+    ReplaySource();
+    ~ReplaySource();
+
+    //  Config
+    std::string     FileName;
+    size_t          BufferBytes;    // Target size of each buffer
+    double          Speed;          // 1 = recorded rate, 0 = unpaced
+    double          SampleRate;     // Per stream, Hz
+    unsigned int    Streams;        // Streams sharing the file
+    size_t          SampleBytes;
+    unsigned int    Loops;          // Passes over the file, 0 = until stopped
+
+    //  False if the file cannot be opened
+    bool  Start(Handler handler);
+    void  Stop();
+    bool  Running() const
+        {  return FRunning.load();  }
+
+    //  Status
+    unsigned long long  Buffers() const
+        {  return FBuffers.load();  }
+    unsigned long long  Bytes() const
+        {  return FBytes.load();  }
+    //  Time the paced stream fell behind its schedule, worst case
+    double  Lag() const
+        {  return FLag;  }
+    //  Bytes dropped as words that start no whole packet
+    unsigned long long  Discarded() const
+        {  return FDiscarded;  }
+    double  Seconds() const
+        {  return FSeconds;  }
+
+private:
+    std::thread                         Thread;
+    StripeReader                        Reader;
+    CompressedReader                    Packed;         // In place of Reader
+    std::vector<unsigned int>           Chunk;          // ...chunk being read
+    size_t                              ChunkIndex;
+    size_t                              ChunkAt;        // Bytes of it delivered
+    Handler                             Deliver;
+    std::atomic<bool>                   Quit;
+    std::atomic<bool>                   FRunning;
+    std::atomic<unsigned long long>     FBuffers;
+    std::atomic<unsigned long long>     FBytes;
+    double                              FLag;
+    unsigned long long                  FDiscarded;
+    double                              FSeconds;
+
+    void  Execute();
+    size_t  Read(void * out, size_t bytes);
+    void  Rewind();
+
+    ReplaySource(const ReplaySource &);
+    ReplaySource & operator=(const ReplaySource &);
+};
+
+#endif
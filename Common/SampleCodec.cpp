@@ -0,0 +1,277 @@
+// SampleCodec.cpp
+//
+// Lossless prediction and bit-packing codec for int16 ADC samples
+
+#include "SampleCodec.h"
+#include <algorithm>
+#include <cstring>
+
+namespace
+{
+    const unsigned int MaxWidth = 18;       // Second difference of int16, zigzagged
+
+    inline unsigned int  Zigzag(int r)
+        {  return (static_cast<unsigned int>(r) << 1) ^ static_cast<unsigned int>(r >> 31);  }
+    inline int  Unzigzag(unsigned int z)
+        {  return static_cast<int>(z >> 1) ^ -static_cast<int>(z & 1);  }
+    inline unsigned int  Width(unsigned int m)
+        {
+        unsigned int w = 0;
+        for (; m; m >>= 1)
+            ++w;
+        return w;
+        }
+
+    //  Predictions from the same lane: 'back' is one lane stride
+    inline int  Predict(const short * x, size_t i, size_t back, unsigned int order)
+        {
+        const int p1 = i >= back ? x[i - back] : 0;
+        if (order < 2)
+            return order ? p1 : 0;
+        const int p2 = i >= 2*back ? x[i - 2*back] : 0;
+        return 2*p1 - p2;
+        }
+
+    //  The stream format is little endian, as the board writes it
+    inline void  Store32(unsigned char * p, unsigned int v)
+        {  std::memcpy(p, &v, sizeof(v));  }
+    inline unsigned int  Load32(const unsigned char * p)
+        {
+        unsigned int v;
+        std::memcpy(&v, p, sizeof(v));
+        return v;
+        }
+
+    inline void  AppendRaw(std::vector<unsigned char> & out, const void * data, size_t bytes)
+        {
+        const unsigned char * p = static_cast<const unsigned char *>(data);
+        out.insert(out.end(), p, p + bytes);
+        }
+}
+
+//===========================================================================
+//  CLASS SampleCodec  -- Lossless coding of int16 sample streams
+//===========================================================================
+//---------------------------------------------------------------------------
+//  SampleCodec::Encode() --  Predict, zigzag and bit-pack, block by block
+//---------------------------------------------------------------------------
+
+void  SampleCodec::Encode(const short * in, size_t count, unsigned int lanes, std::vector<unsigned char> & out)
+{
+    const size_t back = lanes ? lanes : 1;
+    unsigned int r[3][BlockSamples];
+
+    //  Room for the worst case up front; trimmed to fit at the end
+    const size_t start = out.size();
+    out.resize(start + (count + BlockSamples - 1) / BlockSamples * (1 + BlockSamples * MaxWidth / 8) + sizeof(unsigned int));
+    unsigned char * p = &out[start];
+
+    for (size_t b = 0; b < count; b += BlockSamples)
+        {
+        const size_t n = std::min<size_t>(count - b, BlockSamples);
+
+        //  Residuals of each predictor; the first samples of a packet have
+        //  no history and take the general path
+        size_t k = 0;
+        for (; k < n && b + k < 2*back; ++k)
+            {
+            r[0][k] = Zigzag(in[b + k]);
+            r[1][k] = Zigzag(in[b + k] - Predict(in, b + k, back, 1));
+            r[2][k] = Zigzag(in[b + k] - Predict(in, b + k, back, 2));
+            }
+        const short * x = in + b;
+        for (; k < n; ++k)
+            {
+            const int v = x[k], p1 = x[k - back], p2 = x[k - 2*back];
+            r[0][k] = Zigzag(v);
+            r[1][k] = Zigzag(v - p1);
+            r[2][k] = Zigzag(v - 2*p1 + p2);
+            }
+        unsigned int m0 = 0, m1 = 0, m2 = 0;
+        for (k = 0; k < n; ++k)
+            {
+            m0 |= r[0][k];
+            m1 |= r[1][k];
+            m2 |= r[2][k];
+            }
+        const unsigned int w0 = Width(m0), w1 = Width(m1), w2 = Width(m2);
+        const unsigned int order = w2 < w1 && w2 < w0 ? 2 : (w1 < w0 ? 1 : 0);
+        const unsigned int w = order == 2 ? w2 : (order ? w1 : w0);
+        const unsigned int * z = r[order];
+
+        *p++ = static_cast<unsigned char>(order << 5 | w);
+        unsigned long long acc = 0;
+        unsigned int bits = 0;
+        for (k = 0; k < n; ++k)
+            {
+            acc |= static_cast<unsigned long long>(z[k]) << bits;
+            bits += w;
+            if (bits >= 32)
+                {
+                Store32(p, static_cast<unsigned int>(acc));
+                p += 4;
+                acc >>= 32;
+                bits -= 32;
+                }
+            }
+        for (; bits; bits = bits > 8 ? bits - 8 : 0)
+            {
+            *p++ = static_cast<unsigned char>(acc);
+            acc >>= 8;
+            }
+        }
+    out.resize(p - &out[0]);
+}
+
+//---------------------------------------------------------------------------
+//  SampleCodec::Decode() --  Unpack and undo the prediction
+//---------------------------------------------------------------------------
+
+size_t  SampleCodec::Decode(const unsigned char * in, size_t bytes, size_t count, unsigned int lanes, short * out)
+{
+    const size_t back = lanes ? lanes : 1;
+    unsigned char block[BlockSamples * MaxWidth / 8 + 2*sizeof(unsigned int)];
+    int r[BlockSamples];
+    size_t used = 0;
+
+    for (size_t b = 0; b < count; b += BlockSamples)
+        {
+        const size_t n = std::min<size_t>(count - b, BlockSamples);
+        if (used >= bytes)
+            return 0;
+        const unsigned int order = in[used] >> 5;
+        const unsigned int w = in[used] & 0x1F;
+        const size_t packed = (n*w + 7) / 8;
+        if (order > 2 || w > MaxWidth || bytes - used - 1 < packed)
+            return 0;
+
+        //  Unpack from a padded copy so the 32-bit loads never overrun
+        std::memcpy(block, in + used + 1, packed);
+        std::memset(block + packed, 0, sizeof(block) - packed);
+        const unsigned char * q = block;
+        const unsigned long long mask = (1ull << w) - 1;
+        unsigned long long acc = 0;
+        unsigned int bits = 0;
+        for (size_t k = 0; k < n; ++k)
+            {
+            if (bits < w)
+                {
+                acc |= static_cast<unsigned long long>(Load32(q)) << bits;
+                q += 4;
+                bits += 32;
+                }
+            r[k] = Unzigzag(static_cast<unsigned int>(acc & mask));
+            acc >>= w;
+            bits -= w;
+            }
+        used += 1 + packed;
+
+        //  Undo the prediction; a serial dependency, so one loop per order
+        short * y = out + b;
+        size_t k = 0;
+        for (; k < n && b + k < 2*back; ++k)
+            y[k] = static_cast<short>(r[k] + Predict(out, b + k, back, order));
+        if (order == 0)
+            for (; k < n; ++k)
+                y[k] = static_cast<short>(r[k]);
+        else if (back == 1 && k < n)
+            {
+            //  Single lane: keep the history in registers
+            short p1 = y[k - 1], p2 = y[k - 2];
+            for (; k < n; ++k)
+                {
+                const short v = static_cast<short>(r[k] + (order == 1 ? p1 : 2*p1 - p2));
+                y[k] = v;
+                p2 = p1;
+                p1 = v;
+                }
+            }
+        else if (order == 1)
+            for (; k < n; ++k)
+                y[k] = static_cast<short>(r[k] + y[k - back]);
+        else
+            for (; k < n; ++k)
+                y[k] = static_cast<short>(r[k] + 2*y[k - back] - y[k - 2*back]);
+        }
+    return used;
+}
+
+//---------------------------------------------------------------------------
+//  SampleCodec::EncodeChunk() --  Code a run of VITA packets
+//---------------------------------------------------------------------------
+//  Layout: packet count (32 bits); per packet its header words, coded
+//  payload and trailer word; then whatever followed the last whole packet,
+//  raw.
+
+void  SampleCodec::EncodeChunk(const unsigned int * words, size_t bytes, unsigned int lanes,
+                               std::vector<unsigned char> & out, VitaIndex & index)
+{
+    const size_t count = bytes / sizeof(unsigned int);
+    index.Scan(words, count);
+
+    const unsigned int packets = static_cast<unsigned int>(index.Size());
+    AppendRaw(out, &packets, sizeof(packets));
+    for (size_t p = 0; p < index.Size(); ++p)
+        {
+        const VitaPacketInfo & info = index[p];
+        const unsigned int * packet = words + info.Offset;
+        const unsigned int tail = info.Words - info.PayloadOffset - info.PayloadWords;
+        AppendRaw(out, packet, info.PayloadOffset * sizeof(unsigned int));
+        Encode(reinterpret_cast<const short *>(packet + info.PayloadOffset),
+               info.PayloadWords * sizeof(unsigned int) / sizeof(short), lanes, out);
+        AppendRaw(out, packet + info.PayloadOffset + info.PayloadWords, tail * sizeof(unsigned int));
+        }
+
+    const size_t covered = index.Words() * sizeof(unsigned int);
+    AppendRaw(out, reinterpret_cast<const unsigned char *>(words) + covered, bytes - covered);
+}
+
+//---------------------------------------------------------------------------
+//  SampleCodec::DecodeChunk() --  Rebuild a run of VITA packets
+//---------------------------------------------------------------------------
+
+bool  SampleCodec::DecodeChunk(const unsigned char * in, size_t bytes, size_t raw_bytes, unsigned int lanes,
+                               unsigned char * out)
+{
+    unsigned int packets;
+    if (bytes < sizeof(packets))
+        return false;
+    std::memcpy(&packets, in, sizeof(packets));
+    size_t used = sizeof(packets);
+    size_t made = 0;
+
+    for (unsigned int p = 0; p < packets; ++p)
+        {
+        if (bytes - used < sizeof(unsigned int))
+            return false;
+        const unsigned int hdr = Load32(in + used);
+        const unsigned int size = Vita::PacketWords(hdr);
+        const unsigned int head = Vita::HeaderWords(hdr);
+        const unsigned int tail = Vita::HasTrailer(hdr) ? 1 : 0;
+        if (size < head + tail || raw_bytes - made < size * sizeof(unsigned int)
+            || bytes - used < head * sizeof(unsigned int))
+            return false;
+
+        std::memcpy(out + made, in + used, head * sizeof(unsigned int));
+        used += head * sizeof(unsigned int);
+        made += head * sizeof(unsigned int);
+
+        const size_t samples = (size - head - tail) * sizeof(unsigned int) / sizeof(short);
+        const size_t coded = Decode(in + used, bytes - used, samples, lanes, reinterpret_cast<short *>(out + made));
+        if (samples && !coded)
+            return false;
+        used += coded;
+        made += samples * sizeof(short);
+
+        if (bytes - used < tail * sizeof(unsigned int))
+            return false;
+        std::memcpy(out + made, in + used, tail * sizeof(unsigned int));
+        used += tail * sizeof(unsigned int);
+        made += tail * sizeof(unsigned int);
+        }
+
+    if (bytes - used != raw_bytes - made)
+        return false;
+    std::memcpy(out + made, in + used, raw_bytes - made);
+    return true;
+}
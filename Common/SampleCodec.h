@@ -0,0 +1,47 @@
+// SampleCodec.h
+//
+// Lossless prediction and bit-packing codec for int16 ADC samples
+
+#ifndef SampleCodecH
+#define SampleCodecH
+
+#include "VitaIndex.h"
+#include <vector>
+#include <cstddef>
+
+//===========================================================================
+//  CLASS SampleCodec  -- Lossless coding of int16 sample streams
+//===========================================================================
+//  Samples are coded in blocks of BlockSamples.  Each block picks the best
+//  of three predictors from the same lane's history -- none, the previous
+//  sample, or a straight line through the previous two -- zigzags the
+//  residuals and bit-packs them at the width of the largest.  A block
+//  costs one byte (predictor << 5 | width) plus width bits a sample, so
+//  14-bit noise packs to 14 bits and smooth or repetitive signals to a
+//  few.  There are no tables and no state beyond the current packet, so
+//  any packet decodes on its own.
+//
+//  EncodeChunk() handles a run of whole VITA packets: headers and
+//  trailers are kept verbatim, payloads are coded, and anything that does
+//  not parse as a packet is stored raw, so every input round-trips
+//  exactly.  Stateless; safe from any number of threads.
+
+class SampleCodec
+{
+public:
+    enum { BlockSamples = 128 };
+
+    //  Append the coding of 'count' samples, 'lanes' interleaved
+    static void  Encode(const short * in, size_t count, unsigned int lanes, std::vector<unsigned char> & out);
+    //  Decode 'count' samples.  Returns bytes consumed, 0 if 'in' is short.
+    static size_t  Decode(const unsigned char * in, size_t bytes, size_t count, unsigned int lanes, short * out);
+
+    //  Append the coding of 'bytes' of VITA stream; 'index' is scratch
+    static void  EncodeChunk(const unsigned int * words, size_t bytes, unsigned int lanes,
+                             std::vector<unsigned char> & out, VitaIndex & index);
+    //  Rebuild exactly 'raw_bytes' of stream.  False if 'in' is damaged.
+    static bool  DecodeChunk(const unsigned char * in, size_t bytes, size_t raw_bytes, unsigned int lanes,
+                             unsigned char * out);
+};
+
+#endif
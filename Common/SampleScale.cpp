@@ -0,0 +1,191 @@
+// SampleScale.cpp
+//
+// Vectorized conversion of raw ADC counts to calibrated engineering units
+
+#include "SampleScale.h"
+#include "ParallelSplit.h"
+#include <algorithm>
+
+#if defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2) || defined(__SSE2__)
+#define SAMPLESCALE_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace
+{
+    //-----------------------------------------------------------------------
+    //  ScaleScalar() --  One sample at a time
+    //-----------------------------------------------------------------------
+
+    template <class T>
+    void  ScaleScalar(const short * src, T * dest, size_t count, T scale, T bias)
+    {
+        for (size_t i = 0; i < count; ++i)
+            dest[i] = static_cast<T>(src[i]) * scale + bias;
+    }
+
+#ifdef SAMPLESCALE_SSE2
+    //-----------------------------------------------------------------------
+    //  ScaleSse2() --  Eight samples a step, sign extended through 32 bits
+    //-----------------------------------------------------------------------
+
+    void  ScaleSse2(const short * src, float * dest, size_t count, float scale, float bias)
+    {
+        const __m128 s = _mm_set1_ps(scale);
+        const __m128 b = _mm_set1_ps(bias);
+        size_t i = 0;
+        for (; i + 8 <= count; i += 8)
+            {
+            const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i));
+            const __m128i lo = _mm_srai_epi32(_mm_unpacklo_epi16(v, v), 16);
+            const __m128i hi = _mm_srai_epi32(_mm_unpackhi_epi16(v, v), 16);
+            _mm_storeu_ps(dest + i, _mm_add_ps(_mm_mul_ps(_mm_cvtepi32_ps(lo), s), b));
+            _mm_storeu_ps(dest + i + 4, _mm_add_ps(_mm_mul_ps(_mm_cvtepi32_ps(hi), s), b));
+            }
+        ScaleScalar<float>(src + i, dest + i, count - i, scale, bias);
+    }
+
+    void  ScaleSse2(const short * src, double * dest, size_t count, double scale, double bias)
+    {
+        const __m128d s = _mm_set1_pd(scale);
+        const __m128d b = _mm_set1_pd(bias);
+        size_t i = 0;
+        for (; i + 8 <= count; i += 8)
+            {
+            const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i));
+            const __m128i lo = _mm_srai_epi32(_mm_unpacklo_epi16(v, v), 16);
+            const __m128i hi = _mm_srai_epi32(_mm_unpackhi_epi16(v, v), 16);
+            _mm_storeu_pd(dest + i, _mm_add_pd(_mm_mul_pd(_mm_cvtepi32_pd(lo), s), b));
+            _mm_storeu_pd(dest + i + 2, _mm_add_pd(_mm_mul_pd(_mm_cvtepi32_pd(_mm_srli_si128(lo, 8)), s), b));
+            _mm_storeu_pd(dest + i + 4, _mm_add_pd(_mm_mul_pd(_mm_cvtepi32_pd(hi), s), b));
+            _mm_storeu_pd(dest + i + 6, _mm_add_pd(_mm_mul_pd(_mm_cvtepi32_pd(_mm_srli_si128(hi, 8)), s), b));
+            }
+        ScaleScalar<double>(src + i, dest + i, count - i, scale, bias);
+    }
+#endif
+
+    //-----------------------------------------------------------------------
+    //  Kernels -- Table of every kernel compiled in, built at load time
+    //-----------------------------------------------------------------------
+
+    struct KernelTable
+    {
+        SampleScale::SingleFtn  Single[Deinterleave::isCount];
+        SampleScale::DoubleFtn  Double[Deinterleave::isCount];
+        bool                    Compiled[Deinterleave::isCount];
+
+        KernelTable()
+            {
+            for (int i = 0; i < Deinterleave::isCount; ++i)
+                {
+                Single[i] = 0;
+                Double[i] = 0;
+                Compiled[i] = false;
+                }
+
+            Single[Deinterleave::isScalar] = &ScaleScalar<float>;
+            Double[Deinterleave::isScalar] = &ScaleScalar<double>;
+            Compiled[Deinterleave::isScalar] = true;
+#ifdef SAMPLESCALE_SSE2
+            Single[Deinterleave::isSse2] = &ScaleSse2;
+            Double[Deinterleave::isSse2] = &ScaleSse2;
+            Compiled[Deinterleave::isSse2] = true;
+#endif
+            Compiled[Deinterleave::isAvx2] = SampleScaleAvx2Table(Single[Deinterleave::isAvx2],
+                                                                  Double[Deinterleave::isAvx2]);
+            }
+
+        //  Highest level the CPU runs with everything below it built.  Asked
+        //  at run time: Deinterleave's own table may not be built yet while
+        //  this one is.
+        Deinterleave::IIIsa  Best() const
+            {
+            const Deinterleave::IIIsa cpu = Deinterleave::Supported();
+            Deinterleave::IIIsa best = Deinterleave::isScalar;
+            for (int i = 1; i <= cpu && i < Deinterleave::isCount && Compiled[i]; ++i)
+                best = static_cast<Deinterleave::IIIsa>(i);
+            return best;
+            }
+    };
+
+    const KernelTable   Kernels;
+
+    //-----------------------------------------------------------------------
+    //  Split() --  Run a kernel over pieces of a buffer on several threads
+    //-----------------------------------------------------------------------
+    //  Only the last piece has a scalar tail.
+
+    template <class T, class Ftn>
+    void  Split(Ftn kernel, const short * src, T * dest, size_t count, T scale, T bias, unsigned int threads)
+    {
+        ParallelSplit(count, threads, [=](size_t at, size_t n)
+            {
+            kernel(src + at, dest + at, n, scale, bias);
+            });
+    }
+}
+
+//===========================================================================
+//  CLASS SampleScale  -- int16 counts to float or double volts
+//===========================================================================
+//---------------------------------------------------------------------------
+//  constructors for class SampleScale
+//---------------------------------------------------------------------------
+
+SampleScale::SampleScale()
+    : FScale(1.), FBias(0.)
+{
+}
+
+SampleScale::SampleScale(double scale, double bias)
+    : FScale(scale), FBias(bias)
+{
+}
+
+//---------------------------------------------------------------------------
+//  SampleScale::Calibrated() --  Fold an IdRom gain and offset and a span
+//---------------------------------------------------------------------------
+
+SampleScale  SampleScale::Calibrated(double gain, double offset, double span, unsigned int bits)
+{
+    const double volts_per_count = span / static_cast<double>(1u << std::min(std::max(bits, 1u), 16u));
+    return SampleScale(gain * volts_per_count, offset * volts_per_count);
+}
+
+//---------------------------------------------------------------------------
+//  SampleScale::Convert() --  Counts to single or double precision
+//---------------------------------------------------------------------------
+
+void  SampleScale::Convert(const short * src, float * dest, size_t count, unsigned int threads) const
+{
+    Split(Kernels.Single[Kernels.Best()], src, dest, count, static_cast<float>(FScale),
+          static_cast<float>(FBias), threads);
+}
+
+void  SampleScale::Convert(const short * src, double * dest, size_t count, unsigned int threads) const
+{
+    Split(Kernels.Double[Kernels.Best()], src, dest, count, FScale, FBias, threads);
+}
+
+//---------------------------------------------------------------------------
+//  SampleScale::Supported() --  Best usable instruction set
+//---------------------------------------------------------------------------
+
+Deinterleave::IIIsa  SampleScale::Supported()
+{
+    return Kernels.Best();
+}
+
+//---------------------------------------------------------------------------
+//  SampleScale::SingleKernel() --  Kernels at a level
+//---------------------------------------------------------------------------
+
+SampleScale::SingleFtn  SampleScale::SingleKernel(Deinterleave::IIIsa isa)
+{
+    return isa >= 0 && isa <= Kernels.Best() ? Kernels.Single[isa] : 0;
+}
+
+SampleScale::DoubleFtn  SampleScale::DoubleKernel(Deinterleave::IIIsa isa)
+{
+    return isa >= 0 && isa <= Kernels.Best() ? Kernels.Double[isa] : 0;
+}
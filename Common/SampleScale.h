@@ -0,0 +1,63 @@
+// SampleScale.h
+//
+// Vectorized conversion of raw ADC counts to calibrated engineering units
+
+#ifndef SampleScaleH
+#define SampleScaleH
+
+#include "Deinterleave.h"
+#include <cstddef>
+
+//===========================================================================
+//  CLASS SampleScale  -- int16 counts to float or double volts
+//===========================================================================
+//  Every sample becomes counts x Scale() + Bias(), one multiply and one
+//  add, so a channel's IdRom gain and offset and the input span fold into
+//  two constants once, by Calibrated(), and the kernels do no more work
+//  per sample than a plain conversion.  Kernels exist per instruction set
+//  as for Deinterleave; each computes in the output's precision without
+//  fused multiply-add, so every level gives bit for bit the same results.
+//
+//  Convert() splits buffers of more than a million samples across
+//  threads.  No alignment is required of either buffer.
+
+class SampleScale
+{
+public:
+    typedef void (*SingleFtn)(const short * src, float * dest, size_t count, float scale, float bias);
+    typedef void (*DoubleFtn)(const short * src, double * dest, size_t count, double scale, double bias);
+
+    //  Counts unchanged, as a float
+    SampleScale();
+    SampleScale(double scale, double bias);
+
+    //  The ADC's count corrected by the IdRom, counts x gain + offset, then
+    //  'span' full scale across the 2^bits codes of the ADC, so volts if
+    //  the span is.  Samples are right justified and sign extended, as the
+    //  board delivers them, so a 14-bit count steps span / 16384.
+    static SampleScale  Calibrated(double gain, double offset, double span, unsigned int bits = 16);
+
+    double  Scale() const
+        {  return FScale;  }
+    double  Bias() const
+        {  return FBias;  }
+
+    //  'count' samples from 'src' to 'dest'; threads = 0 uses every core
+    void  Convert(const short * src, float * dest, size_t count, unsigned int threads = 0) const;
+    void  Convert(const short * src, double * dest, size_t count, unsigned int threads = 0) const;
+
+    //  Best instruction set with kernels here, and theirs at a level, 0 if
+    //  not compiled in or not run by this CPU
+    static Deinterleave::IIIsa  Supported();
+    static SingleFtn  SingleKernel(Deinterleave::IIIsa isa);
+    static DoubleFtn  DoubleKernel(Deinterleave::IIIsa isa);
+
+private:
+    double  FScale;
+    double  FBias;
+};
+
+//  AVX2 kernels from SampleScaleAvx2.cpp, false if that compiler has none
+bool  SampleScaleAvx2Table(SampleScale::SingleFtn & single, SampleScale::DoubleFtn & wide);
+
+#endif
@@ -0,0 +1,82 @@
+// SampleScaleAvx2.cpp
+//
+// AVX2 counts to units kernels
+//
+// Built with AVX2 code generation enabled, as DeinterleaveAvx2.cpp is.
+// Only reached when the CPU reports AVX2.  Multiply and add stay
+// separate so results match the other levels exactly; compilers that may
+// fuse them once FMA is enabled, the intrinsics included, are told not to.
+
+#include "SampleScale.h"
+
+#if defined(_MSC_VER)
+#pragma fp_contract(off)
+#elif defined(__clang__)
+#pragma STDC FP_CONTRACT OFF
+#elif defined(__GNUC__)
+#pragma GCC optimize("fp-contract=off")
+#endif
+
+#if defined(__AVX2__) || (defined(_MSC_VER) && _MSC_VER >= 1700 && (defined(_M_X64) || defined(_M_IX86)))
+#define SAMPLESCALE_AVX2
+#include <immintrin.h>
+#endif
+
+#ifdef SAMPLESCALE_AVX2
+namespace
+{
+    //  Sixteen samples a step, sign extended eight at a time
+    void  ScaleAvx2(const short * src, float * dest, size_t count, float scale, float bias)
+    {
+        const __m256 s = _mm256_set1_ps(scale);
+        const __m256 b = _mm256_set1_ps(bias);
+        size_t i = 0;
+        for (; i + 16 <= count; i += 16)
+            {
+            const __m128i lo = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i));
+            const __m128i hi = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i + 8));
+            const __m256 a = _mm256_cvtepi32_ps(_mm256_cvtepi16_epi32(lo));
+            const __m256 c = _mm256_cvtepi32_ps(_mm256_cvtepi16_epi32(hi));
+            _mm256_storeu_ps(dest + i, _mm256_add_ps(_mm256_mul_ps(a, s), b));
+            _mm256_storeu_ps(dest + i + 8, _mm256_add_ps(_mm256_mul_ps(c, s), b));
+            }
+        for (; i < count; ++i)
+            dest[i] = static_cast<float>(src[i]) * scale + bias;
+    }
+
+    //  Eight samples a step, four to a vector
+    void  ScaleAvx2(const short * src, double * dest, size_t count, double scale, double bias)
+    {
+        const __m256d s = _mm256_set1_pd(scale);
+        const __m256d b = _mm256_set1_pd(bias);
+        size_t i = 0;
+        for (; i + 8 <= count; i += 8)
+            {
+            const __m256i v = _mm256_cvtepi16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i)));
+            const __m256d a = _mm256_cvtepi32_pd(_mm256_castsi256_si128(v));
+            const __m256d c = _mm256_cvtepi32_pd(_mm256_extracti128_si256(v, 1));
+            _mm256_storeu_pd(dest + i, _mm256_add_pd(_mm256_mul_pd(a, s), b));
+            _mm256_storeu_pd(dest + i + 4, _mm256_add_pd(_mm256_mul_pd(c, s), b));
+            }
+        for (; i < count; ++i)
+            dest[i] = static_cast<double>(src[i]) * scale + bias;
+    }
+}
+#endif
+
+//---------------------------------------------------------------------------
+//  SampleScaleAvx2Table() --  AVX2 kernels, if this compiler has them
+//---------------------------------------------------------------------------
+
+bool  SampleScaleAvx2Table(SampleScale::SingleFtn & single, SampleScale::DoubleFtn & wide)
+{
+#ifdef SAMPLESCALE_AVX2
+    single = &ScaleAvx2;
+    wide = &ScaleAvx2;
+    return true;
+#else
+    (void)single;
+    (void)wide;
+    return false;
+#endif
+}
@@ -0,0 +1,439 @@
+// SegmentedLogger.cpp
+//
+// Stream file rolled over into preallocated segments, oldest retired
+
+#include "SegmentedLogger.h"
+#include "HiResTimer.h"
+#include <sstream>
+#include <iomanip>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+
+//===========================================================================
+//  CLASS SegmentedLogger  -- Stream to a series of segment files
+//===========================================================================
+//---------------------------------------------------------------------------
+//  constructor for class SegmentedLogger
+//---------------------------------------------------------------------------
+
+SegmentedLogger::SegmentedLogger()
+    : SegmentBytes(0), SegmentSeconds(0), RetainSegments(0), RetainBytes(0),
+      BlockBytes(4 * 1024 * 1024), Depth(4), Blocks(0), Reserve(0), Direct(true), Blocking(false),
+      Index(false), FrameSize(1), SampleBytes(sizeof(short)), SampleRate(0),
+      KeptBytes(0), Next(1), Quit(false), Latency(0),
+      FBytes(0), FSealed(0), FDeleted(0), FWritten(0), FDropped(0), FLate(0)
+{
+}
+
+//---------------------------------------------------------------------------
+//  destructor for class SegmentedLogger
+//---------------------------------------------------------------------------
+
+SegmentedLogger::~SegmentedLogger()
+{
+    Close();
+}
+
+//---------------------------------------------------------------------------
+//  SegmentedLogger::Open() --  Open the first segment and the service thread
+//---------------------------------------------------------------------------
+
+bool  SegmentedLogger::Open(const std::string & file)
+{
+    Close();
+
+    Base = file;
+    Kept.clear();
+    KeptBytes = 0;
+    Next = 1;
+    Quit = false;
+    FBytes = 0;
+    FSealed = 0;
+    FDeleted = 0;
+    FWritten = 0;
+    FDropped = 0;
+    FLate = 0;
+    FError.clear();
+
+    std::string error;
+    SegmentPtr first = Create(Next, error);
+    if (!first)
+        {
+        FError = error;
+        return false;
+        }
+    ++Next;
+    first->Opened = static_cast<long long>(std::time(0));
+    first->Ticks = HiResTimer::Ticks();
+    Current = first;
+
+    Thread = std::thread(&SegmentedLogger::Execute, this);
+    return true;
+}
+
+//---------------------------------------------------------------------------
+//  SegmentedLogger::Write() --  Append a buffer, rolling over first if due
+//---------------------------------------------------------------------------
+
+bool  SegmentedLogger::Write(const void * data, size_t bytes, const VitaIndex * index)
+{
+    if (!Current || !bytes)
+        return !bytes;
+
+    const unsigned long long held = Current->Data->Bytes();
+    if (held && ((SegmentBytes && held + bytes > SegmentBytes) ||
+        (SegmentSeconds > 0 && HiResTimer::Ticks() - Current->Ticks >
+            static_cast<long long>(SegmentSeconds * HiResTimer::TicksPerSecond()))))
+        Roll();
+
+    Segment & seg = *Current;
+    const unsigned long long position = seg.Data->Bytes();
+    if (!seg.Data->Write(data, bytes))
+        return false;
+    FBytes.fetch_add(bytes);
+
+    if (index && !index->Empty())
+        {
+        if (seg.Table)
+            seg.Table->Append(*index, position);
+        const VitaPacketInfo & first = (*index)[0];
+        const VitaPacketInfo & last = (*index)[index->Size() - 1];
+        if (!seg.Packets)
+            {
+            seg.TsIntFirst = first.TsInt;
+            seg.TsFracFirst = static_cast<unsigned long long>(first.TsFracHi) << 32 | first.TsFracLo;
+            }
+        seg.TsIntLast = last.TsInt;
+        seg.TsFracLast = static_cast<unsigned long long>(last.TsFracHi) << 32 | last.TsFracLo;
+        seg.Packets += index->Size();
+        }
+    return true;
+}
+
+//---------------------------------------------------------------------------
+//  SegmentedLogger::Close() --  Seal the last segment and stop
+//---------------------------------------------------------------------------
+//  The spare opened ahead never held data; its files go.
+
+void  SegmentedLogger::Close()
+{
+    if (!Current)
+        return;
+
+    std::unique_lock<std::mutex> lock(Lock);
+    Finished.push_back(Current);
+    Current.reset();
+    Quit = true;
+    lock.unlock();
+    Wake.notify_one();
+    Thread.join();
+
+    if (Spare)
+        {
+        Spare->Data->Close();
+        std::remove(Spare->Data->FileName().c_str());
+        if (Spare->Table)
+            {
+            Spare->Table->Close();
+            std::remove(Spare->Table->FileName().c_str());
+            }
+        Spare.reset();
+        }
+}
+
+//---------------------------------------------------------------------------
+//  SegmentedLogger::FileName() --  Segment being written
+//---------------------------------------------------------------------------
+
+std::string  SegmentedLogger::FileName() const
+{
+    std::lock_guard<std::mutex> lock(Lock);
+    return Current ? Current->Data->FileName() : std::string();
+}
+
+//---------------------------------------------------------------------------
+//  SegmentedLogger::Written() --  Bytes on disk, all segments
+//---------------------------------------------------------------------------
+
+unsigned long long  SegmentedLogger::Written() const
+{
+    std::lock_guard<std::mutex> lock(Lock);
+    unsigned long long bytes = FWritten;
+    if (Current)
+        bytes += Current->Data->Written();
+    for (size_t s = 0; s < Finished.size(); ++s)
+        bytes += Finished[s]->Data->Written();
+    return bytes;
+}
+
+//---------------------------------------------------------------------------
+//  SegmentedLogger::Dropped() --  Bytes refused or lost, all segments
+//---------------------------------------------------------------------------
+
+unsigned long long  SegmentedLogger::Dropped() const
+{
+    std::lock_guard<std::mutex> lock(Lock);
+    unsigned long long bytes = FDropped;
+    if (Current)
+        bytes += Current->Data->Dropped();
+    for (size_t s = 0; s < Finished.size(); ++s)
+        bytes += Finished[s]->Data->Dropped();
+    return bytes;
+}
+
+//---------------------------------------------------------------------------
+//  SegmentedLogger::Error() --  First error, empty if none
+//---------------------------------------------------------------------------
+
+std::string  SegmentedLogger::Error() const
+{
+    std::lock_guard<std::mutex> lock(Lock);
+    if (!FError.empty())
+        return FError;
+    if (Current && !Current->Data->Error().empty())
+        return Current->Data->FileName() + ": " + Current->Data->Error();
+    return std::string();
+}
+
+//---------------------------------------------------------------------------
+//  SegmentedLogger::SegmentName() --  Numbered segment of a stream file
+//---------------------------------------------------------------------------
+
+std::string  SegmentedLogger::SegmentName(const std::string & file, unsigned long long sequence)
+{
+    const size_t slash = file.find_last_of("\\/");
+    const size_t dot = file.find_last_of('.');
+    const bool ext = dot != std::string::npos && (slash == std::string::npos || dot > slash);
+
+    std::stringstream name;
+    name << (ext ? file.substr(0, dot) : file) << '.' << std::setw(6) << std::setfill('0') << sequence
+         << (ext ? file.substr(dot) : std::string(".bin"));
+    return name.str();
+}
+
+//---------------------------------------------------------------------------
+//  SegmentedLogger::HeaderName() --  Segment header file name
+//---------------------------------------------------------------------------
+
+std::string  SegmentedLogger::HeaderName(const std::string & segment)
+{
+    const size_t slash = segment.find_last_of("\\/");
+    const size_t dot = segment.find_last_of('.');
+    if (dot == std::string::npos || (slash != std::string::npos && dot < slash))
+        return segment + ".vseg";
+    return segment.substr(0, dot) + ".vseg";
+}
+
+//---------------------------------------------------------------------------
+//  SegmentedLogger::ReadHeader() --  Load a sealed segment's header
+//---------------------------------------------------------------------------
+//  False if the segment has not been sealed, or the header is not one.
+
+bool  SegmentedLogger::ReadHeader(const std::string & segment, SegmentHeader & header)
+{
+    std::FILE * f = std::fopen(HeaderName(segment).c_str(), "rb");
+    if (!f)
+        return false;
+    const bool read = std::fread(&header, sizeof(header), 1, f) == 1;
+    std::fclose(f);
+    return read && !std::memcmp(header.Magic, "IISEGMNT", sizeof(header.Magic)) &&
+        header.HeaderBytes >= sizeof(SegmentHeader);
+}
+
+//---------------------------------------------------------------------------
+//  SegmentedLogger::Create() --  Open and preallocate one segment
+//---------------------------------------------------------------------------
+//  Any header left from an earlier run of the same name is removed first,
+//  so the new file is not taken for a sealed one.  A segment without its
+//  index is still usable; only the data file failing is an error.
+
+SegmentedLogger::SegmentPtr  SegmentedLogger::Create(unsigned long long sequence, std::string & error) const
+{
+    SegmentPtr seg = std::make_shared<Segment>();
+    seg->Sequence = sequence;
+    seg->Offset = 0;
+    seg->Opened = 0;
+    seg->Ticks = 0;
+    seg->Packets = 0;
+    seg->TsFracFirst = seg->TsFracLast = 0;
+    seg->TsIntFirst = seg->TsIntLast = 0;
+
+    const std::string file = SegmentName(Base, sequence);
+    std::remove(HeaderName(file).c_str());
+
+    seg->Data = std::make_shared<DiskLogger>();
+    seg->Data->BlockBytes = BlockBytes;
+    seg->Data->Depth = Depth;
+    seg->Data->Blocks = Blocks;
+    seg->Data->Reserve = SegmentBytes ? SegmentBytes : Reserve;
+    seg->Data->Direct = Direct;
+    seg->Data->Blocking = Blocking;
+    seg->Data->WriteHistogram(Latency);
+    if (!seg->Data->Open(file))
+        {
+        error = file + ": " + seg->Data->Error();
+        return SegmentPtr();
+        }
+
+    if (Index)
+        {
+        seg->Table = std::make_shared<PacketIndexWriter>();
+        seg->Table->FrameSize = FrameSize;
+        seg->Table->SampleBytes = SampleBytes;
+        seg->Table->SampleRate = SampleRate;
+        seg->Table->Direct = Direct;
+        if (!seg->Table->Open(PacketIndexFile::SidecarName(file)))
+            seg->Table.reset();
+        }
+    return seg;
+}
+
+//---------------------------------------------------------------------------
+//  SegmentedLogger::Roll() --  Producer: swap in the spare segment
+//---------------------------------------------------------------------------
+
+void  SegmentedLogger::Roll()
+{
+    std::unique_lock<std::mutex> lock(Lock);
+    if (!Spare)
+        {
+        ++FLate;
+        return;
+        }
+    Spare->Offset = Current->Offset + Current->Data->Bytes();
+    Spare->Opened = static_cast<long long>(std::time(0));
+    Spare->Ticks = HiResTimer::Ticks();
+    Finished.push_back(Current);
+    Current = Spare;
+    Spare.reset();
+    lock.unlock();
+    Wake.notify_one();
+}
+
+//---------------------------------------------------------------------------
+//  SegmentedLogger::Seal() --  Close a finished segment and write its header
+//---------------------------------------------------------------------------
+
+void  SegmentedLogger::Seal(const SegmentPtr & seg)
+{
+    seg->Data->Close();
+    if (seg->Table)
+        seg->Table->Close();
+
+    SegmentHeader head;
+    std::memset(&head, 0, sizeof(head));
+    std::memcpy(head.Magic, "IISEGMNT", sizeof(head.Magic));
+    head.Version = 1;
+    head.HeaderBytes = sizeof(SegmentHeader);
+    head.Sequence = seg->Sequence;
+    head.Offset = seg->Offset;
+    head.Bytes = seg->Data->Written();
+    head.Packets = seg->Table ? seg->Table->Records() : 0;
+    head.Dropped = seg->Data->Dropped();
+    head.Opened = seg->Opened;
+    head.Sealed = static_cast<long long>(std::time(0));
+    head.TsFracFirst = seg->TsFracFirst;
+    head.TsFracLast = seg->TsFracLast;
+    head.TsIntFirst = seg->TsIntFirst;
+    head.TsIntLast = seg->TsIntLast;
+
+    const std::string file = seg->Data->FileName();
+    const std::string header = HeaderName(file);
+    const std::string temp = header + ".tmp";
+    std::string error = seg->Data->Error().empty() ? std::string() : file + ": " + seg->Data->Error();
+    std::FILE * f = std::fopen(temp.c_str(), "wb");
+    bool written = f && std::fwrite(&head, sizeof(head), 1, f) == 1;
+    if (f)
+        written = std::fclose(f) == 0 && written;
+    std::remove(header.c_str());
+    if (!written || std::rename(temp.c_str(), header.c_str()))
+        {
+        std::remove(temp.c_str());
+        if (error.empty())
+            error = header + ": cannot write the segment header";
+        }
+
+    std::unique_lock<std::mutex> lock(Lock);
+    FWritten += head.Bytes;
+    FDropped += head.Dropped;
+    if (FError.empty())
+        FError = error;
+    Finished.erase(std::find(Finished.begin(), Finished.end(), seg));
+    lock.unlock();
+    ++FSealed;
+
+    Retained kept;
+    kept.File = file;
+    kept.Bytes = head.Bytes;
+    Kept.push_back(kept);
+    KeptBytes += kept.Bytes;
+    Retire();
+}
+
+//---------------------------------------------------------------------------
+//  SegmentedLogger::Retire() --  Delete the oldest segments past the limits
+//---------------------------------------------------------------------------
+//  The header goes first, so a reader never finds a sealed segment whose
+//  data is missing.  The newest sealed segment is always kept.
+
+void  SegmentedLogger::Retire()
+{
+    while (Kept.size() > 1 && ((RetainSegments && Kept.size() > RetainSegments) ||
+           (RetainBytes && KeptBytes > RetainBytes)))
+        {
+        const Retained & old = Kept.front();
+        std::remove(HeaderName(old.File).c_str());
+        std::remove(PacketIndexFile::SidecarName(old.File).c_str());
+        std::remove(old.File.c_str());
+        KeptBytes -= old.Bytes;
+        Kept.pop_front();
+        ++FDeleted;
+        }
+}
+
+//---------------------------------------------------------------------------
+//  SegmentedLogger::Execute() --  Service thread: seal, retire, open ahead
+//---------------------------------------------------------------------------
+//  Finished segments are sealed before the next spare is opened, oldest
+//  first.  A spare that will not open is retried every second; until it
+//  does the current segment keeps growing.
+
+void  SegmentedLogger::Execute()
+{
+    std::unique_lock<std::mutex> lock(Lock);
+    for (;;)
+        {
+        if (!Finished.empty())
+            {
+            SegmentPtr seg = Finished.front();
+            lock.unlock();
+            Seal(seg);
+            lock.lock();
+            continue;
+            }
+        if (Quit)
+            break;
+        if (!Spare)
+            {
+            const unsigned long long sequence = Next;
+            lock.unlock();
+            std::string error;
+            SegmentPtr seg = Create(sequence, error);
+            lock.lock();
+            if (seg)
+                {
+                Spare = seg;
+                ++Next;
+                continue;
+                }
+            if (FError.empty())
+                FError = error;
+            Wake.wait_for(lock, std::chrono::seconds(1));
+            continue;
+            }
+        Wake.wait(lock);
+        }
+}
@@ -0,0 +1,175 @@
+// SegmentedLogger.h
+//
+// Stream file rolled over into preallocated segments, oldest retired
+
+#ifndef SegmentedLoggerH
+#define SegmentedLoggerH
+
+#include "DiskLogger.h"
+#include "PacketIndex.h"
+#include <string>
+#include <vector>
+#include <deque>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+
+//===========================================================================
+//  STRUCT SegmentHeader  -- Contents of a sealed segment's .vseg file
+//===========================================================================
+//  Written once the segment's data and index are closed, under a
+//  temporary name and then renamed, so a .vseg that exists describes a
+//  finished segment.  Little endian, as written.
+
+struct SegmentHeader
+{
+    char                Magic[8];       // "IISEGMNT"
+    unsigned int        Version;        // 1
+    unsigned int        HeaderBytes;    // sizeof(SegmentHeader)
+    unsigned long long  Sequence;       // From 1
+    unsigned long long  Offset;         // Stream bytes before this segment
+    unsigned long long  Bytes;          // In the segment file
+    unsigned long long  Packets;        // Indexed, 0 without an index
+    unsigned long long  Dropped;        // Bytes refused while it was current
+    long long           Opened;         // Seconds since 1970, UTC
+    long long           Sealed;
+    unsigned long long  TsFracFirst;    // First and last packet timestamps
+    unsigned long long  TsFracLast;
+    unsigned int        TsIntFirst;
+    unsigned int        TsIntLast;
+    unsigned char       Reserved[40];
+};
+
+//===========================================================================
+//  CLASS SegmentedLogger  -- Stream to a series of segment files
+//===========================================================================
+//  The stream goes to Data.000001.bin, Data.000002.bin and so on beside
+//  the file named to Open(), each a plain VITA stream file that replays,
+//  maps and indexes like Data.bin.  Write() moves on to the next segment
+//  before a buffer that would take the current one past SegmentBytes, or
+//  once it has been current SegmentSeconds, so segments always hold whole
+//  buffers, and so whole packets.
+//
+//  Opening a file, and reserving its space, is slow and unpredictable, so
+//  it never happens on the producer: a service thread keeps the next
+//  segment open and preallocated, and Write() only swaps it in.  The
+//  same thread closes the finished segment, writes its .vseg header, and
+//  then deletes the oldest segments beyond RetainSegments or RetainBytes.
+//  Should the spare not be ready in time the current segment simply runs
+//  long, counted by Late().
+//
+//  With Index set each segment has its own .vidx, with offsets into the
+//  segment and sample numbers counted from its start, so every segment
+//  can be processed alone.  Configure the writers as a DiskLogger.  Only
+//  one thread may call Write().
+
+class SegmentedLogger
+{
+public:
+    SegmentedLogger();
+    ~SegmentedLogger();
+
+    //  Config, read by Open()
+    unsigned long long  SegmentBytes;   // Roll over size, 0 = none
+    double              SegmentSeconds; // Roll over age, 0 = none
+    unsigned int        RetainSegments; // Sealed segments kept, 0 = all
+    unsigned long long  RetainBytes;    // ...up to this total, 0 = any
+    size_t              BlockBytes;
+    unsigned int        Depth;
+    unsigned int        Blocks;
+    unsigned long long  Reserve;        // Per segment when SegmentBytes is 0
+    bool                Direct;
+    bool                Blocking;
+    bool                Index;          // A .vidx per segment
+    unsigned int        FrameSize;      // ...and its header fields
+    unsigned int        SampleBytes;
+    double              SampleRate;
+
+    //  Segments are named after 'file', less its extension
+    bool  Open(const std::string & file);
+    //  Producer.  'index', if not 0, is the buffer's scanned packets.
+    //  False if the data was dropped.
+    bool  Write(const void * data, size_t bytes, const VitaIndex * index);
+    //  Seal the current segment and stop
+    void  Close();
+    bool  IsOpen() const
+        {  return Current.get() != 0;  }
+
+    void  WriteHistogram(LatencyHistogram * latency)
+        {  Latency = latency;  }
+
+    //  Status
+    std::string  FileName() const;              // Current segment
+    unsigned long long  Bytes() const           // Accepted, all segments
+        {  return FBytes.load();  }
+    unsigned long long  Written() const;
+    unsigned long long  Dropped() const;
+    unsigned long long  Segments() const        // Sealed
+        {  return FSealed.load();  }
+    unsigned long long  Deleted() const         // ...and retired
+        {  return FDeleted.load();  }
+    unsigned long long  Late() const            // Roll overs put off
+        {  return FLate;  }
+    std::string  Error() const;
+
+    //  Data.000012.bin for segment 12 of Data.bin
+    static std::string  SegmentName(const std::string & file, unsigned long long sequence);
+    //  Header beside a segment: its extension replaced by .vseg
+    static std::string  HeaderName(const std::string & segment);
+    static bool  ReadHeader(const std::string & segment, SegmentHeader & header);
+
+private:
+    struct Segment
+    {
+        unsigned long long                  Sequence;
+        unsigned long long                  Offset;
+        long long                           Opened;
+        long long                           Ticks;      // ...on the HiResTimer
+        unsigned long long                  Packets;
+        std::shared_ptr<DiskLogger>         Data;
+        std::shared_ptr<PacketIndexWriter>  Table;
+        unsigned long long                  TsFracFirst, TsFracLast;
+        unsigned int                        TsIntFirst, TsIntLast;
+    };
+    typedef std::shared_ptr<Segment>  SegmentPtr;
+
+    struct Retained
+    {
+        std::string                         File;
+        unsigned long long                  Bytes;
+    };
+
+    std::string                 Base;
+    SegmentPtr                  Current;        // Producer's
+    SegmentPtr                  Spare;          // Next, opened ahead
+    std::deque<SegmentPtr>      Finished;       // Awaiting the seal
+    std::deque<Retained>        Kept;           // Sealed, oldest first
+    unsigned long long          KeptBytes;
+    unsigned long long          Next;           // Sequence of the next spare
+    std::thread                 Thread;
+    mutable std::mutex          Lock;
+    std::condition_variable     Wake;
+    bool                        Quit;
+    LatencyHistogram *          Latency;
+
+    std::atomic<unsigned long long>     FBytes;
+    std::atomic<unsigned long long>     FSealed;
+    std::atomic<unsigned long long>     FDeleted;
+    unsigned long long          FWritten;       // Of sealed segments
+    unsigned long long          FDropped;
+    unsigned long long          FLate;
+    std::string                 FError;
+
+    SegmentPtr  Create(unsigned long long sequence, std::string & error) const;
+    void  Roll();
+    void  Seal(const SegmentPtr & segment);
+    void  Retire();
+    void  Execute();
+
+    SegmentedLogger(const SegmentedLogger &);
+    SegmentedLogger & operator=(const SegmentedLogger &);
+};
+
+#endif
@@ -0,0 +1,30 @@
+// StreamSink.h
+//
+// Destination interface for demultiplexed stream payload
+
+#ifndef StreamSinkH
+#define StreamSinkH
+
+#include <cstddef>
+
+//===========================================================================
+//  CLASS IStreamSink  -- Consumer of one stream's raw payload
+//===========================================================================
+//  VitaDemux routes a SID either to a flat preallocated buffer or to a
+//  sink.  Write() is called on the ingest worker that owns the stream,
+//  once per VITA packet, with the payload still in the received buffer.
+
+class IStreamSink
+{
+public:
+    virtual ~IStreamSink()  {  }
+
+    //  Consume 'words' of payload.  Returns bytes accepted; the rest is
+    //  counted as overflow by the caller.
+    virtual size_t  Write(const unsigned int * payload, size_t words) = 0;
+    //  True once the sink will accept no more data
+    virtual bool    Full() const
+        {  return false;  }
+};
+
+#endif
@@ -0,0 +1,440 @@
+// StripedLogger.cpp
+//
+// Stream file striped across volumes, with a manifest to reassemble it
+
+#include "StripedLogger.h"
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+#include <cstdlib>
+
+namespace
+{
+    const unsigned long long Sector = 4096;
+}
+
+//===========================================================================
+//  STRUCT StripeManifest  -- Layout of a striped stream file
+//===========================================================================
+//---------------------------------------------------------------------------
+//  StripeManifest::Save() --  Write the manifest
+//---------------------------------------------------------------------------
+
+bool  StripeManifest::Save(const std::string & file) const
+{
+    std::ofstream out(file.c_str(), std::ios::out | std::ios::trunc);
+    if (!out)
+        return false;
+    out << "StripeManifest=1\n"
+        << "ExtentBytes=" << ExtentBytes << "\n"
+        << "Bytes=" << Bytes << "\n"
+        << "Stripes=" << Files.size() << "\n";
+    for (size_t s = 0; s < Files.size(); ++s)
+        out << "Stripe" << s << "=" << Files[s] << "\n";
+    return out.good();
+}
+
+//---------------------------------------------------------------------------
+//  StripeManifest::Load() --  Read a manifest
+//---------------------------------------------------------------------------
+//  Bytes of 0 means the capture did not close cleanly; read the stripes
+//  to their ends.
+
+bool  StripeManifest::Load(const std::string & file)
+{
+    std::ifstream in(file.c_str());
+    if (!in)
+        return false;
+
+    ExtentBytes = 0;
+    Bytes = 0;
+    Files.clear();
+    size_t stripes = 0;
+    bool tagged = false;
+    std::string line;
+    while (std::getline(in, line))
+        {
+        if (!line.empty() && line[line.size() - 1] == '\r')
+            line.erase(line.size() - 1);
+        const size_t eq = line.find('=');
+        if (eq == std::string::npos)
+            continue;
+        const std::string key = line.substr(0, eq);
+        const std::string value = line.substr(eq + 1);
+        std::istringstream number(value);
+        if (key == "StripeManifest")
+            tagged = true;
+        else if (key == "ExtentBytes")
+            number >> ExtentBytes;
+        else if (key == "Bytes")
+            number >> Bytes;
+        else if (key == "Stripes")
+            {
+            number >> stripes;
+            Files.assign(stripes, std::string());
+            }
+        else if (key.compare(0, 6, "Stripe") == 0)
+            {
+            const size_t s = static_cast<size_t>(std::strtoul(key.c_str() + 6, 0, 10));
+            if (s < Files.size())
+                Files[s] = value;
+            }
+        }
+
+    return tagged && ExtentBytes && !Files.empty() &&
+        std::find(Files.begin(), Files.end(), std::string()) == Files.end();
+}
+
+//---------------------------------------------------------------------------
+//  StripeManifest::Locate() --  Stripe and position of a stream offset
+//---------------------------------------------------------------------------
+
+void  StripeManifest::Locate(unsigned long long offset, size_t & stripe, unsigned long long & position) const
+{
+    if (!ExtentBytes || Files.size() < 2)
+        {
+        stripe = 0;
+        position = offset;
+        return;
+        }
+    const unsigned long long extent = offset / ExtentBytes;
+    stripe = static_cast<size_t>(extent % Files.size());
+    position = extent / Files.size() * ExtentBytes + offset % ExtentBytes;
+}
+
+//---------------------------------------------------------------------------
+//  StripeManifest::StripeBytes() --  Length of one stripe file
+//---------------------------------------------------------------------------
+
+unsigned long long  StripeManifest::StripeBytes(size_t s) const
+{
+    if (!ExtentBytes || Files.size() < 2)
+        return s ? 0 : Bytes;
+    const unsigned long long cycle = ExtentBytes * Files.size();
+    const unsigned long long rest = Bytes % cycle;
+    const unsigned long long start = ExtentBytes * s;
+    const unsigned long long tail = rest > start ? std::min(rest - start, ExtentBytes) : 0;
+    return Bytes / cycle * ExtentBytes + tail;
+}
+
+//---------------------------------------------------------------------------
+//  StripeManifest::IsManifest() --  Whether a file name is a manifest
+//---------------------------------------------------------------------------
+
+bool  StripeManifest::IsManifest(const std::string & file)
+{
+    const std::string ext(Extension());
+    return file.size() > ext.size() && file.compare(file.size() - ext.size(), ext.size(), ext) == 0;
+}
+
+//===========================================================================
+//  CLASS StripedLogger  -- DiskLogger per volume, extents round-robin
+//===========================================================================
+//---------------------------------------------------------------------------
+//  constructor for class StripedLogger
+//---------------------------------------------------------------------------
+
+StripedLogger::StripedLogger()
+    : ExtentBytes(64 * 1024 * 1024), BlockBytes(4 * 1024 * 1024), Depth(4), Blocks(0),
+      Reserve(0), Direct(true), Uring(true), Blocking(false), Position(0), FDropped(0),
+      Latency(0)
+{
+}
+
+//---------------------------------------------------------------------------
+//  destructor for class StripedLogger
+//---------------------------------------------------------------------------
+
+StripedLogger::~StripedLogger()
+{
+    Close();
+}
+
+//---------------------------------------------------------------------------
+//  StripedLogger::Open() --  Create the stripes and the manifest
+//---------------------------------------------------------------------------
+
+bool  StripedLogger::Open(const std::vector<std::string> & files, const std::string & manifest)
+{
+    Close();
+    Stripes.clear();
+    FManifestFile.clear();
+    FError.clear();
+    Position = 0;
+    FDropped = 0;
+    if (files.empty())
+        {
+        FError = "No stripe files";
+        return false;
+        }
+
+    for (size_t s = 0; s < files.size(); ++s)
+        {
+        std::shared_ptr<DiskLogger> disk = std::make_shared<DiskLogger>();
+        disk->BlockBytes = BlockBytes;
+        disk->Depth = Depth;
+        disk->Blocks = Blocks;
+        disk->Reserve = Reserve;
+        disk->Direct = Direct;
+        disk->Uring = Uring;
+        disk->Blocking = Blocking;
+        disk->WriteHistogram(Latency);
+        if (!disk->Open(files[s]))
+            {
+            FError = disk->Error();
+            Close();
+            Stripes.clear();
+            return false;
+            }
+        Stripes.push_back(disk);
+        }
+
+    Need.assign(files.size(), 0);
+    Manifest = StripeManifest();
+    Manifest.Files = files;
+    Manifest.ExtentBytes = std::max((ExtentBytes + Sector - 1) / Sector * Sector, Sector);
+    FManifestFile = files.size() > 1 ? manifest : std::string();
+    if (!FManifestFile.empty() && !Manifest.Save(FManifestFile))
+        {
+        FError = "Cannot write " + FManifestFile;
+        Close();
+        Stripes.clear();
+        return false;
+        }
+    return true;
+}
+
+//---------------------------------------------------------------------------
+//  StripedLogger::Write() --  Deal data to the stripes
+//---------------------------------------------------------------------------
+
+bool  StripedLogger::Write(const void * data, size_t bytes)
+{
+    if (!IsOpen() || !bytes)
+        return !bytes;
+    if (Stripes.size() == 1)
+        {
+        Position += bytes;
+        return Stripes[0]->Write(data, bytes);
+        }
+
+    const unsigned long long extent = Manifest.ExtentBytes;
+
+    //  All or nothing: every stripe touched must have room first.  Only
+    //  this thread fills the stripes, so the room can only grow.
+    if (!Blocking)
+        {
+        std::fill(Need.begin(), Need.end(), 0);
+        unsigned long long pos = Position;
+        for (size_t left = bytes; left; )
+            {
+            size_t stripe;
+            unsigned long long at;
+            Manifest.Locate(pos, stripe, at);
+            const size_t piece = static_cast<size_t>(std::min<unsigned long long>(left, extent - pos % extent));
+            Need[stripe] += piece;
+            pos += piece;
+            left -= piece;
+            }
+        for (size_t s = 0; s < Stripes.size(); ++s)
+            if (Need[s] && !Stripes[s]->Room(Need[s]))
+                {
+                FDropped += bytes;
+                return false;
+                }
+        }
+
+    const char * src = static_cast<const char *>(data);
+    size_t left = bytes;
+    while (left)
+        {
+        size_t stripe;
+        unsigned long long at;
+        Manifest.Locate(Position, stripe, at);
+        const size_t piece = static_cast<size_t>(std::min<unsigned long long>(left, extent - Position % extent));
+        Stripes[stripe]->Write(src, piece);
+        src += piece;
+        left -= piece;
+        Position += piece;
+        }
+    return true;
+}
+
+//---------------------------------------------------------------------------
+//  StripedLogger::Close() --  Flush every stripe, finish the manifest
+//---------------------------------------------------------------------------
+
+void  StripedLogger::Close()
+{
+    if (!IsOpen())
+        return;
+
+    for (size_t s = 0; s < Stripes.size(); ++s)
+        Stripes[s]->Close();
+
+    if (!FManifestFile.empty())
+        {
+        Manifest.Bytes = Position;
+        if (!Manifest.Save(FManifestFile) && FError.empty())
+            FError = "Cannot write " + FManifestFile;
+        }
+}
+
+//---------------------------------------------------------------------------
+//  StripedLogger::Bytes() --  Stream bytes accepted
+//---------------------------------------------------------------------------
+
+unsigned long long  StripedLogger::Bytes() const
+{
+    unsigned long long bytes = 0;
+    for (size_t s = 0; s < Stripes.size(); ++s)
+        bytes += Stripes[s]->Bytes();
+    return bytes;
+}
+
+//---------------------------------------------------------------------------
+//  StripedLogger::Written() --  Stream bytes on disk
+//---------------------------------------------------------------------------
+
+unsigned long long  StripedLogger::Written() const
+{
+    unsigned long long bytes = 0;
+    for (size_t s = 0; s < Stripes.size(); ++s)
+        bytes += Stripes[s]->Written();
+    return bytes;
+}
+
+//---------------------------------------------------------------------------
+//  StripedLogger::Dropped() --  Stream bytes refused or lost
+//---------------------------------------------------------------------------
+
+unsigned long long  StripedLogger::Dropped() const
+{
+    unsigned long long bytes = FDropped;
+    for (size_t s = 0; s < Stripes.size(); ++s)
+        bytes += Stripes[s]->Dropped();
+    return bytes;
+}
+
+//---------------------------------------------------------------------------
+//  StripedLogger::Error() --  First error, empty if none
+//---------------------------------------------------------------------------
+
+std::string  StripedLogger::Error() const
+{
+    if (!FError.empty())
+        return FError;
+    for (size_t s = 0; s < Stripes.size(); ++s)
+        {
+        const std::string error = Stripes[s]->Error();
+        if (!error.empty())
+            return error;
+        }
+    return std::string();
+}
+
+//===========================================================================
+//  CLASS StripeReader  -- Sequential read of a striped or plain file
+//===========================================================================
+//---------------------------------------------------------------------------
+//  constructor for class StripeReader
+//---------------------------------------------------------------------------
+
+StripeReader::StripeReader()
+    : Position(0)
+{
+}
+
+//---------------------------------------------------------------------------
+//  destructor for class StripeReader
+//---------------------------------------------------------------------------
+
+StripeReader::~StripeReader()
+{
+    Close();
+}
+
+//---------------------------------------------------------------------------
+//  StripeReader::Open() --  Open a manifest's stripes, or a plain file
+//---------------------------------------------------------------------------
+
+bool  StripeReader::Open(const std::string & file)
+{
+    Close();
+    Manifest = StripeManifest();
+    if (StripeManifest::IsManifest(file))
+        {
+        if (!Manifest.Load(file))
+            return false;
+        }
+    else
+        Manifest.Files.push_back(file);
+
+    for (size_t s = 0; s < Manifest.Files.size(); ++s)
+        {
+        std::FILE * f = std::fopen(Manifest.Files[s].c_str(), "rb");
+        if (!f)
+            {
+            Close();
+            return false;
+            }
+        Files.push_back(f);
+        }
+    Position = 0;
+    return true;
+}
+
+//---------------------------------------------------------------------------
+//  StripeReader::Close() --  Close the stripe files
+//---------------------------------------------------------------------------
+
+void  StripeReader::Close()
+{
+    for (size_t s = 0; s < Files.size(); ++s)
+        std::fclose(Files[s]);
+    Files.clear();
+}
+
+//---------------------------------------------------------------------------
+//  StripeReader::Read() --  Next bytes of the stream
+//---------------------------------------------------------------------------
+
+size_t  StripeReader::Read(void * data, size_t bytes)
+{
+    char * dst = static_cast<char *>(data);
+    const unsigned long long extent = Files.size() > 1 ? Manifest.ExtentBytes : 0;
+    size_t done = 0;
+    while (done < bytes && !Files.empty())
+        {
+        unsigned long long want = bytes - done;
+        if (extent)
+            want = std::min(want, extent - Position % extent);
+        if (Manifest.Bytes)
+            {
+            if (Position >= Manifest.Bytes)
+                break;
+            want = std::min(want, Manifest.Bytes - Position);
+            }
+
+        size_t stripe;
+        unsigned long long at;
+        Manifest.Locate(Position, stripe, at);
+        const size_t got = std::fread(dst + done, 1, static_cast<size_t>(want), Files[stripe]);
+        done += got;
+        Position += got;
+        if (got < want)
+            break;
+        }
+    return done;
+}
+
+//---------------------------------------------------------------------------
+//  StripeReader::Rewind() --  Back to the start of the stream
+//---------------------------------------------------------------------------
+
+void  StripeReader::Rewind()
+{
+    for (size_t s = 0; s < Files.size(); ++s)
+        std::rewind(Files[s]);
+    Position = 0;
+}
@@ -0,0 +1,137 @@
+// StripedLogger.h
+//
+// Stream file striped across volumes, with a manifest to reassemble it
+
+#ifndef StripedLoggerH
+#define StripedLoggerH
+
+#include "DiskLogger.h"
+#include <string>
+#include <vector>
+#include <memory>
+#include <cstdio>
+
+//===========================================================================
+//  STRUCT StripeManifest  -- Layout of a striped stream file
+//===========================================================================
+//  The stream is cut into extents of ExtentBytes, dealt round-robin to the
+//  stripe files: extent k is the (k / stripes)'th extent of stripe
+//  k % stripes.  Stored as a short "key=value" text file; stripe paths are
+//  kept as written.  A single stripe with no manifest is a plain file.
+
+struct StripeManifest
+{
+    StripeManifest()
+        : ExtentBytes(0), Bytes(0)
+        {}
+
+    unsigned long long          ExtentBytes;
+    unsigned long long          Bytes;          // Stream length
+    std::vector<std::string>    Files;          // One per stripe, in order
+
+    bool  Save(const std::string & file) const;
+    bool  Load(const std::string & file);
+
+    //  Stripe and position in it of stream byte 'offset'
+    void  Locate(unsigned long long offset, size_t & stripe, unsigned long long & position) const;
+    //  Bytes in stripe 's' for a stream of Bytes
+    unsigned long long  StripeBytes(size_t s) const;
+
+    static bool  IsManifest(const std::string & file);
+    static const char *  Extension()
+        {  return ".manifest";  }
+};
+
+//===========================================================================
+//  CLASS StripedLogger  -- DiskLogger per volume, extents round-robin
+//===========================================================================
+//  Each stripe has its own writer thread and queue, so N volumes sustain
+//  about N times one volume's rate.  A write lands whole or is dropped
+//  whole across all the stripes it touches, so the stripes never drift
+//  out of step.  With one file the manifest is skipped and this is a plain
+//  DiskLogger.  Configure as a DiskLogger; Reserve is per stripe.
+
+class StripedLogger
+{
+public:
+    StripedLogger();
+    ~StripedLogger();
+
+    //  Config, read by Open()
+    unsigned long long  ExtentBytes;    // Rounded to 4 KB
+    size_t              BlockBytes;
+    unsigned int        Depth;
+    unsigned int        Blocks;
+    unsigned long long  Reserve;
+    bool                Direct;
+    bool                Uring;
+    bool                Blocking;
+
+    //  'files' are the stripes in order; 'manifest' is written when there
+    //  is more than one.
+    bool  Open(const std::vector<std::string> & files, const std::string & manifest);
+    bool  Write(const void * data, size_t bytes);
+    void  Close();
+    bool  IsOpen() const
+        {  return !Stripes.empty() && Stripes[0]->IsOpen();  }
+
+    void  WriteHistogram(LatencyHistogram * latency)
+        {  Latency = latency;  }
+
+    //  Status
+    size_t  Count() const
+        {  return Stripes.size();  }
+    const DiskLogger &  Stripe(size_t s) const
+        {  return *Stripes[s];  }
+    const std::string &  ManifestFile() const
+        {  return FManifestFile;  }
+    unsigned long long  Bytes() const;
+    unsigned long long  Written() const;
+    unsigned long long  Dropped() const;
+    std::string  Error() const;
+
+private:
+    std::vector< std::shared_ptr<DiskLogger> >  Stripes;
+    StripeManifest                      Manifest;
+    std::string                         FManifestFile;
+    std::string                         FError;
+    unsigned long long                  Position;       // Stream bytes accepted
+    unsigned long long                  FDropped;       // ...and refused
+    std::vector<size_t>                 Need;           // Bytes per stripe of one write
+    LatencyHistogram *                  Latency;
+
+    StripedLogger(const StripedLogger &);
+    StripedLogger & operator=(const StripedLogger &);
+};
+
+//===========================================================================
+//  CLASS StripeReader  -- Sequential read of a striped or plain file
+//===========================================================================
+//  Open() takes either a manifest or an ordinary file.  Read() returns the
+//  stream in order, switching stripe at each extent boundary.
+
+class StripeReader
+{
+public:
+    StripeReader();
+    ~StripeReader();
+
+    bool  Open(const std::string & file);
+    void  Close();
+    //  Bytes read, short only at the end of the stream
+    size_t  Read(void * data, size_t bytes);
+    void  Rewind();
+
+    const StripeManifest &  Layout() const
+        {  return Manifest;  }
+
+private:
+    StripeManifest              Manifest;
+    std::vector<std::FILE *>    Files;
+    unsigned long long          Position;
+
+    StripeReader(const StripeReader &);
+    StripeReader & operator=(const StripeReader &);
+};
+
+#endif
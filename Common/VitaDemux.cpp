@@ -0,0 +1,293 @@
+// VitaDemux.cpp
+//
+// Table-driven VITA stream demultiplexer
+
+#include "VitaDemux.h"
+#include "HiResTimer.h"
+
+//===========================================================================
+//  CLASS VitaDemux  -- Route VITA packets to per-stream destinations
+//===========================================================================
+//---------------------------------------------------------------------------
+//  constructor for class VitaDemux
+//---------------------------------------------------------------------------
+
+VitaDemux::VitaDemux()
+    : PacketTimes(0), PacketSizes(0), Lookup(256, -1), FUnrouted(0), FMalformed(0),
+      FGapLimit(4096), FTimestampRate(0.0)
+{
+}
+
+//---------------------------------------------------------------------------
+//  VitaDemux::Add() --  Add a stream to the routing table
+//---------------------------------------------------------------------------
+
+void  VitaDemux::Add(unsigned int sid, char * dest, size_t bytes, size_t sample_bytes, CopyFtn copy)
+{
+    Route r;
+    r.Sid = sid;
+    r.Dest = dest;
+    r.Sink = 0;
+    r.Capacity = bytes;
+    r.Filled = 0;
+    r.SampleBytes = sample_bytes;
+    r.Packets = 0;
+    r.Overflow = 0;
+    r.Copy = copy;
+
+    //  Re-routing an existing SID replaces its destination
+    const int existing = Find(sid);
+    if (existing >= 0)
+        {
+        Routes[existing] = r;
+        Public[existing].reset(new Shown);
+        return;
+        }
+
+    Routes.push_back(r);
+    Public.push_back(std::shared_ptr<Shown>(new Shown));
+    if (Lookup[sid & 0xFF] < 0)
+        Lookup[sid & 0xFF] = static_cast<int>(Routes.size() - 1);
+}
+
+//---------------------------------------------------------------------------
+//  VitaDemux::AddSink() --  Route a stream to a sink instead of a buffer
+//---------------------------------------------------------------------------
+
+void  VitaDemux::AddSink(unsigned int sid, IStreamSink * sink, size_t sample_bytes)
+{
+    Add(sid, 0, static_cast<size_t>(-1), sample_bytes, 0);
+    Routes[Find(sid)].Sink = sink;
+}
+
+//---------------------------------------------------------------------------
+//  VitaDemux::Clear() --  Empty the routing table
+//---------------------------------------------------------------------------
+
+void  VitaDemux::Clear()
+{
+    Routes.clear();
+    Public.clear();
+    std::fill(Lookup.begin(), Lookup.end(), -1);
+    FUnrouted = 0;
+    FMalformed = 0;
+    GapMap.clear();
+}
+
+//---------------------------------------------------------------------------
+//  VitaDemux::Rewind() --  Restart filling all destinations from the top
+//---------------------------------------------------------------------------
+
+void  VitaDemux::Rewind()
+{
+    for (size_t i = 0; i < Routes.size(); ++i)
+        {
+        Routes[i].Filled = 0;
+        Routes[i].Packets = 0;
+        Routes[i].Overflow = 0;
+        Routes[i].Sequence.Reset();
+        }
+    FUnrouted = 0;
+    FMalformed = 0;
+    GapMap.clear();
+    Publish();
+}
+
+//---------------------------------------------------------------------------
+//  VitaDemux::FindSlow() --  Lookup for SIDs colliding in the fast table
+//---------------------------------------------------------------------------
+
+int  VitaDemux::FindSlow(unsigned int sid) const
+{
+    for (size_t i = 0; i < Routes.size(); ++i)
+        if (Routes[i].Sid == sid)
+            return static_cast<int>(i);
+    return -1;
+}
+
+//---------------------------------------------------------------------------
+//  VitaDemux::Destinations() --  Number of streams stored here, not skipped
+//---------------------------------------------------------------------------
+
+size_t  VitaDemux::Destinations() const
+{
+    size_t count = 0;
+    for (size_t i = 0; i < Routes.size(); ++i)
+        if (Routes[i].Dest || Routes[i].Sink)
+            ++count;
+    return count;
+}
+
+//---------------------------------------------------------------------------
+//  VitaDemux::Full() --  True once every destination is filled
+//---------------------------------------------------------------------------
+
+bool  VitaDemux::Full() const
+{
+    bool any = false;
+    for (size_t i = 0; i < Routes.size(); ++i)
+        {
+        const Route & r = Routes[i];
+        if (r.Sink)
+            {
+            if (!r.Sink->Full())
+                return false;
+            }
+        else if (!r.Dest)
+            continue;
+        else if (r.Capacity - r.Filled >= r.SampleBytes)
+            return false;
+        any = true;
+        }
+    return any;
+}
+
+//---------------------------------------------------------------------------
+//  VitaDemux::Process() --  Route all packets in a block of VITA words
+//---------------------------------------------------------------------------
+//  Unknown SIDs are skipped rather than ending the pass, so one walk over
+//  the buffer handles every stream present.
+
+size_t  VitaDemux::Process(const unsigned int * words, size_t count)
+{
+    size_t stored = 0;
+    size_t offset = 0;
+    VitaPacketInfo info;
+    long long from = PacketTimes ? HiResTimer::Ticks() : 0;
+
+    while (offset < count)
+        {
+        if (!Vita::Decode(words, count, offset, info))
+            {
+            ++FMalformed;
+            break;
+            }
+        offset += info.Words;
+        stored += PacketTimes || PacketSizes ? Timed(info, words, from) : Deliver(info, words);
+        }
+
+    Publish();
+    return stored;
+}
+
+//---------------------------------------------------------------------------
+//  VitaDemux::Process() --  Route all packets listed in an index
+//---------------------------------------------------------------------------
+//  Second pass of the two-pass path: headers were parsed once by
+//  VitaIndex::Scan(), possibly for several demultiplexers sharing the
+//  buffer, so this is a straight run of lookups and copies.
+
+size_t  VitaDemux::Process(const VitaIndex & index, const unsigned int * words)
+{
+    size_t stored = 0;
+    const size_t count = index.Size();
+    if (PacketTimes || PacketSizes)
+        {
+        long long from = PacketTimes ? HiResTimer::Ticks() : 0;
+        for (size_t i = 0; i < count; ++i)
+            stored += Timed(index[i], words, from);
+        }
+    else
+        for (size_t i = 0; i < count; ++i)
+            stored += Deliver(index[i], words);
+    if (index.Truncated())
+        ++FMalformed;
+
+    Publish();
+    return stored;
+}
+
+//---------------------------------------------------------------------------
+//  VitaDemux::Deliver() --  Hand one packet's payload to its route
+//---------------------------------------------------------------------------
+
+size_t  VitaDemux::Deliver(const VitaPacketInfo & info, const unsigned int * words)
+{
+    const int idx = Find(info.Sid);
+    if (idx < 0)
+        {
+        ++FUnrouted;
+        return 0;
+        }
+
+    Route & r = Routes[idx];
+    const unsigned int * payload = words + info.Offset + info.PayloadOffset;
+    size_t done;
+    if (r.Sink)
+        done = r.Sink->Write(payload, info.PayloadWords);
+    else if (r.Dest)
+        done = r.Copy(r.Dest + r.Filled, r.Capacity - r.Filled, payload, info.PayloadWords);
+    else
+        return 0;
+
+    VitaGap gap;
+    const size_t samples = info.PayloadWords * sizeof(unsigned int) / r.SampleBytes;
+    if (r.Sequence.Check(info, samples, FTimestampRate, gap) && GapMap.size() < FGapLimit)
+        GapMap.push_back(gap);
+
+    r.Filled += done;
+    r.Overflow += info.PayloadWords * sizeof(unsigned int) - done;
+    ++r.Packets;
+    return done;
+}
+
+//---------------------------------------------------------------------------
+//  VitaDemux::Timed() --  Deliver() with the packet's time and size noted
+//---------------------------------------------------------------------------
+//  'from' is when the previous packet finished, so one tick read a packet
+//  times it.  Packets of streams stored elsewhere are not recorded, so
+//  workers sharing a buffer record each packet once.
+
+size_t  VitaDemux::Timed(const VitaPacketInfo & info, const unsigned int * words, long long & from)
+{
+    const size_t done = Deliver(info, words);
+    const int idx = Find(info.Sid);
+    const bool stored = idx >= 0 && (Routes[idx].Dest || Routes[idx].Sink);
+    if (PacketTimes)
+        {
+        const long long now = HiResTimer::Ticks();
+        if (stored && now > from)
+            PacketTimes->Record(static_cast<unsigned long long>(HiResTimer::ToSeconds(now - from) * 1.0e9));
+        from = now;
+        }
+    if (PacketSizes && stored)
+        PacketSizes->Record(info.Words * sizeof(unsigned int));
+    return done;
+}
+
+//---------------------------------------------------------------------------
+//  VitaDemux::Publish() --  Copy the route counters out for other threads
+//---------------------------------------------------------------------------
+
+void  VitaDemux::Publish()
+{
+    for (size_t i = 0; i < Routes.size(); ++i)
+        {
+        const Route & r = Routes[i];
+        Shown & s = *Public[i];
+        s.Packets.store(r.Packets, std::memory_order_relaxed);
+        s.Filled.store(r.Filled, std::memory_order_relaxed);
+        s.Overflow.store(r.Overflow, std::memory_order_relaxed);
+        s.Gaps.store(r.Sequence.Gaps(), std::memory_order_relaxed);
+        s.MissingPackets.store(r.Sequence.MissingPackets(), std::memory_order_relaxed);
+        s.MissingSamples.store(r.Sequence.MissingSamples(), std::memory_order_relaxed);
+        }
+}
+
+//---------------------------------------------------------------------------
+//  VitaDemux::Published() --  A route's counters as last published
+//---------------------------------------------------------------------------
+
+VitaDemux::Totals  VitaDemux::Published(size_t idx) const
+{
+    const Shown & s = *Public[idx];
+    Totals t;
+    t.Sid = Routes[idx].Sid;
+    t.Packets = s.Packets.load(std::memory_order_relaxed);
+    t.Filled = s.Filled.load(std::memory_order_relaxed);
+    t.Overflow = s.Overflow.load(std::memory_order_relaxed);
+    t.Gaps = s.Gaps.load(std::memory_order_relaxed);
+    t.MissingPackets = s.MissingPackets.load(std::memory_order_relaxed);
+    t.MissingSamples = s.MissingSamples.load(std::memory_order_relaxed);
+    return t;
+}
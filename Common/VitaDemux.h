@@ -0,0 +1,168 @@
+// VitaDemux.h
+//
+// Table-driven VITA stream demultiplexer
+
+#ifndef VitaDemuxH
+#define VitaDemuxH
+
+#include "VitaHeader.h"
+#include "VitaIndex.h"
+#include "VitaSequence.h"
+#include "StreamSink.h"
+#include "LatencyHistogram.h"
+#include <vector>
+#include <memory>
+#include <atomic>
+#include <cstring>
+#include <algorithm>
+
+//===========================================================================
+//  CopySamples<T>()  -- Per sample-width payload copy
+//===========================================================================
+//  Copies whole samples of type T from a VITA payload into the room left in
+//  a destination.  Instantiated once per sample width so the element math
+//  folds to shifts at compile time.  Returns bytes copied.
+
+template <typename T>
+inline size_t  CopySamples(char * dst, size_t room, const unsigned int * src, size_t words)
+{
+    const size_t avail = words * sizeof(unsigned int) / sizeof(T);
+    const size_t n = std::min(avail, room / sizeof(T));
+    std::memcpy(dst, src, n * sizeof(T));
+    return n * sizeof(T);
+}
+
+//===========================================================================
+//  CLASS VitaDemux  -- Route VITA packets to per-stream destinations
+//===========================================================================
+//  Streams stored here (not skipped) are also checked for continuity; the
+//  first GapLimit() discontinuities are kept in a gap map.
+//
+//  Routes belong to the thread calling Process().  Other threads read a
+//  stream's totals through Published(), which Process() refreshes at the
+//  end of every block, and are given per-packet times and sizes through
+//  the histograms set by Instrument().
+
+class VitaDemux
+{
+public:
+    typedef size_t (*CopyFtn)(char * dst, size_t room, const unsigned int * src, size_t words);
+
+    struct Route
+    {
+        unsigned int        Sid;
+        char *              Dest;           // Preallocated destination, or
+        IStreamSink *       Sink;           // ...sink taking the payload
+        size_t              Capacity;       // ...size in bytes
+        size_t              Filled;         // Bytes written so far
+        size_t              SampleBytes;
+        unsigned long long  Packets;        // Packets routed
+        unsigned long long  Overflow;       // Bytes dropped, destination full
+        CopyFtn             Copy;
+        VitaSequence        Sequence;       // Packet loss accounting
+    };
+
+    //  A route's counters as Process() last published them
+    struct Totals
+    {
+        unsigned int        Sid;
+        unsigned long long  Packets;
+        unsigned long long  Filled;
+        unsigned long long  Overflow;
+        unsigned long long  Gaps;
+        unsigned long long  MissingPackets;
+        long long           MissingSamples;
+    };
+
+    VitaDemux();
+
+    //  Routing Table
+    template <typename T>
+    void  AddStream(unsigned int sid, T * dest, size_t samples)
+        {  Add(sid, reinterpret_cast<char *>(dest), samples * sizeof(T), sizeof(T), &CopySamples<T>);  }
+    void  AddSink(unsigned int sid, IStreamSink * sink, size_t sample_bytes);
+    //  Known stream handled elsewhere: skipped without counting as unrouted
+    void  SkipStream(unsigned int sid)
+        {  Add(sid, 0, 0, 1, &CopySamples<char>);  }
+    void  Clear();
+    void  Rewind();
+
+    //  Continuity checking
+    //  Sample clock, Hz, for sample-count timestamps crossing a second
+    void  TimestampRate(double hz)
+        {  FTimestampRate = hz;  }
+    void  GapLimit(size_t gaps)
+        {  FGapLimit = gaps;  }
+    //  Nanoseconds to route each stored packet, and its bytes; 0 for none
+    void  Instrument(LatencyHistogram * times, LatencyHistogram * sizes)
+        {
+        PacketTimes = times;
+        PacketSizes = sizes;
+        }
+    const std::vector<VitaGap> &  Gaps() const
+        {  return GapMap;  }
+
+    int   Find(unsigned int sid) const
+        {
+        const int idx = Lookup[sid & 0xFF];
+        if (idx >= 0 && Routes[idx].Sid == sid)
+            return idx;
+        return FindSlow(sid);
+        }
+
+    //  Route every packet in a block of VITA words.  Returns payload
+    //  bytes stored across all streams.
+    size_t  Process(const unsigned int * words, size_t count);
+    //  Same, from a pre-scanned index of the block
+    size_t  Process(const VitaIndex & index, const unsigned int * words);
+
+    //  Status
+    size_t  Streams() const
+        {  return Routes.size();  }
+    const Route &  Stream(size_t idx) const
+        {  return Routes[idx];  }
+    size_t  Samples(size_t idx) const
+        {  return Routes[idx].Filled / Routes[idx].SampleBytes;  }
+    //  Safe from any thread while Process() runs
+    Totals  Published(size_t idx) const;
+    size_t  Destinations() const;
+    bool    Full() const;       // Every destination filled
+    unsigned long long  Unrouted() const
+        {  return FUnrouted;  }
+    unsigned long long  Malformed() const
+        {  return FMalformed;  }
+
+private:
+    struct Shown
+    {
+        Shown()
+            : Packets(0), Filled(0), Overflow(0), Gaps(0), MissingPackets(0), MissingSamples(0)
+            {}
+
+        std::atomic<unsigned long long>     Packets;
+        std::atomic<unsigned long long>     Filled;
+        std::atomic<unsigned long long>     Overflow;
+        std::atomic<unsigned long long>     Gaps;
+        std::atomic<unsigned long long>     MissingPackets;
+        std::atomic<long long>              MissingSamples;
+    };
+
+    std::vector<Route>  Routes;
+    std::vector< std::shared_ptr<Shown> >  Public;  // Per route, for Published()
+    LatencyHistogram *  PacketTimes;
+    LatencyHistogram *  PacketSizes;
+    std::vector<int>    Lookup;         // (sid & 0xFF) -> route index, -1 if none
+    unsigned long long  FUnrouted;
+    unsigned long long  FMalformed;
+    std::vector<VitaGap>    GapMap;
+    size_t              FGapLimit;
+    double              FTimestampRate;
+
+    void  Add(unsigned int sid, char * dest, size_t bytes, size_t sample_bytes, CopyFtn copy);
+    size_t  Deliver(const VitaPacketInfo & info, const unsigned int * words);
+    size_t  Timed(const VitaPacketInfo & info, const unsigned int * words, long long & from);
+    void  Publish();
+    int   FindSlow(unsigned int sid) const;
+};
+
+#endif
@@ -0,0 +1,242 @@
+// VitaFile.cpp
+//
+// Memory mapped, indexed view of a recorded VITA stream file
+
+#include "VitaFile.h"
+#include "PacketIndex.h"
+#include <algorithm>
+#include <cstring>
+
+namespace
+{
+    //  Words indexed per VitaIndex pass; bounds the scratch index
+    const size_t Window = 16 * 1024 * 1024;
+}
+
+//===========================================================================
+//  CLASS VitaFile  -- Read a capture file straight from the page cache
+//===========================================================================
+//---------------------------------------------------------------------------
+//  constructor for class VitaFile
+//---------------------------------------------------------------------------
+
+VitaFile::VitaFile()
+    : SampleBytes(sizeof(short)), FBytes(0), FSkipped(0), FIndexed(0)
+{
+}
+
+//---------------------------------------------------------------------------
+//  destructor for class VitaFile
+//---------------------------------------------------------------------------
+
+VitaFile::~VitaFile()
+{
+    Close();
+}
+
+//---------------------------------------------------------------------------
+//  VitaFile::Open() --  Map a capture and index its packets
+//---------------------------------------------------------------------------
+//  A .vidx sidecar saves the header scan for as much of the file as it
+//  covers, provided its packets tile the file from the start; the rest is
+//  scanned as usual.
+
+bool  VitaFile::Open(const std::string & file)
+{
+    Close();
+    FFileName = file;
+    FError.clear();
+    if (!SampleBytes)
+        SampleBytes = sizeof(short);
+
+    if (!Map.Open(file))
+        {
+        FError = Map.Error();
+        return false;
+        }
+    FBytes = Map.Bytes();
+    FSkipped = FBytes % sizeof(unsigned int);
+    Index(Load(PacketIndexFile::SidecarName(file)));
+    return true;
+}
+
+//---------------------------------------------------------------------------
+//  VitaFile::Close() --  Unmap and forget the index
+//---------------------------------------------------------------------------
+
+void  VitaFile::Close()
+{
+    Map.Close();
+    FBytes = 0;
+    FSkipped = 0;
+    FIndexed = 0;
+    FPackets.clear();
+    FStreams.clear();
+    Lookup.clear();
+}
+
+//---------------------------------------------------------------------------
+//  VitaFile::Load() --  Take packets from a sidecar index
+//---------------------------------------------------------------------------
+//  Returns the words covered, 0 if the sidecar is missing or does not
+//  match this file.
+
+size_t  VitaFile::Load(const std::string & sidecar)
+{
+    PacketIndexFile vidx;
+    if (!vidx.Open(sidecar))
+        return 0;
+
+    const size_t count = static_cast<size_t>(FBytes / sizeof(unsigned int));
+    size_t offset = 0;
+    size_t used = 0;
+    for (; used < vidx.Records(); ++used)
+        {
+        const PacketIndexRecord & rec = vidx[used];
+        if (rec.Offset != static_cast<unsigned long long>(offset) * sizeof(unsigned int) || !rec.Words)
+            return 0;   //  Not this file
+        if (rec.Words > count - offset)
+            break;      //  File cut short since
+        offset += rec.Words;
+        }
+
+    FPackets.reserve(used);
+    for (size_t r = 0; r < used; ++r)
+        {
+        const PacketIndexRecord & rec = vidx[r];
+        VitaPacketInfo info;
+        info.Offset = static_cast<size_t>(rec.Offset / sizeof(unsigned int));
+        info.Words = rec.Words;
+        info.Sid = rec.Sid;
+        info.Count = rec.Count;
+        info.PayloadOffset = rec.PayloadOffset;
+        info.PayloadWords = rec.PayloadWords;
+        info.Tsi = rec.Types >> 2 & 3;
+        info.Tsf = rec.Types & 3;
+        info.TsInt = rec.TsInt;
+        info.TsFracHi = static_cast<unsigned int>(rec.TsFrac >> 32);
+        info.TsFracLo = static_cast<unsigned int>(rec.TsFrac);
+        AddPacket(info);
+        }
+    FIndexed = used;
+    return offset;
+}
+
+//---------------------------------------------------------------------------
+//  VitaFile::Index() --  Find every packet from 'offset' words on
+//---------------------------------------------------------------------------
+
+void  VitaFile::Index(size_t offset)
+{
+    const unsigned int * words = Words();
+    const size_t count = static_cast<size_t>(FBytes / sizeof(unsigned int));
+
+    VitaIndex index;
+    while (offset < count)
+        {
+        const size_t window = std::min(Window, count - offset);
+        index.Scan(words + offset, window);
+        for (size_t p = 0; p < index.Size(); ++p)
+            {
+            VitaPacketInfo info = index[p];
+            info.Offset += offset;
+            AddPacket(info);
+            }
+
+        if (index.Words())
+            offset += index.Words();
+        else
+            {
+            //  Not a header, or one cut off by the end of the file: step
+            //  a word and try again, up to the last
+            ++offset;
+            FSkipped += sizeof(unsigned int);
+            }
+        }
+}
+
+//---------------------------------------------------------------------------
+//  VitaFile::AddPacket() --  Append a packet to the index and its stream
+//---------------------------------------------------------------------------
+
+void  VitaFile::AddPacket(const VitaPacketInfo & info)
+{
+    std::map<unsigned int, size_t>::iterator it = Lookup.find(info.Sid);
+    if (it == Lookup.end())
+        {
+        Stream stream;
+        stream.Sid = info.Sid;
+        stream.Samples = 0;
+        it = Lookup.insert(std::make_pair(info.Sid, FStreams.size())).first;
+        FStreams.push_back(stream);
+        }
+
+    Stream & stream = FStreams[it->second];
+    stream.Members.push_back(FPackets.size());
+    stream.Start.push_back(stream.Samples);
+    stream.Samples += info.PayloadWords * sizeof(unsigned int) / SampleBytes;
+    FPackets.push_back(info);
+}
+
+//---------------------------------------------------------------------------
+//  VitaFile::Find() --  Stream of a SID, -1 if none
+//---------------------------------------------------------------------------
+
+int  VitaFile::Find(unsigned int sid) const
+{
+    std::map<unsigned int, size_t>::const_iterator it = Lookup.find(sid);
+    return it == Lookup.end() ? -1 : static_cast<int>(it->second);
+}
+
+//---------------------------------------------------------------------------
+//  VitaFile::Span() --  Payload of a stream's k'th packet
+//---------------------------------------------------------------------------
+
+VitaSpan  VitaFile::Span(size_t stream, size_t k) const
+{
+    const Stream & s = FStreams[stream];
+    const VitaPacketInfo & info = FPackets[s.Members[k]];
+    VitaSpan span;
+    span.Data = reinterpret_cast<const unsigned char *>(Words() + info.Offset + info.PayloadOffset);
+    span.Samples = info.PayloadWords * sizeof(unsigned int) / SampleBytes;
+    span.First = s.Start[k];
+    return span;
+}
+
+//---------------------------------------------------------------------------
+//  VitaFile::Locate() --  Span holding a stream sample
+//---------------------------------------------------------------------------
+
+size_t  VitaFile::Locate(size_t stream, unsigned long long sample) const
+{
+    const Stream & s = FStreams[stream];
+    if (sample >= s.Samples)
+        return s.Members.size();
+    return static_cast<size_t>(std::upper_bound(s.Start.begin(), s.Start.end(), sample) - s.Start.begin()) - 1;
+}
+
+//---------------------------------------------------------------------------
+//  VitaFile::Gather() --  Copy a sample range of a stream
+//---------------------------------------------------------------------------
+
+size_t  VitaFile::Gather(size_t stream, unsigned long long first, size_t count, void * out) const
+{
+    const Stream & s = FStreams[stream];
+    if (first >= s.Samples)
+        return 0;
+    count = static_cast<size_t>(std::min<unsigned long long>(count, s.Samples - first));
+
+    unsigned char * dest = static_cast<unsigned char *>(out);
+    size_t left = count;
+    for (size_t k = Locate(stream, first); left; ++k)
+        {
+        const VitaSpan span = Span(stream, k);
+        const size_t skip = static_cast<size_t>(first - span.First);
+        const size_t n = std::min(left, span.Samples - skip);
+        std::memcpy(dest, span.Data + skip*SampleBytes, n*SampleBytes);
+        dest += n*SampleBytes;
+        first += n;
+        left -= n;
+        }
+    return count;
+}
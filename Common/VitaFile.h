@@ -0,0 +1,131 @@
+// VitaFile.h
+//
+// Memory mapped, indexed view of a recorded VITA stream file
+
+#ifndef VitaFileH
+#define VitaFileH
+
+#include "VitaIndex.h"
+#include "MappedFile.h"
+#include <string>
+#include <vector>
+#include <map>
+#include <cstddef>
+
+//===========================================================================
+//  STRUCT VitaSpan  -- One packet's payload, in place in the mapping
+//===========================================================================
+
+struct VitaSpan
+{
+    VitaSpan()
+        : Data(0), Samples(0), First(0)
+        {}
+
+    const unsigned char *   Data;
+    size_t                  Samples;    // Whole samples in the payload
+    unsigned long long      First;      // Stream sample index of Data[0]
+
+    template <typename T>
+    const T *  As() const
+        {  return reinterpret_cast<const T *>(Data);  }
+};
+
+//===========================================================================
+//  CLASS VitaFile  -- Read a capture file straight from the page cache
+//===========================================================================
+//  Open() maps the whole file read-only and indexes its packets once:
+//  from the .vidx sidecar written with the capture where there is one,
+//  otherwise by scanning the headers in large windows through VitaIndex,
+//  which touches only the header pages.  Each stream is then a list of
+//  spans over its payloads where they lie in the file: nothing is copied
+//  or decoded per sample.  Gather() copies any sample range of a stream
+//  to contiguous memory, one memcpy per packet crossed.
+//
+//  Bytes that do not parse as packets are stepped over a word at a time
+//  until the headers line up again, and counted; a packet cut off at the
+//  end of the file is left out.  Striped captures must be replayed or
+//  reassembled first.  All const members may be used from any number of threads.
+
+class VitaFile
+{
+public:
+    VitaFile();
+    ~VitaFile();
+
+    //  Config, read by Open()
+    size_t  SampleBytes;        // Bytes per stream sample, all lanes
+
+    bool  Open(const std::string & file);
+    void  Close();
+    bool  IsOpen() const
+        {  return Map.IsOpen();  }
+    //  Hint the kernel that reads will run front to back
+    void  Sequential() const
+        {  Map.Sequential();  }
+
+    //  File
+    const std::string &  FileName() const
+        {  return FFileName;  }
+    const std::string &  Error() const
+        {  return FError;  }
+    unsigned long long  Bytes() const
+        {  return FBytes;  }
+    unsigned long long  Skipped() const         // Not part of any whole packet
+        {  return FSkipped;  }
+    const unsigned int *  Words() const
+        {  return Map.As<unsigned int>();  }
+    //  Packets taken from the .vidx sidecar rather than scanned
+    size_t  Indexed() const
+        {  return FIndexed;  }
+
+    //  Packets, in file order; Offset is in words from the file start
+    size_t  Packets() const
+        {  return FPackets.size();  }
+    const VitaPacketInfo &  Packet(size_t idx) const
+        {  return FPackets[idx];  }
+
+    //  Streams, in order of first appearance
+    size_t  Streams() const
+        {  return FStreams.size();  }
+    int  Find(unsigned int sid) const;
+    unsigned int  Sid(size_t stream) const
+        {  return FStreams[stream].Sid;  }
+    unsigned long long  Samples(size_t stream) const
+        {  return FStreams[stream].Samples;  }
+    size_t  Spans(size_t stream) const
+        {  return FStreams[stream].Members.size();  }
+    VitaSpan  Span(size_t stream, size_t k) const;
+    //  Span holding stream sample 'sample'; Spans() if past the end
+    size_t  Locate(size_t stream, unsigned long long sample) const;
+    //  Copy up to 'count' samples from 'first' to 'out'.  Returns samples copied.
+    size_t  Gather(size_t stream, unsigned long long first, size_t count, void * out) const;
+
+private:
+    struct Stream
+    {
+        unsigned int                        Sid;
+        unsigned long long                  Samples;
+        std::vector<size_t>                 Members;    // Packet indices
+        std::vector<unsigned long long>     Start;      // First sample of each
+    };
+
+    MappedFile                  Map;
+    std::string                 FFileName;
+    std::string                 FError;
+    unsigned long long          FBytes;
+    unsigned long long          FSkipped;
+    size_t                      FIndexed;
+    std::vector<VitaPacketInfo> FPackets;
+    std::vector<Stream>         FStreams;
+    std::map<unsigned int, size_t>  Lookup;     // SID to stream
+
+    size_t  Load(const std::string & sidecar);
+    void  Index(size_t offset);
+    void  AddPacket(const VitaPacketInfo & info);
+
+    VitaFile(const VitaFile &);
+    VitaFile & operator=(const VitaFile &);
+};
+
+#endif
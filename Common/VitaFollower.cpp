@@ -0,0 +1,410 @@
+// VitaFollower.cpp
+//
+// Incremental reader of a stream file while it is still being logged
+
+#include "VitaFollower.h"
+#include "VitaHeader.h"
+#include "SegmentedLogger.h"
+#include "LatencyHistogram.h"
+#include "HiResTimer.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <cstdio>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+//===========================================================================
+//  CLASS VitaFollower::Source  -- A file another process is writing
+//===========================================================================
+//  Opened to share reading and writing with the logger, and deleting,
+//  so a segment can still be retired while it is being read.
+
+class VitaFollower::Source
+{
+public:
+    Source()
+#ifdef _WIN32
+        : File(INVALID_HANDLE_VALUE)
+#else
+        : File(-1)
+#endif
+        {}
+
+    ~Source()
+        {
+#ifdef _WIN32
+        if (File != INVALID_HANDLE_VALUE)
+            CloseHandle(File);
+#else
+        if (File >= 0)
+            close(File);
+#endif
+        }
+
+    bool  Open(const std::string & name)
+        {
+#ifdef _WIN32
+        File = CreateFileA(name.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+                           0, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, 0);
+        return File != INVALID_HANDLE_VALUE;
+#else
+        File = open(name.c_str(), O_RDONLY);
+        return File >= 0;
+#endif
+        }
+
+    //  Current length
+    unsigned long long  Size() const
+        {
+#ifdef _WIN32
+        LARGE_INTEGER size;
+        return GetFileSizeEx(File, &size) ? static_cast<unsigned long long>(size.QuadPart) : 0;
+#else
+        struct stat st;
+        return fstat(File, &st) == 0 ? static_cast<unsigned long long>(st.st_size) : 0;
+#endif
+        }
+
+    //  Bytes read, short only at the end of the file or on an error
+    size_t  Read(unsigned long long offset, void * dest, size_t bytes) const
+        {
+        char * out = static_cast<char *>(dest);
+        size_t done = 0;
+        while (done < bytes)
+            {
+#ifdef _WIN32
+            OVERLAPPED at;
+            std::memset(&at, 0, sizeof(at));
+            at.Offset = static_cast<DWORD>(offset + done);
+            at.OffsetHigh = static_cast<DWORD>((offset + done) >> 32);
+            DWORD n = 0;
+            const DWORD want = static_cast<DWORD>(std::min<size_t>(bytes - done, 0x40000000));
+            if (!ReadFile(File, out + done, want, &n, &at) || !n)
+                break;
+#else
+            const ssize_t n = pread(File, out + done, bytes - done, static_cast<off_t>(offset + done));
+            if (n <= 0)
+                break;
+#endif
+            done += static_cast<size_t>(n);
+            }
+        return done;
+        }
+
+    static bool  Exists(const std::string & name)
+        {
+        Source probe;
+        return probe.Open(name);
+        }
+
+private:
+#ifdef _WIN32
+    HANDLE  File;
+#else
+    int     File;
+#endif
+
+    Source(const Source &);
+    Source & operator=(const Source &);
+};
+
+//===========================================================================
+//  CLASS VitaFollower  -- Tail a growing Data.bin, or its segments
+//===========================================================================
+//---------------------------------------------------------------------------
+//  constructor for class VitaFollower
+//---------------------------------------------------------------------------
+
+VitaFollower::VitaFollower()
+    : SampleBytes(sizeof(short)), Interval(20), ReadBytes(16 * 1024 * 1024), Sync(4), Segmented(false),
+      Sequence(0), Position(0), Want(Vita::MinReadBytes), Quit(false), Closing(false), Latency(0),
+      FRunning(false), FBytes(0), FPackets(0), FSkipped(0), FSegments(0), FMissed(0)
+{
+}
+
+//---------------------------------------------------------------------------
+//  destructor for class VitaFollower
+//---------------------------------------------------------------------------
+
+VitaFollower::~VitaFollower()
+{
+    Stop();
+}
+
+//---------------------------------------------------------------------------
+//  VitaFollower::Start() --  Follow 'file' from its beginning
+//---------------------------------------------------------------------------
+
+bool  VitaFollower::Start(const std::string & file, Handler handler)
+{
+    Stop();
+    if (file.empty() || !handler)
+        return false;
+
+    Base = file;
+    Deliver = handler;
+    File.reset();
+    Sequence = Segmented ? 1 : 0;
+    Position = 0;
+    Want = Vita::MinReadBytes;
+    FStreams.clear();
+    Order.clear();
+    Quit = false;
+    Closing = false;
+    FBytes = 0;
+    FPackets = 0;
+    FSkipped = 0;
+    FSegments = 0;
+    FMissed = 0;
+    FFileName.clear();
+
+    FRunning = true;
+    Thread = std::thread(&VitaFollower::Execute, this);
+    return true;
+}
+
+//---------------------------------------------------------------------------
+//  VitaFollower::Finish() --  Read to the end of the closed file and stop
+//---------------------------------------------------------------------------
+
+void  VitaFollower::Finish()
+{
+    if (!Thread.joinable())
+        return;
+    std::unique_lock<std::mutex> lock(Lock);
+    Closing = true;
+    lock.unlock();
+    Wake.notify_all();
+    Thread.join();
+}
+
+//---------------------------------------------------------------------------
+//  VitaFollower::Stop() --  Stop at once
+//---------------------------------------------------------------------------
+
+void  VitaFollower::Stop()
+{
+    if (!Thread.joinable())
+        return;
+    std::unique_lock<std::mutex> lock(Lock);
+    Quit = true;
+    lock.unlock();
+    Wake.notify_all();
+    Thread.join();
+}
+
+//---------------------------------------------------------------------------
+//  VitaFollower::FileName() --  File being read
+//---------------------------------------------------------------------------
+
+std::string  VitaFollower::FileName() const
+{
+    std::lock_guard<std::mutex> lock(Lock);
+    return FFileName;
+}
+
+//---------------------------------------------------------------------------
+//  VitaFollower::Attach() --  Open the file, or the segment due, if it
+//                             exists yet
+//---------------------------------------------------------------------------
+//  A segment that is gone while the one after it exists was retired
+//  before it could be read; it is counted and passed over.
+
+bool  VitaFollower::Attach()
+{
+    if (File)
+        return true;
+
+    std::shared_ptr<Source> source = std::make_shared<Source>();
+    std::string name = Sequence ? SegmentedLogger::SegmentName(Base, Sequence) : Base;
+    while (!source->Open(name))
+        {
+        if (!Sequence || !Source::Exists(SegmentedLogger::SegmentName(Base, Sequence + 1)))
+            return false;
+        ++Sequence;
+        ++FMissed;
+        name = SegmentedLogger::SegmentName(Base, Sequence);
+        }
+
+    File = source;
+    Position = 0;
+    Want = Vita::MinReadBytes;
+    std::lock_guard<std::mutex> lock(Lock);
+    FFileName = name;
+    return true;
+}
+
+//---------------------------------------------------------------------------
+//  VitaFollower::Poll() --  Read and publish what has been appended
+//---------------------------------------------------------------------------
+//  What did not parse last time is read again, as the logger may have
+//  filled it in since.  The end of the file is only trusted at the end
+//  of the read.  The read grows while it is all taken and falls
+//  back to MinReadBytes when it is not, so a reserved tail is not read
+//  over and over at full size.  Returns true if anything was taken.
+
+bool  VitaFollower::Poll(bool final)
+{
+    if (!Attach())
+        return false;
+
+    const long long start = HiResTimer::Ticks();
+    SegmentHeader header;
+    const bool sealed = Sequence && SegmentedLogger::ReadHeader(FileName(), header);
+    const unsigned long long end = sealed ? header.Bytes : File->Size();
+    const size_t bytes = static_cast<size_t>(std::min<unsigned long long>(end > Position ? end - Position : 0,
+        std::min(Want, std::max(ReadBytes, Vita::MinReadBytes)))) & ~(sizeof(unsigned int) - 1);
+
+    Words.resize(bytes / sizeof(unsigned int));
+    const size_t read = bytes ? File->Read(Position, &Words[0], bytes) : 0;
+    Words.resize(read / sizeof(unsigned int));     // The logger may have cut its padding off
+
+    //  A segment is done once sealed, or once retired from under us
+    const bool whole = Position + Words.size() * sizeof(unsigned int) >= end;
+    bool last = final || sealed;
+    size_t taken = Parse(last && whole);
+    if (!taken && !last && Sequence && !Source::Exists(FileName()))
+        {
+        last = true;
+        taken = Parse(whole);
+        }
+    Position += static_cast<unsigned long long>(taken) * sizeof(unsigned int);
+    Want = taken && taken == Words.size() ? std::min(Want * 2, ReadBytes) : Vita::MinReadBytes;
+    Publish();
+    if (taken && Latency)
+        Latency->Record(static_cast<unsigned long long>((HiResTimer::Ticks() - start) * 1.0e9 / HiResTimer::TicksPerSecond()));
+
+    if (Sequence && last && Position >= end)
+        {
+        File.reset();
+        ++Sequence;
+        if (Position)
+            ++FSegments;
+        return true;
+        }
+    return taken != 0;
+}
+
+//---------------------------------------------------------------------------
+//  VitaFollower::Parse() --  Take the whole packets in Words
+//---------------------------------------------------------------------------
+//  Returns the words taken.  Writes land out of order, so until the file
+//  is complete zeros are a block still in flight, never garbage.  With
+//  'final' the last packet needs no successor, and words that never parse
+//  are skipped.
+
+size_t  VitaFollower::Parse(bool final)
+{
+    const size_t count = Words.size();
+    const unsigned int * words = count ? &Words[0] : 0;
+    size_t at = 0;
+    while (at < count)
+        {
+        const unsigned int hdr = words[at];
+        VitaPacketInfo info;
+        if (Vita::HasStreamId(hdr) && Vita::Decode(words, count, at, info))
+            {
+            const size_t next = at + info.Words;
+            const bool chained = next < count && (words[next] & Vita::HeaderShape) == (hdr & Vita::HeaderShape);
+            if (!chained && !final && (next >= count || !words[next] || Resync(next) >= count))
+                break;
+
+            std::map<unsigned int, Stream>::iterator it = FStreams.find(info.Sid);
+            if (it == FStreams.end())
+                {
+                it = FStreams.insert(std::make_pair(info.Sid, Stream())).first;
+                it->second.Samples = 0;
+                Order.push_back(info.Sid);
+                }
+            const size_t payload = info.PayloadWords * sizeof(unsigned int) / SampleBytes * SampleBytes;
+            const char * src = reinterpret_cast<const char *>(words + at + info.PayloadOffset);
+            it->second.Pending.insert(it->second.Pending.end(), src, src + payload);
+            ++FPackets;
+            FBytes += info.Words * sizeof(unsigned int);
+            at = next;
+            continue;
+            }
+
+        //  A header whose packet has not all landed
+        if (!final && Vita::HasStreamId(hdr) && Vita::PacketWords(hdr) > count - at &&
+            Vita::PacketWords(hdr) >= Vita::HeaderWords(hdr) + (Vita::HasTrailer(hdr) ? 1 : 0))
+            break;
+
+        //  A hole the logger has yet to fill; it reads as zeros
+        if (!final && !hdr)
+            break;
+
+        //  Not a packet: skip only to whole packets, unless there will be no more
+        const size_t sync = Resync(at + 1);
+        if (sync >= count && !final)
+            break;
+        FSkipped += (std::min(sync, count) - at) * sizeof(unsigned int);
+        FBytes += (std::min(sync, count) - at) * sizeof(unsigned int);
+        at = std::min(sync, count);
+        }
+    return at;
+}
+
+//---------------------------------------------------------------------------
+//  VitaFollower::Resync() --  First word at or after 'offset' that starts
+//                             a chain of Sync packets, Words.size() if none
+//---------------------------------------------------------------------------
+//  As VitaParser's, but a chain must be whole: the rest may yet arrive.
+
+size_t  VitaFollower::Resync(size_t offset) const
+{
+    const size_t count = Words.size();
+    return count ? Vita::Resync(&Words[0], count, offset, std::max(Sync, 1u), false) : count;
+}
+
+//---------------------------------------------------------------------------
+//  VitaFollower::Publish() --  Hand each stream's new samples over
+//---------------------------------------------------------------------------
+
+void  VitaFollower::Publish()
+{
+    for (size_t s = 0; s < Order.size(); ++s)
+        {
+        Stream & stream = FStreams[Order[s]];
+        if (stream.Pending.empty())
+            continue;
+        const size_t count = stream.Pending.size() / SampleBytes;
+        Deliver(Order[s], stream.Samples, &stream.Pending[0], count);
+        stream.Samples += count;
+        stream.Pending.clear();
+        }
+}
+
+//---------------------------------------------------------------------------
+//  VitaFollower::Execute() --  Poll until stopped, or finished and drained
+//---------------------------------------------------------------------------
+
+void  VitaFollower::Execute()
+{
+    for (;;)
+        {
+        std::unique_lock<std::mutex> lock(Lock);
+        if (Quit)
+            break;
+        const bool closing = Closing;
+        lock.unlock();
+
+        if (Poll(closing))
+            continue;
+        if (closing)
+            break;
+
+        lock.lock();
+        Wake.wait_for(lock, std::chrono::milliseconds(Interval), [this]()
+            {  return Quit || Closing;  });
+        }
+    File.reset();
+    FRunning = false;
+}
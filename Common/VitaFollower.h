@@ -0,0 +1,132 @@
+// VitaFollower.h
+//
+// Incremental reader of a stream file while it is still being logged
+
+#ifndef VitaFollowerH
+#define VitaFollowerH
+
+#include <string>
+#include <vector>
+#include <map>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <cstddef>
+
+class LatencyHistogram;
+
+//===========================================================================
+//  CLASS VitaFollower  -- Tail a growing Data.bin, or its segments
+//===========================================================================
+//  A thread polls the file every Interval ms, reads what has been
+//  appended since, at most ReadBytes at a time, and hands the handler
+//  each stream's new samples, one call per stream per poll, in stream
+//  order.  A sample therefore reaches the handler within about Interval
+//  of reaching the file, plus the time to read and parse one ReadBytes.
+//  Nothing is asked of the logger: it is read through the file system,
+//  so the ingest threads do no more work than they did.
+//
+//  The logger may reserve space ahead and completes its writes out of
+//  order, so the end of the file says little about where the data ends.
+//  A packet is taken only once the header after it is there too, with
+//  the same layout, which also shows its payload landed.  Words that do
+//  not parse are waited on and read again at the next poll, not skipped,
+//  unless whole packets follow them.  Finish() says the file is complete:
+//  the last packet is taken and the thread ends.
+//
+//  With Segmented set the numbered segments SegmentedLogger writes beside
+//  the file are followed instead, in turn; each is finished once its
+//  .vseg header appears.  Segments retired before they were read are
+//  counted by Missed().  The file need not exist yet when Start() is
+//  called.  The handler runs on the follower's thread.
+
+class VitaFollower
+{
+public:
+    //  'count' samples of SampleBytes from stream sample 'first' on
+    typedef std::function<void (unsigned int sid, unsigned long long first,
+                                const void * samples, size_t count)>  Handler;
+
+    VitaFollower();
+    ~VitaFollower();
+
+    //  Config, read by Start()
+    size_t          SampleBytes;    // Per stream sample, all lanes
+    unsigned int    Interval;       // Poll period, ms
+    size_t          ReadBytes;      // Most read per poll
+    unsigned int    Sync;           // Headers that must chain to resync
+    bool            Segmented;      // Follow SegmentedLogger's segments
+
+    bool  Start(const std::string & file, Handler handler);
+    //  The logger has closed the file: take the rest of it, then stop
+    void  Finish();
+    //  Stop now, leaving the rest unread
+    void  Stop();
+    bool  Running() const
+        {  return FRunning.load();  }
+
+    //  Time from a poll seeing data to its samples handed over, in ns
+    void  PublishHistogram(LatencyHistogram * latency)
+        {  Latency = latency;  }
+
+    //  Status
+    unsigned long long  Bytes() const           // Parsed, all files
+        {  return FBytes.load();  }
+    unsigned long long  Packets() const
+        {  return FPackets.load();  }
+    unsigned long long  Skipped() const         // Not part of any whole packet
+        {  return FSkipped.load();  }
+    unsigned long long  Segments() const        // Followed to their end
+        {  return FSegments.load();  }
+    unsigned long long  Missed() const          // Retired before they were read
+        {  return FMissed.load();  }
+    std::string  FileName() const;              // Being followed
+
+private:
+    class Source;
+
+    struct Stream
+    {
+        unsigned long long  Samples;            // Published
+        std::vector<char>   Pending;            // ...and about to be
+    };
+
+    std::string                     Base;
+    Handler                         Deliver;
+    std::shared_ptr<Source>         File;
+    unsigned long long              Sequence;   // Of the segment followed, 0 if unsegmented
+    unsigned long long              Position;   // File bytes parsed
+    size_t                          Want;       // Bytes to read past it next poll
+    std::vector<unsigned int>       Words;      // ...read there
+    std::map<unsigned int, Stream>  FStreams;   // By SID
+    std::vector<unsigned int>       Order;      // ...in order of first appearance
+    std::thread                     Thread;
+    mutable std::mutex              Lock;
+    std::condition_variable         Wake;
+    bool                            Quit;
+    bool                            Closing;
+    LatencyHistogram *              Latency;
+
+    std::atomic<bool>                   FRunning;
+    std::atomic<unsigned long long>     FBytes;
+    std::atomic<unsigned long long>     FPackets;
+    std::atomic<unsigned long long>     FSkipped;
+    std::atomic<unsigned long long>     FSegments;
+    std::atomic<unsigned long long>     FMissed;
+    std::string                         FFileName;
+
+    bool  Attach();
+    bool  Poll(bool final);
+    size_t  Parse(bool final);
+    size_t  Resync(size_t offset) const;
+    void  Publish();
+    void  Execute();
+
+    VitaFollower(const VitaFollower &);
+    VitaFollower & operator=(const VitaFollower &);
+};
+
+#endif
@@ -0,0 +1,151 @@
+// VitaHeader.h
+//
+// Raw VITA-49 packet header decoding
+//
+// These helpers walk VITA packets directly in a block of 32-bit words, so
+// the same code serves the live stream (IntegerDG over a VeloBuffer), files
+// on disk and synthetic buffers built without a board.
+
+#ifndef VitaHeaderH
+#define VitaHeaderH
+
+#include <cstddef>
+
+//===========================================================================
+//  STRUCT VitaPacketInfo  -- Decoded header of one VITA packet
+//===========================================================================
+
+struct VitaPacketInfo
+{
+    size_t          Offset;         // Packet start, in words from buffer start
+    unsigned int    Words;          // Total packet size in words
+    unsigned int    Sid;            // Stream ID
+    unsigned int    Count;          // 4-bit rolling packet count
+    unsigned int    PayloadOffset;  // Payload start, in words from packet start
+    unsigned int    PayloadWords;   // Payload size in words
+    unsigned int    Tsi;            // Timestamp types from the header
+    unsigned int    Tsf;
+    unsigned int    TsInt;          // Integer timestamp (0 if absent)
+    unsigned int    TsFracHi;       // Fractional timestamp (0 if absent)
+    unsigned int    TsFracLo;
+};
+
+//===========================================================================
+//  NAMESPACE Vita  -- Header field access
+//===========================================================================
+
+namespace Vita
+{
+    //  Limits shared by the readers that walk files of packets
+    const unsigned int  MaxPacketWords = 0xFFFF;    // The header's size field
+    const unsigned int  HeaderShape = 0xFFF00000;   // Header bits above the count
+    const size_t        MinReadBytes = 1024 * 1024; // Four of the largest packets
+
+    //  Header word layout (VITA-49.0)
+    //    31..28  packet type     27  class ID present   26  trailer present
+    //    23..22  TSI             21..20  TSF            19..16  packet count
+    //    15..0   packet size in words, header included
+    inline unsigned int  PacketType(unsigned int hdr)
+            {  return hdr >> 28;  }
+    inline bool          HasStreamId(unsigned int hdr)
+            {  return (PacketType(hdr) & 1) || PacketType(hdr) >= 4;  }
+    inline bool          HasClassId(unsigned int hdr)
+            {  return ((hdr >> 27) & 1) != 0;  }
+    inline bool          HasTrailer(unsigned int hdr)
+            {  return ((hdr >> 26) & 1) != 0;  }
+    inline unsigned int  Tsi(unsigned int hdr)
+            {  return (hdr >> 22) & 3;  }
+    inline unsigned int  Tsf(unsigned int hdr)
+            {  return (hdr >> 20) & 3;  }
+    inline unsigned int  PacketCount(unsigned int hdr)
+            {  return (hdr >> 16) & 0xF;  }
+    inline unsigned int  PacketWords(unsigned int hdr)
+            {  return hdr & 0xFFFF;  }
+
+    //  Number of words preceding the payload
+    inline unsigned int  HeaderWords(unsigned int hdr)
+        {
+        return 1 + (HasStreamId(hdr) ? 1 : 0) + (HasClassId(hdr) ? 2 : 0)
+                 + (Tsi(hdr) ? 1 : 0) + (Tsf(hdr) ? 2 : 0);
+        }
+
+    //  Build a header word -- used by synthetic sources and writers
+    inline unsigned int  MakeHeader(unsigned int type, bool class_id, bool trailer,
+                                    unsigned int tsi, unsigned int tsf,
+                                    unsigned int count, unsigned int words)
+        {
+        return (type << 28) | ((class_id ? 1u : 0u) << 27) | ((trailer ? 1u : 0u) << 26)
+             | ((tsi & 3) << 22) | ((tsf & 3) << 20) | ((count & 0xF) << 16)
+             | (words & 0xFFFF);
+        }
+
+    //  Decode the packet at 'offset'.  Returns false where the cursor based
+    //  code would report !isValid(): empty, truncated or malformed header.
+    inline bool  Decode(const unsigned int * buffer, size_t words, size_t offset,
+                        VitaPacketInfo & info)
+        {
+        if (offset >= words)
+            return false;
+
+        const unsigned int * p = buffer + offset;
+        const unsigned int hdr = p[0];
+        const unsigned int size = PacketWords(hdr);
+        const unsigned int head = HeaderWords(hdr);
+        const unsigned int tail = HasTrailer(hdr) ? 1 : 0;
+
+        if (size < head + tail || size > words - offset)
+            return false;
+
+        unsigned int idx = 1;
+        info.Sid = 0;
+        if (HasStreamId(hdr))
+            info.Sid = p[idx++];
+        if (HasClassId(hdr))
+            idx += 2;
+        info.Tsi = Tsi(hdr);
+        info.Tsf = Tsf(hdr);
+        info.TsInt = info.Tsi ? p[idx++] : 0;
+        info.TsFracHi = 0;
+        info.TsFracLo = 0;
+        if (info.Tsf)
+            {
+            info.TsFracHi = p[idx++];
+            info.TsFracLo = p[idx++];
+            }
+
+        info.Offset = offset;
+        info.Words = size;
+        info.Count = PacketCount(hdr);
+        info.PayloadOffset = idx;
+        info.PayloadWords = size - head - tail;
+        return true;
+        }
+
+    //  First word at or after 'offset' that starts a chain of 'depth'
+    //  packets, 'words' if none.  The packets must also share the first
+    //  one's type, flags and timestamp types, as a stream's do, which
+    //  payload words seldom manage by chance.  With 'cut' a chain cut short
+    //  by the end of the words still counts; a reader that may yet get the
+    //  rest passes false.
+    inline size_t  Resync(const unsigned int * buffer, size_t words, size_t offset, unsigned int depth,
+                          bool cut)
+        {
+        for (; offset < words; ++offset)
+            {
+            size_t at = offset;
+            unsigned int chained = 0;
+            VitaPacketInfo info;
+            while (chained < depth && at < words && (buffer[at] & HeaderShape) == (buffer[offset] & HeaderShape) &&
+                   HasStreamId(buffer[at]) && Decode(buffer, words, at, info))
+                {
+                at += info.Words;
+                ++chained;
+                }
+            if (chained == depth || (cut && chained && at == words))
+                return offset;
+            }
+        return words;
+        }
+}
+
+#endif
@@ -0,0 +1,124 @@
+// VitaIndex.cpp
+//
+// Header-only pre-scan of a buffer of VITA packets
+
+#include "VitaIndex.h"
+
+#if defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2) || defined(__SSE2__)
+#define VITA_INDEX_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace
+{
+    //  Header bits that may change between packets of one stream run
+    const unsigned int CountMask = 0x000F0000;
+}
+
+//===========================================================================
+//  CLASS VitaIndex  -- Offsets, sizes, SIDs and timestamps of a buffer
+//===========================================================================
+//---------------------------------------------------------------------------
+//  constructor for class VitaIndex
+//---------------------------------------------------------------------------
+
+VitaIndex::VitaIndex()
+    : FWords(0), FTruncated(false)
+{
+}
+
+//---------------------------------------------------------------------------
+//  VitaIndex::Clear() --  Forget the last scan, keeping capacity
+//---------------------------------------------------------------------------
+
+void  VitaIndex::Clear()
+{
+    Packets.clear();
+    FWords = 0;
+    FTruncated = false;
+}
+
+//---------------------------------------------------------------------------
+//  VitaIndex::Scan() --  Index every packet in a block of VITA words
+//---------------------------------------------------------------------------
+
+size_t  VitaIndex::Scan(const unsigned int * words, size_t count)
+{
+    Clear();
+
+    size_t offset = 0;
+    VitaPacketInfo info;
+    while (offset < count)
+        {
+        if (!Vita::Decode(words, count, offset, info))
+            {
+            FTruncated = true;
+            break;
+            }
+        if (Packets.empty())
+            Packets.reserve(count / info.Words + 1);
+        Packets.push_back(info);
+        offset = ScanRun(words, count, offset + info.Words);
+        }
+
+    FWords = offset < count ? offset : count;
+    return Packets.size();
+}
+
+//---------------------------------------------------------------------------
+//  VitaIndex::ScanRun() --  Index packets laid out like the last one
+//---------------------------------------------------------------------------
+//  Returns the offset of the first packet that does not match.
+
+size_t  VitaIndex::ScanRun(const unsigned int * words, size_t count, size_t offset)
+{
+    const VitaPacketInfo proto = Packets.back();
+    const unsigned int stride = proto.Words;
+    const unsigned int hdr = words[proto.Offset] & ~CountMask;
+
+    //  Word positions of the optional fields in this layout
+    const unsigned int sid_at = Vita::HasStreamId(hdr) ? 1 : 0;
+    const unsigned int tsi_at = Vita::Tsi(hdr) ? 1 + (sid_at ? 1 : 0) + (Vita::HasClassId(hdr) ? 2 : 0) : 0;
+    const unsigned int tsf_at = Vita::Tsf(hdr) ? proto.PayloadOffset - 2 : 0;
+
+    VitaPacketInfo info = proto;
+    size_t end = offset;
+
+#ifdef VITA_INDEX_SSE2
+    //  Check four predicted headers per compare
+    const __m128i want = _mm_set1_epi32(static_cast<int>(hdr));
+    const __m128i mask = _mm_set1_epi32(static_cast<int>(~CountMask));
+    while (end + 4 * static_cast<size_t>(stride) <= count)
+        {
+        const unsigned int * p = words + end;
+        const __m128i got = _mm_set_epi32(p[3*stride], p[2*stride], p[stride], p[0]);
+        const __m128i same = _mm_cmpeq_epi32(_mm_and_si128(got, mask), want);
+        if (_mm_movemask_epi8(same) != 0xFFFF)
+            break;
+        end += 4 * static_cast<size_t>(stride);
+        }
+#endif
+
+    //  Finish the run one header at a time
+    while (end + stride <= count && (words[end] & ~CountMask) == hdr)
+        end += stride;
+
+    for (size_t o = offset; o < end; o += stride)
+        {
+        const unsigned int * p = words + o;
+        info.Offset = o;
+        info.Count = Vita::PacketCount(p[0]);
+        if (sid_at)
+            info.Sid = p[sid_at];
+        if (tsi_at)
+            info.TsInt = p[tsi_at];
+        if (tsf_at)
+            {
+            info.TsFracHi = p[tsf_at];
+            info.TsFracLo = p[tsf_at + 1];
+            }
+        Packets.push_back(info);
+        }
+
+    return end;
+}
@@ -0,0 +1,52 @@
+// VitaIndex.h
+//
+// Header-only pre-scan of a buffer of VITA packets
+
+#ifndef VitaIndexH
+#define VitaIndexH
+
+#include "VitaHeader.h"
+#include <vector>
+
+//===========================================================================
+//  CLASS VitaIndex  -- Offsets, sizes, SIDs and timestamps of a buffer
+//===========================================================================
+//  Scan() walks only the headers, so the branchy parsing is done once and
+//  kept apart from the bulk payload copies that follow.  The header chain
+//  is serial -- each size gives the next offset -- so the scan predicts
+//  instead: once a packet is decoded, following packets are assumed to
+//  share its layout and only their header words are checked, four at a
+//  time with SSE2 where available.  Any mismatch falls back to a full
+//  decode.
+
+class VitaIndex
+{
+public:
+    VitaIndex();
+
+    //  Index every packet in 'count' words.  Returns the packets found.
+    size_t  Scan(const unsigned int * words, size_t count);
+    void    Clear();
+
+    size_t  Size() const
+        {  return Packets.size();  }
+    bool    Empty() const
+        {  return Packets.empty();  }
+    const VitaPacketInfo &  operator[](size_t idx) const
+        {  return Packets[idx];  }
+    //  Words covered by complete packets
+    size_t  Words() const
+        {  return FWords;  }
+    //  Scan stopped early at a truncated or malformed header
+    bool    Truncated() const
+        {  return FTruncated;  }
+
+private:
+    std::vector<VitaPacketInfo>     Packets;
+    size_t                          FWords;
+    bool                            FTruncated;
+
+    size_t  ScanRun(const unsigned int * words, size_t count, size_t offset);
+};
+
+#endif
@@ -0,0 +1,307 @@
+// VitaParser.cpp
+//
+// Parallel chunked parser of recorded VITA stream files
+
+#include "VitaParser.h"
+#include "VitaIndex.h"
+#include "Deinterleave.h"
+#include <algorithm>
+#include <thread>
+#include <atomic>
+#include <functional>
+#include <cstring>
+
+namespace
+{
+    const size_t Window = 16 * 1024 * 1024;     // Words per VitaIndex scan
+    const size_t MinChunkBytes = 4 * 1024 * 1024;
+}
+
+//===========================================================================
+//  CLASS VitaParser  -- Split a capture file to per-stream arrays on all cores
+//===========================================================================
+//---------------------------------------------------------------------------
+//  constructor for class VitaParser
+//---------------------------------------------------------------------------
+
+VitaParser::VitaParser()
+    : Threads(0), ChunkBytes(64 * 1024 * 1024), Sync(4), SampleBytes(sizeof(short)), Lanes(1),
+      FPackets(0), FSkipped(0), FResynced(0)
+{
+}
+
+//---------------------------------------------------------------------------
+//  destructor for class VitaParser
+//---------------------------------------------------------------------------
+
+VitaParser::~VitaParser()
+{
+    Close();
+}
+
+//---------------------------------------------------------------------------
+//  VitaParser::Open() --  Map a file and index its chunks in parallel
+//---------------------------------------------------------------------------
+
+bool  VitaParser::Open(const std::string & file)
+{
+    Close();
+    if (!Map.Open(file))
+        {
+        FError = Map.Error();
+        return false;
+        }
+
+    //  Enough chunks to keep every thread busy to the end
+    const unsigned int threads = Threads ? Threads : std::max(std::thread::hardware_concurrency(), 1u);
+    const size_t count = static_cast<size_t>(Map.Bytes() / sizeof(unsigned int));
+    const size_t most = std::max<size_t>(static_cast<size_t>(Map.Bytes() / MinChunkBytes), 1);
+    const size_t chunks = std::min<size_t>(std::max<size_t>(static_cast<size_t>(Map.Bytes() / std::max<size_t>(ChunkBytes, 1)),
+        4 * threads), most);
+    const size_t words = (count + chunks - 1) / chunks;
+    for (size_t begin = 0; begin < count; begin += words)
+        {
+        Part part;
+        part.Begin = begin;
+        part.End = std::min(begin + words, count);
+        part.Start = part.Stop = part.Begin;
+        part.Skipped = 0;
+        Parts.push_back(part);
+        }
+
+    ForEach([this](Part & part)
+        {
+        part.Start = part.Begin ? Resync(part.Begin) : 0;
+        Walk(part);
+        });
+
+    //  Stitch: each part must start where the one before it stopped
+    for (size_t k = 1; k < Parts.size(); ++k)
+        if (Parts[k].Start != Parts[k-1].Stop)
+            {
+            Parts[k].Start = Parts[k-1].Stop;
+            Walk(Parts[k]);
+            ++FResynced;
+            }
+
+    //  Stream totals, and where each part's samples of a stream begin
+    for (size_t k = 0; k < Parts.size(); ++k)
+        {
+        Part & part = Parts[k];
+        FPackets += part.Packets.size();
+        FSkipped += part.Skipped;
+        for (size_t c = 0; c < part.Counts.size(); ++c)
+            if (Lookup.find(part.Counts[c].first) == Lookup.end())
+                {
+                Stream stream;
+                stream.Sid = part.Counts[c].first;
+                stream.Samples = 0;
+                stream.Capacity = 0;
+                Lookup[stream.Sid] = FStreams.size();
+                FStreams.push_back(stream);
+                }
+        part.Base.resize(FStreams.size());
+        for (size_t s = 0; s < FStreams.size(); ++s)
+            part.Base[s] = FStreams[s].Samples;
+        for (size_t c = 0; c < part.Counts.size(); ++c)
+            FStreams[Lookup[part.Counts[c].first]].Samples += part.Counts[c].second;
+        }
+    return true;
+}
+
+//---------------------------------------------------------------------------
+//  VitaParser::Close() --  Unmap and forget
+//---------------------------------------------------------------------------
+
+void  VitaParser::Close()
+{
+    Map.Close();
+    Parts.clear();
+    FStreams.clear();
+    Lookup.clear();
+    FError.clear();
+    FPackets = 0;
+    FSkipped = 0;
+    FResynced = 0;
+}
+
+//---------------------------------------------------------------------------
+//  VitaParser::Find() --  Stream of a SID, -1 if none
+//---------------------------------------------------------------------------
+
+int  VitaParser::Find(unsigned int sid) const
+{
+    std::map<unsigned int, size_t>::const_iterator it = Lookup.find(sid);
+    return it == Lookup.end() ? -1 : static_cast<int>(it->second);
+}
+
+//---------------------------------------------------------------------------
+//  VitaParser::Route() --  Destination of one stream's samples
+//---------------------------------------------------------------------------
+
+void  VitaParser::Route(unsigned int sid, char * const * dest, unsigned long long capacity)
+{
+    const int s = Find(sid);
+    if (s < 0)
+        return;
+    Stream & stream = FStreams[s];
+    stream.Dest.clear();
+    if (dest)
+        stream.Dest.assign(dest, dest + std::max(Lanes, 1u));
+    stream.Capacity = capacity;
+}
+
+//---------------------------------------------------------------------------
+//  VitaParser::Extract() --  Copy every routed stream, parts in parallel
+//---------------------------------------------------------------------------
+
+unsigned long long  VitaParser::Extract()
+{
+    std::atomic<unsigned long long> copied(0);
+    ForEach([&](Part & part)
+        {
+        copied.fetch_add(Copy(part));
+        });
+    return copied.load();
+}
+
+//---------------------------------------------------------------------------
+//  VitaParser::Resync() --  First word at or after 'offset' that starts
+//                           a chain of Sync packets
+//---------------------------------------------------------------------------
+//  A chain cut short by the end of the file still counts.  Returns the
+//  file length in words if there is none.
+
+size_t  VitaParser::Resync(size_t offset) const
+{
+    const size_t count = static_cast<size_t>(Map.Bytes() / sizeof(unsigned int));
+    return Vita::Resync(Map.As<unsigned int>(), count, offset, std::max(Sync, 1u), true);
+}
+
+//---------------------------------------------------------------------------
+//  VitaParser::Walk() --  Index a part's packets from its Start
+//---------------------------------------------------------------------------
+//  Packets are taken while they start before End; the first that does
+//  not is where the next part starts.  The last part runs to the end of
+//  the file, whose trailing partial packet, if any, is skipped.
+
+void  VitaParser::Walk(Part & part) const
+{
+    const unsigned int * words = Map.As<unsigned int>();
+    const size_t count = static_cast<size_t>(Map.Bytes() / sizeof(unsigned int));
+    const size_t sample = SampleBytes * std::max(Lanes, 1u);
+
+    part.Packets.clear();
+    part.Counts.clear();
+    part.Skipped = 0;
+
+    size_t offset = part.Start;
+    size_t last = 0;
+    VitaIndex index;
+    while (offset < part.End)
+        {
+        //  Enough to finish a packet that straddles End, no more
+        const size_t window = std::min(std::min(Window, count - offset), part.End - offset + Vita::MaxPacketWords);
+        index.Scan(words + offset, window);
+
+        size_t p = 0;
+        for (; p < index.Size() && offset + index[p].Offset < part.End; ++p)
+            {
+            VitaPacketInfo info = index[p];
+            info.Offset += offset;
+            part.Packets.push_back(info);
+
+            if (last >= part.Counts.size() || part.Counts[last].first != info.Sid)
+                {
+                last = 0;
+                while (last < part.Counts.size() && part.Counts[last].first != info.Sid)
+                    ++last;
+                if (last == part.Counts.size())
+                    part.Counts.push_back(std::make_pair(info.Sid, 0ull));
+                }
+            part.Counts[last].second += info.PayloadWords * sizeof(unsigned int) / sample;
+            }
+
+        if (p < index.Size())
+            {
+            offset += index[p].Offset;
+            break;
+            }
+        if (index.Words())
+            offset += index.Words();
+        else
+            {
+            //  Not a header, or one cut off by the end of the file: step
+            //  a word and try again, up to the last
+            ++offset;
+            part.Skipped += sizeof(unsigned int);
+            }
+        }
+    part.Stop = std::max(offset, part.Start);
+}
+
+//---------------------------------------------------------------------------
+//  VitaParser::Copy() --  Move one part's routed payloads to their streams
+//---------------------------------------------------------------------------
+
+unsigned long long  VitaParser::Copy(const Part & part) const
+{
+    const unsigned char * data = Map.Data();
+    const unsigned int lanes = std::max(Lanes, 1u);
+    const size_t sample = SampleBytes * lanes;
+    const Deinterleave::Ftn kernel = Deinterleave::Kernel(SampleBytes, lanes);
+
+    std::vector<unsigned long long> at(part.Base);
+    std::vector<char *> dest(lanes);
+    unsigned long long copied = 0;
+    size_t s = 0;
+    for (size_t p = 0; p < part.Packets.size(); ++p)
+        {
+        const VitaPacketInfo & info = part.Packets[p];
+        if (s >= FStreams.size() || FStreams[s].Sid != info.Sid)
+            s = Lookup.find(info.Sid)->second;
+        const Stream & stream = FStreams[s];
+        const unsigned long long first = at[s];
+        const size_t samples = info.PayloadWords * sizeof(unsigned int) / sample;
+        at[s] += samples;
+        if (stream.Dest.empty() || first >= stream.Capacity)
+            continue;
+
+        const size_t n = static_cast<size_t>(std::min<unsigned long long>(samples, stream.Capacity - first));
+        const unsigned char * src = data + (info.Offset + info.PayloadOffset) * sizeof(unsigned int);
+        for (unsigned int l = 0; l < lanes; ++l)
+            dest[l] = stream.Dest[l] + first * SampleBytes;
+        if (kernel)
+            kernel(&dest[0], reinterpret_cast<const char *>(src), n);
+        else
+            for (size_t k = 0; k < n; ++k)
+                for (unsigned int l = 0; l < lanes; ++l)
+                    std::memcpy(dest[l] + k * SampleBytes, src + (k * lanes + l) * SampleBytes, SampleBytes);
+        copied += static_cast<unsigned long long>(n) * lanes;
+        }
+    return copied;
+}
+
+//---------------------------------------------------------------------------
+//  VitaParser::ForEach() --  Run 'ftn' on every part, Threads at a time
+//---------------------------------------------------------------------------
+
+template <typename F>
+void  VitaParser::ForEach(F ftn)
+{
+    const unsigned int threads = static_cast<unsigned int>(std::min<size_t>(
+        Threads ? Threads : std::max(std::thread::hardware_concurrency(), 1u), Parts.size()));
+    std::atomic<size_t> next(0);
+    const std::function<void ()> work = [&]()
+        {
+        for (size_t k = next++; k < Parts.size(); k = next++)
+            ftn(Parts[k]);
+        };
+
+    std::vector<std::thread> pool;
+    for (unsigned int t = 1; t < threads; ++t)
+        pool.push_back(std::thread(work));
+    work();
+    for (size_t t = 0; t < pool.size(); ++t)
+        pool[t].join();
+}
@@ -0,0 +1,121 @@
+// VitaParser.h
+//
+// Parallel chunked parser of recorded VITA stream files
+
+#ifndef VitaParserH
+#define VitaParserH
+
+#include "VitaHeader.h"
+#include "MappedFile.h"
+#include <string>
+#include <vector>
+#include <map>
+#include <cstddef>
+
+//===========================================================================
+//  CLASS VitaParser  -- Split a capture file to per-stream arrays on all cores
+//===========================================================================
+//  The file is mapped and cut into chunks of about ChunkBytes, which the
+//  threads take in turn.  A chunk other than the first starts mid-packet,
+//  so its thread first resynchronizes: it steps a word at a time until
+//  Sync headers of one layout in a row decode and chain.  It then indexes
+//  its packets up to the first one starting in the next chunk, stepping
+//  over words that do not parse as it goes, as VitaFile does.  Where a chunk
+//  ends is checked against where the next one synchronized; should they
+//  disagree the next chunk is indexed again from the true boundary, so
+//  the result is what a serial pass over the file would give.
+//
+//  Open() does that indexing and totals each stream's samples per chunk.
+//  Route() then names the destination of a stream's samples, one buffer
+//  per lane, and Extract() copies every chunk's payloads straight there,
+//  deinterleaving packed lanes, again on all cores.  Each chunk knows
+//  where its samples go from the totals of the chunks before it, so the
+//  threads never share a destination range.
+
+class VitaParser
+{
+public:
+    VitaParser();
+    ~VitaParser();
+
+    //  Config, read by Open()
+    unsigned int    Threads;        // 0 = every core
+    size_t          ChunkBytes;     // Split size; smaller for small files
+    unsigned int    Sync;           // Headers that must chain to resync
+    size_t          SampleBytes;    // Per lane
+    unsigned int    Lanes;          // Interleaved in each stream sample
+
+    bool  Open(const std::string & file);
+    void  Close();
+    bool  IsOpen() const
+        {  return Map.IsOpen();  }
+
+    //  File
+    const std::string &  Error() const
+        {  return FError;  }
+    unsigned long long  Bytes() const
+        {  return Map.Bytes();  }
+    unsigned long long  Packets() const
+        {  return FPackets;  }
+    unsigned long long  Skipped() const         // Not part of any whole packet
+        {  return FSkipped;  }
+    size_t  Chunks() const
+        {  return Parts.size();  }
+    size_t  Resynced() const                    // Chunks indexed a second time
+        {  return FResynced;  }
+
+    //  Streams, in order of first appearance
+    size_t  Streams() const
+        {  return FStreams.size();  }
+    unsigned int  Sid(size_t stream) const
+        {  return FStreams[stream].Sid;  }
+    unsigned long long  Samples(size_t stream) const   // Per lane
+        {  return FStreams[stream].Samples;  }
+    int  Find(unsigned int sid) const;
+
+    //  Send stream 'sid' to dest[0..Lanes-1], each with room for 'capacity'
+    //  samples.  Samples past that are left out; 0 stops routing it.
+    void  Route(unsigned int sid, char * const * dest, unsigned long long capacity);
+    //  Copy every routed stream.  Returns the samples copied, all lanes.
+    unsigned long long  Extract();
+
+private:
+    struct Part
+    {
+        size_t                          Begin, End;     // Words owned
+        size_t                          Start, Stop;    // First packet, first of the next part
+        unsigned long long              Skipped;        // Bytes
+        std::vector<VitaPacketInfo>     Packets;
+        std::vector< std::pair<unsigned int, unsigned long long> >
+                                        Counts;         // Samples per SID, first seen first
+        std::vector<unsigned long long> Base;           // First sample per stream
+    };
+
+    struct Stream
+    {
+        unsigned int                    Sid;
+        unsigned long long              Samples;
+        std::vector<char *>             Dest;
+        unsigned long long              Capacity;
+    };
+
+    MappedFile                      Map;
+    std::vector<Part>               Parts;
+    std::vector<Stream>             FStreams;
+    std::map<unsigned int, size_t>  Lookup;
+    std::string                     FError;
+    unsigned long long              FPackets;
+    unsigned long long              FSkipped;
+    size_t                          FResynced;
+
+    size_t  Resync(size_t offset) const;
+    void  Walk(Part & part) const;
+    unsigned long long  Copy(const Part & part) const;
+    template <typename F>
+    void  ForEach(F ftn);
+
+    VitaParser(const VitaParser &);
+    VitaParser & operator=(const VitaParser &);
+};
+
+#endif
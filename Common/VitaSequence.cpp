@@ -0,0 +1,106 @@
+// VitaSequence.cpp
+//
+// Packet-loss accounting from VITA packet counts and timestamps
+
+#include "VitaSequence.h"
+
+//===========================================================================
+//  CLASS VitaSequence  -- Continuity check of one stream
+//===========================================================================
+//---------------------------------------------------------------------------
+//  VitaSequence::Reset() --  Forget the stream history and counters
+//---------------------------------------------------------------------------
+
+void  VitaSequence::Reset()
+{
+    Seen = false;
+    LastSamples = 0;
+    TicksPerSample = 0.0;
+    FReceived = 0;
+    FGaps = 0;
+    FMissingPackets = 0;
+    FMissingSamples = 0;
+}
+
+//---------------------------------------------------------------------------
+//  VitaSequence::Compare() --  Measure the gap between 'Last' and 'info'
+//---------------------------------------------------------------------------
+
+bool  VitaSequence::Compare(const VitaPacketInfo & info, double rate, VitaGap & gap)
+{
+    unsigned int packets = (info.Count - Last.Count - 1) & 0xF;
+    double missing = static_cast<double>(packets) * LastSamples;
+
+    double ticks;
+    if (LastSamples && Elapsed(Last, info, rate, ticks))
+        {
+        if (TicksPerSample > 0.0)
+            {
+            missing = ticks / TicksPerSample - static_cast<double>(LastSamples);
+            if (missing > -0.5 && missing < 0.5)
+                missing = 0.0;
+            packets = 0;
+            if (missing > 0.0)
+                {
+                packets = static_cast<unsigned int>(missing / LastSamples + 0.5);
+                if (!packets)
+                    packets = 1;
+                }
+            }
+        else if (!packets && ticks > 0.0)
+            TicksPerSample = ticks / LastSamples;
+        }
+
+    if (!packets && missing == 0.0)
+        return false;
+
+    gap.Sid = info.Sid;
+    gap.Position = FReceived;
+    gap.TsInt = info.TsInt;
+    gap.TsFrac = (static_cast<unsigned long long>(info.TsFracHi) << 32) | info.TsFracLo;
+    gap.Packets = packets;
+    gap.Samples = static_cast<long long>(missing < 0.0 ? missing - 0.5 : missing + 0.5);
+
+    ++FGaps;
+    FMissingPackets += packets;
+    FMissingSamples += gap.Samples;
+    return true;
+}
+
+//---------------------------------------------------------------------------
+//  VitaSequence::Elapsed() --  Timestamp ticks from one packet to the next
+//---------------------------------------------------------------------------
+//  Ticks are picoseconds for real-time TSF and sample clocks otherwise.
+//  False when the packets carry no usable fractional timestamp.
+
+bool  VitaSequence::Elapsed(const VitaPacketInfo & from, const VitaPacketInfo & to,
+                            double rate, double & ticks)
+{
+    if (!to.Tsf || to.Tsf != from.Tsf || to.Tsi != from.Tsi)
+        return false;
+
+    const unsigned long long a = (static_cast<unsigned long long>(from.TsFracHi) << 32) | from.TsFracLo;
+    const unsigned long long b = (static_cast<unsigned long long>(to.TsFracHi) << 32) | to.TsFracLo;
+    const double frac = static_cast<double>(static_cast<long long>(b - a));
+    const double whole = static_cast<double>(static_cast<int>(to.TsInt - from.TsInt));
+
+    switch (to.Tsf)
+        {
+        case 1:     // Sample count, restarting each second
+            if (!whole)
+                ticks = frac;
+            else if (rate > 0.0)
+                ticks = whole * rate + frac;
+            else
+                return false;
+            return true;
+
+        case 2:     // Real time, picoseconds
+            ticks = whole * 1.0e12 + frac;
+            return true;
+
+        default:    // Free-running count
+            ticks = frac;
+            return true;
+        }
+}
@@ -0,0 +1,82 @@
+// VitaSequence.h
+//
+// Packet-loss accounting from VITA packet counts and timestamps
+
+#ifndef VitaSequenceH
+#define VitaSequenceH
+
+#include "VitaHeader.h"
+
+//===========================================================================
+//  STRUCT VitaGap  -- One discontinuity seen in a stream
+//===========================================================================
+
+struct VitaGap
+{
+    unsigned int        Sid;
+    unsigned long long  Position;       // Samples received before the gap
+    unsigned int        TsInt;          // Timestamp of the packet after it
+    unsigned long long  TsFrac;
+    unsigned int        Packets;        // Packets lost (estimate)
+    long long           Samples;        // Samples lost; < 0 if time went back
+};
+
+//===========================================================================
+//  CLASS VitaSequence  -- Continuity check of one stream
+//===========================================================================
+//  Check() is fed every packet of a stream in order.  The 4-bit packet
+//  count catches up to 15 lost packets; when the packets carry timestamps
+//  the spacing between packets is learned from the first contiguous pair,
+//  after which the timestamps decide -- they see through any number of
+//  lost packets and give the missing samples exactly.  Sample-count TSF
+//  restarts at each integer second, so it needs the sample clock rate to
+//  span a second boundary; without it that packet falls back to the count.
+
+class VitaSequence
+{
+public:
+    VitaSequence()
+        {  Reset();  }
+
+    void  Reset();
+
+    //  Check the next packet, holding 'samples' samples.  Returns true, with
+    //  'gap' filled in, if data was lost ahead of it.
+    bool  Check(const VitaPacketInfo & info, size_t samples, double rate, VitaGap & gap)
+        {
+        bool lost = false;
+        if (Seen && (((info.Count - Last.Count - 1) & 0xF) || info.Tsf || info.Tsi))
+            lost = Compare(info, rate, gap);
+        Last = info;
+        LastSamples = samples;
+        FReceived += samples;
+        Seen = true;
+        return lost;
+        }
+
+    //  Status
+    unsigned long long  Gaps() const
+        {  return FGaps;  }
+    unsigned long long  MissingPackets() const
+        {  return FMissingPackets;  }
+    long long  MissingSamples() const
+        {  return FMissingSamples;  }
+    unsigned long long  Received() const
+        {  return FReceived;  }
+
+private:
+    bool                Seen;
+    VitaPacketInfo      Last;
+    size_t              LastSamples;
+    double              TicksPerSample;     // Learned timestamp spacing, 0 = not yet
+    unsigned long long  FReceived;
+    unsigned long long  FGaps;
+    unsigned long long  FMissingPackets;
+    long long           FMissingSamples;
+
+    bool  Compare(const VitaPacketInfo & info, double rate, VitaGap & gap);
+    static bool  Elapsed(const VitaPacketInfo & from, const VitaPacketInfo & to,
+                         double rate, double & ticks);
+};
+
+#endif
@@ -0,0 +1,127 @@
+// VitaSynth.cpp
+//
+// Synthetic VITA packet generator for board-free testing and benchmarks
+
+#include "VitaSynth.h"
+#include "VitaHeader.h"
+#include <algorithm>
+
+//===========================================================================
+//  CLASS VitaSynth  -- Build X6-style VITA packet buffers in software
+//===========================================================================
+//---------------------------------------------------------------------------
+//  constructor for class VitaSynth
+//---------------------------------------------------------------------------
+
+VitaSynth::VitaSynth(unsigned int channels, size_t packet_bytes, unsigned int first_sid)
+    : FPattern(pSawtooth), FSampleRate(1.0e9), FFirstSid(first_sid),
+      PayloadWords(0), Next(0), FPackets(0),
+      Sample(channels ? channels : 1, 0), Count(channels ? channels : 1, 0),
+      Seed(0x12345678)
+{
+    PacketBytes(packet_bytes);
+}
+
+//---------------------------------------------------------------------------
+//  VitaSynth::PacketBytes() --  Set payload size, clipped to a VITA packet
+//---------------------------------------------------------------------------
+
+void  VitaSynth::PacketBytes(size_t bytes)
+{
+    size_t words = bytes / sizeof(unsigned int);
+    if (words < 1)
+        words = 1;
+    if (words > 0xFFFF - HeaderWords)
+        words = 0xFFFF - HeaderWords;
+    PayloadWords = words;
+}
+
+//---------------------------------------------------------------------------
+//  VitaSynth::Reset() --  Restart counters and patterns
+//---------------------------------------------------------------------------
+
+void  VitaSynth::Reset()
+{
+    Next = 0;
+    FPackets = 0;
+    Seed = 0x12345678;
+    std::fill(Sample.begin(), Sample.end(), 0ULL);
+    std::fill(Count.begin(), Count.end(), 0u);
+}
+
+//---------------------------------------------------------------------------
+//  VitaSynth::Value() --  Sample value for channel 'ch' at index 'n'
+//---------------------------------------------------------------------------
+
+short  VitaSynth::Value(unsigned int ch, unsigned long long n)
+{
+    switch (FPattern)
+        {
+        case pNoise:
+            Seed ^= Seed << 13;
+            Seed ^= Seed >> 17;
+            Seed ^= Seed << 5;
+            return static_cast<short>((Seed & 0x3FFF) - 0x2000);
+
+        case pCounter:
+            return static_cast<short>(n + (ch << 12));
+
+        case pSawtooth:
+        default:
+            //  14-bit ramp, as the input test generator produces
+            return static_cast<short>((static_cast<unsigned int>(n) & 0x3FFF) - 0x2000);
+        }
+}
+
+//---------------------------------------------------------------------------
+//  VitaSynth::Generate() --  Append packets to a buffer
+//---------------------------------------------------------------------------
+
+size_t  VitaSynth::Generate(std::vector<unsigned int> & buffer, size_t packets)
+{
+    const size_t words = PacketWords();
+    const size_t start = buffer.size();
+    const size_t samples = PayloadWords * sizeof(unsigned int) / sizeof(short);
+    const unsigned long long rate = FSampleRate > 0 ? static_cast<unsigned long long>(FSampleRate) : 1;
+    buffer.resize(start + packets * words);
+
+    unsigned int * p = buffer.empty() ? 0 : &buffer[start];
+    for (size_t i = 0; i < packets; ++i, p += words)
+        {
+        const unsigned int ch = Next;
+        const unsigned long long first = Sample[ch];
+
+        //  Type 1 (IF data w/ SID), class ID, TSI=UTC, TSF=sample count
+        p[0] = Vita::MakeHeader(1, true, false, 1, 1, Count[ch], static_cast<unsigned int>(words));
+        p[1] = FFirstSid + ch;
+        p[2] = 0;
+        p[3] = 0;
+        p[4] = static_cast<unsigned int>(first / rate);
+        p[5] = 0;
+        p[6] = static_cast<unsigned int>(first % rate);
+
+        short * payload = reinterpret_cast<short *>(p + HeaderWords);
+        for (size_t s = 0; s < samples; ++s)
+            payload[s] = Value(ch, first + s);
+
+        Sample[ch] += samples;
+        Count[ch] = (Count[ch] + 1) & 0xF;
+        Next = (Next + 1) % Channels();
+        ++FPackets;
+        }
+
+    return packets * words;
+}
+
+//---------------------------------------------------------------------------
+//  VitaSynth::Fill() --  Replace buffer contents with up to 'bytes' of packets
+//---------------------------------------------------------------------------
+
+size_t  VitaSynth::Fill(std::vector<unsigned int> & buffer, size_t bytes)
+{
+    size_t packets = bytes / (PacketWords() * sizeof(unsigned int));
+    if (!packets)
+        packets = 1;
+    buffer.clear();
+    return Generate(buffer, packets);
+}
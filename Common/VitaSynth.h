@@ -0,0 +1,66 @@
+// VitaSynth.h
+//
+// Synthetic VITA packet generator for board-free testing and benchmarks
+
+#ifndef VitaSynthH
+#define VitaSynthH
+
+#include <vector>
+#include <cstddef>
+
+//===========================================================================
+//  CLASS VitaSynth  -- Build X6-style VITA packet buffers in software
+//===========================================================================
+//  Packets are emitted round-robin across channels with SIDs FirstSid+ch,
+//  a 7 word header (SID, class ID, integer and sample-count timestamps) and
+//  int16 payload, as the X6 input stream does.
+
+class VitaSynth
+{
+public:
+    enum IIPattern { pSawtooth, pNoise, pCounter };
+
+    VitaSynth(unsigned int channels = 2, size_t packet_bytes = 0x10000,
+              unsigned int first_sid = 0x100);
+
+    //  Properties
+    void  Pattern(IIPattern p)
+        {  FPattern = p;  }
+    void  SampleRate(double rate)
+        {  FSampleRate = rate;  }
+    void  PacketBytes(size_t bytes);
+    size_t  PacketBytes() const
+        {  return PayloadWords * sizeof(unsigned int);  }
+    size_t  PacketWords() const
+        {  return PayloadWords + HeaderWords;  }
+    unsigned int  Channels() const
+        {  return static_cast<unsigned int>(Sample.size());  }
+    unsigned int  FirstSid() const
+        {  return FFirstSid;  }
+    unsigned long long  Packets() const
+        {  return FPackets;  }
+
+    //  Append 'packets' packets to 'buffer'.  Returns words appended.
+    size_t  Generate(std::vector<unsigned int> & buffer, size_t packets);
+    //  Replace 'buffer' with whole packets totalling at most 'bytes'
+    size_t  Fill(std::vector<unsigned int> & buffer, size_t bytes);
+    //  Restart counters and patterns
+    void  Reset();
+
+    enum { HeaderWords = 7 };
+
+private:
+    IIPattern                       FPattern;
+    double                          FSampleRate;
+    unsigned int                    FFirstSid;
+    size_t                          PayloadWords;
+    unsigned int                    Next;           // Next channel to emit
+    unsigned long long              FPackets;
+    std::vector<unsigned long long> Sample;         // Per channel sample index
+    std::vector<unsigned int>       Count;          // Per channel packet count
+    unsigned int                    Seed;
+
+    short  Value(unsigned int ch, unsigned long long n);
+};
+
+#endif
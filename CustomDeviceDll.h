@@ -25,6 +25,63 @@ extern "C"
 #else
 #define EXPORT MODE EXTERN_C _stdcall
 #endif
+//
+//  Output of Parse(), as ApplicationIo::IIParseMode
+//
+typedef enum
+{
+	PARSE_WORKSPACE = 0,    // ch<n> arrays in the MATLAB workspace
+	PARSE_FILES     = 1,    // Parse.ch<n> files in ExportFormat
+	PARSE_SCAN      = 2,    // Index and report only
+	PARSE_STREAM    = 3     // Parse.ch<n> files from a file of any size
+} ParseMode;
+
+//
+//  Ingest instrumentation snapshot, see ingestStats()
+//
+#define INGEST_STATS_STREAMS 16
+
+typedef struct
+{
+	double  Count;
+	double  Min;
+	double  Mean;
+	double  P50;
+	double  P90;
+	double  P99;
+	double  P999;
+	double  P9999;
+	double  Max;
+} HistogramSummary;
+
+typedef struct
+{
+	double              Seconds;            // Since stream start or last reset
+	double              BlockRate;          // MB/s, averaged as the status timer shows it
+	double              Buffers;            // Buffers delivered to the workers, live or replayed
+	double              Bytes;
+	double              QueueDrops;         // Buffers lost to full worker queues
+	double              QueueHighWater;     // Deepest worker queue seen
+	double              QueueCapacity;
+	HistogramSummary    InterArrivalUs;     // Between stream callbacks
+	HistogramSummary    ChannelizeUs;       // Demultiplexing one buffer
+	HistogramSummary    QueueWaitUs;        // Callback to worker pickup
+	HistogramSummary    BufferBytes;        // Bytes per received buffer
+	int                 Streams;
+	unsigned int        StreamSid[INGEST_STATS_STREAMS];
+	double              StreamPackets[INGEST_STATS_STREAMS];
+	double              StreamBytes[INGEST_STATS_STREAMS];      // Stored
+	double              StreamOverflow[INGEST_STATS_STREAMS];   // Refused, destination full
+	double              StreamGaps[INGEST_STATS_STREAMS];       // Discontinuities seen
+	double              StreamLostPackets[INGEST_STATS_STREAMS];
+	double              StreamLostSamples[INGEST_STATS_STREAMS];
+	HistogramSummary    DiskWriteUs;        // One disk log block write
+	double              DiskBytes;          // Written to the disk log
+	double              DiskDropped;        // Refused by the disk log, pool full
+	HistogramSummary    PacketRouteUs;      // Demultiplexing one packet
+	HistogramSummary    PacketBytes;        // Bytes per packet stored
+} IngestStatsSnapshot;
+
 //
 //  Prototypes
 //
@@ -36,12 +93,29 @@ int EXPORT deviceOpen(int target);
 int EXPORT deviceClose(int target);
 int EXPORT startStream(int target);
 int EXPORT stopStream(int target);
-int EXPORT Parse(int target, int ohhgod);
+//  -1 for a mode outside ParseMode, or if parsing throws
+int EXPORT Parse(int target, ParseMode mode);
+//  Frames firstFrame.. of each channel in channelMask (bit n = channel n),
+//  read through Data.vidx; outBuffer holds count*FrameSize per channel.
+//  Returns frames found, -1 on error, or if the log was indexed with
+//  another FrameSize or PackedLanes.  file may be 0 for Data.bin.
+long long EXPORT extractFrames(int target, const char *file, long long firstFrame, int count,
+							   unsigned int channelMask, short *outBuffer);
 int EXPORT arrayTest(int target);
 int EXPORT Vpp(int target);
 bool EXPORT dlc(int target);
 int EXPORT loadSettings(int target);
 int EXPORT setParams(int target, const char *param, double value);
+int EXPORT benchmark(int target, int mode);
+int EXPORT replay(int target, const char *file, double speed, int loops);
+int EXPORT freezeCapture(int target, int postFrames);
+int EXPORT thawCapture(int target);
+int EXPORT snapshotCapture(int target, int frames);
+//  Capture channel into buffer (e.g. a libpointer) from the next start on.
+//  The only copy-free capture: ch<n>d is published with mexPutVariable,
+//  which copies.  buffer 0 detaches.
+int EXPORT attachCapture(int target, int channel, short *buffer, long long samples);
+int EXPORT ingestStats(int target, IngestStatsSnapshot *stats, int reset);
 
 
 
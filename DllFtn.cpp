@@ -169,12 +169,37 @@ int EXPORT stopStream(int target)
 	return 0;
 }
 
-int EXPORT Parse(int target,int ohhgod)
+int EXPORT Parse(int target, ParseMode mode)
 {
-	Io[target]->ParseFile(ohhgod);
+	if (mode < PARSE_WORKSPACE || mode > PARSE_STREAM)
+		return -1;
+	try
+	{
+		Io[target]->ParseFile(static_cast<ApplicationIo::IIParseMode>(mode));
+	}
+	catch (...)
+	{
+		return -1;
+	}
 	return 0;
 }
 
+long long EXPORT extractFrames(int target, const char *file, long long firstFrame, int count,
+							   unsigned int channelMask, short *outBuffer)
+{
+	if (firstFrame < 0 || count < 0 || (count && !outBuffer))
+		return -1;
+	try
+	{
+		return Io[target]->ExtractFrames(file ? file : "", static_cast<unsigned long long>(firstFrame),
+										 static_cast<size_t>(count), channelMask, outBuffer);
+	}
+	catch (...)
+	{
+		return -1;
+	}
+}
+
 int EXPORT arrayTest(int target)
 {
 	Io[target]->testArray();
@@ -205,4 +230,152 @@ int EXPORT setParams(int target, const char *param, double value)
 {
 	Io[target]->setParameters(param,value);
 	return 0;
-}
\ No newline at end of file
+}
+
+int EXPORT benchmark(int target, int mode)
+{
+	try
+	{
+		Io[target]->Benchmark(mode);
+	}
+	catch (...)
+	{
+		return -1;
+	}
+	return 0;
+}
+
+int EXPORT replay(int target, const char *file, double speed, int loops)
+{
+	try
+	{
+		Io[target]->Replay(file ? file : "", speed, loops);
+	}
+	catch (...)
+	{
+		return -1;
+	}
+	return 0;
+}
+
+int EXPORT freezeCapture(int target, int postFrames)
+{
+	try
+	{
+		Io[target]->FreezeCapture(postFrames);
+	}
+	catch (...)
+	{
+		return -1;
+	}
+	return 0;
+}
+
+int EXPORT thawCapture(int target)
+{
+	try
+	{
+		Io[target]->ThawCapture();
+	}
+	catch (...)
+	{
+		return -1;
+	}
+	return 0;
+}
+
+int EXPORT snapshotCapture(int target, int frames)
+{
+	try
+	{
+		return static_cast<int>(Io[target]->SnapshotCapture(std::max(frames, 0)));
+	}
+	catch (...)
+	{
+		return -1;
+	}
+}
+
+int EXPORT attachCapture(int target, int channel, short *buffer, long long samples)
+{
+	if (channel < 0 || samples < 0)
+		return -1;
+	try
+	{
+		Io[target]->AttachCapture(channel, buffer, static_cast<size_t>(samples));
+	}
+	catch (...)
+	{
+		return -1;
+	}
+	return 0;
+}
+
+static void Summarize(const LatencyHistogram & h, double scale, HistogramSummary & out)
+{
+	out.Count = static_cast<double>(h.Count());
+	out.Min   = h.Min() * scale;
+	out.Mean  = h.Mean() * scale;
+	out.P50   = h.Percentile(50.0) * scale;
+	out.P90   = h.Percentile(90.0) * scale;
+	out.P99   = h.Percentile(99.0) * scale;
+	out.P999  = h.Percentile(99.9) * scale;
+	out.P9999 = h.Percentile(99.99) * scale;
+	out.Max   = h.Max() * scale;
+}
+
+int EXPORT ingestStats(int target, IngestStatsSnapshot *stats, int reset)
+{
+	if (!stats)
+		return -1;
+	try
+	{
+		ApplicationIo & io = *Io[target];
+		IngestStats & s = io.Stats();
+		IngestStatsSnapshot snap = IngestStatsSnapshot();
+
+		snap.Seconds = s.Seconds();
+		snap.BlockRate = io.BlockRate();
+		snap.Buffers = static_cast<double>(s.BufferBytes.Count());
+		snap.Bytes = static_cast<double>(s.BufferBytes.Sum());
+		snap.QueueDrops = static_cast<double>(io.IngestDrops());
+		for (unsigned int w = 0; w < io.IngestWorkers(); ++w)
+		{
+			QueueStatus q = io.IngestStatus(w);
+			snap.QueueHighWater = std::max(snap.QueueHighWater, static_cast<double>(q.HighWater));
+			snap.QueueCapacity = static_cast<double>(q.Capacity);
+		}
+		Summarize(s.InterArrival, 1.0e-3, snap.InterArrivalUs);
+		Summarize(s.Channelize, 1.0e-3, snap.ChannelizeUs);
+		Summarize(s.QueueWait, 1.0e-3, snap.QueueWaitUs);
+		Summarize(s.BufferBytes, 1.0, snap.BufferBytes);
+		Summarize(s.DiskWrite, 1.0e-3, snap.DiskWriteUs);
+		Summarize(s.PacketRoute, 1.0e-3, snap.PacketRouteUs);
+		Summarize(s.PacketBytes, 1.0, snap.PacketBytes);
+		snap.DiskBytes = static_cast<double>(io.DiskLog().Written() + io.SegmentLog().Written());
+		snap.DiskDropped = static_cast<double>(io.DiskLog().Dropped() + io.SegmentLog().Dropped());
+
+		std::vector<VitaDemux::Totals> totals;
+		io.StreamCounters(totals);
+		for (size_t i = 0; i < totals.size() && i < INGEST_STATS_STREAMS; ++i)
+		{
+			snap.StreamSid[i] = totals[i].Sid;
+			snap.StreamPackets[i] = static_cast<double>(totals[i].Packets);
+			snap.StreamBytes[i] = static_cast<double>(totals[i].Filled);
+			snap.StreamOverflow[i] = static_cast<double>(totals[i].Overflow);
+			snap.StreamGaps[i] = static_cast<double>(totals[i].Gaps);
+			snap.StreamLostPackets[i] = static_cast<double>(totals[i].MissingPackets);
+			snap.StreamLostSamples[i] = static_cast<double>(totals[i].MissingSamples);
+			snap.Streams = static_cast<int>(i + 1);
+		}
+
+		*stats = snap;
+		if (reset)
+			s.Reset();
+	}
+	catch (...)
+	{
+		return -1;
+	}
+	return 0;
+}